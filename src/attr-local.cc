@@ -0,0 +1,507 @@
+/**
+ * @file attr-local.cc
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "local-fs.h"
+#include "attr-local.h"
+
+using namespace std;
+
+
+#define DENTS_BUFFER_SIZE  (64 * 1024)
+
+
+/**
+ * A directory being changed. The root stands for the directories holding
+ * the top level paths.
+ */
+struct AttrDir
+{
+    AttrDir *parent;            // NULL for the root
+    gchar *path;
+    gint pending;               // subdirectories not done yet, plus one while the directory is read
+    gint depth;                 // directories above it held open by the same worker
+    gboolean change_after;      // changed once everything in it is
+    struct stat st;
+};
+
+
+struct AttrTask
+{
+    AttrDir *dir;
+    gchar *path;
+    gboolean top;               // a top level path, not looked at yet
+    struct stat st;
+};
+
+
+struct AttrLocalJob
+{
+    GThreadPool *pool;
+    AttrLocalChange change;
+    gboolean recursive;
+
+    gint cancelled;
+    gboolean done;
+
+    GMutex lock;                // for everything below
+    GCond done_cond;
+
+    guint64 files;
+    guint64 changed;
+    guint n_errors;
+    gchar *error_path;
+    gint error;
+};
+
+
+#ifdef SYS_getdents64
+// what getdents64() returns, glibc has no declaration of it
+struct DirEntry64
+{
+    guint64 d_ino;
+    gint64 d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+#endif
+
+
+static void change_dir (AttrLocalJob *job, AttrDir *parent, gint at_fd, const gchar *name, const struct stat &st, gboolean follow);
+
+
+inline gboolean is_cancelled (AttrLocalJob *job)
+{
+    return g_atomic_int_get (&job->cancelled);
+}
+
+
+/**
+ * Returns the path of entry @a name in @a dir, which is @a name itself
+ * for the top level paths.
+ */
+inline gchar *entry_path (AttrDir *dir, gint at_fd, const gchar *name)
+{
+    return at_fd==AT_FDCWD ? g_strdup (name) : g_build_filename (dir->path, name, NULL);
+}
+
+
+inline void count_files (AttrLocalJob *job, guint64 files, guint64 changed)
+{
+    if (!files && !changed)
+        return;
+
+    g_mutex_lock (&job->lock);
+    job->files += files;
+    job->changed += changed;
+    g_mutex_unlock (&job->lock);
+}
+
+
+static void add_error (AttrLocalJob *job, AttrDir *dir, gint at_fd, const gchar *name, gint error)
+{
+    g_mutex_lock (&job->lock);
+
+    if (!job->n_errors++)
+    {
+        job->error_path = entry_path (dir, at_fd, name);
+        job->error = error;
+    }
+
+    g_mutex_unlock (&job->lock);
+}
+
+
+/**
+ * Returns TRUE if a directory with the new mode can't be read and entered
+ * by its owner anymore, so it has to wait until everything in it is done.
+ */
+inline gboolean locks_owner_out (AttrLocalJob *job)
+{
+    return job->change.set_mode && (job->change.mode & (S_IRUSR | S_IXUSR))!=(S_IRUSR | S_IXUSR);
+}
+
+
+/**
+ * Changes entry @a name of @a dir, open as @a at_fd, which has the
+ * attributes in @a st now. Returns TRUE if anything was changed.
+ */
+static gboolean change_entry (AttrLocalJob *job, AttrDir *dir, gint at_fd, const gchar *name, const struct stat &st)
+{
+    const AttrLocalChange &c = job->change;
+    gboolean changed = FALSE;
+
+    // first, as changing the owner may clear the set-user-ID and set-group-ID bits
+    if (c.set_owner && ((c.uid!=(uid_t) -1 && st.st_uid!=c.uid) || (c.gid!=(gid_t) -1 && st.st_gid!=c.gid)))
+    {
+        if (fchownat (at_fd, name, c.uid, c.gid, 0)!=0)
+        {
+            add_error (job, dir, at_fd, name, errno);
+            return FALSE;
+        }
+
+        changed = TRUE;
+    }
+
+    if (c.set_mode && (S_ISDIR (st.st_mode) || !c.dirs_only) && (changed || (st.st_mode & 07777)!=c.mode))
+    {
+        if (fchmodat (at_fd, name, c.mode, 0)!=0)
+        {
+            add_error (job, dir, at_fd, name, errno);
+            return changed;
+        }
+
+        changed = TRUE;
+    }
+
+    return changed;
+}
+
+
+static void finish_dir (AttrLocalJob *job, AttrDir *dir)
+{
+    if (!g_atomic_int_dec_and_test (&dir->pending))
+        return;
+
+    AttrDir *parent = dir->parent;
+
+    if (parent && dir->change_after && !is_cancelled (job))
+        count_files (job, 0, change_entry (job, parent, AT_FDCWD, dir->path, dir->st));
+
+    g_free (dir->path);
+    g_free (dir);
+
+    if (parent)
+    {
+        finish_dir (job, parent);
+        return;
+    }
+
+    g_mutex_lock (&job->lock);
+    job->done = TRUE;
+    g_cond_broadcast (&job->done_cond);
+    g_mutex_unlock (&job->lock);
+}
+
+
+static void push_task (AttrLocalJob *job, AttrDir *dir, gchar *path, gboolean top, const struct stat *st)
+{
+    AttrTask *task = g_new0 (AttrTask, 1);
+
+    task->dir = dir;
+    task->path = path;
+    task->top = top;
+
+    if (st)
+        task->st = *st;
+
+    g_thread_pool_push (job->pool, task, NULL);
+}
+
+
+/**
+ * Changes entry @a name of @a dir, which is open as @a at_fd, and counts
+ * it in @a files and @a changed. @a type is its d_type, if known.
+ */
+static void visit_entry (AttrLocalJob *job, AttrDir *dir, gint at_fd, const gchar *name, guchar type,
+                         guint64 &files, guint64 &changed)
+{
+    // symbolic links are neither followed nor changed, nor are files if only directories are
+    if (type==DT_LNK)
+        return;
+
+    if (type!=DT_UNKNOWN && type!=DT_DIR && job->change.dirs_only && !job->change.set_owner)
+    {
+        files++;
+        return;
+    }
+
+    struct stat st;
+
+    if (fstatat (at_fd, name, &st, AT_SYMLINK_NOFOLLOW)!=0)
+    {
+        if (errno!=ENOENT)
+            add_error (job, dir, at_fd, name, errno);
+        return;
+    }
+
+    if (S_ISLNK (st.st_mode))
+        return;
+
+    files++;
+
+    if (!S_ISDIR (st.st_mode))
+    {
+        if (change_entry (job, dir, at_fd, name, st))
+            changed++;
+        return;
+    }
+
+    g_atomic_int_inc (&dir->pending);
+
+    // handed out only to idle workers, or when too many directories are open
+    if (g_thread_pool_unprocessed (job->pool)<ATTR_LOCAL_QUEUE_MAX || dir->depth>=ATTR_LOCAL_DEPTH_MAX)
+        push_task (job, dir, g_build_filename (dir->path, name, NULL), FALSE, &st);
+    else
+        change_dir (job, dir, at_fd, name, st, FALSE);
+}
+
+
+/**
+ * Changes the entries of @a dir, open as @a fd, and closes it.
+ */
+static void read_dir (AttrLocalJob *job, AttrDir *dir, gint fd)
+{
+    guint64 files = 0;
+    guint64 changed = 0;
+
+#ifdef SYS_getdents64
+    gchar *buf = (gchar *) g_malloc (DENTS_BUFFER_SIZE);
+
+    while (!is_cancelled (job))
+    {
+        long n = syscall (SYS_getdents64, fd, buf, DENTS_BUFFER_SIZE);
+
+        if (n<0 && errno==EINTR)
+            continue;
+
+        if (n<0)
+            add_error (job, dir->parent, AT_FDCWD, dir->path, errno);
+
+        if (n<=0)
+            break;
+
+        for (long pos=0; pos<n && !is_cancelled (job); )
+        {
+            DirEntry64 *e = (DirEntry64 *) (buf + pos);
+
+            pos += e->d_reclen;
+
+            if (!is_dot_or_dotdot (e->d_name))
+                visit_entry (job, dir, fd, e->d_name, e->d_type, files, changed);
+        }
+
+        count_files (job, files, changed);
+        files = changed = 0;
+    }
+
+    g_free (buf);
+    close (fd);
+#else
+    DIR *d = fdopendir (fd);
+
+    if (!d)
+    {
+        add_error (job, dir->parent, AT_FDCWD, dir->path, errno);
+        close (fd);
+        return;
+    }
+
+    while (struct dirent *e = !is_cancelled (job) ? readdir (d) : NULL)
+        if (!is_dot_or_dotdot (e->d_name))
+            visit_entry (job, dir, fd, e->d_name, e->d_type, files, changed);
+
+    count_files (job, files, changed);
+    closedir (d);
+#endif
+}
+
+
+/**
+ * Changes the directory @a name of @a parent, which is open as @a at_fd
+ * and has the attributes in @a st now, with everything in it. Only the
+ * top level paths are @a follow ed if they are symbolic links.
+ */
+static void change_dir (AttrLocalJob *job, AttrDir *parent, gint at_fd, const gchar *name, const struct stat &st, gboolean follow)
+{
+    AttrDir *dir = g_new0 (AttrDir, 1);
+
+    dir->parent = parent;
+    dir->path = entry_path (parent, at_fd, name);
+    dir->pending = 1;
+    dir->depth = at_fd==AT_FDCWD ? 0 : parent->depth + 1;
+    dir->st = st;
+    dir->change_after = locks_owner_out (job);
+
+    if (!dir->change_after && change_entry (job, parent, at_fd, name, st))
+        count_files (job, 0, 1);
+
+    gint fd = openat (at_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC | (follow ? 0 : O_NOFOLLOW));
+
+    if (fd>=0)
+        read_dir (job, dir, fd);
+    else
+        if (errno!=ENOENT)
+            add_error (job, parent, at_fd, name, errno);
+
+    finish_dir (job, dir);
+}
+
+
+static void run_task (AttrTask *task, AttrLocalJob *job)
+{
+    // change_dir() finishes the directory of the task once the new one is done
+    if (is_cancelled (job))
+        finish_dir (job, task->dir);
+    else
+        if (!task->top)
+            change_dir (job, task->dir, AT_FDCWD, task->path, task->st, FALSE);
+        else
+            if (stat (task->path, &task->st)!=0)
+            {
+                add_error (job, task->dir, AT_FDCWD, task->path, errno);
+                finish_dir (job, task->dir);
+            }
+            else
+            {
+                count_files (job, 1, 0);
+
+                if (job->recursive && S_ISDIR (task->st.st_mode))
+                    change_dir (job, task->dir, AT_FDCWD, task->path, task->st, TRUE);
+                else
+                {
+                    count_files (job, 0, change_entry (job, task->dir, AT_FDCWD, task->path, task->st));
+                    finish_dir (job, task->dir);
+                }
+            }
+
+    g_free (task->path);
+    g_free (task);
+}
+
+
+AttrLocalJob *attr_local_job_new (GList *paths, const AttrLocalChange *change, gboolean recursive)
+{
+    g_return_val_if_fail (change != NULL, NULL);
+
+    AttrLocalJob *job = g_new0 (AttrLocalJob, 1);
+
+    job->change = *change;
+    job->change.mode &= 07777;
+    job->recursive = recursive;
+
+    g_mutex_init (&job->lock);
+    g_cond_init (&job->done_cond);
+
+    AttrDir *root = g_new0 (AttrDir, 1);
+
+    root->pending = 1;
+
+    job->pool = g_thread_pool_new ((GFunc) run_task, job, ATTR_LOCAL_THREADS, FALSE, NULL);
+
+    for (GList *i = paths; i; i = i->next)
+    {
+        g_atomic_int_inc (&root->pending);
+        push_task (job, root, g_strdup ((const gchar *) i->data), TRUE, NULL);
+    }
+
+    finish_dir (job, root);
+
+    return job;
+}
+
+
+gboolean attr_local_job_get_progress (AttrLocalJob *job, guint64 *files, guint64 *changed)
+{
+    g_return_val_if_fail (job != NULL, TRUE);
+
+    g_mutex_lock (&job->lock);
+
+    if (files)
+        *files = job->files;
+    if (changed)
+        *changed = job->changed;
+
+    gboolean done = job->done;
+
+    g_mutex_unlock (&job->lock);
+
+    return done;
+}
+
+
+guint attr_local_job_get_errors (AttrLocalJob *job, gchar **path, gint *error)
+{
+    g_return_val_if_fail (job != NULL, 0);
+
+    g_mutex_lock (&job->lock);
+
+    guint n_errors = job->n_errors;
+
+    if (path)
+        *path = g_strdup (job->error_path);
+    if (error)
+        *error = job->error;
+
+    g_mutex_unlock (&job->lock);
+
+    return n_errors;
+}
+
+
+void attr_local_job_cancel (AttrLocalJob *job)
+{
+    g_return_if_fail (job != NULL);
+
+    g_atomic_int_set (&job->cancelled, TRUE);
+}
+
+
+void attr_local_job_wait (AttrLocalJob *job)
+{
+    g_return_if_fail (job != NULL);
+
+    g_mutex_lock (&job->lock);
+
+    while (!job->done)
+        g_cond_wait (&job->done_cond, &job->lock);
+
+    g_mutex_unlock (&job->lock);
+}
+
+
+void attr_local_job_free (AttrLocalJob *job)
+{
+    if (!job)
+        return;
+
+    if (!attr_local_job_get_progress (job, NULL, NULL))
+    {
+        attr_local_job_cancel (job);
+        attr_local_job_wait (job);
+    }
+
+    g_thread_pool_free (job->pool, FALSE, TRUE);
+
+    g_mutex_clear (&job->lock);
+    g_cond_clear (&job->done_cond);
+
+    g_free (job->error_path);
+    g_free (job);
+}
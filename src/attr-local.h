@@ -0,0 +1,96 @@
+/**
+ * @file attr-local.h
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <sys/types.h>
+
+#define ATTR_LOCAL_THREADS      8
+#define ATTR_LOCAL_QUEUE_MAX    ATTR_LOCAL_THREADS      // directories waiting for a worker, the others are done by the worker finding them
+#define ATTR_LOCAL_DEPTH_MAX    64                      // directories open at once in a worker
+
+/**
+ * Changes the permissions and owners of local files and directory trees
+ * natively.
+ *
+ * Directories are read with getdents64() and their entries are looked at
+ * and changed with fstatat(), fchmodat() and fchownat() relative to the
+ * open directory. Entries which have the attributes already are left
+ * alone. Subdirectories are handed to a bounded thread pool while it has
+ * idle workers, so independent subtrees are done in parallel; otherwise
+ * the worker finding them goes on depth first.
+ *
+ * The top level paths are changed even if they are symbolic links, which
+ * are followed, while links below them are skipped. A directory whose new
+ * mode would lock its owner out is changed after everything in it.
+ *
+ * The job never blocks its caller, its progress is polled. Errors don't
+ * stop it, they are counted and the first one is kept.
+ */
+struct AttrLocalJob;
+
+struct AttrLocalChange
+{
+    gboolean set_mode;
+    mode_t mode;                        // the permission bits, 07777
+    gboolean dirs_only;                 // the mode is set for directories only
+
+    gboolean set_owner;
+    uid_t uid;                          // (uid_t) -1 keeps the owner
+    gid_t gid;                          // (gid_t) -1 keeps the group
+};
+
+/**
+ * Starts changing the local paths in @a paths, a list of gchar *, as
+ * @a change says. With @a recursive everything below them is changed as
+ * well.
+ */
+AttrLocalJob *attr_local_job_new (GList *paths, const AttrLocalChange *change, gboolean recursive);
+
+/**
+ * Stores the number of files looked at so far in @a files and the number
+ * of them changed in @a changed, both may be NULL. Returns TRUE once the
+ * job is done.
+ */
+gboolean attr_local_job_get_progress (AttrLocalJob *job, guint64 *files, guint64 *changed);
+
+/**
+ * Returns the number of files that couldn't be changed. @a path, which
+ * may be NULL, gets the path of the first of them and must be freed,
+ * @a error gets its errno value.
+ */
+guint attr_local_job_get_errors (AttrLocalJob *job, gchar **path, gint *error);
+
+/**
+ * Stops as soon as possible. What is changed stays changed.
+ */
+void attr_local_job_cancel (AttrLocalJob *job);
+
+/**
+ * Waits until the job is done.
+ */
+void attr_local_job_wait (AttrLocalJob *job);
+
+/**
+ * Cancels the job if it is still running and frees it.
+ */
+void attr_local_job_free (AttrLocalJob *job);
@@ -0,0 +1,559 @@
+/**
+ * @file delete-local.cc
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include <string>
+#include <vector>
+
+#include "local-fs.h"
+#include "delete-local.h"
+
+using namespace std;
+
+
+#define DENTS_BUFFER_SIZE   (64 * 1024)
+#define DELETE_COUNT_BATCH  1024            // files deleted between updates of the progress
+
+
+/**
+ * A directory being deleted. It is removed once all its entries are,
+ * unless something below it stays. The root stands for the directories
+ * holding the top level paths.
+ */
+struct DeleteDir
+{
+    DeleteDir *parent;          // NULL for the root
+    gchar *path;
+    gint pending;               // subdirectories not done yet, plus one while the directory is read
+    gint depth;                 // directories above it held open by the same worker
+    gint keep;                  // something below was skipped or failed
+    gboolean gone;              // removed by someone else meanwhile
+};
+
+
+struct DeleteTask
+{
+    DeleteDir *dir;
+    gchar *path;
+    guchar type;                // DT_DIR for the directories found, DT_UNKNOWN for the top level paths
+};
+
+
+struct DeleteLocalJob
+{
+    GThreadPool *pool;
+
+    gint cancelled;
+    gboolean done;
+
+    GMutex lock;                // for everything below
+    GCond done_cond;
+
+    guint64 files_deleted;
+
+    GMutex ask_lock;            // one question at a time
+    GCond answer_cond;
+    gboolean asking;
+    gchar *question_path;
+    gint question_error;
+    gint answer;
+};
+
+
+#ifdef SYS_getdents64
+// what getdents64() returns, glibc has no declaration of it
+struct DirEntry64
+{
+    guint64 d_ino;
+    gint64 d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+#endif
+
+
+static void remove_dir (DeleteLocalJob *job, DeleteDir *parent, gint at_fd, const gchar *name);
+
+
+inline gboolean is_cancelled (DeleteLocalJob *job)
+{
+    return g_atomic_int_get (&job->cancelled);
+}
+
+
+/**
+ * Returns the path of entry @a name in @a dir, which is @a name itself
+ * for the top level paths.
+ */
+inline gchar *entry_path (DeleteDir *dir, gint at_fd, const gchar *name)
+{
+    return at_fd==AT_FDCWD ? g_strdup (name) : g_build_filename (dir->path, name, NULL);
+}
+
+
+inline void count_deleted (DeleteLocalJob *job, guint64 n)
+{
+    if (!n)
+        return;
+
+    g_mutex_lock (&job->lock);
+    job->files_deleted += n;
+    g_mutex_unlock (&job->lock);
+}
+
+
+/**
+ * Returns TRUE if the failed operation on @a path should be tried again,
+ * otherwise @a dir is kept. ABORT cancels the job.
+ */
+static gboolean retry_after_error (DeleteLocalJob *job, DeleteDir *dir, const gchar *path, gint error)
+{
+    gint answer = DELETE_LOCAL_ERROR_ACTION_ABORT;
+
+    g_mutex_lock (&job->ask_lock);
+    g_mutex_lock (&job->lock);
+
+    if (!is_cancelled (job))
+    {
+        job->asking = TRUE;
+        job->question_path = g_strdup (path);
+        job->question_error = error;
+        job->answer = -1;
+
+        while (job->answer<0 && !is_cancelled (job))
+            g_cond_wait (&job->answer_cond, &job->lock);
+
+        answer = is_cancelled (job) ? DELETE_LOCAL_ERROR_ACTION_ABORT : job->answer;
+
+        job->asking = FALSE;
+        g_free (job->question_path);
+        job->question_path = NULL;
+    }
+
+    g_mutex_unlock (&job->lock);
+    g_mutex_unlock (&job->ask_lock);
+
+    if (answer==DELETE_LOCAL_ERROR_ACTION_RETRY)
+        return TRUE;
+
+    if (answer==DELETE_LOCAL_ERROR_ACTION_ABORT)
+        delete_local_job_cancel (job);
+
+    g_atomic_int_set (&dir->keep, TRUE);
+
+    return FALSE;
+}
+
+
+static void finish_dir (DeleteLocalJob *job, DeleteDir *dir)
+{
+    if (!g_atomic_int_dec_and_test (&dir->pending))
+        return;
+
+    DeleteDir *parent = dir->parent;
+
+    if (parent)
+    {
+        if (g_atomic_int_get (&dir->keep) || is_cancelled (job))
+            g_atomic_int_set (&parent->keep, TRUE);
+        else
+            while (!dir->gone)
+            {
+                if (rmdir (dir->path)==0)
+                {
+                    count_deleted (job, 1);
+                    break;
+                }
+
+                if (errno==ENOENT || !retry_after_error (job, parent, dir->path, errno))
+                    break;
+            }
+    }
+
+    g_free (dir->path);
+    g_free (dir);
+
+    if (parent)
+    {
+        finish_dir (job, parent);
+        return;
+    }
+
+    g_mutex_lock (&job->lock);
+    job->done = TRUE;
+    g_cond_broadcast (&job->done_cond);
+    g_mutex_unlock (&job->lock);
+}
+
+
+static void push_task (DeleteLocalJob *job, DeleteDir *dir, gchar *path, guchar type)
+{
+    DeleteTask *task = g_new (DeleteTask, 1);
+
+    task->dir = dir;
+    task->path = path;
+    task->type = type;
+
+    g_thread_pool_push (job->pool, task, NULL);
+}
+
+
+/**
+ * Removes entry @a name of @a dir, which is open as @a at_fd, and
+ * counts it in @a n_deleted. @a type is its d_type, if known.
+ */
+static void remove_entry (DeleteLocalJob *job, DeleteDir *dir, gint at_fd, const gchar *name, guchar type, guint64 &n_deleted)
+{
+    if (type==DT_UNKNOWN)
+    {
+        struct stat st;
+
+        type = fstatat (at_fd, name, &st, AT_SYMLINK_NOFOLLOW)==0 && S_ISDIR (st.st_mode) ? DT_DIR : DT_REG;
+    }
+
+    while (type!=DT_DIR)
+    {
+        if (unlinkat (at_fd, name, 0)==0)
+        {
+            n_deleted++;
+            return;
+        }
+
+        gint error = errno;
+
+        if (error==ENOENT)
+            return;
+
+        if (error==EISDIR || error==EPERM)          // EPERM is what POSIX allows for directories
+        {
+            struct stat st;
+
+            if (fstatat (at_fd, name, &st, AT_SYMLINK_NOFOLLOW)==0 && S_ISDIR (st.st_mode))
+            {
+                type = DT_DIR;
+                break;
+            }
+        }
+
+        gchar *path = entry_path (dir, at_fd, name);
+        gboolean retry = retry_after_error (job, dir, path, error);
+
+        g_free (path);
+
+        if (!retry)
+            return;
+    }
+
+    g_atomic_int_inc (&dir->pending);
+
+    // handed out only to idle workers, or when too many directories are open
+    if (at_fd!=AT_FDCWD && (g_thread_pool_unprocessed (job->pool)<DELETE_LOCAL_QUEUE_MAX || dir->depth>=DELETE_LOCAL_DEPTH_MAX))
+        push_task (job, dir, g_build_filename (dir->path, name, NULL), DT_DIR);
+    else
+        remove_dir (job, dir, at_fd, name);
+}
+
+
+/**
+ * Removes the entries of @a dir, open as @a fd, and closes it. The whole
+ * directory is read before anything is removed from it, as removing
+ * entries while it is read can make others be skipped, on NFS especially,
+ * and the directory then can't be removed.
+ */
+static void read_dir (DeleteLocalJob *job, DeleteDir *dir, gint fd)
+{
+    guint64 n_deleted = 0;
+
+#ifdef SYS_getdents64
+    GByteArray *entries = g_byte_array_new ();
+
+    while (!is_cancelled (job))
+    {
+        guint len = entries->len;
+
+        g_byte_array_set_size (entries, len + DENTS_BUFFER_SIZE);
+
+        long n = syscall (SYS_getdents64, fd, entries->data + len, DENTS_BUFFER_SIZE);
+
+        g_byte_array_set_size (entries, len + MAX(n, 0));
+
+        if (n<0 && errno==EINTR)
+            continue;
+
+        if (n<0)
+            g_atomic_int_set (&dir->keep, TRUE);
+
+        if (n<=0)
+            break;
+    }
+
+    for (guint pos=0; pos<entries->len && !is_cancelled (job); )
+    {
+        DirEntry64 *e = (DirEntry64 *) (entries->data + pos);
+
+        pos += e->d_reclen;
+
+        if (!is_dot_or_dotdot (e->d_name))
+            remove_entry (job, dir, fd, e->d_name, e->d_type, n_deleted);
+
+        if (n_deleted>=DELETE_COUNT_BATCH)
+        {
+            count_deleted (job, n_deleted);
+            n_deleted = 0;
+        }
+    }
+
+    count_deleted (job, n_deleted);
+    g_byte_array_free (entries, TRUE);
+    close (fd);
+#else
+    DIR *d = fdopendir (fd);
+
+    if (!d)
+    {
+        g_atomic_int_set (&dir->keep, TRUE);
+        close (fd);
+        return;
+    }
+
+    vector<string> names;
+    vector<guchar> types;
+
+    while (struct dirent *e = !is_cancelled (job) ? readdir (d) : NULL)
+        if (!is_dot_or_dotdot (e->d_name))
+        {
+            names.push_back(e->d_name);
+            types.push_back(e->d_type);
+        }
+
+    for (gsize i=0; i<names.size() && !is_cancelled (job); ++i)
+        remove_entry (job, dir, fd, names[i].c_str(), types[i], n_deleted);
+
+    count_deleted (job, n_deleted);
+    closedir (d);
+#endif
+}
+
+
+/**
+ * Removes the directory @a name of @a parent, which is open as @a at_fd,
+ * with everything in it.
+ */
+static void remove_dir (DeleteLocalJob *job, DeleteDir *parent, gint at_fd, const gchar *name)
+{
+    DeleteDir *dir = g_new0 (DeleteDir, 1);
+
+    dir->parent = parent;
+    dir->path = entry_path (parent, at_fd, name);
+    dir->pending = 1;
+    dir->depth = at_fd==AT_FDCWD ? 0 : parent->depth + 1;
+
+    for (;;)
+    {
+        gint fd = openat (at_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+        if (fd>=0)
+        {
+            read_dir (job, dir, fd);
+            break;
+        }
+
+        if (errno==ENOENT)
+        {
+            dir->gone = TRUE;
+            break;
+        }
+
+        if (!retry_after_error (job, dir, dir->path, errno))
+            break;
+    }
+
+    finish_dir (job, dir);
+}
+
+
+static void run_task (DeleteTask *task, DeleteLocalJob *job)
+{
+    if (is_cancelled (job))
+    {
+        g_atomic_int_set (&task->dir->keep, TRUE);
+        finish_dir (job, task->dir);
+    }
+    else
+        if (task->type==DT_DIR)
+            remove_dir (job, task->dir, AT_FDCWD, task->path);
+        else
+        {
+            guint64 n_deleted = 0;
+
+            remove_entry (job, task->dir, AT_FDCWD, task->path, task->type, n_deleted);
+            count_deleted (job, n_deleted);
+            finish_dir (job, task->dir);
+        }
+
+    g_free (task->path);
+    g_free (task);
+}
+
+
+DeleteLocalJob *delete_local_job_new (GList *paths)
+{
+    DeleteLocalJob *job = g_new0 (DeleteLocalJob, 1);
+
+    g_mutex_init (&job->lock);
+    g_mutex_init (&job->ask_lock);
+    g_cond_init (&job->done_cond);
+    g_cond_init (&job->answer_cond);
+
+    DeleteDir *root = g_new0 (DeleteDir, 1);
+
+    root->pending = 1;
+
+    job->pool = g_thread_pool_new ((GFunc) run_task, job, DELETE_LOCAL_THREADS, FALSE, NULL);
+
+    // each top level path gets a task of its own, which finds out what it is
+    for (GList *i = paths; i; i = i->next)
+    {
+        g_atomic_int_inc (&root->pending);
+        push_task (job, root, g_strdup ((const gchar *) i->data), DT_UNKNOWN);
+    }
+
+    finish_dir (job, root);
+
+    return job;
+}
+
+
+gboolean delete_local_job_get_progress (DeleteLocalJob *job, guint64 *files)
+{
+    g_return_val_if_fail (job != NULL, TRUE);
+
+    g_mutex_lock (&job->lock);
+
+    if (files)
+        *files = job->files_deleted;
+
+    gboolean done = job->done;
+
+    g_mutex_unlock (&job->lock);
+
+    return done;
+}
+
+
+gboolean delete_local_job_get_question (DeleteLocalJob *job, gchar **path, gint *error)
+{
+    g_return_val_if_fail (job != NULL, FALSE);
+
+    g_mutex_lock (&job->lock);
+
+    gboolean asking = job->asking && job->answer<0;
+
+    if (path)
+        *path = asking ? g_strdup (job->question_path) : NULL;
+    if (error)
+        *error = job->question_error;
+
+    g_mutex_unlock (&job->lock);
+
+    return asking;
+}
+
+
+void delete_local_job_answer (DeleteLocalJob *job, gint answer)
+{
+    g_return_if_fail (job != NULL);
+    g_return_if_fail (answer >= 0);
+
+    g_mutex_lock (&job->lock);
+
+    if (job->asking && job->answer<0)
+    {
+        job->answer = answer;
+        g_cond_broadcast (&job->answer_cond);
+    }
+
+    g_mutex_unlock (&job->lock);
+}
+
+
+gboolean delete_local_job_aborted (DeleteLocalJob *job)
+{
+    g_return_val_if_fail (job != NULL, TRUE);
+
+    return is_cancelled (job);
+}
+
+
+void delete_local_job_cancel (DeleteLocalJob *job)
+{
+    g_return_if_fail (job != NULL);
+
+    g_atomic_int_set (&job->cancelled, TRUE);
+
+    // wake up the worker waiting for an answer
+    g_mutex_lock (&job->lock);
+    g_cond_broadcast (&job->answer_cond);
+    g_mutex_unlock (&job->lock);
+}
+
+
+void delete_local_job_wait (DeleteLocalJob *job)
+{
+    g_return_if_fail (job != NULL);
+
+    g_mutex_lock (&job->lock);
+
+    while (!job->done)
+        g_cond_wait (&job->done_cond, &job->lock);
+
+    g_mutex_unlock (&job->lock);
+}
+
+
+void delete_local_job_free (DeleteLocalJob *job)
+{
+    if (!job)
+        return;
+
+    if (!delete_local_job_get_progress (job, NULL))
+    {
+        delete_local_job_cancel (job);
+        delete_local_job_wait (job);
+    }
+
+    g_thread_pool_free (job->pool, FALSE, TRUE);
+
+    g_mutex_clear (&job->lock);
+    g_mutex_clear (&job->ask_lock);
+    g_cond_clear (&job->done_cond);
+    g_cond_clear (&job->answer_cond);
+
+    g_free (job);
+}
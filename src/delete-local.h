@@ -0,0 +1,99 @@
+/**
+ * @file delete-local.h
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#define DELETE_LOCAL_THREADS    8
+#define DELETE_LOCAL_QUEUE_MAX  DELETE_LOCAL_THREADS    // directories waiting for a worker, the others are removed by the worker finding them
+#define DELETE_LOCAL_DEPTH_MAX  64                      // directories open at once in a worker
+
+/**
+ * Deletes local files and directory trees natively.
+ *
+ * Each directory is read in large batches with getdents64() and its
+ * entries are removed with unlinkat() relative to the open directory, so
+ * no path is looked up again. Subdirectories are handed to a bounded
+ * thread pool while it has idle workers, so independent subtrees are
+ * removed in parallel; otherwise the worker finding them goes on depth
+ * first, which keeps the directories it touches close together. A
+ * directory is removed once everything below it is gone. Symbolic links
+ * are removed, never followed.
+ *
+ * The job never blocks its caller: the number of files deleted so far is
+ * polled, and so are the questions about errors, which a worker waits on
+ * until they are answered.
+ */
+struct DeleteLocalJob;
+
+// same values as GnomeVFSXferErrorAction
+enum DeleteLocalErrorAction
+{
+    DELETE_LOCAL_ERROR_ACTION_ABORT,
+    DELETE_LOCAL_ERROR_ACTION_RETRY,
+    DELETE_LOCAL_ERROR_ACTION_SKIP
+};
+
+/**
+ * Starts deleting the local paths in @a paths, a list of gchar *.
+ */
+DeleteLocalJob *delete_local_job_new (GList *paths);
+
+/**
+ * Stores the number of files deleted so far in @a files, each directory
+ * counts as one file. Returns TRUE once the job is done.
+ */
+gboolean delete_local_job_get_progress (DeleteLocalJob *job, guint64 *files);
+
+/**
+ * Returns TRUE if a worker is waiting for an answer about an error.
+ * @a path, which may be NULL, gets the path it is about and must be
+ * freed, @a error gets its errno value.
+ */
+gboolean delete_local_job_get_question (DeleteLocalJob *job, gchar **path, gint *error);
+
+/**
+ * Answers the pending question with a DeleteLocalErrorAction. Answering
+ * with ABORT cancels the job.
+ */
+void delete_local_job_answer (DeleteLocalJob *job, gint answer);
+
+/**
+ * Returns TRUE if the job was cancelled or aborted.
+ */
+gboolean delete_local_job_aborted (DeleteLocalJob *job);
+
+/**
+ * Stops deleting as soon as possible. What is deleted stays deleted.
+ */
+void delete_local_job_cancel (DeleteLocalJob *job);
+
+/**
+ * Waits until the job is done. Questions must be answered meanwhile by
+ * another thread, or the job cancelled first.
+ */
+void delete_local_job_wait (DeleteLocalJob *job);
+
+/**
+ * Cancels the job if it is still running and frees it.
+ */
+void delete_local_job_free (DeleteLocalJob *job);
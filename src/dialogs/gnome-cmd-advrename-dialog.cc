@@ -42,6 +42,10 @@
 using namespace std;
 
 
+#define PREVIEW_SLICE_USEC  10000       // time spent on the new names at once, before the main loop goes on
+#define PREFETCH_POLL_MSEC  100         // how often the preview looks whether the tags it needs have been read
+
+
 struct GnomeCmdAdvrenameDialogClass
 {
     GtkDialogClass parent_class;
@@ -57,9 +61,26 @@ struct GnomeCmdAdvrenameDialog::Private
     GtkWidget *files_view;
     GtkWidget *profile_menu_button;
 
+    guint preview_id;                           // idle source computing the new names of the rows not shown, or the timeout waiting for their tags
+    gint preview_row;                           // the next row it computes
+    gint shown_first, shown_last;               // the rows computed before it started
+    vector<GnomeCmd::RegexReplace *> preview_rx;
+
+    TagCacheJob *prefetch_job;                  // reads the tags of the files in the background
+    int prefetch_classes;                       // the tag classes it reads
+
     Private();
     ~Private();
 
+    void set_new_filename(GtkTreeModel *files, GtkTreeIter *iter, gint row);
+    void stop_preview();
+    void finish_preview(GtkTreeModel *files);
+    static gboolean on_preview_idle (GnomeCmdAdvrenameDialog *dialog);
+
+    void start_prefetch(GtkTreeModel *files, int tag_classes);
+    void stop_prefetch();
+    static gboolean on_prefetch_poll (GnomeCmdAdvrenameDialog *dialog);
+
     static gchar *translate_menu (const gchar *path, gpointer data);
 
     GtkWidget *create_placeholder_menu(GnomeCmdData::AdvrenameConfig *cfg);
@@ -97,11 +118,152 @@ inline GnomeCmdAdvrenameDialog::Private::Private()
     vbox = NULL;
     profile_component = NULL;
     files_view = NULL;
+    preview_id = 0;
+    preview_row = 0;
+    shown_first = 0;
+    shown_last = -1;
+    prefetch_job = NULL;
+    prefetch_classes = 0;
 }
 
 
 inline GnomeCmdAdvrenameDialog::Private::~Private()
 {
+    stop_preview();
+    stop_prefetch();
+}
+
+
+void GnomeCmdAdvrenameDialog::Private::set_new_filename(GtkTreeModel *files, GtkTreeIter *iter, gint row)
+{
+    GnomeCmdFile *f;
+
+    gtk_tree_model_get (files, iter,
+                        COL_FILE, &f,
+                        -1);
+    if (!f)
+        return;
+
+    gchar *fname = gnome_cmd_advrename_gen_fname (f, row);
+
+    for (vector<GnomeCmd::RegexReplace *>::iterator j=preview_rx.begin(); j!=preview_rx.end(); ++j)
+    {
+        gchar *prev_fname = fname;
+
+        fname = (*j)->replace(prev_fname);
+
+        g_free (prev_fname);
+    }
+
+    fname = profile_component->trim_blanks (profile_component->convert_case (fname));
+    gtk_list_store_set (GTK_LIST_STORE (files), iter,
+                        COL_NEW_NAME, fname,
+                        -1);
+    g_free (fname);
+}
+
+
+void GnomeCmdAdvrenameDialog::Private::stop_preview()
+{
+    if (preview_id)
+        g_source_remove (preview_id);
+
+    preview_id = 0;
+}
+
+
+/**
+ * Computes the new names the idle source has not got to yet.
+ */
+void GnomeCmdAdvrenameDialog::Private::finish_preview(GtkTreeModel *files)
+{
+    if (!preview_id)
+        return;
+
+    stop_preview();
+
+    GtkTreeIter i;
+
+    for (gboolean valid_iter=gtk_tree_model_iter_nth_child (files, &i, NULL, preview_row); valid_iter; valid_iter=gtk_tree_model_iter_next (files, &i), ++preview_row)
+        if (preview_row<shown_first || preview_row>shown_last)
+            set_new_filename (files, &i, preview_row);
+}
+
+
+gboolean GnomeCmdAdvrenameDialog::Private::on_preview_idle (GnomeCmdAdvrenameDialog *dialog)
+{
+    Private *priv = dialog->priv;
+    GtkTreeIter i;
+
+    gint64 stop_time = g_get_monotonic_time () + PREVIEW_SLICE_USEC;
+
+    //  iterators are not kept between the slices, the row is looked up by its number
+    gboolean valid_iter = gtk_tree_model_iter_nth_child (dialog->files, &i, NULL, priv->preview_row);
+
+    for (; valid_iter && g_get_monotonic_time ()<stop_time; valid_iter=gtk_tree_model_iter_next (dialog->files, &i), ++priv->preview_row)
+        if (priv->preview_row<priv->shown_first || priv->preview_row>priv->shown_last)
+            priv->set_new_filename (dialog->files, &i, priv->preview_row);
+
+    if (valid_iter)
+        return TRUE;
+
+    priv->preview_id = 0;
+
+    return FALSE;
+}
+
+
+/**
+ * Starts reading the tags of @a tag_classes for all the files, so that the
+ * preview finds them in the tag cache.
+ */
+void GnomeCmdAdvrenameDialog::Private::start_prefetch(GtkTreeModel *files, int tag_classes)
+{
+    stop_prefetch();
+
+    GList *file_list = NULL;
+    GtkTreeIter i;
+
+    for (gboolean valid_iter=gtk_tree_model_get_iter_first (files, &i); valid_iter; valid_iter=gtk_tree_model_iter_next (files, &i))
+    {
+        GnomeCmdFile *f;
+
+        gtk_tree_model_get (files, &i,
+                            COL_FILE, &f,
+                            -1);
+        if (f)
+            file_list = g_list_prepend (file_list, f);
+    }
+
+    //  in the order of the rows, as the preview goes through them
+    file_list = g_list_reverse (file_list);
+
+    prefetch_job = gcmd_tags_prefetch (file_list, tag_classes);
+    prefetch_classes = tag_classes;
+
+    g_list_free (file_list);
+}
+
+
+void GnomeCmdAdvrenameDialog::Private::stop_prefetch()
+{
+    tag_cache_job_free (prefetch_job);
+
+    prefetch_job = NULL;
+    prefetch_classes = 0;
+}
+
+
+gboolean GnomeCmdAdvrenameDialog::Private::on_prefetch_poll (GnomeCmdAdvrenameDialog *dialog)
+{
+    Private *priv = dialog->priv;
+
+    if (!tag_cache_job_get_progress (priv->prefetch_job, NULL, NULL))
+        return TRUE;
+
+    priv->preview_id = g_idle_add ((GSourceFunc) on_preview_idle, dialog);
+
+    return FALSE;
 }
 
 
@@ -246,7 +408,8 @@ void GnomeCmdAdvrenameDialog::Private::on_profile_regex_changed (GnomeCmdAdvrena
 
 void GnomeCmdAdvrenameDialog::Private::on_files_model_row_deleted (GtkTreeModel *files, GtkTreePath *path, GnomeCmdAdvrenameDialog *dialog)
 {
-    if (dialog->priv->template_has_counters)
+    //  rows moved while the new names are computed may be missed, start over
+    if (dialog->priv->template_has_counters || dialog->priv->preview_id)
         dialog->update_new_filenames();
 }
 
@@ -323,6 +486,9 @@ void GnomeCmdAdvrenameDialog::Private::on_files_view_popup_menu__update_files (G
                             -1);
     }
 
+    //  the tags read already could be changed as well
+    dialog->priv->stop_prefetch();
+
     gnome_cmd_advrename_parse_template (dialog->priv->profile_component->get_template_entry(), dialog->priv->template_has_counters);
     dialog->update_new_filenames();
 }
@@ -452,6 +618,8 @@ void GnomeCmdAdvrenameDialog::Private::on_dialog_response (GnomeCmdAdvrenameDial
         case GTK_RESPONSE_OK:
         case GTK_RESPONSE_APPLY:
 
+            dialog->priv->finish_preview(dialog->files);
+
             old_focused_file_name = main_win->fs(ACTIVE)->file_list()->get_focused_file()->get_name();
 
             for (gboolean valid_iter=gtk_tree_model_get_iter_first (dialog->files, &i); valid_iter; valid_iter=gtk_tree_model_iter_next (dialog->files, &i))
@@ -639,13 +807,15 @@ inline GtkWidget *create_files_view ()
 
 void GnomeCmdAdvrenameDialog::update_new_filenames()
 {
+    priv->stop_preview();
+
     gnome_cmd_advrename_reset_counter (gtk_tree_model_iter_n_children (files, NULL),
                                        defaults.default_profile.counter_start,
                                        defaults.default_profile.counter_width,
                                        defaults.default_profile.counter_step);
     GtkTreeIter i;
 
-    vector<GnomeCmd::RegexReplace *> rx;
+    priv->preview_rx.clear();
 
     GtkTreeModel *regexes = priv->profile_component->get_regex_model();
 
@@ -657,38 +827,42 @@ void GnomeCmdAdvrenameDialog::update_new_filenames()
                             GnomeCmdAdvrenameProfileComponent::COL_REGEX, &r,
                             -1);
         if (r && *r)                            //  ignore regex pattern if it can't be retrieved or if it is malformed
-            rx.push_back(r);
+            priv->preview_rx.push_back(r);
     }
 
-    for (gboolean valid_iter=gtk_tree_model_get_iter_first (files, &i); valid_iter; valid_iter=gtk_tree_model_iter_next (files, &i))
-    {
-        GnomeCmdFile *f;
+    //  the tags the template needs are read in the background, unless they are being read already
+    int tag_classes = gnome_cmd_advrename_template_tag_classes();
 
-        gtk_tree_model_get (files, &i,
-                            COL_FILE, &f,
-                            -1);
-        if (!f)
-            continue;
+    if (tag_classes & ~priv->prefetch_classes)
+        priv->start_prefetch(files, tag_classes | priv->prefetch_classes);
 
-        gchar *fname = gnome_cmd_advrename_gen_fname (f);
+    //  the rows shown now first, the others in the background
+    GtkTreePath *first_path, *last_path;
 
-        for (vector<GnomeCmd::RegexReplace *>::iterator j=rx.begin(); j!=rx.end(); ++j)
-        {
-            GnomeCmd::RegexReplace *&r = *j;
+    priv->shown_first = 0;
+    priv->shown_last = -1;
+
+    if (GTK_WIDGET_REALIZED (priv->files_view) && gtk_tree_view_get_visible_range (GTK_TREE_VIEW (priv->files_view), &first_path, &last_path))
+    {
+        priv->shown_first = gtk_tree_path_get_indices (first_path)[0];
+        priv->shown_last = gtk_tree_path_get_indices (last_path)[0];
 
-            gchar *prev_fname = fname;
+        gtk_tree_path_free (first_path);
+        gtk_tree_path_free (last_path);
+    }
 
-            fname = r->replace(prev_fname);
+    gint row = priv->shown_first;
 
-            g_free (prev_fname);
-        }
+    for (gboolean valid_iter=gtk_tree_model_iter_nth_child (files, &i, NULL, row); valid_iter && row<=priv->shown_last; valid_iter=gtk_tree_model_iter_next (files, &i), ++row)
+        priv->set_new_filename (files, &i, row);
 
-        fname = priv->profile_component->trim_blanks (priv->profile_component->convert_case (fname));
-        gtk_list_store_set (GTK_LIST_STORE (files), &i,
-                            COL_NEW_NAME, fname,
-                            -1);
-        g_free (fname);
-    }
+    priv->preview_row = 0;
+
+    //  the other rows wait for their tags, instead of reading them one by one here
+    if (priv->prefetch_job && !tag_cache_job_get_progress (priv->prefetch_job, NULL, NULL))
+        priv->preview_id = g_timeout_add (PREFETCH_POLL_MSEC, (GSourceFunc) Private::on_prefetch_poll, this);
+    else
+        priv->preview_id = g_idle_add ((GSourceFunc) Private::on_preview_idle, this);
 }
 
 
@@ -762,6 +936,9 @@ void GnomeCmdAdvrenameDialog::set(GList *file_list)
 
 void GnomeCmdAdvrenameDialog::unset()
 {
+    priv->stop_preview();
+    priv->stop_prefetch();
+
     gtk_tree_view_set_model (GTK_TREE_VIEW (priv->files_view), NULL);       // unset the model
 
     GnomeCmdFile *f;
@@ -25,6 +25,7 @@
 #include <errno.h>
 
 #include "gnome-cmd-includes.h"
+#include "gnome-cmd-attr.h"
 #include "gnome-cmd-chmod-component.h"
 #include "gnome-cmd-dir.h"
 #include "gnome-cmd-user-actions.h"
@@ -99,17 +100,37 @@ static void do_chmod (GnomeCmdFile *in, GnomeVFSFilePermissions perm, gboolean r
 
 inline void do_chmod_files (GnomeCmdChmodDialog *dialog)
 {
+    gboolean recursive = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->priv->recurse_check));
+    const gchar *mode_text = get_combo_text (dialog->priv->recurse_combo);
+    ChmodRecursiveMode mode = strcmp (mode_text, recurse_opts[CHMOD_ALL_FILES]) == 0 ? CHMOD_ALL_FILES :
+                                                                                       CHMOD_DIRS_ONLY;
+    GList *local_files = NULL;
+
     for (GList *i = dialog->priv->files; i; i = i->next)
     {
         GnomeCmdFile *f = (GnomeCmdFile *) i->data;
-        gboolean recursive = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->priv->recurse_check));
-        const gchar *mode_text = get_combo_text (dialog->priv->recurse_combo);
-        ChmodRecursiveMode mode = strcmp (mode_text, recurse_opts[CHMOD_ALL_FILES]) == 0 ? CHMOD_ALL_FILES :
-                                                                                           CHMOD_DIRS_ONLY;
+
+        // local files are changed natively in the background
+        if (f->is_local())
+        {
+            // like do_chmod(), only directories are changed at all with CHMOD_DIRS_ONLY
+            if (!(recursive && mode == CHMOD_DIRS_ONLY && f->info->type != GNOME_VFS_FILE_TYPE_DIRECTORY))
+                local_files = g_list_append (local_files, f);
+            continue;
+        }
 
         do_chmod (f, dialog->priv->perms, recursive, mode);
         view_refresh (NULL, NULL);
     }
+
+    if (local_files)
+    {
+        AttrLocalChange change = {TRUE, (mode_t) (dialog->priv->perms & 07777), recursive && mode == CHMOD_DIRS_ONLY,
+                                  FALSE, (uid_t) -1, (gid_t) -1};
+
+        gnome_cmd_attr_start (local_files, change, recursive);
+        g_list_free (local_files);
+    }
 }
 
 
@@ -25,6 +25,7 @@
 #include <errno.h>
 
 #include "gnome-cmd-includes.h"
+#include "gnome-cmd-attr.h"
 #include "gnome-cmd-chown-dialog.h"
 #include "gnome-cmd-chown-component.h"
 #include "gnome-cmd-dir.h"
@@ -44,45 +45,6 @@ struct GnomeCmdChownDialogPrivate
 G_DEFINE_TYPE (GnomeCmdChownDialog, gnome_cmd_chown_dialog, GNOME_CMD_TYPE_DIALOG)
 
 
-static void do_chown (GnomeCmdFile *in, uid_t uid, gid_t gid, gboolean recurse)
-{
-    g_return_if_fail (in != NULL);
-    g_return_if_fail (in->info != NULL);
-
-    GnomeVFSResult ret = in->chown(uid, gid);
-
-    if (ret != GNOME_VFS_OK)
-    {
-        gchar *fpath = in->get_real_path();
-        gchar *msg = g_strdup_printf (_("Could not chown %s"), fpath);
-        gnome_cmd_show_message (*main_win, msg, gnome_vfs_result_to_string (ret));
-        g_free (msg);
-        g_free (fpath);
-    }
-    else
-        if (!recurse)
-            return;
-
-    if (in->info->type == GNOME_VFS_FILE_TYPE_DIRECTORY)
-    {
-        GnomeCmdDir *dir = gnome_cmd_dir_ref (GNOME_CMD_DIR (in));
-
-        gnome_cmd_dir_list_files (dir, FALSE);
-
-        for (GList *i = gnome_cmd_dir_get_files (dir); i; i = i->next)
-        {
-            GnomeCmdFile *f = (GnomeCmdFile *) i->data;
-            if (!f->is_dotdot && strcmp (f->info->name, ".") != 0
-                && !GNOME_VFS_FILE_INFO_SYMLINK(f->info))
-            {
-                do_chown (f, uid, gid, TRUE);
-            }
-        }
-        gnome_cmd_dir_unref (dir);
-    }
-}
-
-
 static void on_ok (GtkButton *button, GnomeCmdChownDialog *dialog)
 {
     uid_t uid = -1;
@@ -103,6 +65,8 @@ static void on_ok (GtkButton *button, GnomeCmdChownDialog *dialog)
 
     gboolean recurse = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->priv->recurse_check));
 
+    GList *local_files = NULL;
+
     for (GList *i = dialog->priv->files; i; i = i->next)
     {
         GnomeCmdFile *f = (GnomeCmdFile *) i->data;
@@ -110,10 +74,14 @@ static void on_ok (GtkButton *button, GnomeCmdChownDialog *dialog)
         g_return_if_fail (f != NULL);
 
         if (GNOME_VFS_FILE_INFO_LOCAL (f->info))
-            do_chown (f, uid, gid, recurse);
+            local_files = g_list_append (local_files, f);
     }
 
-    view_refresh (NULL, NULL);
+    // changed natively in the background, which refreshes the file lists at the end
+    AttrLocalChange change = {FALSE, 0, FALSE, TRUE, uid, gid};
+
+    gnome_cmd_attr_start (local_files, change, recurse);
+    g_list_free (local_files);
 
     gnome_cmd_file_list_free (dialog->priv->files);
     gtk_widget_destroy (GTK_WIDGET (dialog));
@@ -27,11 +27,15 @@
 #include "gnome-cmd-file-list.h"
 #include "gnome-cmd-main-win.h"
 #include "utils.h"
+#include "delete-local.h"
 #include "dialogs/gnome-cmd-delete-dialog.h"
 
 using namespace std;
 
 
+#define LOCAL_POLL_RATE  10         // ms between looks at the native job
+
+
 struct DeleteData
 {
     GtkWidget *progbar;
@@ -47,7 +51,7 @@ struct DeleteData
     gboolean stop;                // tells the work thread to stop working
     gboolean delete_done;         // tells the main thread that the work thread is done
     gchar *msg;                   // a message descriping the current status of the delete operation
-    gfloat progress;              // a float values between 0 and 1 representing the progress of the whole operation
+    gfloat progress;              // a float values between 0 and 1 representing the progress of the whole operation, below 0 if unknown
     GMutex mutex;                 // used to sync the main and worker thread
 };
 
@@ -108,6 +112,65 @@ static gint delete_progress_callback (GnomeVFSXferProgressInfo *info, DeleteData
 }
 
 
+/**
+ * Deletes the local files in @a paths natively. Its questions about errors
+ * are asked the same way as those of GnomeVFS, its progress is the number
+ * of files deleted so far, as the total isn't known up front.
+ */
+static void delete_local_files (DeleteData *data, GList *paths)
+{
+    DeleteLocalJob *job = delete_local_job_new (paths);
+    guint64 files = 0;
+
+    while (!delete_local_job_get_progress (job, &files))
+    {
+        gchar *path;
+        gint error;
+
+        if (delete_local_job_get_question (job, &path, &error))
+        {
+            g_mutex_lock (&data->mutex);
+            data->vfs_status = gnome_vfs_result_from_errno_code (error);
+            data->problem_file = g_path_get_basename (path);
+            data->problem = TRUE;
+            g_mutex_unlock (&data->mutex);
+
+            while (data->problem_action == -1)
+                g_thread_yield ();
+
+            g_mutex_lock (&data->mutex);
+            delete_local_job_answer (job, data->problem_action);
+            data->problem_action = -1;
+            g_free (data->problem_file);
+            data->problem_file = NULL;
+            data->vfs_status = GNOME_VFS_OK;
+            g_mutex_unlock (&data->mutex);
+
+            g_free (path);
+        }
+
+        g_mutex_lock (&data->mutex);
+        g_free (data->msg);
+        data->msg = g_strdup_printf (ngettext("Deleted %lu file",
+                                              "Deleted %lu files",
+                                              files),
+                                     (gulong) files);
+        data->progress = -1.0f;
+        g_mutex_unlock (&data->mutex);
+
+        if (data->stop)
+            delete_local_job_cancel (job);
+
+        g_usleep (LOCAL_POLL_RATE * 1000);
+    }
+
+    if (delete_local_job_aborted (job))
+        data->stop = TRUE;
+
+    delete_local_job_free (job);
+}
+
+
 static void on_cancel (GtkButton *btn, DeleteData *data)
 {
     data->stop = TRUE;
@@ -161,8 +224,9 @@ inline void create_delete_progress_win (DeleteData *data)
 static void perform_delete_operation (DeleteData *data)
 {
     GList *uri_list = NULL;
+    GList *local_paths = NULL;
 
-    // go through all files and add the uri of the appropriate ones to a list
+    // go through all files and add the uri of the appropriate ones to a list, local files are deleted natively
     for (GList *i=data->files; i; i=i->next)
     {
         GnomeCmdFile *f = (GnomeCmdFile *) i->data;
@@ -170,19 +234,36 @@ static void perform_delete_operation (DeleteData *data)
         if (f->is_dotdot || strcmp(f->info->name, ".") == 0)
             continue;
 
+        // the files of local connections, NFS mounts too
+        if (f->is_local())
+        {
+            local_paths = g_list_append (local_paths, f->get_real_path());
+            continue;
+        }
+
         GnomeVFSURI *uri = f->get_uri();
         if (!uri) continue;
 
         uri_list = g_list_append (uri_list, gnome_vfs_uri_ref (uri));
     }
 
+    if (local_paths)
+    {
+        delete_local_files (data, local_paths);
+
+        g_list_foreach (local_paths, (GFunc) g_free, NULL);
+        g_list_free (local_paths);
+    }
+
     if (uri_list)
     {
-        gnome_vfs_xfer_delete_list (uri_list,
-                                    GNOME_VFS_XFER_ERROR_MODE_QUERY,
-                                    GNOME_VFS_XFER_DEFAULT,
-                                    (GnomeVFSXferProgressCallback) delete_progress_callback,
-                                    data);
+        // an abort of the native deletion stops the rest too
+        if (!data->stop)
+            gnome_vfs_xfer_delete_list (uri_list,
+                                        GNOME_VFS_XFER_ERROR_MODE_QUERY,
+                                        GNOME_VFS_XFER_DEFAULT,
+                                        (GnomeVFSXferProgressCallback) delete_progress_callback,
+                                        data);
 
         g_list_foreach (uri_list, (GFunc) gnome_vfs_uri_unref, NULL);
         g_list_free (uri_list);
@@ -197,7 +278,10 @@ static gboolean update_delete_status_widgets (DeleteData *data)
     g_mutex_lock (&data->mutex);
 
     gtk_label_set_text (GTK_LABEL (data->proglabel), data->msg);
-    gtk_progress_set_percentage (GTK_PROGRESS (data->progbar), data->progress);
+    if (data->progress<0)
+        gtk_progress_bar_pulse (GTK_PROGRESS_BAR (data->progbar));
+    else
+        gtk_progress_set_percentage (GTK_PROGRESS (data->progbar), data->progress);
 
     if (data->problem)
     {
@@ -240,15 +240,14 @@ static void on_copy_clipboard (GtkButton *button, GnomeCmdFilePropsDialogPrivate
     string s;
 
     for (GnomeCmdFileMetadata::METADATA_COLL::const_iterator i=data->f->metadata->begin(); i!=data->f->metadata->end(); ++i)
-        for (set<string>::const_iterator j=i->second.begin(); j!=i->second.end(); ++j)
-        {
-            s += gcmd_tags_get_name(i->first);
-            s += '\t';
-            s += gcmd_tags_get_title(i->first);
-            s += '\t';
-            s += *j;
-            s += '\n';
-        }
+    {
+        s += gcmd_tags_get_name(i->tag);
+        s += '\t';
+        s += gcmd_tags_get_title(i->tag);
+        s += '\t';
+        s += data->f->metadata->value(*i);
+        s += '\n';
+    }
 
     gtk_clipboard_set_text (gtk_clipboard_get (GDK_SELECTION_CLIPBOARD), s.data(), s.size());
 }
@@ -565,7 +564,7 @@ static GtkTreeModel *create_and_fill_model (GnomeCmdFile *f)
 
     for (GnomeCmdFileMetadata::METADATA_COLL::const_iterator i=f->metadata->begin(); i!=f->metadata->end(); ++i)
     {
-        const GnomeCmdTag t = i->first;
+        const GnomeCmdTag t = i->tag;
         GnomeCmdTagClass curr_tagclass = gcmd_tags_get_class(t);
 
         if (curr_tagclass==TAG_NONE_CLASS)
@@ -580,18 +579,15 @@ static GtkTreeModel *create_and_fill_model (GnomeCmdFile *f)
                                 -1);
         }
 
-        for (set<string>::const_iterator j=i->second.begin(); j!=i->second.end(); ++j)
-        {
-            GtkTreeIter child;
-
-            gtk_tree_store_append (treestore, &child, &toplevel);
-            gtk_tree_store_set (treestore, &child,
-                                COL_TAG, t,
-                                COL_NAME, gcmd_tags_get_title(t),
-                                COL_VALUE, j->c_str(),
-                                COL_DESC, gcmd_tags_get_description(t),
-                                -1);
-        }
+        GtkTreeIter child;
+
+        gtk_tree_store_append (treestore, &child, &toplevel);
+        gtk_tree_store_set (treestore, &child,
+                            COL_TAG, t,
+                            COL_NAME, gcmd_tags_get_title(t),
+                            COL_VALUE, f->metadata->value(*i),
+                            COL_DESC, gcmd_tags_get_description(t),
+                            -1);
 
         prev_tagclass = curr_tagclass;
     }
@@ -68,7 +68,7 @@ static void on_confirm_delete_toggled (GtkToggleButton *togglebutton, GtkWidget
 static GtkWidget *create_general_tab (GtkWidget *parent, GnomeCmdData::Options &cfg)
 {
     GtkWidget *frame, *hbox, *vbox, *cat, *cat_box;
-    GtkWidget *radio, *check;
+    GtkWidget *radio, *check, *label, *spin;
 
     frame = create_tabframe (parent);
     hbox = create_tabhbox (parent);
@@ -189,6 +189,37 @@ static GtkWidget *create_general_tab (GtkWidget *parent, GnomeCmdData::Options &
     gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (check), cfg.quick_search_exact_match_end);
 
 
+    // Search options
+    cat_box = create_vbox (parent, FALSE, 0);
+    cat = create_category (parent, cat_box, _("Search"));
+    gtk_box_pack_start (GTK_BOX (vbox), cat, FALSE, TRUE, 0);
+
+    check = create_check (parent, _("Keep an index of local file names"), "search_index");
+    gtk_box_pack_start (GTK_BOX (cat_box), check, FALSE, TRUE, 0);
+    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (check), cfg.search_index);
+
+
+    // Transfer options
+    cat_box = create_vbox (parent, FALSE, 0);
+    cat = create_category (parent, cat_box, _("Transfers"));
+    gtk_box_pack_start (GTK_BOX (vbox), cat, FALSE, TRUE, 0);
+
+    check = create_check (parent, _("Log the timing of file transfers"), "transfer_log");
+    gtk_box_pack_start (GTK_BOX (cat_box), check, FALSE, TRUE, 0);
+    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (check), cfg.transfer_log);
+
+    check = create_check (parent, _("Keep checksums for resuming large copies"), "transfer_checksums");
+    gtk_box_pack_start (GTK_BOX (cat_box), check, FALSE, TRUE, 0);
+    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (check), cfg.transfer_checksums);
+
+    hbox = create_hbox (parent, FALSE, 6);
+    gtk_box_pack_start (GTK_BOX (cat_box), hbox, FALSE, TRUE, 0);
+    label = create_label (parent, _("Transfers at once per disk or host:"));
+    gtk_box_pack_start (GTK_BOX (hbox), label, FALSE, TRUE, 0);
+    spin = create_spin (parent, "transfers_per_device_spin", 1, 8, cfg.transfers_per_device);
+    gtk_box_pack_start (GTK_BOX (hbox), spin, FALSE, TRUE, 0);
+
+
 #ifdef HAVE_UNIQUE
     // Multiple instances
     cat_box = create_vbox (parent, FALSE, 0);
@@ -249,6 +280,10 @@ inline void store_general_options (GtkWidget *dialog, GnomeCmdData::Options &cfg
     GtkWidget *save_dir_history = lookup_widget (dialog, "save_dir_history");
     GtkWidget *save_cmdline_history = lookup_widget (dialog, "save_cmdline_history");
     GtkWidget *save_search_history = lookup_widget (dialog, "save_search_history");
+    GtkWidget *search_index = lookup_widget (dialog, "search_index");
+    GtkWidget *transfer_log = lookup_widget (dialog, "transfer_log");
+    GtkWidget *transfer_checksums = lookup_widget (dialog, "transfer_checksums");
+    GtkWidget *transfers_per_device_spin = lookup_widget (dialog, "transfers_per_device_spin");
 
     cfg.left_mouse_button_mode = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (lmb_singleclick_radio)) ? GnomeCmdData::LEFT_BUTTON_OPENS_WITH_SINGLE_CLICK : GnomeCmdData::LEFT_BUTTON_OPENS_WITH_DOUBLE_CLICK;
 
@@ -276,6 +311,10 @@ inline void store_general_options (GtkWidget *dialog, GnomeCmdData::Options &cfg
     cfg.save_dir_history_on_exit = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (save_dir_history));
     cfg.save_cmdline_history_on_exit = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (save_cmdline_history));
     cfg.save_search_history_on_exit = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (save_search_history));
+    cfg.search_index = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (search_index));
+    cfg.transfer_log = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (transfer_log));
+    cfg.transfer_checksums = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (transfer_checksums));
+    cfg.transfers_per_device = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (transfers_per_device_spin));
 }
 
 
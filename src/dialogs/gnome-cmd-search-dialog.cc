@@ -34,6 +34,8 @@
 #include "gnome-cmd-selection-profile-component.h"
 #include "gnome-cmd-manage-profiles-dialog.h"
 #include "filter.h"
+#include "search-index.h"
+#include "search-local.h"
 #include "utils.h"
 
 using namespace std;
@@ -50,7 +52,7 @@ static char *msgs[] = {N_("Search local directories only"),
 #define SEARCH_JUMP_SIZE     4096U
 #define SEARCH_BUFFER_SIZE  (SEARCH_JUMP_SIZE * 10U)
 
-#define GNOME_SEARCH_TOOL_REFRESH_DURATION  50000
+#define SEARCH_CONTENT_THREADS_MAX  8
 
 
 struct GnomeCmdSearchDialogClass
@@ -70,15 +72,23 @@ struct SearchFileData
 };
 
 
+struct ContentCheck
+{
+    GnomeCmdFile *f;
+    GnomeCmdDir *dir;
+};
+
+
 struct SearchData
 {
     struct ProtectedData
     {
         GList  *files;
+        GList  *paths;                          /**< local files found, in reverse order */
         gchar  *msg;
         GMutex *mutex;
 
-        ProtectedData(): files(0), msg(0), mutex(0)     {}
+        ProtectedData(): files(0), paths(0), msg(0), mutex(0)     {}
     };
 
     GnomeCmdSearchDialog *dialog;
@@ -86,10 +96,13 @@ struct SearchData
     GnomeCmdDir *start_dir;                     /**< the directory to start searching from */
 
     Filter *name_filter;
-    regex_t *content_regex;
+    GAsyncQueue *content_regexes;               /**< a compiled content regex for each content thread */
+    GThreadPool *content_pool;                  /**< matches file contents in parallel to the directory traversal */
     gint context_id;                            /**< the context id of the status bar */
     GList *match_dirs;                          /**< the directories which we found matching files in */
     GThread *thread;
+    string local_path;                          /**< the directory to start a local search from */
+    string content_pattern;
     ProtectedData pdata;
     gint update_gui_timeout_id;
 
@@ -100,11 +113,11 @@ struct SearchData
     explicit SearchData(GnomeCmdSearchDialog *dlg);
 
     void set_statusmsg(const gchar *msg=NULL);
-    gchar *build_search_command();
     void search_dir_r(GnomeCmdDir *dir, long level);  /**< searches a given directory for files that matches the criteria given by data */
+    void add_match(GnomeCmdFile *f, GnomeCmdDir *dir);
 
-    gboolean name_matches(gchar *name)   {  return name_filter->match(name);  }     /**< determines if the name of a file matches an regexp */
-    gboolean content_matches(GnomeCmdFile *f);                                      /**< determines if the content of a file matches an regexp */
+    gboolean name_matches(const gchar *name)   {  return name_filter->match(name);  }   /**< determines if the name of a file matches an regexp */
+    gboolean content_matches(GnomeCmdFile *f, regex_t *re);                             /**< determines if the content of a file matches an regexp */
     gboolean read_search_file(SearchFileData *, GnomeCmdFile *f);                   /**< loads a file in chunks and returns the content */
     gboolean start_generic_search();
     gboolean start_local_search();
@@ -268,7 +281,8 @@ inline SearchData::SearchData(GnomeCmdSearchDialog *dlg): dialog(dlg)
     start_dir = NULL;
 
     name_filter = NULL;
-    content_regex = NULL;
+    content_regexes = NULL;
+    content_pool = NULL;
     context_id = 0;
     match_dirs = NULL;
     thread = NULL;
@@ -342,7 +356,7 @@ gboolean SearchData::read_search_file(SearchFileData *searchfile_data, GnomeCmdF
 }
 
 
-inline gboolean SearchData::content_matches(GnomeCmdFile *f)
+gboolean SearchData::content_matches(GnomeCmdFile *f, regex_t *re)
 {
     g_return_val_if_fail (f != NULL, FALSE);
     g_return_val_if_fail (f->info != NULL, FALSE);
@@ -364,8 +378,11 @@ inline gboolean SearchData::content_matches(GnomeCmdFile *f)
     regmatch_t match;
 
     while (read_search_file(search_file, f))
-        if (regexec (content_regex, search_file->mem, 1, &match, 0) != REG_NOMATCH)
+        if (regexec (re, search_file->mem, 1, &match, 0) != REG_NOMATCH)
+        {
+            free_search_file_data (search_file);
             return TRUE;        // stop on first match
+        }
 
     return FALSE;
 }
@@ -445,20 +462,51 @@ void SearchData::search_dir_r(GnomeCmdDir *dir, long level)
                 if (!name_matches(f->info->name))                       // if the name doesn't match, let's go to the next file
                     continue;
 
-                if (dialog->defaults.default_profile.content_search && !content_matches(f))              // if the user wants to we should do some content matching here
-                    continue;
+                if (content_pool)                                       // if the user wants to, the content is matched by the content threads
+                {
+                    ContentCheck *check = g_new (ContentCheck, 1);
 
-                g_mutex_lock (pdata.mutex);                             // the file matched the search criteria, let's add it to the list
-                pdata.files = g_list_append (pdata.files, f->ref());
-                g_mutex_unlock (pdata.mutex);
+                    check->f = f->ref();
+                    check->dir = gnome_cmd_dir_ref (dir);
+                    g_thread_pool_push (content_pool, check, NULL);
+                    continue;
+                }
 
-                if (g_list_index (match_dirs, dir) == -1)               // also ref each directory that has a matching file
-                    match_dirs = g_list_append (match_dirs, gnome_cmd_dir_ref (dir));
+                add_match(f, dir);
             }
     }
 }
 
 
+void SearchData::add_match(GnomeCmdFile *f, GnomeCmdDir *dir)
+{
+    g_mutex_lock (pdata.mutex);                                         // the file matched the search criteria, let's add it to the list
+
+    pdata.files = g_list_prepend (pdata.files, f->ref());
+
+    if (g_list_index (match_dirs, dir) == -1)                           // also ref each directory that has a matching file
+        match_dirs = g_list_append (match_dirs, gnome_cmd_dir_ref (dir));
+
+    g_mutex_unlock (pdata.mutex);
+}
+
+
+static void check_content (ContentCheck *check, SearchData *data)
+{
+    // every thread needs its own regex, regexec() calls on the same one are serialized
+    regex_t *re = (regex_t *) g_async_queue_pop (data->content_regexes);
+
+    if (!data->stopped && data->content_matches(check->f, re))
+        data->add_match(check->f, check->dir);
+
+    g_async_queue_push (data->content_regexes, re);
+
+    check->f->unref();
+    gnome_cmd_dir_unref (check->dir);
+    g_free (check);
+}
+
+
 static gpointer perform_search_operation (SearchData *data)
 {
     // unref all directories which contained matching files from last search
@@ -469,19 +517,43 @@ static gpointer perform_search_operation (SearchData *data)
         data->match_dirs = NULL;
     }
 
-    data->search_dir_r(data->start_dir, data->dialog->defaults.default_profile.max_depth);
+    if (data->dialog->defaults.default_profile.content_search)
+    {
+        guint n_threads = CLAMP (g_get_num_processors (), 2, SEARCH_CONTENT_THREADS_MAX);
 
-    // free regexps
-    delete data->name_filter;
-    data->name_filter = NULL;
+        data->content_regexes = g_async_queue_new ();
 
-    if (data->dialog->defaults.default_profile.content_search)
+        for (guint i=0; i<n_threads; ++i)
+        {
+            regex_t *re = g_new0 (regex_t, 1);
+            regcomp (re, data->content_pattern.c_str(), data->dialog->defaults.default_profile.match_case ? 0 : REG_ICASE);
+            g_async_queue_push (data->content_regexes, re);
+        }
+
+        data->content_pool = g_thread_pool_new ((GFunc) check_content, data, n_threads, FALSE, NULL);
+    }
+
+    data->search_dir_r(data->start_dir, data->dialog->defaults.default_profile.max_depth);
+
+    // wait for the content threads and free regexps
+    if (data->content_pool)
     {
-        regfree (data->content_regex);
-        g_free (data->content_regex);
-        data->content_regex = NULL;
+        g_thread_pool_free (data->content_pool, FALSE, TRUE);
+        data->content_pool = NULL;
+
+        while (regex_t *re = (regex_t *) g_async_queue_try_pop (data->content_regexes))
+        {
+            regfree (re);
+            g_free (re);
+        }
+
+        g_async_queue_unref (data->content_regexes);
+        data->content_regexes = NULL;
     }
 
+    delete data->name_filter;
+    data->name_filter = NULL;
+
     gnome_cmd_dir_unref (data->start_dir);      //  FIXME:  ???
     data->start_dir = NULL;
 
@@ -501,8 +573,10 @@ static gboolean update_search_status_widgets (SearchData *data)
     {
         g_mutex_lock (data->pdata.mutex);
 
-        GList *files = data->pdata.files;
+        GList *files = g_list_reverse (data->pdata.files);
+        GList *paths = g_list_reverse (data->pdata.paths);
         data->pdata.files = NULL;
+        data->pdata.paths = NULL;
 
         data->set_statusmsg(data->pdata.msg);                       // update status bar with the latest message
 
@@ -513,10 +587,23 @@ static gboolean update_search_status_widgets (SearchData *data)
         for (GList *i = files; i; i = i->next)                      // add all files found since last update to the list
             fl->append_file(GNOME_CMD_FILE (i->data));
 
+        for (GList *i = paths; i; i = i->next)
+        {
+            gchar *utf8 = g_filename_display_name ((gchar *) i->data);
+            GnomeCmdFile *f = gnome_cmd_file_new (utf8);
+
+            if (f)
+                fl->append_file(f);
+
+            g_free (utf8);
+        }
+
         gnome_cmd_file_list_free (files);
+        g_list_foreach (paths, (GFunc) g_free, NULL);
+        g_list_free (paths);
     }
 
-    if ((!data->search_done && !data->stopped) || data->pdata.files)
+    if ((!data->search_done && !data->stopped) || data->pdata.files || data->pdata.paths)
         return TRUE;
 
     if (!data->dialog_destroyed)
@@ -566,7 +653,11 @@ gboolean SearchData::join_thread_func (SearchData *data)
         g_thread_join (data->thread);
 
     if (data->pdata.mutex)
+    {
         g_mutex_clear (data->pdata.mutex);
+        g_free (data->pdata.mutex);
+        data->pdata.mutex = NULL;
+    }
 
     return FALSE;
 }
@@ -577,15 +668,14 @@ gboolean SearchData::start_generic_search()
     // create an re for file name matching
     name_filter = new Filter(dialog->defaults.default_profile.filename_pattern.c_str(), dialog->defaults.default_profile.match_case, dialog->defaults.default_profile.syntax);
 
-    // if we're going to search through file content create an re for that too
-    if (dialog->defaults.default_profile.content_search)
-    {
-        content_regex = g_new0 (regex_t, 1);
-        regcomp (content_regex, dialog->defaults.default_profile.text_pattern.c_str(), dialog->defaults.default_profile.match_case ? 0 : REG_ICASE);
-    }
+    // if we're going to search through file content, the content threads compile an re for that
+    content_pattern = dialog->defaults.default_profile.text_pattern;
 
     if (!pdata.mutex)
-        g_mutex_init(pdata.mutex);
+    {
+        pdata.mutex = g_new (GMutex, 1);
+        g_mutex_init (pdata.mutex);
+    }
 
     thread = g_thread_new (NULL, (GThreadFunc) perform_search_operation, this);
 
@@ -593,258 +683,242 @@ gboolean SearchData::start_generic_search()
 }
 
 
-/**
- * local search - using findutils
- */
-gchar *SearchData::build_search_command()
+static gboolean local_name_matches (const gchar *name, SearchData *data)
 {
-    gchar *file_pattern_utf8 = g_strdup (dialog->defaults.default_profile.filename_pattern.c_str());
-    GError *error = NULL;
+    return data->name_matches(name);
+}
 
-    switch (dialog->defaults.default_profile.syntax)
-    {
-        case Filter::TYPE_FNMATCH:
-            if (!file_pattern_utf8 || !*file_pattern_utf8)
-            {
-                g_free (file_pattern_utf8);
-                file_pattern_utf8 = g_strdup ("*");
-            }
-            else
-                if (!g_utf8_strchr (file_pattern_utf8, -1, '*') && !g_utf8_strchr (file_pattern_utf8, -1, '?'))
-                {
-                    gchar *tmp = file_pattern_utf8;
-                    file_pattern_utf8 = g_strconcat ("*", file_pattern_utf8, "*", NULL);
-                    g_free (tmp);
-                }
-            break;
 
-        case Filter::TYPE_REGEX:
-            break;
+static void on_local_dir (const gchar *path, SearchData *data)
+{
+    if (data->dialog_destroyed)
+        return;
 
-        default:
-            break;
-    }
+    gchar *display_path = g_filename_display_name (path);
 
-    gchar *file_pattern_locale = g_locale_from_utf8 (file_pattern_utf8, -1, NULL, NULL, &error);
+    g_mutex_lock (data->pdata.mutex);           // several threads search at once, the status bar shows the latest directory
 
-    if (!file_pattern_locale)
-    {
-        gnome_cmd_error_message (file_pattern_utf8, error);
-        g_free (file_pattern_utf8);
-        return NULL;
-    }
+    g_free (data->pdata.msg);
+    data->pdata.msg = g_strdup_printf (_("Searching in: %s"), display_path);
 
-    gchar *file_pattern_quoted = quote_if_needed (file_pattern_locale);
-    gchar *look_in_folder_utf8 = GNOME_CMD_FILE (start_dir)->get_real_path();
-    gchar *look_in_folder_locale = g_locale_from_utf8 (look_in_folder_utf8, -1, NULL, NULL, NULL);
+    g_mutex_unlock (data->pdata.mutex);
 
-    if (!look_in_folder_locale)     // if for some reason a path was not returned, fallback to the user's home directory
-        look_in_folder_locale = g_strconcat (g_get_home_dir (), G_DIR_SEPARATOR_S, NULL);
+    g_free (display_path);
+}
 
-    gchar *look_in_folder_quoted = quote_if_needed (look_in_folder_locale);
 
-    GString *command = g_string_sized_new (512);
+static void on_local_file_found (const gchar *path, SearchData *data)
+{
+    g_mutex_lock (data->pdata.mutex);
+    data->pdata.paths = g_list_prepend (data->pdata.paths, g_strdup (path));
+    g_mutex_unlock (data->pdata.mutex);
+}
 
-    g_string_append (command, "find ");
-    g_string_append (command, look_in_folder_quoted);
 
-    if (dialog->defaults.default_profile.max_depth!=-1)
-        g_string_append_printf (command, " -maxdepth %i", dialog->defaults.default_profile.max_depth+1);
+struct SearchIndexUpdate
+{
+    gchar *index_file;
+    gchar *root;
+};
 
-    switch (dialog->defaults.default_profile.syntax)
-    {
-        case Filter::TYPE_FNMATCH:
-            g_string_append_printf (command, " -iname '%s'", file_pattern_utf8);
-            break;
 
-        case Filter::TYPE_REGEX:
-            g_string_append_printf (command, " -regextype posix-extended -iregex '.*/.*%s.*'", file_pattern_utf8);
-            break;
-        default:
-            ;
-    }
+static GMutex search_index_lock;
+static GThread *search_index_thread = NULL;    // the last update, joined by the next one or by gnome_cmd_search_dialog_stop_index_update()
+static gint search_index_updating = FALSE;
+static gint search_index_cancelled = FALSE;
 
-    if (dialog->defaults.default_profile.content_search)
-    {
-        static const gchar GREP_COMMAND[] = "grep";
 
-        if (dialog->defaults.default_profile.match_case)
-            g_string_append_printf (command, " '!' -type p -exec %s -E -q '%s' {} \\;", GREP_COMMAND, dialog->defaults.default_profile.text_pattern.c_str());
-        else
-            g_string_append_printf (command, " '!' -type p -exec %s -E -q -i '%s' {} \\;", GREP_COMMAND, dialog->defaults.default_profile.text_pattern.c_str());
-    }
+static gchar *get_search_index_file (const gchar *root)
+{
+    gchar *dir = config_dir ? g_build_filename (config_dir, "search-index", NULL) : g_build_filename (g_get_home_dir (), "." PACKAGE, "search-index", NULL);
+    gchar *checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, root, -1);
+    gchar *index_file = g_build_filename (dir, checksum, NULL);
 
-    g_string_append (command, " -print");
+    g_mkdir_with_parents (dir, 0700);
 
-    g_free (file_pattern_utf8);
-    g_free (file_pattern_locale);
-    g_free (file_pattern_quoted);
-    g_free (look_in_folder_utf8);
-    g_free (look_in_folder_locale);
-    g_free (look_in_folder_quoted);
+    g_free (checksum);
+    g_free (dir);
 
-    return g_string_free (command, FALSE);
+    return index_file;
 }
 
 
-static void child_command_set_pgid_cb (gpointer unused)
+static gpointer update_search_index (SearchIndexUpdate *update)
 {
-    if (setpgid (0, 0) < 0)
-        g_print (_("Failed to set process group id of child %d: %s.\n"), getpid (), g_strerror (errno));
+    gint err = search_index_update (update->index_file, update->root, &search_index_cancelled);
+
+    if (err && err!=ECANCELED)
+        g_warning (_("Failed to update the search index of %s: %s"), update->root, g_strerror (err));
+
+    g_free (update->index_file);
+    g_free (update->root);
+    g_free (update);
+
+    g_atomic_int_set (&search_index_updating, FALSE);
+
+    return NULL;
 }
 
 
-static gboolean handle_search_command_stdout_io (GIOChannel *ioc, GIOCondition condition, SearchData *data)
+/**
+ * Brings the index of @a root up to date in the background, one index at a time.
+ */
+static void start_search_index_update (const gchar *index_file, const gchar *root)
 {
-    gboolean broken_pipe = FALSE;
+    g_mutex_lock (&search_index_lock);
 
-    if (condition & G_IO_IN)
+    if (g_atomic_int_compare_and_exchange (&search_index_updating, FALSE, TRUE))
     {
-        GError *error = NULL;
+        if (search_index_thread)
+            g_thread_join (search_index_thread);
 
-        GString *string = g_string_new (NULL);
+        SearchIndexUpdate *update = g_new (SearchIndexUpdate, 1);
 
-        GTimer *timer = g_timer_new ();
-        g_timer_start (timer);
+        update->index_file = g_strdup (index_file);
+        update->root = g_strdup (root);
 
-        while (!ioc->is_readable);
+        g_atomic_int_set (&search_index_cancelled, FALSE);
+        search_index_thread = g_thread_new (NULL, (GThreadFunc) update_search_index, update);
+    }
 
-        do
-        {
-            gint status;
+    g_mutex_unlock (&search_index_lock);
+}
 
-            if (data->stopped)
-            {
-                broken_pipe = TRUE;
-                break;
-            }
 
-            do
-            {
-                status = g_io_channel_read_line_string (ioc, string, NULL, &error);
+void gnome_cmd_search_dialog_stop_index_update ()
+{
+    g_mutex_lock (&search_index_lock);
 
-                if (status == G_IO_STATUS_EOF)
-                    broken_pipe = TRUE;
-                else
-                    if (status == G_IO_STATUS_AGAIN)
-                        while (gtk_events_pending ())
-                        {
-                            if (data->stopped)
-                                return FALSE;
-
-                            gtk_main_iteration ();
-                        }
-            }
-            while (status == G_IO_STATUS_AGAIN && !broken_pipe);
+    if (search_index_thread)
+    {
+        g_atomic_int_set (&search_index_cancelled, TRUE);
+        g_thread_join (search_index_thread);
+        search_index_thread = NULL;
+    }
 
-            if (broken_pipe)
-                break;
+    g_mutex_unlock (&search_index_lock);
+}
 
-            if (status != G_IO_STATUS_NORMAL)
-            {
-                if (error)
-                {
-                    g_warning ("handle_search_command_stdout_io(): %s", error->message);
-                    g_error_free (error);
-                }
-                continue;
-            }
 
-            string = g_string_truncate (string, string->len - 1);
+static void search_local_path (SearchData *data, const gchar *path, gint max_depth, gboolean update_index);
 
-            if (string->len <= 1)
-                continue;
 
-            gchar *utf8 = g_filename_display_name (string->str);
+static void on_unindexed_dir (const gchar *path, gint max_depth, SearchData *data)
+{
+    search_local_path (data, path, max_depth, FALSE);
+}
 
-            GnomeCmdFile *f = gnome_cmd_file_new (utf8);
 
-            if (f)
-                data->dialog->priv->result_list->append_file(f);
+/**
+ * Answers a search by name from the index of the file system @a path is
+ * on, if there is one. Directories that changed since it was written are
+ * read again, and the index is updated afterwards.
+ */
+static gboolean search_local_index (SearchData *data, const gchar *path, gint max_depth, gboolean update_index)
+{
+    gchar *root = search_index_mount_root (path);
 
-            g_free (utf8);
+    if (!root)
+        return FALSE;
 
-            gulong duration;
+    gchar *index_file = get_search_index_file (root);
+    SearchIndex *index = search_index_open (index_file);
+    gint err = ENOENT;
+    guint n_stale = 0;
 
-            g_timer_elapsed (timer, &duration);
+    if (index)
+    {
+        SearchIndexQuery query;
 
-            if (duration > GNOME_SEARCH_TOOL_REFRESH_DURATION)
-            {
-                while (gtk_events_pending ())
-                {
-                    if (data->stopped)
-                        return FALSE;
+        query.max_depth = max_depth;
+        query.name_matches = (SearchLocalNameFunc) local_name_matches;
+        query.found = (SearchLocalFunc) on_local_file_found;
+        query.unindexed_dir = (SearchIndexDirFunc) on_unindexed_dir;
+        query.user_data = data;
+        query.cancelled = (volatile gint *) &data->stopped;
 
-                    gtk_main_iteration ();
-                }
+        on_local_dir (path, data);
 
-                g_timer_reset (timer);
-            }
-        }
-        while (g_io_channel_get_buffer_condition (ioc) & G_IO_IN);
+        err = search_index_query (index, path, query, &n_stale);
 
-        g_string_free (string, TRUE);
-        g_timer_destroy (timer);
+        search_index_close (index);
     }
 
-    if (!(condition & G_IO_IN) || broken_pipe)
-    {
-        g_io_channel_shutdown (ioc, TRUE, NULL);
-
-        data->search_done = TRUE;
+    if (update_index && (err || n_stale) && !data->stopped)
+        start_search_index_update (index_file, root);
 
-        return FALSE;
-    }
+    g_free (index_file);
+    g_free (root);
 
-    return TRUE;
+    return err==0;
 }
 
 
-gboolean SearchData::start_local_search()
+static void search_local_path (SearchData *data, const gchar *path, gint max_depth, gboolean update_index)
 {
-    gchar *command = build_search_command();
+    SearchLocalParams params;
 
-    g_return_val_if_fail (command!=NULL, FALSE);
+    params.max_depth = max_depth;
+    params.name_matches = (SearchLocalNameFunc) local_name_matches;
+    params.found = (SearchLocalFunc) on_local_file_found;
+    params.entering_dir = (SearchLocalFunc) on_local_dir;
+    params.user_data = data;
+    params.cancelled = (volatile gint *) &data->stopped;
 
-    DEBUG ('g', "running: %s\n", command);
+    if (data->dialog->defaults.default_profile.content_search)
+    {
+        params.content_pattern = data->content_pattern.c_str();
+        // the same extended syntax 'grep -E' was given before the local engine replaced it
+        params.content_cflags = REG_EXTENDED | (data->dialog->defaults.default_profile.match_case ? 0 : REG_ICASE);
+    }
+    else
+        // the index only knows names, not content
+        if (gnome_cmd_data.options.search_index && search_local_index (data, path, max_depth, update_index))
+            return;
 
-    GError *error = NULL;
-    gchar **argv  = NULL;
-    gint child_stdout;
+    gint err = search_local (path, params);
 
-    if (!g_shell_parse_argv (command, NULL, &argv, &error))
-    {
-        gnome_cmd_error_message (_("Error parsing the search command."), error);
+    if (err)
+        g_warning (_("Failed to search %s: %s"), path, g_strerror (err));
+}
 
-        g_free (command);
-        g_strfreev (argv);
 
-        return FALSE;
-    }
+static gpointer perform_local_search (SearchData *data)
+{
+    search_local_path (data, data->local_path.c_str(), data->dialog->defaults.default_profile.max_depth, TRUE);
 
-    g_free (command);
+    delete data->name_filter;
+    data->name_filter = NULL;
 
-    if (!g_spawn_async_with_pipes (NULL, argv, NULL, GSpawnFlags (G_SPAWN_SEARCH_PATH | G_SPAWN_STDERR_TO_DEV_NULL), child_command_set_pgid_cb, NULL, NULL, NULL, &child_stdout, NULL, &error))
-    {
-        gnome_cmd_error_message (_("Error running the search command."), error);
+    data->search_done = TRUE;
 
-        g_strfreev (argv);
+    return NULL;
+}
+
+
+/**
+ * local search - directories are read and files matched natively, by one thread per CPU, or looked up in the file name index
+ */
+gboolean SearchData::start_local_search()
+{
+    gchar *path = GNOME_CMD_FILE (start_dir)->get_real_path();
 
+    if (!path)
         return FALSE;
-    }
 
-#ifdef G_OS_WIN32
-    GIOChannel *ioc_stdout = g_io_channel_win32_new_fd (child_stdout);
-#else
-    GIOChannel *ioc_stdout = g_io_channel_unix_new (child_stdout);
-#endif
+    local_path = path;
+    g_free (path);
 
-    g_io_channel_set_encoding (ioc_stdout, NULL, NULL);
-    g_io_channel_set_flags (ioc_stdout, G_IO_FLAG_NONBLOCK, NULL);
-    g_io_add_watch (ioc_stdout, GIOCondition (G_IO_IN | G_IO_HUP), (GIOFunc) handle_search_command_stdout_io, this);
+    name_filter = new Filter(dialog->defaults.default_profile.filename_pattern.c_str(), dialog->defaults.default_profile.match_case, dialog->defaults.default_profile.syntax);
+    content_pattern = dialog->defaults.default_profile.text_pattern;
+
+    if (!pdata.mutex)
+    {
+        pdata.mutex = g_new (GMutex, 1);
+        g_mutex_init (pdata.mutex);
+    }
 
-    g_io_channel_unref (ioc_stdout);
-    g_strfreev (argv);
+    thread = g_thread_new (NULL, (GThreadFunc) perform_local_search, this);
 
     return TRUE;
 }
@@ -923,7 +997,6 @@ void GnomeCmdSearchDialog::Private::on_dialog_response(GtkDialog *window, int re
                 data.dialog_destroyed = FALSE;
 
                 data.context_id = gtk_statusbar_get_context_id (GTK_STATUSBAR (dialog->priv->statusbar), "info");
-                data.content_regex = NULL;
                 data.match_dirs = NULL;
 
                 gchar *dir_str = gtk_file_chooser_get_uri (GTK_FILE_CHOOSER (dialog->priv->dir_browser));
@@ -1030,6 +1103,7 @@ void GnomeCmdSearchDialog::Private::on_dialog_response(GtkDialog *window, int re
         case GTK_RESPONSE_DELETE_EVENT:
         case GTK_RESPONSE_CANCEL:
         case GTK_RESPONSE_CLOSE:
+            gnome_cmd_search_dialog_stop_index_update ();
             gtk_widget_hide (*dialog);
             g_signal_stop_emission_by_name (dialog, "response");
             break;
@@ -34,6 +34,12 @@
 
 GType gnome_cmd_search_dialog_get_type ();
 
+/**
+ * Cancels the background update of a search index, if one is running,
+ * and waits for it to finish.
+ */
+void gnome_cmd_search_dialog_stop_index_update ();
+
 
 struct GnomeCmdSearchDialog
 {
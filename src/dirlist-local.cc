@@ -0,0 +1,305 @@
+/**
+ * @file dirlist-local.cc
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <dirent.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "local-fs.h"
+#include "dirlist-local.h"
+
+
+#define DIRENT_BUFFER_SIZE (256*1024)
+#define MAX_WORKERS 16
+
+
+struct ScanContext
+{
+    gint dirfd;
+    DirListLocalFunc func;
+    gpointer user_data;
+    volatile gint *cancelled;
+};
+
+
+struct ScanChunk
+{
+    gchar **names;
+    guint n;
+};
+
+
+inline gboolean is_cancelled (ScanContext *ctx)
+{
+    return ctx->cancelled && g_atomic_int_get (ctx->cancelled);
+}
+
+
+static gchar *read_symlink (gint dirfd, const gchar *name, gsize size_hint)
+{
+    gsize size = size_hint>0 ? size_hint+1 : 256;
+
+    for (;;)
+    {
+        gchar *buf = (gchar *) g_malloc (size);
+        ssize_t len = readlinkat (dirfd, name, buf, size);
+
+        if (len<0)
+        {
+            g_free (buf);
+            return NULL;
+        }
+
+        if ((gsize) len<size)
+        {
+            buf[len] = '\0';
+            return buf;
+        }
+
+        g_free (buf);
+        size *= 2;
+    }
+}
+
+
+static void stat_entry (gint dirfd, DirListLocalEntry &e)
+{
+    if (fstatat (dirfd, e.name, &e.st, AT_SYMLINK_NOFOLLOW)!=0)
+        return;
+
+    if (!S_ISLNK (e.st.st_mode))
+        return;
+
+    e.is_symlink = TRUE;
+    e.symlink_name = read_symlink (dirfd, e.name, e.st.st_size);
+
+    struct stat target;
+
+    if (fstatat (dirfd, e.name, &target, 0)==0)
+        e.st = target;
+    else
+        e.is_broken = TRUE;
+}
+
+
+static void process_chunk (ScanChunk *chunk, ScanContext *ctx)
+{
+    if (!is_cancelled (ctx))
+    {
+        DirListLocalEntry *entries = g_new0 (DirListLocalEntry, chunk->n);
+
+        for (guint i=0; i<chunk->n; ++i)
+        {
+            entries[i].name = chunk->names[i];
+            chunk->names[i] = NULL;
+            stat_entry (ctx->dirfd, entries[i]);
+        }
+
+        ctx->func (entries, chunk->n, ctx->user_data);
+
+        for (guint i=0; i<chunk->n; ++i)
+        {
+            g_free (entries[i].name);
+            g_free (entries[i].symlink_name);
+        }
+
+        g_free (entries);
+    }
+
+    for (guint i=0; i<chunk->n; ++i)
+        g_free (chunk->names[i]);
+
+    g_free (chunk->names);
+    g_free (chunk);
+}
+
+
+inline guint default_worker_count ()
+{
+    // stat() on network file systems is latency bound, so use more threads than CPUs
+    return CLAMP (g_get_num_processors () * 2, 2, MAX_WORKERS);
+}
+
+
+class ChunkDispatcher
+{
+    ScanContext *ctx;
+    guint chunk_size;
+    guint n_workers;
+    GThreadPool *pool;
+    ScanChunk *chunk;
+
+  public:
+
+    ChunkDispatcher(ScanContext *c, guint size, guint workers): ctx(c), chunk_size(size), n_workers(workers), pool(NULL), chunk(NULL)   {}
+
+    void add(const gchar *name);
+    void finish();
+};
+
+
+void ChunkDispatcher::add(const gchar *name)
+{
+    if (!chunk)
+    {
+        chunk = g_new0 (ScanChunk, 1);
+        chunk->names = g_new (gchar *, chunk_size);
+    }
+
+    chunk->names[chunk->n++] = g_strdup (name);
+
+    if (chunk->n<chunk_size)
+        return;
+
+    // the pool is only created once a directory turns out to be larger than a single chunk
+    if (!pool)
+        pool = g_thread_pool_new ((GFunc) process_chunk, ctx, n_workers, FALSE, NULL);
+
+    g_thread_pool_push (pool, chunk, NULL);
+    chunk = NULL;
+}
+
+
+void ChunkDispatcher::finish()
+{
+    if (chunk)
+        process_chunk (chunk, ctx);
+
+    chunk = NULL;
+
+    if (pool)
+        g_thread_pool_free (pool, FALSE, TRUE);
+
+    pool = NULL;
+}
+
+
+#ifdef SYS_getdents64
+struct linux_dirent64
+{
+    guint64        d_ino;
+    gint64         d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+
+
+static gint read_entries (gint dirfd, ChunkDispatcher &dispatcher, ScanContext *ctx)
+{
+    gchar *buf = (gchar *) g_malloc (DIRENT_BUFFER_SIZE);
+    gint err = 0;
+
+    while (!is_cancelled (ctx))
+    {
+        long nread = syscall (SYS_getdents64, dirfd, buf, DIRENT_BUFFER_SIZE);
+
+        if (nread<0)
+        {
+            err = errno;
+            break;
+        }
+
+        if (nread==0)
+            break;
+
+        for (long pos=0; pos<nread;)
+        {
+            linux_dirent64 *d = (linux_dirent64 *) (buf + pos);
+
+            if (!is_dot_or_dotdot (d->d_name))
+                dispatcher.add(d->d_name);
+
+            pos += d->d_reclen;
+        }
+    }
+
+    g_free (buf);
+
+    return err;
+}
+#else
+static gint read_entries (gint dirfd, ChunkDispatcher &dispatcher, ScanContext *ctx)
+{
+    gint fd = dup (dirfd);
+
+    if (fd<0)
+        return errno;
+
+    DIR *dir = fdopendir (fd);
+
+    if (!dir)
+    {
+        gint err = errno;
+        close (fd);
+        return err;
+    }
+
+    gint err = 0;
+
+    for (errno=0; !is_cancelled (ctx); errno=0)
+    {
+        struct dirent *d = readdir (dir);
+
+        if (!d)
+        {
+            err = errno;
+            break;
+        }
+
+        if (!is_dot_or_dotdot (d->d_name))
+            dispatcher.add(d->d_name);
+    }
+
+    closedir (dir);
+
+    return err;
+}
+#endif
+
+
+gint dirlist_local_scan (const gchar *path, DirListLocalFunc func, gpointer user_data, volatile gint *cancelled, guint chunk_size, guint n_workers)
+{
+    g_return_val_if_fail (path != NULL, EINVAL);
+    g_return_val_if_fail (func != NULL, EINVAL);
+
+    gint dirfd = open (path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (dirfd<0)
+        return errno;
+
+    ScanContext ctx = {dirfd, func, user_data, cancelled};
+    ChunkDispatcher dispatcher(&ctx, MAX (chunk_size, 1), n_workers ? n_workers : default_worker_count ());
+
+    gint err = read_entries (dirfd, dispatcher, &ctx);
+
+    dispatcher.finish();
+
+    close (dirfd);
+
+    return err;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file dirlist-local.h
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <sys/stat.h>
+
+#define DIRLIST_LOCAL_CHUNK_SIZE 512
+
+
+struct DirListLocalEntry
+{
+    gchar *name;
+    gchar *symlink_name;        // target of a symbolic link, NULL otherwise
+    struct stat st;             // attributes of the link target if it exists, of the entry itself otherwise
+    gboolean is_symlink;
+    gboolean is_broken;         // symbolic link pointing to nowhere
+};
+
+/**
+ * Called once for every chunk of entries, possibly from several worker
+ * threads at the same time. The callback may take over @a name and
+ * @a symlink_name by setting them to NULL, everything else is freed after
+ * it returns.
+ */
+typedef void (* DirListLocalFunc) (DirListLocalEntry *entries, guint n, gpointer user_data);
+
+/**
+ * Lists the local directory @a path without going through GnomeVFS.
+ * Names are read with large getdents64() batches and stat'ed in chunks of
+ * @a chunk_size on a pool of @a n_workers threads (0 = pick a default
+ * based on the number of CPUs). "." and ".." are skipped. Setting
+ * @a *cancelled to non-zero stops the listing as soon as possible.
+ *
+ * @returns 0 on success, an errno value otherwise
+ */
+gint dirlist_local_scan (const gchar *path,
+                         DirListLocalFunc func,
+                         gpointer user_data,
+                         volatile gint *cancelled=NULL,
+                         guint chunk_size=DIRLIST_LOCAL_CHUNK_SIZE,
+                         guint n_workers=0);
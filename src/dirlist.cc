@@ -23,6 +23,11 @@
 
 #include "gnome-cmd-includes.h"
 #include "dirlist.h"
+#include "dirlist-local.h"
+#include "gnome-cmd-con.h"
+#ifdef HAVE_SAMBA
+#include "gnome-cmd-con-smb.h"
+#endif
 #include "gnome-cmd-data.h"
 #include "utils.h"
 
@@ -86,11 +91,24 @@ static gboolean update_list_progress (GnomeCmdDir *dir)
 }
 
 
+inline GnomeVFSFileInfoOptions list_info_options (GnomeCmdDir *dir)
+{
+#ifdef HAVE_SAMBA
+    // samba workgroups and servers are recognized by their MIME type in create_file_list()
+    if (GNOME_CMD_IS_CON_SMB (gnome_cmd_dir_get_connection (dir)))
+        return (GnomeVFSFileInfoOptions) (GNOME_VFS_FILE_INFO_FOLLOW_LINKS | GNOME_VFS_FILE_INFO_GET_MIME_TYPE);
+#endif
+
+    // MIME types are detected lazily, see mime-loader.h
+    return GNOME_VFS_FILE_INFO_FOLLOW_LINKS;
+}
+
+
 inline void visprog_list (GnomeCmdDir *dir)
 {
     DEBUG('l', "visprog_list\n");
 
-    GnomeVFSFileInfoOptions infoOpts = (GnomeVFSFileInfoOptions) (GNOME_VFS_FILE_INFO_FOLLOW_LINKS | GNOME_VFS_FILE_INFO_GET_MIME_TYPE);
+    GnomeVFSFileInfoOptions infoOpts = list_info_options (dir);
 
     GnomeVFSURI *uri = GNOME_CMD_FILE (dir)->get_uri();
     gchar *uri_str = gnome_vfs_uri_to_string (uri, GNOME_VFS_URI_HIDE_PASSWORD);
@@ -113,7 +131,7 @@ inline void visprog_list (GnomeCmdDir *dir)
 
 inline void blocking_list (GnomeCmdDir *dir)
 {
-    GnomeVFSFileInfoOptions infoOpts = (GnomeVFSFileInfoOptions) (GNOME_VFS_FILE_INFO_FOLLOW_LINKS | GNOME_VFS_FILE_INFO_GET_MIME_TYPE);
+    GnomeVFSFileInfoOptions infoOpts = list_info_options (dir);
 
     gchar *uri_str = GNOME_CMD_FILE (dir)->get_uri_str();
     DEBUG('l', "blocking_list: %s\n", uri_str);
@@ -128,16 +146,242 @@ inline void blocking_list (GnomeCmdDir *dir)
 }
 
 
+/******************************************************
+ * Native listing of local directories
+ **/
+
+struct DirListJob
+{
+    gchar *path;
+    GThread *thread;
+
+    GMutex mutex;                 // protects infolist and counter, which are filled by the worker threads
+    GList *infolist;
+    gint counter;
+
+    gint error;
+    volatile gint cancelled;
+    volatile gint done;
+};
+
+
+inline GnomeVFSFileType mode_to_vfs_type (mode_t mode)
+{
+    if (S_ISREG (mode))   return GNOME_VFS_FILE_TYPE_REGULAR;
+    if (S_ISDIR (mode))   return GNOME_VFS_FILE_TYPE_DIRECTORY;
+    if (S_ISLNK (mode))   return GNOME_VFS_FILE_TYPE_SYMBOLIC_LINK;
+    if (S_ISFIFO (mode))  return GNOME_VFS_FILE_TYPE_FIFO;
+    if (S_ISSOCK (mode))  return GNOME_VFS_FILE_TYPE_SOCKET;
+    if (S_ISCHR (mode))   return GNOME_VFS_FILE_TYPE_CHARACTER_DEVICE;
+    if (S_ISBLK (mode))   return GNOME_VFS_FILE_TYPE_BLOCK_DEVICE;
+
+    return GNOME_VFS_FILE_TYPE_UNKNOWN;
+}
+
+
+// fills GnomeVFSFileInfo the same way the GnomeVFS file method does for FOLLOW_LINKS
+static GnomeVFSFileInfo *create_file_info (DirListLocalEntry &e)
+{
+    GnomeVFSFileInfo *info = gnome_vfs_file_info_new ();
+
+    info->name = e.name;
+    e.name = NULL;
+
+    if (!e.st.st_mode)                  // stat() failed, we know nothing more than the name
+        return info;
+
+    info->type = mode_to_vfs_type (e.st.st_mode);
+    info->permissions = (GnomeVFSFilePermissions) (e.st.st_mode & 07777);
+    info->flags = GNOME_VFS_FILE_FLAGS_LOCAL;
+    info->device = e.st.st_dev;
+    info->inode = e.st.st_ino;
+    info->link_count = e.st.st_nlink;
+    info->uid = e.st.st_uid;
+    info->gid = e.st.st_gid;
+    info->size = e.st.st_size;
+    info->block_count = e.st.st_blocks;
+    info->io_block_size = e.st.st_blksize;
+    info->atime = e.st.st_atime;
+    info->mtime = e.st.st_mtime;
+    info->ctime = e.st.st_ctime;
+
+    info->valid_fields = (GnomeVFSFileInfoFields) (GNOME_VFS_FILE_INFO_FIELDS_TYPE |
+                                                   GNOME_VFS_FILE_INFO_FIELDS_PERMISSIONS |
+                                                   GNOME_VFS_FILE_INFO_FIELDS_FLAGS |
+                                                   GNOME_VFS_FILE_INFO_FIELDS_DEVICE |
+                                                   GNOME_VFS_FILE_INFO_FIELDS_INODE |
+                                                   GNOME_VFS_FILE_INFO_FIELDS_LINK_COUNT |
+                                                   GNOME_VFS_FILE_INFO_FIELDS_SIZE |
+                                                   GNOME_VFS_FILE_INFO_FIELDS_BLOCK_COUNT |
+                                                   GNOME_VFS_FILE_INFO_FIELDS_IO_BLOCK_SIZE |
+                                                   GNOME_VFS_FILE_INFO_FIELDS_ATIME |
+                                                   GNOME_VFS_FILE_INFO_FIELDS_MTIME |
+                                                   GNOME_VFS_FILE_INFO_FIELDS_CTIME);
+
+    if (e.is_symlink)
+    {
+        info->flags = (GnomeVFSFileFlags) (info->flags | GNOME_VFS_FILE_FLAGS_SYMLINK);
+        info->symlink_name = e.symlink_name;
+        e.symlink_name = NULL;
+        info->valid_fields = (GnomeVFSFileInfoFields) (info->valid_fields | GNOME_VFS_FILE_INFO_FIELDS_SYMLINK_NAME);
+    }
+
+    // MIME types of other files are detected lazily, see mime-loader.h
+    if (info->type == GNOME_VFS_FILE_TYPE_DIRECTORY)
+    {
+        info->mime_type = g_strdup ("x-directory/normal");
+        info->valid_fields = (GnomeVFSFileInfoFields) (info->valid_fields | GNOME_VFS_FILE_INFO_FIELDS_MIME_TYPE);
+    }
+
+    return info;
+}
+
+
+static void on_local_chunk_listed (DirListLocalEntry *entries, guint n, DirListJob *job)
+{
+    GList *chunk = NULL;
+
+    for (guint i=0; i<n; ++i)
+        chunk = g_list_prepend (chunk, create_file_info (entries[i]));
+
+    g_mutex_lock (&job->mutex);
+    job->infolist = g_list_concat (chunk, job->infolist);
+    job->counter += n;
+    g_mutex_unlock (&job->mutex);
+}
+
+
+static gpointer local_list_thread_func (DirListJob *job)
+{
+    job->error = dirlist_local_scan (job->path, (DirListLocalFunc) on_local_chunk_listed, job, &job->cancelled);
+    g_atomic_int_set (&job->done, TRUE);
+
+    return NULL;
+}
+
+
+static DirListJob *dir_list_job_new (GnomeCmdDir *dir)
+{
+    DirListJob *job = g_new0 (DirListJob, 1);
+
+    job->path = GNOME_CMD_FILE (dir)->get_real_path();
+    g_mutex_init (&job->mutex);
+
+    return job;
+}
+
+
+static void dir_list_job_free (DirListJob *job)
+{
+    g_list_foreach (job->infolist, (GFunc) gnome_vfs_file_info_unref, NULL);
+    g_list_free (job->infolist);
+    g_mutex_clear (&job->mutex);
+    g_free (job->path);
+    g_free (job);
+}
+
+
+// moves the entries collected so far by the worker threads to dir->infolist
+static void fetch_local_entries (GnomeCmdDir *dir, DirListJob *job)
+{
+    g_mutex_lock (&job->mutex);
+    dir->infolist = g_list_concat (job->infolist, dir->infolist);
+    dir->list_counter = job->counter;
+    job->infolist = NULL;
+    g_mutex_unlock (&job->mutex);
+}
+
+
+inline void finish_local_list (GnomeCmdDir *dir, DirListJob *job)
+{
+    fetch_local_entries (dir, job);
+
+    if (dir->state == GnomeCmdDir::STATE_LISTING)
+    {
+        dir->list_result = job->error ? gnome_vfs_result_from_errno_code (job->error) : GNOME_VFS_OK;
+        dir->state = job->error ? GnomeCmdDir::STATE_EMPTY : GnomeCmdDir::STATE_LISTED;
+    }
+
+    DEBUG('l', "Native listing of %s finished: %d files, %s\n", job->path, dir->list_counter, g_strerror (job->error));
+
+    dir_list_job_free (job);
+}
+
+
+static gboolean update_local_list_progress (GnomeCmdDir *dir)
+{
+    DirListJob *job = dir->list_job;
+
+    if (!g_atomic_int_get (&job->done))
+    {
+        fetch_local_entries (dir, job);
+
+        if (dir->state == GnomeCmdDir::STATE_LISTING)
+        {
+            gchar *msg = g_strdup_printf (ngettext ("%d file listed", "%d files listed", dir->list_counter), dir->list_counter);
+            gtk_label_set_text (GTK_LABEL (dir->label), msg);
+            progress_bar_update (dir->pbar, 50);
+            g_free (msg);
+        }
+
+        return TRUE;
+    }
+
+    g_thread_join (job->thread);
+    dir->list_job = NULL;
+    finish_local_list (dir, job);
+
+    DEBUG ('l', "calling list_done func\n");
+    dir->done_func (dir, dir->infolist, dir->list_result);
+
+    return FALSE;
+}
+
+
+inline void visprog_local_list (GnomeCmdDir *dir)
+{
+    DEBUG('l', "visprog_local_list\n");
+
+    dir->list_job = dir_list_job_new (dir);
+    dir->list_job->thread = g_thread_new ("dirlist", (GThreadFunc) local_list_thread_func, dir->list_job);
+
+    g_timeout_add (gnome_cmd_data.gui_update_rate, (GSourceFunc) update_local_list_progress, dir);
+}
+
+
+inline void blocking_local_list (GnomeCmdDir *dir)
+{
+    DirListJob *job = dir_list_job_new (dir);
+
+    DEBUG('l', "blocking_local_list: %s\n", job->path);
+
+    local_list_thread_func (job);
+    finish_local_list (dir, job);
+
+    dir->done_func (dir, dir->infolist, dir->list_result);
+}
+
+
 void dirlist_list (GnomeCmdDir *dir, gboolean visprog)
 {
     g_return_if_fail (GNOME_CMD_IS_DIR (dir));
 
     dir->infolist = NULL;
     dir->list_handle = NULL;
+    dir->list_job = NULL;
     dir->list_counter = 0;
     dir->list_result = GNOME_VFS_OK;
     dir->state = GnomeCmdDir::STATE_LISTING;
 
+    if (gnome_cmd_dir_is_local (dir))
+    {
+        if (visprog)
+            visprog_local_list (dir);
+        else
+            blocking_local_list (dir);
+        return;
+    }
+
     if (!visprog)
     {
         blocking_list (dir);
@@ -153,6 +397,14 @@ void dirlist_cancel (GnomeCmdDir *dir)
     dir->state = GnomeCmdDir::STATE_EMPTY;
     dir->list_result = GNOME_VFS_OK;
 
+    if (dir->list_job)
+    {
+        // the worker threads are stopped and joined by update_local_list_progress()
+        DEBUG('l', "Cancelling native listing\n");
+        g_atomic_int_set (&dir->list_job->cancelled, TRUE);
+        return;
+    }
+
     DEBUG('l', "Calling async_cancel\n");
     gnome_vfs_async_cancel (dir->list_handle);
 }
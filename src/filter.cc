@@ -66,7 +66,7 @@ Filter::~Filter()
 
 gboolean Filter::match(const gchar *text)
 {
-    static regmatch_t _match;
+    regmatch_t _match;      // not static, the search matches names from several threads
 
     switch (type)
     {
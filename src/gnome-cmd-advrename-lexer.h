@@ -29,4 +29,16 @@
 
 void gnome_cmd_advrename_reset_counter(int n, long start=1, int precision=-1, int step=1);
 void gnome_cmd_advrename_parse_template(const char *template_string, gboolean &has_counters);
-char *gnome_cmd_advrename_gen_fname(GnomeCmdFile *f, size_t new_fname_size=NAME_MAX);
+
+/**
+ * Returns the GnomeCmdTagClass bits of the metatags in the template
+ * parsed last, besides TAG_FILE.
+ */
+int gnome_cmd_advrename_template_tag_classes();
+
+/**
+ * Returns the new name of @a f, the file in row @a index of the files to
+ * be renamed, which sets the value of the counters. The rows may be done
+ * in any order.
+ */
+char *gnome_cmd_advrename_gen_fname(GnomeCmdFile *f, long index, size_t new_fname_size=NAME_MAX);
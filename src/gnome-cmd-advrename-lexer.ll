@@ -76,7 +76,7 @@ struct CHUNK
 
     struct
     {
-      long n;
+      long n;           // the value for the first file
       int step;
       int prec;
       int init_step;
@@ -400,6 +400,24 @@ void gnome_cmd_advrename_parse_template(const char *template_string, gboolean &h
 }
 
 
+int gnome_cmd_advrename_template_tag_classes()
+{
+  int tag_classes = TAG_NONE_CLASS;
+
+  for (vector<CHUNK *>::const_iterator i=fname_template.begin(); i!=fname_template.end(); ++i)
+    if ((*i)->type==METATAG)
+    {
+      GnomeCmdTagClass tag_class = gcmd_tags_get_class((*i)->tag.tag);
+
+      // file tags are no more than what is known about the file already
+      if (tag_class!=TAG_FILE)
+        tag_classes |= tag_class;
+    }
+
+  return tag_classes;
+}
+
+
 inline void mk_substr (int src_len, const CHUNK *p, int &pos, int &len)
 {
   pos = p->tag.beg<0 ? p->tag.beg+src_len : p->tag.beg;
@@ -483,7 +501,7 @@ inline gboolean convert (char *s, char from, char to)
 }
 
 
-char *gnome_cmd_advrename_gen_fname (GnomeCmdFile *f, size_t new_fname_size)
+char *gnome_cmd_advrename_gen_fname (GnomeCmdFile *f, long index, size_t new_fname_size)
 {
   if (fname_template.empty())
     return g_strdup ("");
@@ -545,13 +563,11 @@ char *gnome_cmd_advrename_gen_fname (GnomeCmdFile *f, size_t new_fname_size)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wformat-nonliteral"
 #endif
-                      snprintf (counter_value, MAX_PRECISION+1, (*i)->counter.fmt, (*i)->counter.n);
+                      snprintf (counter_value, MAX_PRECISION+1, (*i)->counter.fmt, (*i)->counter.n + index*(*i)->counter.step);
 #if defined (__GNUC__)
 #pragma GCC diagnostic pop
 #endif
                       fmt += counter_value;
-
-                      (*i)->counter.n += (*i)->counter.step;
                     }
                     break;
 
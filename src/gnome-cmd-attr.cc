@@ -0,0 +1,132 @@
+/**
+ * @file gnome-cmd-attr.cc
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include "gnome-cmd-includes.h"
+#include "gnome-cmd-attr.h"
+#include "gnome-cmd-file.h"
+#include "gnome-cmd-main-win.h"
+#include "gnome-cmd-user-actions.h"
+#include "gnome-cmd-xfer-progress-win.h"
+#include "gnome-cmd-data.h"
+#include "utils.h"
+
+using namespace std;
+
+
+#define ATTR_WIN_DELAY_USEC     (G_USEC_PER_SEC / 2)   // quick changes are done without a progress window
+
+
+struct AttrData
+{
+    AttrLocalJob *job;
+    GnomeCmdXferProgressWin *win;
+    gint64 start_time;
+};
+
+
+static void show_errors (AttrLocalJob *job)
+{
+    gchar *path = NULL;
+    gint error = 0;
+    guint n_errors = attr_local_job_get_errors (job, &path, &error);
+
+    if (!n_errors)
+        return;
+
+    gchar *msg = n_errors==1 ? g_strdup_printf (_("Could not change %s"), path) :
+                               g_strdup_printf (ngettext ("Could not change %u file, the first was %s",
+                                                          "Could not change %u files, the first was %s",
+                                                          n_errors), n_errors, path);
+
+    gnome_cmd_show_message (*main_win, msg, g_strerror (error));
+
+    g_free (msg);
+    g_free (path);
+}
+
+
+static gboolean update_attr_gui_func (AttrData *data)
+{
+    if (data->win && data->win->cancel_pressed)
+        attr_local_job_cancel (data->job);
+
+    guint64 files, changed;
+
+    if (attr_local_job_get_progress (data->job, &files, &changed))
+    {
+        if (data->win)
+            gtk_widget_destroy (GTK_WIDGET (data->win));
+
+        show_errors (data->job);
+        attr_local_job_free (data->job);
+        g_free (data);
+
+        view_refresh (NULL, NULL);
+
+        return FALSE;
+    }
+
+    if (!data->win && g_get_monotonic_time () - data->start_time>=ATTR_WIN_DELAY_USEC)
+    {
+        data->win = GNOME_CMD_XFER_PROGRESS_WIN (gnome_cmd_xfer_progress_win_new ());
+        gnome_cmd_xfer_progress_win_set_action (data->win, _("changing…"));
+        gtk_widget_show (GTK_WIDGET (data->win));
+    }
+
+    if (data->win && !data->win->cancel_pressed)
+    {
+        gchar *msg = g_strdup_printf (ngettext ("%lu file looked at, %lu changed",
+                                                "%lu files looked at, %lu changed",
+                                                files),
+                                      (gulong) files, (gulong) changed);
+
+        gnome_cmd_xfer_progress_win_set_msg (data->win, msg);
+        gtk_progress_bar_pulse (GTK_PROGRESS_BAR (data->win->totalprog));
+
+        g_free (msg);
+    }
+
+    return TRUE;
+}
+
+
+void gnome_cmd_attr_start (GList *files, const AttrLocalChange &change, gboolean recursive)
+{
+    GList *paths = NULL;
+
+    for (GList *i = files; i; i = i->next)
+        paths = g_list_append (paths, GNOME_CMD_FILE (i->data)->get_real_path());
+
+    if (!paths)
+        return;
+
+    AttrData *data = g_new0 (AttrData, 1);
+
+    data->job = attr_local_job_new (paths, &change, recursive);
+    data->start_time = g_get_monotonic_time ();
+
+    g_list_foreach (paths, (GFunc) g_free, NULL);
+    g_list_free (paths);
+
+    g_timeout_add (gnome_cmd_data.gui_update_rate, (GSourceFunc) update_attr_gui_func, data);
+}
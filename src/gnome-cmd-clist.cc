@@ -232,6 +232,10 @@ static void draw_row (GtkCList *clist, GdkRectangle *area, gint row, GtkCListRow
     if (!clist_row)
         clist_row = (GtkCListRow *) ROW_ELEMENT (clist, row)->data;
 
+    // rows may be filled in only when they are shown
+    if (GNOME_CMD_CLIST (clist)->format_row_func)
+        GNOME_CMD_CLIST (clist)->format_row_func (GNOME_CMD_CLIST (clist), row, clist_row, GNOME_CMD_CLIST (clist)->format_row_data);
+
     // rectangle of the entire row
     row_rectangle.x = 0;
     row_rectangle.y = ROW_TOP_YPIXEL (clist, row);
@@ -548,6 +552,8 @@ static void class_init (GnomeCmdCListClass *klass)
 static void init (GnomeCmdCList *clist)
 {
     clist->drag_motion_row = -1;
+    clist->format_row_func = NULL;
+    clist->format_row_data = NULL;
 
     gtk_clist_set_selection_mode (GTK_CLIST (clist), GTK_SELECTION_SINGLE);
 
@@ -650,3 +656,96 @@ void gnome_cmd_clist_set_drag_row (GnomeCmdCList *clist, gint row)
     if (row >= 0)
         draw_row (GTK_CLIST (clist), NULL, row, NULL);
 }
+
+
+void gnome_cmd_clist_set_format_row_func (GnomeCmdCList *clist, GnomeCmdCListFormatRowFunc func, gpointer user_data)
+{
+    g_return_if_fail (GNOME_CMD_IS_CLIST (clist));
+
+    clist->format_row_func = func;
+    clist->format_row_data = user_data;
+}
+
+
+void gnome_cmd_clist_row_set_text (GnomeCmdCList *clist, GtkCListRow *clist_row, gint column, const gchar *text)
+{
+    g_return_if_fail (clist_row != NULL);
+    g_return_if_fail (column>=0 && column<GTK_CLIST (clist)->columns);
+
+    GTK_CLIST_GET_CLASS (clist)->set_cell_contents (GTK_CLIST (clist), clist_row, column, text ? GTK_CELL_TEXT : GTK_CELL_EMPTY, text, 0, NULL, NULL);
+}
+
+
+void gnome_cmd_clist_row_set_pixmap (GnomeCmdCList *clist, GtkCListRow *clist_row, gint column, GdkPixmap *pixmap, GdkBitmap *mask)
+{
+    g_return_if_fail (clist_row != NULL);
+    g_return_if_fail (column>=0 && column<GTK_CLIST (clist)->columns);
+
+    // set_cell_contents() takes over the references
+    g_object_ref (pixmap);
+    if (mask)
+        g_object_ref (mask);
+
+    GTK_CLIST_GET_CLASS (clist)->set_cell_contents (GTK_CLIST (clist), clist_row, column, GTK_CELL_PIXMAP, NULL, 0, pixmap, mask);
+}
+
+
+void gnome_cmd_clist_row_set_style (GnomeCmdCList *clist, GtkCListRow *clist_row, GtkStyle *style)
+{
+    g_return_if_fail (clist_row != NULL);
+
+    if (clist_row->style == style)
+        return;
+
+    // the same as gtk_clist_set_row_style(), but without the column width updates, the file list has fixed widths
+    if (clist_row->style)
+    {
+        if (GTK_WIDGET_REALIZED (clist))
+            gtk_style_detach (clist_row->style);
+        g_object_unref (clist_row->style);
+    }
+
+    clist_row->style = style;
+
+    if (clist_row->style)
+    {
+        g_object_ref (clist_row->style);
+        if (GTK_WIDGET_REALIZED (clist))
+            clist_row->style = gtk_style_attach (clist_row->style, GTK_CLIST (clist)->clist_window);
+    }
+}
+
+
+void gnome_cmd_clist_row_set_colors (GnomeCmdCList *clist, GtkCListRow *clist_row, GdkColor *fg, GdkColor *bg)
+{
+    g_return_if_fail (clist_row != NULL);
+
+    GdkColormap *colormap = gtk_widget_get_colormap (GTK_WIDGET (clist));
+
+    clist_row->fg_set = fg != NULL;
+    clist_row->bg_set = bg != NULL;
+
+    if (fg)
+    {
+        clist_row->foreground = *fg;
+        if (GTK_WIDGET_REALIZED (clist))
+            gdk_colormap_alloc_color (colormap, &clist_row->foreground, FALSE, TRUE);
+    }
+
+    if (bg)
+    {
+        clist_row->background = *bg;
+        if (GTK_WIDGET_REALIZED (clist))
+            gdk_colormap_alloc_color (colormap, &clist_row->background, FALSE, TRUE);
+    }
+}
+
+
+void gnome_cmd_clist_row_clear (GnomeCmdCList *clist, GtkCListRow *clist_row)
+{
+    g_return_if_fail (clist_row != NULL);
+
+    for (gint i=0; i<GTK_CLIST (clist)->columns; ++i)
+        if (clist_row->cell[i].type != GTK_CELL_EMPTY)
+            GTK_CLIST_GET_CLASS (clist)->set_cell_contents (GTK_CLIST (clist), clist_row, i, GTK_CELL_EMPTY, NULL, 0, NULL, NULL);
+}
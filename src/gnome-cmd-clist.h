@@ -28,11 +28,18 @@
 #define GNOME_CMD_CLIST_GET_CLASS(obj)    (G_TYPE_INSTANCE_GET_CLASS((obj), GNOME_CMD_TYPE_CLIST, GnomeCmdCListClass))
 
 
+struct GnomeCmdCList;
+
+typedef void (* GnomeCmdCListFormatRowFunc) (GnomeCmdCList *clist, gint row, GtkCListRow *clist_row, gpointer user_data);
+
 struct GnomeCmdCList
 {
     GtkCList parent;
 
     gint drag_motion_row;
+
+    GnomeCmdCListFormatRowFunc format_row_func;
+    gpointer format_row_data;
 };
 
 
@@ -59,3 +66,20 @@ void gnome_cmd_clist_set_voffset (GnomeCmdCList *clist, gint voffset);
 
 gint gnome_cmd_clist_get_row (GnomeCmdCList *clist, gint x, gint y);
 void gnome_cmd_clist_set_drag_row (GnomeCmdCList *clist, gint row);
+
+/**
+ * Lets rows be appended without their content: @a func is called right
+ * before a row is drawn and may fill it in with the gnome_cmd_clist_row_*()
+ * functions below.
+ */
+void gnome_cmd_clist_set_format_row_func (GnomeCmdCList *clist, GnomeCmdCListFormatRowFunc func, gpointer user_data);
+
+/**
+ * Counterparts of gtk_clist_set_text() & co. that take the row itself, so
+ * they don't have to walk the row list, and that don't redraw it.
+ */
+void gnome_cmd_clist_row_set_text (GnomeCmdCList *clist, GtkCListRow *clist_row, gint column, const gchar *text);
+void gnome_cmd_clist_row_set_pixmap (GnomeCmdCList *clist, GtkCListRow *clist_row, gint column, GdkPixmap *pixmap, GdkBitmap *mask);
+void gnome_cmd_clist_row_set_style (GnomeCmdCList *clist, GtkCListRow *clist_row, GtkStyle *style);
+void gnome_cmd_clist_row_set_colors (GnomeCmdCList *clist, GtkCListRow *clist_row, GdkColor *fg, GdkColor *bg);
+void gnome_cmd_clist_row_clear (GnomeCmdCList *clist, GtkCListRow *clist_row);
@@ -1370,6 +1370,10 @@ GnomeCmdData::Options::Options(const Options &cfg)
     save_dir_history_on_exit = cfg.save_dir_history_on_exit;
     save_cmdline_history_on_exit = cfg.save_cmdline_history_on_exit;
     save_search_history_on_exit = cfg.save_search_history_on_exit;
+    search_index = cfg.search_index;
+    transfer_log = cfg.transfer_log;
+    transfer_checksums = cfg.transfer_checksums;
+    transfers_per_device = cfg.transfers_per_device;
     symlink_prefix = g_strdup (cfg.symlink_prefix);
     main_win_pos[0] = cfg.main_win_pos[0];
     main_win_pos[1] = cfg.main_win_pos[1];
@@ -1433,6 +1437,10 @@ GnomeCmdData::Options &GnomeCmdData::Options::operator = (const Options &cfg)
         save_dir_history_on_exit = cfg.save_dir_history_on_exit;
         save_cmdline_history_on_exit = cfg.save_cmdline_history_on_exit;
         save_search_history_on_exit = cfg.save_search_history_on_exit;
+        search_index = cfg.search_index;
+        transfer_log = cfg.transfer_log;
+        transfer_checksums = cfg.transfer_checksums;
+        transfers_per_device = cfg.transfers_per_device;
         symlink_prefix = g_strdup (cfg.symlink_prefix);
         main_win_pos[0] = cfg.main_win_pos[0];
         main_win_pos[1] = cfg.main_win_pos[1];
@@ -3659,6 +3667,10 @@ void GnomeCmdData::load()
     options.save_dir_history_on_exit = g_settings_get_boolean (options.gcmd_settings->general, GCMD_SETTINGS_SAVE_DIR_HISTORY_ON_EXIT);
     options.save_cmdline_history_on_exit = g_settings_get_boolean (options.gcmd_settings->general, GCMD_SETTINGS_SAVE_CMDLINE_HISTORY_ON_EXIT);
     options.save_search_history_on_exit = g_settings_get_boolean (options.gcmd_settings->general, GCMD_SETTINGS_SAVE_SEARCH_HISTORY_ON_EXIT);
+    options.search_index = g_settings_get_boolean (options.gcmd_settings->general, GCMD_SETTINGS_SEARCH_INDEX);
+    options.transfer_log = g_settings_get_boolean (options.gcmd_settings->general, GCMD_SETTINGS_TRANSFER_LOG);
+    options.transfer_checksums = g_settings_get_boolean (options.gcmd_settings->general, GCMD_SETTINGS_TRANSFER_CHECKSUMS);
+    options.transfers_per_device = g_settings_get_uint (options.gcmd_settings->general, GCMD_SETTINGS_TRANSFERS_PER_DEVICE);
 
     options.always_show_tabs = g_settings_get_boolean (options.gcmd_settings->general, GCMD_SETTINGS_ALWAYS_SHOW_TABS);
     options.tab_lock_indicator = (TabLockIndicator) g_settings_get_enum (options.gcmd_settings->general, GCMD_SETTINGS_TAB_LOCK_INDICATOR);
@@ -4270,6 +4282,10 @@ void GnomeCmdData::save()
     set_gsettings_when_changed      (options.gcmd_settings->general, GCMD_SETTINGS_SAVE_DIR_HISTORY_ON_EXIT, &(options.save_dir_history_on_exit));
     set_gsettings_when_changed      (options.gcmd_settings->general, GCMD_SETTINGS_SAVE_CMDLINE_HISTORY_ON_EXIT, &(options.save_cmdline_history_on_exit));
     set_gsettings_when_changed      (options.gcmd_settings->general, GCMD_SETTINGS_SAVE_SEARCH_HISTORY_ON_EXIT, &(options.save_search_history_on_exit));
+    set_gsettings_when_changed      (options.gcmd_settings->general, GCMD_SETTINGS_SEARCH_INDEX, &(options.search_index));
+    set_gsettings_when_changed      (options.gcmd_settings->general, GCMD_SETTINGS_TRANSFER_LOG, &(options.transfer_log));
+    set_gsettings_when_changed      (options.gcmd_settings->general, GCMD_SETTINGS_TRANSFER_CHECKSUMS, &(options.transfer_checksums));
+    set_gsettings_when_changed      (options.gcmd_settings->general, GCMD_SETTINGS_TRANSFERS_PER_DEVICE, &(options.transfers_per_device));
 
     set_gsettings_when_changed      (options.gcmd_settings->general, GCMD_SETTINGS_ALWAYS_SHOW_TABS, &(options.always_show_tabs));
     set_gsettings_enum_when_changed (options.gcmd_settings->general, GCMD_SETTINGS_TAB_LOCK_INDICATOR, options.tab_lock_indicator);
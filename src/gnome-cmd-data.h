@@ -88,6 +88,10 @@ GcmdSettings *gcmd_settings_new (void);
 #define GCMD_SETTINGS_SAVE_DIR_HISTORY_ON_EXIT        "save-dir-history-on-exit"
 #define GCMD_SETTINGS_SAVE_CMDLINE_HISTORY_ON_EXIT    "save-cmdline-history-on-exit"
 #define GCMD_SETTINGS_SAVE_SEARCH_HISTORY_ON_EXIT     "save-search-history-on-exit"
+#define GCMD_SETTINGS_SEARCH_INDEX                    "search-index"
+#define GCMD_SETTINGS_TRANSFER_LOG                    "transfer-log"
+#define GCMD_SETTINGS_TRANSFER_CHECKSUMS              "transfer-checksums"
+#define GCMD_SETTINGS_TRANSFERS_PER_DEVICE            "transfers-per-device"
 #define GCMD_SETTINGS_ALWAYS_SHOW_TABS                "always-show-tabs"
 #define GCMD_SETTINGS_TAB_LOCK_INDICATOR              "tab-lock-indicator"
 #define GCMD_SETTINGS_MAIN_WIN_STATE                  "main-win-state"
@@ -267,6 +271,10 @@ struct GnomeCmdData
         gboolean                     save_dir_history_on_exit;
         gboolean                     save_cmdline_history_on_exit;
         gboolean                     save_search_history_on_exit;
+        gboolean                     search_index;
+        gboolean                     transfer_log;
+        gboolean                     transfer_checksums;
+        gint                         transfers_per_device;
         gchar                       *symlink_prefix;
         gint                         main_win_pos[2];
         // Format
@@ -327,6 +335,10 @@ struct GnomeCmdData
                    save_dir_history_on_exit(TRUE),
                    save_cmdline_history_on_exit(TRUE),
                    save_search_history_on_exit(TRUE),
+                   search_index(FALSE),
+                   transfer_log(FALSE),
+                   transfer_checksums(FALSE),
+                   transfers_per_device(1),
                    symlink_prefix(NULL),
                    size_disp_mode(GNOME_CMD_SIZE_DISP_MODE_POWERED),
                    perm_disp_mode(GNOME_CMD_PERM_DISP_MODE_TEXT),
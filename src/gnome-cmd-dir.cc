@@ -431,11 +431,11 @@ static GList *create_file_list (GnomeCmdDir *dir, GList *info_list)
                                                                             gnome_cmd_file_new (info, dir);
 
             gnome_cmd_file_ref (f);
-            file_list = g_list_append (file_list, f);
+            file_list = g_list_prepend (file_list, f);
         }
     }
 
-    return file_list;
+    return g_list_reverse (file_list);
 }
 
 
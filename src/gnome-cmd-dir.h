@@ -34,6 +34,7 @@ GType gnome_cmd_dir_get_type ();
 
 struct GnomeCmdDir;
 struct GnomeCmdDirPrivate;
+struct DirListJob;
 
 typedef void (* DirListDoneFunc) (GnomeCmdDir *dir, GList *files, GnomeVFSResult result);
 
@@ -60,6 +61,7 @@ struct GnomeCmdDir
     gint voffset;
     GList *infolist;
     GnomeVFSAsyncHandle *list_handle;
+    DirListJob *list_job;               // native listing of local directories, see dirlist.cc
     GnomeVFSResult list_result;
     gint list_counter;
     State state;
@@ -67,6 +67,36 @@ gboolean GnomeCmdFileCollection::remove(const gchar *uri_str)
 }
 
 
+void GnomeCmdFileCollection::remove(GList *files)
+{
+    if (!files)
+        return;
+
+    GHashTable *removed = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    for (GList *i=files; i; i=i->next)
+        g_hash_table_insert (removed, i->data, i->data);
+
+    GList *kept = NULL;
+
+    for (GList *i=list; i; i=i->next)
+        if (!g_hash_table_lookup (removed, i->data))
+            kept = g_list_prepend (kept, i->data);
+
+    g_list_free (list);
+    list = g_list_reverse (kept);
+
+    for (GList *i=files; i; i=i->next)
+    {
+        gchar *uri_str = GNOME_CMD_FILE (i->data)->get_uri_str();
+        g_hash_table_remove (map, uri_str);
+        g_free (uri_str);
+    }
+
+    g_hash_table_destroy (removed);
+}
+
+
 GnomeCmdFile *GnomeCmdFileCollection::find(const gchar *uri_str)
 {
     g_return_val_if_fail (uri_str != NULL, NULL);
@@ -90,3 +120,10 @@ GList *GnomeCmdFileCollection::sort(GCompareDataFunc compare_func, gpointer user
 
     return list;
 }
+
+
+void GnomeCmdFileCollection::reorder(GList *files)
+{
+    g_list_free (list);
+    list = files;
+}
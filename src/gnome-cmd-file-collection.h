@@ -42,12 +42,19 @@ class GnomeCmdFileCollection
     void add(GList *files);
     gboolean remove(GnomeCmdFile *f);
     gboolean remove(const gchar *uri_str);
+    void remove(GList *files);
 
     GList *get_list()   {  return list;  }
 
     GnomeCmdFile *find(const gchar *uri_str);
 
     GList *sort(GCompareDataFunc compare_func, gpointer user_data);
+
+    /**
+     * Replaces the list with @a files, which has to hold the same files
+     * in a different order. The collection takes over @a files.
+     */
+    void reorder(GList *files);
 };
 
 
@@ -67,6 +74,16 @@ inline GnomeCmdFileCollection::~GnomeCmdFileCollection()
 
 inline void GnomeCmdFileCollection::add(GList *files)
 {
+    GList *added = NULL;
+
     for (; files; files = files->next)
-        add(GNOME_CMD_FILE (files->data));
+    {
+        GnomeCmdFile *f = GNOME_CMD_FILE (files->data);
+
+        g_hash_table_insert (map, f->get_uri_str(), f);
+        f->ref();
+        added = g_list_prepend (added, f);
+    }
+
+    list = g_list_concat (list, g_list_reverse (added));
 }
@@ -21,6 +21,7 @@
 
 #include <config.h>
 #include <stdio.h>
+#include <map>
 #include <glib-object.h>
 #include <libgnomeui/gnome-popup-menu.h>
 
@@ -32,6 +33,7 @@
 #include "gnome-cmd-main-win.h"
 #include "gnome-cmd-plain-path.h"
 #include "utils.h"
+#include "tree-size.h"
 #include "gnome-cmd-data.h"
 #include "gnome-cmd-xfer.h"
 #include "imageloader.h"
@@ -40,7 +42,9 @@
 #include "gnome-cmd-file-popmenu.h"
 #include "gnome-cmd-quicksearch-popup.h"
 #include "gnome-cmd-file-collection.h"
+#include "gnome-cmd-sorted-index.h"
 #include "ls_colors.h"
+#include "mime-loader.h"
 #include "dialogs/gnome-cmd-delete-dialog.h"
 #include "dialogs/gnome-cmd-patternsel-dialog.h"
 #include "dialogs/gnome-cmd-rename-dialog.h"
@@ -61,6 +65,18 @@ using namespace std;
 
 #define FL_PBAR_MAX 50
 
+/* Monitor events are collected for gui_update_rate ms. Batches with more changes than
+ * this (or than there are rows) are merged into the list at once instead of being
+ * applied row by row.
+ */
+#define DIR_CHANGES_INCREMENTAL_MAX 1000u
+
+/* Rows are formatted when they are drawn for the first time. The text and icons of
+ * at most this many rows are kept, the ones not drawn for the longest time are emptied
+ * again.
+ */
+#define FORMATTED_ROWS_MAX 1000u
+
 
 enum
 {
@@ -119,6 +135,8 @@ static gint sort_by_perm (GnomeCmdFile *f1, GnomeCmdFile *f2, GnomeCmdFileList *
 static gint sort_by_owner (GnomeCmdFile *f1, GnomeCmdFile *f2, GnomeCmdFileList *fl);
 static gint sort_by_group (GnomeCmdFile *f1, GnomeCmdFile *f2, GnomeCmdFileList *fl);
 
+inline void add_file_to_clist (GnomeCmdFileList *fl, GnomeCmdFile *f, gint in_row);
+
 
 static GnomeCmdFileListColumn file_list_column[GnomeCmdFileList::NUM_COLUMNS] =
 {{GnomeCmdFileList::COLUMN_ICON,"",GTK_JUSTIFY_CENTER,GTK_SORT_ASCENDING, NULL},
@@ -153,6 +171,7 @@ struct GnomeCmdFileList::Private
 
     gint cur_file;
     GnomeCmdFileCollection visible_files;
+    GnomeCmd::SortedIndex<GnomeCmdFile> rows;                 // visible_files in the order of the clist rows
     GnomeCmd::Collection<GnomeCmdFile *> selected_files;      // contains GnomeCmdFile pointers, no refing
 
     gchar *base_dir;
@@ -181,6 +200,18 @@ struct GnomeCmdFileList::Private
 
     GtkItemFactory *ifac;
 
+    guint mime_types_idle_id;
+
+    vector<GnomeCmdFile *> created_files;       // monitor events waiting for the next list update, reffed
+    vector<GnomeCmdFile *> deleted_files;
+    guint dir_changes_id;
+
+    GHashTable *formatted_rows;                 // GnomeCmdFile * -> FormattedRow *, the rows with content
+    guint format_stamp;
+
+    map<GnomeCmdFile *, TreeSizeJob *> tree_size_jobs;      // directories being summed up, reffed
+    guint tree_sizes_id;
+
     explicit Private(GnomeCmdFileList *fl);
     ~Private();
 
@@ -216,6 +247,13 @@ GnomeCmdFileList::Private::Private(GnomeCmdFileList *fl)
     con_open_dialog_label = NULL;
     con_open_dialog_pbar = NULL;
 
+    mime_types_idle_id = 0;
+    dir_changes_id = 0;
+    tree_sizes_id = 0;
+
+    formatted_rows = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+    format_stamp = 0;
+
     memset(sort_raising, GTK_SORT_ASCENDING, sizeof(sort_raising));
 
     for (gint i=0; i<NUM_COLUMNS; i++)
@@ -237,6 +275,7 @@ GnomeCmdFileList::Private::Private(GnomeCmdFileList *fl)
 
 GnomeCmdFileList::Private::~Private()
 {
+    g_hash_table_destroy (formatted_rows);
     g_object_unref (ifac);
 }
 
@@ -279,6 +318,7 @@ GnomeCmdFileList::GnomeCmdFileList(ColumnID sort_col, GtkSortType sort_order)
     priv->current_col = sort_col;
     priv->sort_raising[sort_col] = sort_order;
     priv->sort_func = file_list_column[sort_col].sort_func;
+    priv->rows.set_compare_func(priv->sort_func, this);
 
     create_column_titles();
 }
@@ -551,7 +591,7 @@ void GnomeCmdFileList::toggle_file(GnomeCmdFile *f)
         return;
 
     guint real_row = row;
-    if (real_row < priv->visible_files.size())
+    if (real_row < priv->rows.size())
     {
         if (!priv->selected_files.contain(f))
             select_file(f, real_row);
@@ -1083,6 +1123,186 @@ static gint sort_by_group (GnomeCmdFile *f1, GnomeCmdFile *f2, GnomeCmdFileList
 }
 
 
+/**
+ * Everything the sort functions above look up or compute for a file,
+ * gathered once before sorting the whole list. Comparing two keys
+ * doesn't touch GnomeVFSFileInfo, search for the extension or allocate
+ * the dirname, which makes a difference for large search results.
+ */
+struct FileSortKey
+{
+    const gchar *name;          // collation key
+    const gchar *ext;           // NULL for directories and files without extension
+    const gchar *dirname;       // shared by the files of a directory, only set when sorting by directory
+    gint64 value;               // size, mtime, permissions, uid or gid, depending on the column
+    guint8 type;
+    guint8 is_dotdot;
+};
+
+
+class FileSortKeyLess
+{
+    gint col;
+    gboolean raising;           // of the sort column
+    gboolean name_raising;      // of the name column, breaks ties
+
+    gint compare(const FileSortKey &k1, const FileSortKey &k2) const;
+
+  public:
+
+    explicit FileSortKeyLess(GnomeCmdFileList *fl): col(fl->priv->current_col),
+                                                    raising(fl->priv->sort_raising[fl->priv->current_col]),
+                                                    name_raising(fl->priv->sort_raising[GnomeCmdFileList::COLUMN_NAME])   {}
+
+    bool operator () (const FileSortKey &k1, const FileSortKey &k2) const   {  return compare(k1, k2) < 0;  }
+};
+
+
+// the same order as sort_by_name(), sort_by_ext()... give
+gint FileSortKeyLess::compare(const FileSortKey &k1, const FileSortKey &k2) const
+{
+    if (k1.is_dotdot)
+        return -1;
+
+    if (k2.is_dotdot)
+        return 1;
+
+    gint ret = my_intcmp (k1.type, k2.type, TRUE);
+
+    if (ret)
+        return ret;
+
+    switch (col)
+    {
+        case GnomeCmdFileList::COLUMN_EXT:
+            if (!k1.ext && !k2.ext)
+                return my_strcmp (k1.name, k2.name, name_raising);
+            if (!k1.ext)
+                return raising ? 1 : -1;
+            if (!k2.ext)
+                return raising ? -1 : 1;
+            ret = my_strcmp (k1.ext, k2.ext, raising);
+            return ret ? ret : my_strcmp (k1.name, k2.name, name_raising);
+
+        case GnomeCmdFileList::COLUMN_DIR:
+            ret = k1.dirname==k2.dirname ? 0 : my_strcmp (k1.dirname, k2.dirname, raising);
+            return ret ? ret : my_strcmp (k1.name, k2.name, raising);
+
+        case GnomeCmdFileList::COLUMN_SIZE:
+        case GnomeCmdFileList::COLUMN_DATE:
+        case GnomeCmdFileList::COLUMN_PERM:
+        case GnomeCmdFileList::COLUMN_OWNER:
+        case GnomeCmdFileList::COLUMN_GROUP:
+            if (k1.value!=k2.value)
+                return (k1.value > k2.value) == !raising ? 1 : -1;
+            return my_strcmp (k1.name, k2.name, name_raising);
+
+        default:
+            return my_strcmp (k1.name, k2.name, raising);
+    }
+}
+
+
+class FileSortKeyMaker
+{
+    gint col;
+    GHashTable *dirnames;       // owns the dirnames of the keys, freed by the caller after sorting
+
+  public:
+
+    FileSortKeyMaker(GnomeCmdFileList *fl, GHashTable *_dirnames): col(fl->priv->current_col), dirnames(_dirnames)   {}
+
+    void operator () (GnomeCmdFile *f, FileSortKey &k) const;
+};
+
+
+void FileSortKeyMaker::operator () (GnomeCmdFile *f, FileSortKey &k) const
+{
+    GnomeVFSFileInfo *info = f->info;
+
+    k.name = f->get_collation_fname();
+    k.ext = col==GnomeCmdFileList::COLUMN_EXT ? f->get_extension() : NULL;
+    k.dirname = NULL;
+    k.value = 0;
+    k.type = info->type;
+    k.is_dotdot = f->is_dotdot;
+
+    switch (col)
+    {
+        case GnomeCmdFileList::COLUMN_DIR:
+            {
+                gchar *dirname = f->get_dirname();
+                k.dirname = (const gchar *) g_hash_table_lookup (dirnames, dirname);
+
+                if (k.dirname)
+                    g_free (dirname);
+                else
+                {
+                    g_hash_table_insert (dirnames, dirname, dirname);
+                    k.dirname = dirname;
+                }
+            }
+            break;
+
+        case GnomeCmdFileList::COLUMN_SIZE:
+            k.value = info->size;
+            break;
+
+        case GnomeCmdFileList::COLUMN_DATE:
+            k.value = info->mtime;
+            break;
+
+        case GnomeCmdFileList::COLUMN_PERM:
+            k.value = info->permissions;
+            break;
+
+        case GnomeCmdFileList::COLUMN_OWNER:
+            k.value = info->uid;
+            break;
+
+        case GnomeCmdFileList::COLUMN_GROUP:
+            k.value = info->gid;
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/**
+ * Sorts @a files with precomputed keys and makes them the rows of the
+ * list: in the row index, in visible_files and appended to the (cleared
+ * and frozen) clist. @a files is emptied.
+ */
+static void load_files (GnomeCmdFileList *fl, vector<GnomeCmdFile *> &files)
+{
+    GnomeCmdFileList::Private *priv = fl->priv;
+    GHashTable *dirnames = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    priv->rows.set_compare_func(priv->sort_func, fl);
+    priv->rows.load<FileSortKey>(files, FileSortKeyMaker(fl, dirnames), FileSortKeyLess(fl));
+
+    g_hash_table_destroy (dirnames);
+
+    GList *sorted_files = NULL;
+
+    for (GnomeCmd::SortedIndex<GnomeCmdFile>::const_iterator i=priv->rows.end(); i!=priv->rows.begin();)
+        sorted_files = g_list_prepend (sorted_files, *--i);
+
+    if (priv->visible_files.empty())
+    {
+        priv->visible_files.add(sorted_files);
+        g_list_free (sorted_files);
+    }
+    else
+        priv->visible_files.reorder(sorted_files);
+
+    for (GnomeCmd::SortedIndex<GnomeCmdFile>::const_iterator i=priv->rows.begin(); i!=priv->rows.end(); ++i)
+        add_file_to_clist (fl, *i, -1);
+}
+
+
 /*******************************
  * Callbacks
  *******************************/
@@ -1247,7 +1467,7 @@ static void mime_exec_single (GnomeCmdFile *f)
     GnomeVFSMimeApplication *vfs_app;
     GnomeCmdApp *app;
 
-    if (!f->info->mime_type)
+    if (!f->get_mime_type())
         return;
 
     // Check if the file is a binary executable that lacks the executable bit
@@ -1301,10 +1521,10 @@ static void mime_exec_single (GnomeCmdFile *f)
             }
     }
 
-    vfs_app = gnome_vfs_mime_get_default_application (f->info->mime_type);
+    vfs_app = f->get_default_application();
     if (!vfs_app)
     {
-        gchar *msg = g_strdup_printf (_("No default application found for the MIME type %s."), f->info->mime_type);
+        gchar *msg = g_strdup_printf (_("No default application found for the MIME type %s."), f->get_mime_type());
         gnome_cmd_show_message (NULL, msg, "Open the \"File types and programs\" page in the Control Center to add one.");
         g_free (msg);
         return;
@@ -1511,12 +1731,323 @@ static void on_realize (GnomeCmdFileList *fl, gpointer user_data)
 }
 
 
+struct FormattedRow
+{
+    GtkCListRow *clist_row;
+    guint stamp;                    // when the row was drawn last
+};
+
+
+static void set_row_colors (GnomeCmdFileList *fl, GnomeCmdFile *f, gint row, GtkCListRow *clist_row)
+{
+    GnomeCmdCList *clist = GNOME_CMD_CLIST (fl);
+
+    if (fl->priv->selected_files.contain(f))
+    {
+        if (!gnome_cmd_data.options.use_ls_colors)
+            gnome_cmd_clist_row_set_style (clist, clist_row, (row % 2) ? alt_sel_list_style : sel_list_style);
+        else
+        {
+            GnomeCmdColorTheme *colors = gnome_cmd_data.options.get_current_color_theme();
+            if (!colors->respect_theme)
+                gnome_cmd_clist_row_set_colors (clist, clist_row, colors->sel_fg, colors->sel_bg);
+        }
+    }
+    else
+    {
+        if (!gnome_cmd_data.options.use_ls_colors)
+            gnome_cmd_clist_row_set_style (clist, clist_row, (row % 2) ? alt_list_style : list_style);
+        else
+            if (LsColor *col = ls_colors_get (f))
+                gnome_cmd_clist_row_set_colors (clist, clist_row, col->fg, col->bg);
+    }
+}
+
+
+static void forget_oldest_formatted_rows (GnomeCmdFileList *fl)
+{
+    GHashTable *formatted_rows = fl->priv->formatted_rows;
+    vector<pair<guint, GnomeCmdFile *> > rows;
+    GHashTableIter iter;
+    gpointer key, value;
+
+    rows.reserve(g_hash_table_size (formatted_rows));
+
+    g_hash_table_iter_init (&iter, formatted_rows);
+    while (g_hash_table_iter_next (&iter, &key, &value))
+        rows.push_back(make_pair(((FormattedRow *) value)->stamp, (GnomeCmdFile *) key));
+
+    // keep the newer half, the rows on screen are always among them
+    guint n = rows.size() - FORMATTED_ROWS_MAX/2;
+
+    nth_element (rows.begin(), rows.begin()+n, rows.end());
+
+    for (guint i=0; i<n; ++i)
+    {
+        FormattedRow *formatted = (FormattedRow *) g_hash_table_lookup (formatted_rows, rows[i].second);
+
+        gnome_cmd_clist_row_clear (GNOME_CMD_CLIST (fl), formatted->clist_row);
+        g_hash_table_remove (formatted_rows, rows[i].second);
+    }
+}
+
+
+static void format_row (GnomeCmdCList *clist, gint row, GtkCListRow *clist_row, GnomeCmdFileList *fl)
+{
+    GnomeCmdFile *f = (GnomeCmdFile *) clist_row->data;
+
+    if (!f)
+        return;
+
+    GnomeCmdFileList::Private *priv = fl->priv;
+    FormattedRow *formatted = (FormattedRow *) g_hash_table_lookup (priv->formatted_rows, f);
+
+    if (formatted)
+    {
+        formatted->stamp = ++priv->format_stamp;
+        return;
+    }
+
+    formatted = g_new (FormattedRow, 1);
+    formatted->clist_row = clist_row;
+    formatted->stamp = ++priv->format_stamp;
+    g_hash_table_insert (priv->formatted_rows, f, formatted);
+
+    FileFormatData data(fl, f, f->has_tree_size());
+
+    for (gint i=0; i<GnomeCmdFileList::NUM_COLUMNS; i++)
+        gnome_cmd_clist_row_set_text (clist, clist_row, i, data.text[i]);
+
+    // If the use wants icons to show file types set it now
+    if (gnome_cmd_data.options.layout != GNOME_CMD_LAYOUT_TEXT)
+    {
+        GdkPixmap *pixmap;
+        GdkBitmap *mask;
+
+        if (f->get_type_pixmap_and_mask(&pixmap, &mask))
+            gnome_cmd_clist_row_set_pixmap (clist, clist_row, 0, pixmap, mask);
+    }
+
+    set_row_colors (fl, f, row, clist_row);
+
+    if (g_hash_table_size (priv->formatted_rows) > FORMATTED_ROWS_MAX)
+        forget_oldest_formatted_rows (fl);
+}
+
+
+/**
+ * Empties the row of @a f so it is formatted again the next time it is drawn.
+ * Returns FALSE if the row wasn't formatted.
+ */
+static gboolean unformat_row (GnomeCmdFileList *fl, GnomeCmdFile *f)
+{
+    FormattedRow *formatted = (FormattedRow *) g_hash_table_lookup (fl->priv->formatted_rows, f);
+
+    if (!formatted)
+        return FALSE;
+
+    gnome_cmd_clist_row_clear (GNOME_CMD_CLIST (fl), formatted->clist_row);
+    g_hash_table_remove (fl->priv->formatted_rows, f);
+
+    return TRUE;
+}
+
+
+static void clear_clist (GnomeCmdFileList *fl)
+{
+    g_hash_table_remove_all (fl->priv->formatted_rows);
+    gtk_clist_clear (*fl);
+}
+
+
+static void on_mime_type_loaded (GnomeCmdFile *f, GnomeCmdFileList *fl)
+{
+    if (unformat_row (fl, f))
+        gtk_widget_queue_draw (*fl);
+}
+
+
+static gboolean load_visible_mime_types (GnomeCmdFileList *fl)
+{
+    fl->priv->mime_types_idle_id = 0;
+
+    GtkCList *clist = *fl;
+    gint row_height = clist->row_height + CELL_SPACING;
+    gint first = MAX (0, -clist->voffset / row_height);
+    gint last = MIN (clist->rows - 1, (clist->clist_window_height - clist->voffset) / row_height);
+
+    GList *i = g_list_nth (clist->row_list, first);
+
+    for (gint row=first; i && row<=last; ++row, i=i->next)
+    {
+        GnomeCmdFile *f = (GnomeCmdFile *) GTK_CLIST_ROW (i)->data;
+
+        if (f && !f->info->mime_type)
+            mime_loader_request (f, (MimeLoadedFunc) on_mime_type_loaded, fl);
+    }
+
+    return FALSE;
+}
+
+
+static gboolean on_expose (GnomeCmdFileList *fl, GdkEventExpose *event, gpointer user_data)
+{
+    // MIME types are only needed for icons, and only for the rows on screen
+    if (gnome_cmd_data.options.layout == GNOME_CMD_LAYOUT_MIME_ICONS && !fl->priv->mime_types_idle_id)
+        fl->priv->mime_types_idle_id = g_idle_add ((GSourceFunc) load_visible_mime_types, fl);
+
+    return FALSE;
+}
+
+
+static void refill_clist (GnomeCmdFileList *fl, GnomeCmdFile *focused)
+{
+    GtkCList *clist = *fl;
+
+    gtk_clist_freeze (clist);
+    clear_clist (fl);
+
+    for (GnomeCmd::SortedIndex<GnomeCmdFile>::const_iterator i=fl->priv->rows.begin(); i!=fl->priv->rows.end(); ++i)
+        add_file_to_clist (fl, *i, -1);
+
+    gint row = focused ? fl->get_row_from_file(focused) : -1;
+
+    if (row<0)
+        row = MIN (fl->priv->cur_file, (gint) fl->priv->rows.size()-1);
+
+    if (row>=0)
+    {
+        if (GTK_WIDGET_HAS_FOCUS (fl))
+            focus_file_at_row (fl, row);
+        else
+            fl->priv->cur_file = clist->focus_row = row;
+    }
+
+    // reselect the previously selected files
+    for (GnomeCmd::Collection<GnomeCmdFile *>::iterator i=fl->priv->selected_files.begin(); i!=fl->priv->selected_files.end(); ++i)
+        fl->select_file(*i);
+
+    gtk_clist_thaw (clist);
+}
+
+
+static void merge_dir_changes (GnomeCmdFileList *fl, vector<GnomeCmdFile *> &added, vector<GnomeCmdFile *> &removed)
+{
+    GnomeCmdFileList::Private *priv = fl->priv;
+
+    GnomeCmdFile *focused = fl->get_focused_file();
+    GtkAdjustment *vadj = gtk_clist_get_vadjustment (*fl);
+    gdouble scroll_pos = vadj->value;
+
+    GList *files = NULL;
+
+    for (vector<GnomeCmdFile *>::iterator i=removed.begin(); i!=removed.end(); ++i)
+    {
+        priv->selected_files.remove(*i);
+        files = g_list_prepend (files, *i);
+    }
+
+    priv->visible_files.remove(files);
+    g_list_free (files);
+    files = NULL;
+
+    for (vector<GnomeCmdFile *>::reverse_iterator i=added.rbegin(); i!=added.rend(); ++i)
+        files = g_list_prepend (files, *i);
+
+    priv->visible_files.add(files);
+    g_list_free (files);
+
+    if (find (removed.begin(), removed.end(), focused)!=removed.end())
+        focused = NULL;
+
+    priv->rows.remove(removed);
+    priv->rows.merge(added);
+
+    refill_clist (fl, focused);
+
+    gtk_adjustment_set_value (vadj, MIN (scroll_pos, vadj->upper - vadj->page_size));
+}
+
+
+static void drop_dir_changes (GnomeCmdFileList *fl)
+{
+    GnomeCmdFileList::Private *priv = fl->priv;
+
+    if (priv->dir_changes_id)
+        g_source_remove (priv->dir_changes_id);
+
+    priv->dir_changes_id = 0;
+
+    for_each (priv->created_files.begin(), priv->created_files.end(), gnome_cmd_file_unref);
+    for_each (priv->deleted_files.begin(), priv->deleted_files.end(), gnome_cmd_file_unref);
+
+    priv->created_files.clear();
+    priv->deleted_files.clear();
+}
+
+
+/**
+ * Applies the monitor events collected since the last update at once.
+ * A few files are inserted and removed row by row, larger batches are
+ * merged into the sorted rows and the clist is refilled in one go, as
+ * gtk_clist_insert() has to walk the row list for every single file.
+ */
+static gboolean update_dir_changes (GnomeCmdFileList *fl)
+{
+    GnomeCmdFileList::Private *priv = fl->priv;
+
+    vector<GnomeCmdFile *> created, deleted, added, removed;
+
+    created.swap(priv->created_files);
+    deleted.swap(priv->deleted_files);
+    priv->dir_changes_id = 0;
+
+    for (vector<GnomeCmdFile *>::iterator i=created.begin(); i!=created.end(); ++i)
+        if (fl->file_is_wanted(*i))
+            added.push_back(*i);
+
+    for (vector<GnomeCmdFile *>::iterator i=deleted.begin(); i!=deleted.end(); ++i)
+        if (fl->has_file(*i))
+            removed.push_back(*i);
+
+    guint n_changes = added.size() + removed.size();
+
+    DEBUG('l', "Updating file list with %u created and %u deleted files\n", (guint) added.size(), (guint) removed.size());
+
+    if (n_changes > MIN (DIR_CHANGES_INCREMENTAL_MAX, priv->rows.size()))
+        merge_dir_changes (fl, added, removed);
+    else
+    {
+        for (vector<GnomeCmdFile *>::iterator i=removed.begin(); i!=removed.end(); ++i)
+            fl->remove_file(*i);
+
+        for (vector<GnomeCmdFile *>::iterator i=added.begin(); i!=added.end(); ++i)
+            fl->insert_file(*i);
+    }
+
+    for_each (created.begin(), created.end(), gnome_cmd_file_unref);
+    for_each (deleted.begin(), deleted.end(), gnome_cmd_file_unref);
+
+    if (n_changes)
+        g_signal_emit (fl, signals[FILES_CHANGED], 0);
+
+    return FALSE;
+}
+
+
+inline void schedule_dir_changes (GnomeCmdFileList *fl)
+{
+    if (!fl->priv->dir_changes_id)
+        fl->priv->dir_changes_id = g_timeout_add (gnome_cmd_data.gui_update_rate, (GSourceFunc) update_dir_changes, fl);
+}
+
+
 static void on_dir_file_created (GnomeCmdDir *dir, GnomeCmdFile *f, GnomeCmdFileList *fl)
 {
     g_return_if_fail (GNOME_CMD_IS_FILE_LIST (fl));
 
-    if (fl->insert_file(f))
-        g_signal_emit (fl, signals[FILES_CHANGED], 0);
+    fl->priv->created_files.push_back(f->ref());
+    schedule_dir_changes (fl);
 }
 
 
@@ -1524,9 +2055,22 @@ static void on_dir_file_deleted (GnomeCmdDir *dir, GnomeCmdFile *f, GnomeCmdFile
 {
     g_return_if_fail (GNOME_CMD_IS_FILE_LIST (fl));
 
-    if (fl->cwd == dir)
-        if (fl->remove_file(f))
-            g_signal_emit (fl, signals[FILES_CHANGED], 0);
+    if (fl->cwd != dir)
+        return;
+
+    vector<GnomeCmdFile *> &created = fl->priv->created_files;
+    vector<GnomeCmdFile *>::iterator i = find (created.begin(), created.end(), f);
+
+    // created and deleted again before the list has been updated
+    if (i!=created.end())
+    {
+        created.erase(i);
+        f->unref();
+        return;
+    }
+
+    fl->priv->deleted_files.push_back(f->ref());
+    schedule_dir_changes (fl);
 }
 
 
@@ -1730,6 +2274,64 @@ static void create_con_open_progress_dialog (GnomeCmdFileList *fl)
 }
 
 
+/**
+ * Shows the sizes summed up so far by the running tree size jobs, so big
+ * trees grow in place instead of freezing the list until they're done.
+ */
+static gboolean update_tree_sizes (GnomeCmdFileList *fl)
+{
+    map<GnomeCmdFile *, TreeSizeJob *> &jobs = fl->priv->tree_size_jobs;
+
+    for (map<GnomeCmdFile *, TreeSizeJob *>::iterator i=jobs.begin(); i!=jobs.end(); )
+    {
+        GnomeCmdFile *f = i->first;
+        guint64 bytes;
+        gboolean done = tree_size_job_get (i->second, &bytes, NULL);
+
+        f->set_tree_size(bytes);
+        unformat_row (fl, f);
+
+        if (done)
+        {
+            tree_size_job_free (i->second);
+            f->unref();
+            jobs.erase(i++);
+        }
+        else
+            ++i;
+    }
+
+    gtk_widget_queue_draw (*fl);
+    g_signal_emit (fl, signals[FILES_CHANGED], 0);
+
+    if (!jobs.empty())
+        return TRUE;
+
+    fl->priv->tree_sizes_id = 0;
+
+    return FALSE;
+}
+
+
+static void drop_tree_sizes (GnomeCmdFileList *fl)
+{
+    GnomeCmdFileList::Private *priv = fl->priv;
+
+    if (priv->tree_sizes_id)
+        g_source_remove (priv->tree_sizes_id);
+
+    priv->tree_sizes_id = 0;
+
+    for (map<GnomeCmdFile *, TreeSizeJob *>::iterator i=priv->tree_size_jobs.begin(); i!=priv->tree_size_jobs.end(); ++i)
+    {
+        tree_size_job_free (i->second);
+        i->first->unref();
+    }
+
+    priv->tree_size_jobs.clear();
+}
+
+
 /*******************************
  * Gtk class implementation
  *******************************/
@@ -1738,6 +2340,13 @@ static void gnome_cmd_file_list_finalize (GObject *object)
 {
     GnomeCmdFileList *fl = GNOME_CMD_FILE_LIST (object);
 
+    mime_loader_cancel (fl);
+    drop_dir_changes (fl);
+    drop_tree_sizes (fl);
+
+    if (fl->priv->mime_types_idle_id)
+        g_source_remove (fl->priv->mime_types_idle_id);
+
     delete fl->priv;
 
     G_OBJECT_CLASS (gnome_cmd_file_list_parent_class)->finalize (object);
@@ -1836,6 +2445,9 @@ static void gnome_cmd_file_list_init (GnomeCmdFileList *fl)
     g_signal_connect (fl, "motion-notify-event", G_CALLBACK (on_motion_notify), fl);
 
     g_signal_connect_after (fl, "realize", G_CALLBACK (on_realize), fl);
+    g_signal_connect_after (fl, "expose-event", G_CALLBACK (on_expose), fl);
+
+    gnome_cmd_clist_set_format_row_func (GNOME_CMD_CLIST (fl), (GnomeCmdCListFormatRowFunc) format_row, fl);
     g_signal_connect (fl, "file-clicked", G_CALLBACK (on_file_clicked), fl);
     g_signal_connect (fl, "file-released", G_CALLBACK (on_file_released), fl);
 }
@@ -1861,37 +2473,13 @@ inline void add_file_to_clist (GnomeCmdFileList *fl, GnomeCmdFile *f, gint in_ro
 {
     GtkCList *clist = *fl;
 
-    FileFormatData data(fl, f,FALSE);
+    // the row stays empty until format_row() fills it in when it gets drawn
+    static gchar *no_text[GnomeCmdFileList::NUM_COLUMNS];
 
-    gint row = in_row == -1 ? gtk_clist_append (clist, data.text) : gtk_clist_insert (clist, in_row, data.text);
-
-    // Setup row data and color
-    if (!gnome_cmd_data.options.use_ls_colors)
-        gtk_clist_set_row_style (clist, row, (row % 2) ? alt_list_style : list_style);
-    else
-    {
-        LsColor *col = ls_colors_get (f);
-        if (col)
-        {
-            if (col->bg)
-                gtk_clist_set_background (clist, row, col->bg);
-            if (col->fg)
-                gtk_clist_set_foreground (clist, row, col->fg);
-        }
-    }
+    gint row = in_row == -1 ? gtk_clist_append (clist, no_text) : gtk_clist_insert (clist, in_row, no_text);
 
     gtk_clist_set_row_data (clist, row, f);
 
-    // If the use wants icons to show file types set it now
-    if (gnome_cmd_data.options.layout != GNOME_CMD_LAYOUT_TEXT)
-    {
-        GdkPixmap *pixmap;
-        GdkBitmap *mask;
-
-        if (f->get_type_pixmap_and_mask(&pixmap, &mask))
-            gtk_clist_set_pixmap (clist, row, 0, pixmap, mask);
-    }
-
     // If we have been waiting for this file to show up, focus it
     if (fl->priv->focus_later && strcmp (f->get_name(), fl->priv->focus_later)==0)
         focus_file_at_row (fl, row);
@@ -1914,6 +2502,7 @@ inline void add_file_to_clist (GnomeCmdFileList *fl, GnomeCmdFile *f, gint in_ro
 void GnomeCmdFileList::append_file (GnomeCmdFile *f)
 {
     priv->visible_files.add(f);
+    priv->rows.append(f);
     add_file_to_clist (this, f, -1);
 }
 
@@ -1923,25 +2512,17 @@ gboolean GnomeCmdFileList::insert_file(GnomeCmdFile *f)
     if (!file_is_wanted(f))
         return FALSE;
 
-    gint num_files = size();
-
-    for (gint i=0; i<num_files; i++)
-    {
-        GnomeCmdFile *f2 = get_file_at_row(i);
-        if (priv->sort_func (f2, f, this) == 1)
-        {
-            priv->visible_files.add(f);
-            add_file_to_clist (this, f, i);
+    // files appended out of order (e.g. search results) have to be sorted first
+    if (!priv->rows.is_sorted())
+        sort();
 
-            if (i<=priv->cur_file)
-                priv->cur_file++;
+    gint row = priv->rows.insert(f);
 
-            return TRUE;
-        }
-    }
+    priv->visible_files.add(f);
+    add_file_to_clist (this, f, row);
 
-    // Insert the file at the end of the list
-    append_file(f);
+    if (row<=priv->cur_file)
+        priv->cur_file++;
 
     return TRUE;
 }
@@ -1951,7 +2532,7 @@ void GnomeCmdFileList::show_files(GnomeCmdDir *dir)
 {
     remove_all_files();
 
-    GList *files = NULL;
+    vector<GnomeCmdFile *> files;
 
     // select the files to show
     for (GList *i = gnome_cmd_dir_get_files (dir); i; i = i->next)
@@ -1959,27 +2540,21 @@ void GnomeCmdFileList::show_files(GnomeCmdDir *dir)
         GnomeCmdFile *f = GNOME_CMD_FILE (i->data);
 
         if (file_is_wanted (f))
-            files = g_list_append (files, f);
+            files.push_back(f);
     }
 
     // Create a parent dir file (..) if appropriate
     gchar *path = GNOME_CMD_FILE (dir)->get_path();
     if (path && strcmp (path, G_DIR_SEPARATOR_S) != 0)
-        files = g_list_append (files, gnome_cmd_dir_new_parent_dir_file (dir));
+        files.push_back(gnome_cmd_dir_new_parent_dir_file (dir));
     g_free (path);
 
-    if (!files)
+    if (files.empty())
         return;
 
-    files = g_list_sort_with_data (files, (GCompareDataFunc) priv->sort_func, this);
-
     gtk_clist_freeze (*this);
-    for (GList *i = files; i; i = i->next)
-        append_file(GNOME_CMD_FILE (i->data));
+    load_files (this, files);
     gtk_clist_thaw (*this);
-
-    if (files)
-        g_list_free (files);
 }
 
 
@@ -1988,23 +2563,9 @@ void GnomeCmdFileList::update_file(GnomeCmdFile *f)
     if (!f->needs_update())
         return;
 
-    gint row = get_row_from_file(f);
-    if (row == -1)
-        return;
-
-    FileFormatData data(this, f, FALSE);
-
-    for (gint i=1; i<NUM_COLUMNS; i++)
-        gtk_clist_set_text (*this, row, i, data.text[i]);
-
-    if (gnome_cmd_data.options.layout != GNOME_CMD_LAYOUT_TEXT)
-    {
-        GdkPixmap *pixmap;
-        GdkBitmap *mask;
-
-        if (f->get_type_pixmap_and_mask(&pixmap, &mask))
-            gtk_clist_set_pixmap (*this, row, 0, pixmap, mask);
-    }
+    // rows not drawn yet get the new values anyway
+    if (unformat_row (this, f))
+        gtk_widget_queue_draw (*this);
 }
 
 
@@ -2012,14 +2573,28 @@ void GnomeCmdFileList::show_dir_tree_size(GnomeCmdFile *f)
 {
     g_return_if_fail (GNOME_CMD_IS_FILE (f));
 
-    gint row = get_row_from_file(f);
-    if (row == -1)
+    if (!has_file(f))
         return;
 
-    FileFormatData data(this, f,TRUE);
+    if (f->info->type==GNOME_VFS_FILE_TYPE_DIRECTORY && !f->is_dotdot && !f->has_tree_size() && f->is_local())
+    {
+        gchar *path = f->get_real_path();
+        GList *paths = g_list_append (NULL, path);
+
+        priv->tree_size_jobs[f->ref()] = tree_size_job_new (paths);
+        f->set_tree_size(0);
+
+        g_list_free (paths);
+        g_free (path);
+
+        if (!priv->tree_sizes_id)
+            priv->tree_sizes_id = g_timeout_add (gnome_cmd_data.gui_update_rate, (GSourceFunc) update_tree_sizes, this);
+    }
+    else
+        f->get_tree_size();
 
-    for (gint i=1; i<NUM_COLUMNS; i++)
-        gtk_clist_set_text (*this, row, i, data.text[i]);
+    if (unformat_row (this, f))
+        gtk_widget_queue_draw (*this);
 }
 
 
@@ -2043,7 +2618,9 @@ gboolean GnomeCmdFileList::remove_file(GnomeCmdFile *f)
     if (row<0)                              // f not found in the shown file list...
         return FALSE;
 
+    g_hash_table_remove (priv->formatted_rows, f);
     gtk_clist_remove (*this, row);
+    priv->rows.remove_at(row);
 
     priv->selected_files.remove(f);
     priv->visible_files.remove(f);
@@ -2065,7 +2642,10 @@ gboolean GnomeCmdFileList::remove_file(const gchar *uri_str)
 
 void GnomeCmdFileList::clear()
 {
-    gtk_clist_clear (*this);
+    mime_loader_cancel (this);
+    drop_dir_changes (this);
+    clear_clist (this);
+    priv->rows.clear();
     priv->visible_files.clear();
     priv->selected_files.clear();
 }
@@ -2116,6 +2696,36 @@ GnomeCmdFile *GnomeCmdFileList::get_first_selected_file()
 }
 
 
+guint GnomeCmdFileList::size()
+{
+    return priv->rows.size();
+}
+
+
+bool GnomeCmdFileList::empty()
+{
+    return priv->rows.empty();
+}
+
+
+gboolean GnomeCmdFileList::has_file(const GnomeCmdFile *f)
+{
+    return priv->rows.find(const_cast<GnomeCmdFile *>(f)) != -1;
+}
+
+
+GnomeCmdFile *GnomeCmdFileList::get_file_at_row(gint row)
+{
+    return row<0 ? NULL : priv->rows[row];
+}
+
+
+gint GnomeCmdFileList::get_row_from_file(GnomeCmdFile *f)
+{
+    return priv->rows.find(f);
+}
+
+
 GnomeCmdFile *GnomeCmdFileList::get_focused_file()
 {
     return priv->cur_file < 0 ? NULL : get_file_at_row(priv->cur_file);
@@ -2263,11 +2873,12 @@ void GnomeCmdFileList::sort()
     GnomeCmdFile *selfile = get_selected_file();
 
     gtk_clist_freeze (*this);
-    gtk_clist_clear (*this);
+    clear_clist (this);
 
     // resort the files and readd them to the list
-    for (GList *list = priv->visible_files.sort(priv->sort_func, this); list; list = list->next)
-        add_file_to_clist (this, GNOME_CMD_FILE (list->data), -1);
+    vector<GnomeCmdFile *> files(priv->rows.begin(), priv->rows.end());
+
+    load_files (this, files);
 
     // refocus the previously selected file if this file list has the focus
     if (selfile && GTK_WIDGET_HAS_FOCUS (this))
@@ -2886,6 +3497,8 @@ void GnomeCmdFileList::goto_directory(const gchar *in_dir)
 
 void GnomeCmdFileList::invalidate_tree_size()
 {
+    drop_tree_sizes (this);
+
     for (GList *i = get_visible_files(); i; i = i->next)
     {
         GnomeCmdFile *f = (GnomeCmdFile *) i->data;
@@ -107,8 +107,8 @@ struct GnomeCmdFileList
     GnomeCmdFileList(ColumnID sort_col, GtkSortType sort_order);
     ~GnomeCmdFileList();
 
-    guint size()                          {  return g_list_length (get_visible_files());  }
-    bool empty()                          {  return get_visible_files()==NULL;            }    // FIXME should be: size()==0
+    guint size();
+    bool empty();
     void clear();
 
     void reload();
@@ -140,8 +140,8 @@ struct GnomeCmdFileList
     void restore_selection();
 
     void select_row(gint row);
-    GnomeCmdFile *get_file_at_row(gint row)            {  return static_cast<GnomeCmdFile *>(gtk_clist_get_row_data (*this, row));  }
-    gint get_row_from_file(GnomeCmdFile *f)            {  return gtk_clist_find_row_from_data (*this, f);               }
+    GnomeCmdFile *get_file_at_row(gint row);
+    gint get_row_from_file(GnomeCmdFile *f);
     void focus_file(const gchar *focus_file, gboolean scroll_to_file=TRUE);
 
     void sort();
@@ -239,11 +239,6 @@ inline void GnomeCmdFileList::remove_files (GList *files)
 	    remove_file(static_cast<GnomeCmdFile *>(files->data));
 }
 
-inline gboolean GnomeCmdFileList::has_file(const GnomeCmdFile *f)
-{
-    return g_list_index (get_visible_files(), f) != -1;
-}
-
 inline GnomeCmdFile *GnomeCmdFileList::get_selected_file()
 {
     GnomeCmdFile *f = get_focused_file();
@@ -554,7 +554,7 @@ inline gchar *get_default_application_action_name (GList *files, gchar **icon_pa
 
     GnomeCmdFile *f = (GnomeCmdFile *) files->data;
     gchar *uri_str = f->get_uri_str();
-    GnomeVFSMimeApplication *app = gnome_vfs_mime_get_default_application_for_uri (uri_str, f->info->mime_type);
+    GnomeVFSMimeApplication *app = gnome_vfs_mime_get_default_application_for_uri (uri_str, f->get_mime_type());
     
     if (icon_path)
     {
@@ -641,7 +641,7 @@ GtkWidget *gnome_cmd_file_popmenu_new (GnomeCmdFileList *fl)
     gint i = -1;
     menu->priv->data_list = NULL;
 
-    vfs_apps = tmp_list = gnome_vfs_mime_get_all_applications (f->info->mime_type);
+    vfs_apps = tmp_list = gnome_vfs_mime_get_all_applications (f->get_mime_type());
     for (; vfs_apps && i < MAX_OPEN_WITH_APPS; vfs_apps = vfs_apps->next)
     {
         GnomeVFSMimeApplication *vfs_app = (GnomeVFSMimeApplication *) vfs_apps->data;
@@ -31,6 +31,7 @@
 #include "gnome-cmd-main-win.h"
 #include "gnome-cmd-con-list.h"
 #include "gnome-cmd-xfer.h"
+#include "mime-loader.h"
 #include "tags/gnome-cmd-tags.h"
 #include "intviewer/libgviewer.h"
 #include "dialogs/gnome-cmd-file-props-dialog.h"
@@ -615,23 +616,52 @@ gboolean GnomeCmdFile::get_type_pixmap_and_mask(GdkPixmap **pixmap, GdkBitmap **
 }
 
 
+const gchar *GnomeCmdFile::get_mime_type()
+{
+    g_return_val_if_fail (info != NULL, NULL);
+
+    // directory listings leave the MIME type out, see mime-loader.h
+    if (!info->mime_type)
+        set_mime_type(mime_loader_detect (this));
+
+    return info->mime_type;
+}
+
+
+void GnomeCmdFile::set_mime_type(gchar *mime_type)
+{
+    g_return_if_fail (info != NULL);
+
+    if (info->mime_type || !mime_type)
+    {
+        g_free (mime_type);
+        return;
+    }
+
+    info->mime_type = mime_type;
+    info->valid_fields = (GnomeVFSFileInfoFields) (info->valid_fields | GNOME_VFS_FILE_INFO_FIELDS_MIME_TYPE);
+}
+
+
 gboolean GnomeCmdFile::has_mime_type(const gchar *mime_type)
 {
     g_return_val_if_fail (info != NULL, FALSE);
-    g_return_val_if_fail (info->mime_type != NULL, FALSE);
     g_return_val_if_fail (mime_type != NULL, FALSE);
 
-    return strcmp (info->mime_type, mime_type) == 0;
+    const gchar *my_mime_type = get_mime_type();
+
+    return my_mime_type && strcmp (my_mime_type, mime_type) == 0;
 }
 
 
 gboolean GnomeCmdFile::mime_begins_with(const gchar *mime_type_start)
 {
     g_return_val_if_fail (info != NULL, FALSE);
-    g_return_val_if_fail (info->mime_type != NULL, FALSE);
     g_return_val_if_fail (mime_type_start != NULL, FALSE);
 
-    return strncmp (info->mime_type, mime_type_start, strlen(mime_type_start)) == 0;
+    const gchar *my_mime_type = get_mime_type();
+
+    return my_mime_type && strncmp (my_mime_type, mime_type_start, strlen(mime_type_start)) == 0;
 }
 
 
@@ -917,6 +947,12 @@ gboolean GnomeCmdFile::needs_update()
 }
 
 
+void GnomeCmdFile::set_tree_size(GnomeVFSFileSize size)
+{
+    priv->tree_size = size;
+}
+
+
 void GnomeCmdFile::invalidate_tree_size()
 {
     priv->tree_size = -1;
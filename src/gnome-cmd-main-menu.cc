@@ -660,6 +660,13 @@ static void init (GnomeCmdMainMenu *main_menu)
             GNOME_APP_PIXMAP_NONE, NULL,
             NULL
         },
+        MENUTYPE_SEPARATOR,
+        {
+            MENU_TYPE_ITEM, _("_Transfers…"), "", NULL,
+            (gpointer) view_transfers, NULL,
+            GNOME_APP_PIXMAP_NONE, NULL,
+            NULL
+        },
         MENUTYPE_END
     };
 
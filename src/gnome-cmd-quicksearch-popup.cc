@@ -27,12 +27,26 @@
 #include "gnome-cmd-file.h"
 #include "gnome-cmd-data.h"
 #include "gnome-cmd-main-win.h"
+#include "name-match.h"
 
 using namespace std;
 
 
 static GtkWindowClass *parent_class = NULL;
 
+#define QUICKSEARCH_POLL_MSEC   20
+
+
+struct QuicksearchTask
+{
+    NameMatch *index;
+    gchar *text;
+    vector<guint32> found;
+    gboolean complete;
+    gint done;
+    gint cancelled;
+};
+
 struct GnomeCmdQuicksearchPopupPrivate
 {
     GnomeCmdFileList *fl;
@@ -40,6 +54,14 @@ struct GnomeCmdQuicksearchPopupPrivate
     GList *matches;
     GList *pos;
     GnomeCmdFile *last_focused_file;
+
+    GPtrArray *files;                   // the visible files, as the index has their names
+    NameMatch *index;
+
+    QuicksearchTask *task;              // the query looked for in the background
+    GThread *thread;
+    guint poll_id;
+    gchar *pending_text;                // the query typed in the meantime
 };
 
 
@@ -48,8 +70,13 @@ inline void focus_file (GnomeCmdQuicksearchPopup *popup, GnomeCmdFile *f)
     if (f->is_dotdot)
         return;
 
-    popup->priv->last_focused_file = f;
     gint row = popup->priv->fl->get_row_from_file(f);
+
+    // gone from the list since the search started
+    if (row<0)
+        return;
+
+    popup->priv->last_focused_file = f;
     gtk_clist_moveto (GTK_CLIST (popup->priv->fl), row, 0, 1, 0);
     gtk_clist_freeze (GTK_CLIST (popup->priv->fl));
     GNOME_CMD_CLIST (popup->priv->fl)->drag_motion_row = row;
@@ -57,13 +84,179 @@ inline void focus_file (GnomeCmdQuicksearchPopup *popup, GnomeCmdFile *f)
 }
 
 
+inline NameMatchMode get_match_mode ()
+{
+    if (gnome_cmd_data.options.quick_search_exact_match_begin)
+        return gnome_cmd_data.options.quick_search_exact_match_end ? NAME_MATCH_EXACT : NAME_MATCH_PREFIX;
+    else
+        return gnome_cmd_data.options.quick_search_exact_match_end ? NAME_MATCH_SUFFIX : NAME_MATCH_SUBSTRING;
+}
+
+
+/**
+ * Indexes the names of the visible files when the first letter is typed,
+ * the following ones are looked for among the files matched before.
+ */
+static void make_index (GnomeCmdQuicksearchPopup *popup)
+{
+    if (popup->priv->index)
+        return;
+
+    vector<const gchar *> names;
+
+    popup->priv->files = g_ptr_array_new ();
+
+    for (GList *files = popup->priv->fl->get_visible_files(); files; files = files->next)
+    {
+        GnomeCmdFile *f = (GnomeCmdFile *) files->data;
+
+        f->ref();
+        g_ptr_array_add (popup->priv->files, f);
+        names.push_back(f->info->name);
+    }
+
+    popup->priv->index = name_match_new (names, gnome_cmd_data.options.case_sens_sort, get_match_mode ());
+}
+
+
+static void set_matches (GnomeCmdQuicksearchPopup *popup, const vector<guint32> &found)
+{
+    for (vector<guint32>::const_reverse_iterator i=found.rbegin(); i!=found.rend(); ++i)
+        popup->priv->matches = g_list_prepend (popup->priv->matches, g_ptr_array_index (popup->priv->files, *i));
+}
+
+
+inline void set_pos (GnomeCmdQuicksearchPopup *popup)
+{
+    // If no file matches the new filter, focus on the last file that matched a previous filter
+    if (popup->priv->matches==NULL && popup->priv->last_focused_file!=NULL)
+        popup->priv->matches = g_list_append (popup->priv->matches, popup->priv->last_focused_file);
+
+    popup->priv->pos = popup->priv->matches;
+}
+
+
+static gpointer find_names (QuicksearchTask *task)
+{
+    task->complete = name_match_find (task->index, task->text, task->found, &task->cancelled);
+
+    g_atomic_int_set (&task->done, TRUE);
+
+    return NULL;
+}
+
+
+inline void free_task (QuicksearchTask *task)
+{
+    g_free (task->text);
+    delete task;
+}
+
+
+static void search (GnomeCmdQuicksearchPopup *popup, const gchar *text);
+
+
+static gboolean on_search_poll (GnomeCmdQuicksearchPopup *popup)
+{
+    QuicksearchTask *task = popup->priv->task;
+
+    if (!g_atomic_int_get (&task->done))
+        return TRUE;
+
+    g_thread_join (popup->priv->thread);
+    popup->priv->thread = NULL;
+    popup->priv->task = NULL;
+    popup->priv->poll_id = 0;
+
+    if (task->complete && !g_atomic_int_get (&task->cancelled))
+    {
+        set_matches (popup, task->found);
+        set_pos (popup);
+
+        if (popup->priv->pos)
+            focus_file (popup, GNOME_CMD_FILE (popup->priv->pos->data));
+    }
+
+    free_task (task);
+
+    if (popup->priv->pending_text)
+    {
+        gchar *text = popup->priv->pending_text;
+
+        popup->priv->pending_text = NULL;
+        search (popup, text);
+        g_free (text);
+    }
+
+    return FALSE;
+}
+
+
+/**
+ * Looks for @a text in a thread, so that typing in a huge listing doesn't
+ * wait for each letter. Only one query runs at a time, the one typed last
+ * follows it.
+ */
+static void start_search (GnomeCmdQuicksearchPopup *popup, const gchar *text)
+{
+    if (popup->priv->task)
+    {
+        popup->priv->pending_text = g_strdup (text);
+        return;
+    }
+
+    QuicksearchTask *task = new QuicksearchTask;
+
+    task->index = popup->priv->index;
+    task->text = g_strdup (text);
+    task->complete = FALSE;
+    task->done = FALSE;
+    task->cancelled = FALSE;
+
+    popup->priv->task = task;
+    popup->priv->thread = g_thread_new (NULL, (GThreadFunc) find_names, task);
+    popup->priv->poll_id = g_timeout_add (QUICKSEARCH_POLL_MSEC, (GSourceFunc) on_search_poll, popup);
+}
+
+
+static void stop_search (GnomeCmdQuicksearchPopup *popup)
+{
+    if (popup->priv->task)
+    {
+        g_atomic_int_set (&popup->priv->task->cancelled, TRUE);
+        g_thread_join (popup->priv->thread);
+        g_source_remove (popup->priv->poll_id);
+        free_task (popup->priv->task);
+        popup->priv->task = NULL;
+        popup->priv->thread = NULL;
+        popup->priv->poll_id = 0;
+    }
+
+    g_free (popup->priv->pending_text);
+    popup->priv->pending_text = NULL;
+
+    if (popup->priv->index)
+    {
+        name_match_free (popup->priv->index);
+        popup->priv->index = NULL;
+    }
+
+    if (popup->priv->files)
+    {
+        for (guint i=0; i<popup->priv->files->len; ++i)
+            GNOME_CMD_FILE (g_ptr_array_index (popup->priv->files, i))->unref();
+
+        g_ptr_array_free (popup->priv->files, TRUE);
+        popup->priv->files = NULL;
+    }
+}
+
+
 static void set_filter (GnomeCmdQuicksearchPopup *popup, const gchar *text)
 {
     g_return_if_fail (GNOME_CMD_IS_FILE_LIST (popup->priv->fl));
     g_return_if_fail (text != NULL);
 
-    gboolean first = TRUE;
-
     gtk_clist_freeze (GTK_CLIST (popup->priv->fl));
     GNOME_CMD_CLIST (popup->priv->fl)->drag_motion_row = -1;
     gtk_clist_thaw (GTK_CLIST (popup->priv->fl));
@@ -74,36 +267,62 @@ static void set_filter (GnomeCmdQuicksearchPopup *popup, const gchar *text)
         popup->priv->matches = NULL;
     }
 
-    gchar *pattern;
+    popup->priv->pos = NULL;
 
-    if (gnome_cmd_data.options.quick_search_exact_match_begin)
-        pattern = gnome_cmd_data.options.quick_search_exact_match_end ? g_strdup (text) : g_strconcat (text, "*", NULL);
-    else
-        pattern = gnome_cmd_data.options.quick_search_exact_match_end ? g_strconcat ("*", text, NULL) : g_strconcat ("*", text, "*", NULL);
+    // what was typed meanwhile is outdated now
+    if (popup->priv->task)
+        g_atomic_int_set (&popup->priv->task->cancelled, TRUE);
 
-    for (GList *files = popup->priv->fl->get_visible_files(); files; files = files->next)
+    g_free (popup->priv->pending_text);
+    popup->priv->pending_text = NULL;
+
+    if (name_match_is_plain (text))
     {
-        GnomeCmdFile *f = (GnomeCmdFile *) files->data;
+        make_index (popup);
 
-        if (gnome_cmd_filter_fnmatch (pattern, f->info->name, gnome_cmd_data.options.case_sens_sort))
+        if (popup->priv->files->len>=NAME_MATCH_ASYNC_MIN)
         {
-            if (first)
-            {
-                focus_file (popup, f);
-                first = FALSE;
-            }
+            start_search (popup, text);
+            return;
+        }
+
+        vector<guint32> found;
+
+        name_match_find (popup->priv->index, text, found);
+        set_matches (popup, found);
+    }
+    else
+    {
+        gchar *pattern;
+
+        if (gnome_cmd_data.options.quick_search_exact_match_begin)
+            pattern = gnome_cmd_data.options.quick_search_exact_match_end ? g_strdup (text) : g_strconcat (text, "*", NULL);
+        else
+            pattern = gnome_cmd_data.options.quick_search_exact_match_end ? g_strconcat ("*", text, NULL) : g_strconcat ("*", text, "*", NULL);
 
-            popup->priv->matches = g_list_append (popup->priv->matches, f);
+        for (GList *files = popup->priv->fl->get_visible_files(); files; files = files->next)
+        {
+            GnomeCmdFile *f = (GnomeCmdFile *) files->data;
+
+            if (gnome_cmd_filter_fnmatch (pattern, f->info->name, gnome_cmd_data.options.case_sens_sort))
+                popup->priv->matches = g_list_prepend (popup->priv->matches, f);
         }
+
+        popup->priv->matches = g_list_reverse (popup->priv->matches);
+
+        g_free (pattern);
     }
 
-    g_free (pattern);
+    set_pos (popup);
+}
 
-    // If no file matches the new filter, focus on the last file that matched a previous filter
-    if (popup->priv->matches==NULL && popup->priv->last_focused_file!=NULL)
-        popup->priv->matches = g_list_append (popup->priv->matches, popup->priv->last_focused_file);
 
-    popup->priv->pos = popup->priv->matches;
+static void search (GnomeCmdQuicksearchPopup *popup, const gchar *text)
+{
+    set_filter (popup, text);
+
+    if (popup->priv->pos)
+        focus_file (popup, GNOME_CMD_FILE (popup->priv->pos->data));
 }
 
 
@@ -114,8 +333,11 @@ inline void hide_popup (GnomeCmdQuicksearchPopup *popup)
     GNOME_CMD_CLIST (popup->priv->fl)->drag_motion_row = -1;
     gtk_clist_thaw (GTK_CLIST (popup->priv->fl));
     gtk_widget_grab_focus (GTK_WIDGET (popup->priv->fl));
+    stop_search (popup);
     if (popup->priv->matches)
         g_list_free (popup->priv->matches);
+    popup->priv->matches = NULL;
+    popup->priv->pos = NULL;
     popup->priv->last_focused_file = NULL;
     gtk_widget_hide (GTK_WIDGET (popup));
 }
@@ -123,10 +345,7 @@ inline void hide_popup (GnomeCmdQuicksearchPopup *popup)
 
 static void on_text_changed (GtkEntry *entry, GnomeCmdQuicksearchPopup *popup)
 {
-    set_filter (popup, gtk_entry_get_text (GTK_ENTRY (entry)));
-
-    if (popup->priv->pos)
-        focus_file (popup, GNOME_CMD_FILE (popup->priv->pos->data));
+    search (popup, gtk_entry_get_text (GTK_ENTRY (entry)));
 }
 
 
@@ -237,6 +456,8 @@ static void destroy (GtkObject *object)
 {
     GnomeCmdQuicksearchPopup *popup = GNOME_CMD_QUICKSEARCH_POPUP (object);
 
+    stop_search (popup);
+    g_list_free (popup->priv->matches);
     g_free (popup->priv);
 
     if (GTK_OBJECT_CLASS (parent_class)->destroy)
@@ -0,0 +1,238 @@
+/**
+ * @file gnome-cmd-sorted-index.h
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace GnomeCmd
+{
+    /**
+     * Row order of a list of pointers, kept sorted by a GCompareDataFunc.
+     * Positions are found by binary search, so inserting, removing and
+     * looking up the row of an element takes O(log n) comparisons (plus
+     * a memmove of the pointers behind it).
+     *
+     * Elements may be appended out of order, e.g. for search results;
+     * lookups then fall back to a linear scan until the next sort().
+     */
+    template <typename T>
+    class SortedIndex
+    {
+        struct Less
+        {
+            GCompareDataFunc compare_func;
+            gpointer user_data;
+
+            Less(GCompareDataFunc func, gpointer data): compare_func(func), user_data(data)   {}
+
+            bool operator () (T *a, T *b) const     {  return compare_func (a, b, user_data) < 0;  }
+        };
+
+        std::vector<T *> rows;
+        GCompareDataFunc compare_func;
+        gpointer user_data;
+        gboolean sorted;
+
+        template <typename Key, typename KeyLess>
+        struct KeyedLess
+        {
+            KeyLess key_less;
+
+            explicit KeyedLess(KeyLess l): key_less(l)  {}
+
+            bool operator () (const std::pair<Key, T *> &a, const std::pair<Key, T *> &b) const    {  return key_less (a.first, b.first);  }
+        };
+
+        Less less() const                           {  return Less(compare_func, user_data);  }
+
+      public:
+
+        typedef typename std::vector<T *>::const_iterator const_iterator;
+
+        SortedIndex(): compare_func(NULL), user_data(NULL), sorted(TRUE)   {}
+
+        void set_compare_func(GCompareDataFunc func, gpointer data)        {  compare_func = func;  user_data = data;  sorted = FALSE;  }
+
+        guint size() const                          {  return rows.size();   }
+        gboolean empty() const                      {  return rows.empty();  }
+        gboolean is_sorted() const                  {  return sorted;        }
+
+        T *operator [] (guint row) const            {  return row<rows.size() ? rows[row] : NULL;  }
+
+        const_iterator begin() const                {  return rows.begin();  }
+        const_iterator end() const                  {  return rows.end();    }
+
+        void clear()                                {  rows.clear();  sorted = TRUE;  }
+        void reserve(guint n)                       {  rows.reserve(n);  }
+
+        void append(T *t);
+        guint insert(T *t);
+        gint find(T *t) const;
+        gboolean remove(T *t);
+        void remove_at(guint row)                   {  rows.erase(rows.begin()+row);  }
+        guint remove(std::vector<T *> &removed);
+        void merge(std::vector<T *> &added);
+        void sort();
+        template <typename Key, typename MakeKey, typename KeyLess>
+        void load(std::vector<T *> &elements, MakeKey make_key, KeyLess key_less);
+    };
+
+    template <typename T>
+    inline void SortedIndex<T>::append(T *t)
+    {
+        if (sorted && compare_func && !rows.empty() && compare_func (rows.back(), t, user_data) > 0)
+            sorted = FALSE;
+
+        rows.push_back(t);
+    }
+
+    /**
+     * Inserts @a t behind all elements that compare equal to it and
+     * returns its row.
+     */
+    template <typename T>
+    inline guint SortedIndex<T>::insert(T *t)
+    {
+        g_return_val_if_fail (compare_func != NULL, 0);
+
+        if (!sorted)
+            sort();
+
+        typename std::vector<T *>::iterator i = std::upper_bound (rows.begin(), rows.end(), t, less());
+
+        return rows.insert(i, t) - rows.begin();
+    }
+
+    template <typename T>
+    inline gint SortedIndex<T>::find(T *t) const
+    {
+        if (sorted && compare_func)
+        {
+            std::pair<const_iterator, const_iterator> range = std::equal_range (rows.begin(), rows.end(), t, less());
+
+            for (const_iterator i=range.first; i!=range.second; ++i)
+                if (*i==t)
+                    return i - rows.begin();
+        }
+
+        // unsorted, or the element changed since it was placed (renamed, resized...)
+        const_iterator i = std::find (rows.begin(), rows.end(), t);
+
+        return i==rows.end() ? -1 : i - rows.begin();
+    }
+
+    template <typename T>
+    inline gboolean SortedIndex<T>::remove(T *t)
+    {
+        gint row = find(t);
+
+        if (row<0)
+            return FALSE;
+
+        remove_at(row);
+
+        return TRUE;
+    }
+
+    /**
+     * Removes all elements of @a removed with a single linear pass and
+     * returns their number.
+     */
+    template <typename T>
+    inline guint SortedIndex<T>::remove(std::vector<T *> &removed)
+    {
+        std::sort (removed.begin(), removed.end());
+
+        guint n = rows.size();
+        typename std::vector<T *>::iterator i = rows.begin();
+
+        for (typename std::vector<T *>::iterator j=rows.begin(); j!=rows.end(); ++j)
+            if (!std::binary_search (removed.begin(), removed.end(), *j))
+                *i++ = *j;
+
+        rows.erase(i, rows.end());
+
+        return n - rows.size();
+    }
+
+    /**
+     * Sorts @a added and merges it in with a single linear pass, which is
+     * cheaper than inserting the elements one by one once there are many.
+     */
+    template <typename T>
+    inline void SortedIndex<T>::merge(std::vector<T *> &added)
+    {
+        g_return_if_fail (compare_func != NULL);
+
+        if (!sorted)
+            sort();
+
+        std::stable_sort (added.begin(), added.end(), less());
+
+        guint n = rows.size();
+
+        rows.insert(rows.end(), added.begin(), added.end());
+        std::inplace_merge (rows.begin(), rows.begin()+n, rows.end(), less());
+    }
+
+    /**
+     * Replaces the content with @a elements, sorted by keys built once per
+     * element with make_key(t, key) and compared with key_less(key1, key2),
+     * which has to give the same order as the compare function. This is
+     * much cheaper than sort() when the compare function has to look up or
+     * compute its values on every call. @a elements is emptied.
+     */
+    template <typename T>
+    template <typename Key, typename MakeKey, typename KeyLess>
+    inline void SortedIndex<T>::load(std::vector<T *> &elements, MakeKey make_key, KeyLess key_less)
+    {
+        std::vector<std::pair<Key, T *> > keys(elements.size());
+
+        for (guint i=0; i<elements.size(); ++i)
+        {
+            make_key (elements[i], keys[i].first);
+            keys[i].second = elements[i];
+        }
+
+        std::stable_sort (keys.begin(), keys.end(), KeyedLess<Key, KeyLess>(key_less));
+
+        for (guint i=0; i<keys.size(); ++i)
+            elements[i] = keys[i].second;
+
+        rows.swap(elements);
+        elements.clear();
+        sorted = TRUE;
+    }
+
+    template <typename T>
+    inline void SortedIndex<T>::sort()
+    {
+        g_return_if_fail (compare_func != NULL);
+
+        std::stable_sort (rows.begin(), rows.end(), less());
+        sorted = TRUE;
+    }
+}
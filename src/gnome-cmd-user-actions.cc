@@ -35,6 +35,7 @@
 #include "gnome-cmd-user-actions.h"
 #include "gnome-cmd-dir-indicator.h"
 #include "gnome-cmd-style.h"
+#include "gnome-cmd-xfer.h"
 #include "plugin_manager.h"
 #include "cap.h"
 #include "utils.h"
@@ -281,6 +282,7 @@ static UserActionData user_actions_data[] = {
                                              {view_main_menu, "view.main_menu", N_("Display main menu")},
                                              {view_step_up, "view.step_up", N_("Move cursor one step up")},
                                              {view_step_down, "view.step_down", N_("Move cursor one step down")},
+                                             {view_transfers, "view.transfers", N_("Show the transfer queue")},
                                             };
 
 
@@ -1555,6 +1557,12 @@ void view_main_menu (GtkMenuItem *menuitem, gpointer not_used)
     g_settings_set_boolean (gcmd_user_actions.settings->general, GCMD_SETTINGS_MAINMENU_VISIBILITY, !mainmenu_visibility);
 }
 
+void view_transfers (GtkMenuItem *menuitem, gpointer not_used)
+{
+    gnome_cmd_xfer_show_queue ();
+}
+
+
 void view_first (GtkMenuItem *menuitem, gpointer not_used)
 {
     get_fs (ACTIVE)->first();
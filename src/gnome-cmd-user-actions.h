@@ -311,6 +311,7 @@ GNOME_CMD_USER_ACTION(view_horizontal_orientation);
 GNOME_CMD_USER_ACTION(view_main_menu);
 GNOME_CMD_USER_ACTION(view_step_up);
 GNOME_CMD_USER_ACTION(view_step_down);
+GNOME_CMD_USER_ACTION(view_transfers);
 
 /************** Bookmarks Menu **************/
 GNOME_CMD_USER_ACTION(bookmarks_add_current);
@@ -97,6 +97,9 @@ static void init (GnomeCmdXferProgressWin *win)
     win->fileprog_label = create_label (w, "");
     gtk_container_add (GTK_CONTAINER (vbox), win->fileprog_label);
 
+    win->rate_label = create_label (w, "");
+    gtk_container_add (GTK_CONTAINER (vbox), win->rate_label);
+
     win->totalprog = create_progress_bar (w);
     gtk_container_add (GTK_CONTAINER (vbox), win->totalprog);
 
@@ -187,6 +190,37 @@ void gnome_cmd_xfer_progress_win_set_total_progress (GnomeCmdXferProgressWin *wi
 }
 
 
+void gnome_cmd_xfer_progress_win_set_rate (GnomeCmdXferProgressWin *win,
+                                           gdouble bytes_per_sec,
+                                           gdouble files_per_sec,
+                                           gint64 seconds_left,
+                                           const gchar *bottleneck)
+{
+    if (bytes_per_sec<0)
+    {
+        gtk_label_set_text (GTK_LABEL (win->rate_label), "");
+        return;
+    }
+
+    GString *text = g_string_sized_new (128);
+
+    g_string_printf (text, _("%s/s, %.0f files/s"), size2string ((GnomeVFSFileSize) bytes_per_sec, gnome_cmd_data.options.size_disp_mode), files_per_sec);
+
+    if (seconds_left>=3600)
+        g_string_append_printf (text, _(", %d:%02d:%02d left"), (gint) (seconds_left / 3600), (gint) (seconds_left / 60 % 60), (gint) (seconds_left % 60));
+    else
+        if (seconds_left>=0)
+            g_string_append_printf (text, _(", %d:%02d left"), (gint) (seconds_left / 60), (gint) (seconds_left % 60));
+
+    if (bottleneck)
+        g_string_append_printf (text, _(" (mostly %s)"), bottleneck);
+
+    gtk_label_set_text (GTK_LABEL (win->rate_label), text->str);
+
+    g_string_free (text, TRUE);
+}
+
+
 void gnome_cmd_xfer_progress_win_set_msg (GnomeCmdXferProgressWin *win, const gchar *string)
 {
     gtk_label_set_text (GTK_LABEL (win->msg_label), string);
@@ -37,6 +37,7 @@ struct GnomeCmdXferProgressWin
     GtkWidget *fileprog;
     GtkWidget *msg_label;
     GtkWidget *fileprog_label;
+    GtkWidget *rate_label;
 
     gboolean cancel_pressed;
 };
@@ -58,6 +59,17 @@ void gnome_cmd_xfer_progress_win_set_total_progress (GnomeCmdXferProgressWin *wi
                                                      GnomeVFSFileSize bytes_copied,
                                                      GnomeVFSFileSize bytes_total);
 
+/**
+ * Shows the recent rate and the time left, or nothing while @a bytes_per_sec
+ * is negative. @a seconds_left is -1 if not known, @a bottleneck names the
+ * phase most of the time goes into when it isn't the copying itself.
+ */
+void gnome_cmd_xfer_progress_win_set_rate (GnomeCmdXferProgressWin *win,
+                                           gdouble bytes_per_sec,
+                                           gdouble files_per_sec,
+                                           gint64 seconds_left,
+                                           const gchar *bottleneck);
+
 void gnome_cmd_xfer_progress_win_set_msg (GnomeCmdXferProgressWin *win, const gchar *string);
 
 void gnome_cmd_xfer_progress_win_set_action (GnomeCmdXferProgressWin *win, const gchar *string);
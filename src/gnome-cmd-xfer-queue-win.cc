@@ -0,0 +1,242 @@
+/**
+ * @file gnome-cmd-xfer-queue-win.cc
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include "gnome-cmd-includes.h"
+#include "gnome-cmd-xfer-queue-win.h"
+#include "gnome-cmd-main-win.h"
+#include "gnome-cmd-treeview.h"
+#include "utils.h"
+
+using namespace std;
+
+
+#define QUEUE_UPDATE_RATE   500
+
+
+enum
+{
+    COL_ID,
+    COL_TITLE,
+    COL_STATE,
+    COL_PROGRESS,
+    NUM_COLS
+};
+
+
+static GtkWidget *queue_win = NULL;
+static GtkWidget *queue_view = NULL;
+static guint update_id = 0;
+
+
+inline const gchar *state_text (XferQueueJob *job)
+{
+    if (job->state==XFER_QUEUE_RUNNING)
+        return job->paused ? _("Paused") : _("Running");
+
+    return job->paused ? _("Held back") : _("Waiting");
+}
+
+
+static guint get_selected_id ()
+{
+    GtkTreeModel *model;
+    GtkTreeIter iter;
+    guint id = 0;
+
+    if (gtk_tree_selection_get_selected (gtk_tree_view_get_selection (GTK_TREE_VIEW (queue_view)), &model, &iter))
+        gtk_tree_model_get (model, &iter, COL_ID, &id, -1);
+
+    return id;
+}
+
+
+static void fill_view (XferQueue *queue)
+{
+    GtkListStore *store = GTK_LIST_STORE (gtk_tree_view_get_model (GTK_TREE_VIEW (queue_view)));
+    GtkTreeSelection *selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (queue_view));
+    guint selected_id = get_selected_id ();
+    GtkTreeIter iter;
+
+    gtk_list_store_clear (store);
+
+    for (GList *i = xfer_queue_get_jobs (queue); i; i = i->next)
+    {
+        XferQueueJob *job = (XferQueueJob *) i->data;
+
+        gtk_list_store_append (store, &iter);
+        gtk_list_store_set (store, &iter,
+                            COL_ID, job->id,
+                            COL_TITLE, job->title,
+                            COL_STATE, state_text (job),
+                            COL_PROGRESS, job->progress<0 ? 0 : (gint) (job->progress * 100.0f),
+                            -1);
+
+        if (job->id==selected_id)
+            gtk_tree_selection_select_iter (selection, &iter);
+    }
+}
+
+
+static gboolean update_view (XferQueue *queue)
+{
+    fill_view (queue);
+
+    return TRUE;
+}
+
+
+static void on_up (GtkButton *button, XferQueue *queue)
+{
+    xfer_queue_move (queue, get_selected_id (), -1);
+    fill_view (queue);
+}
+
+
+static void on_down (GtkButton *button, XferQueue *queue)
+{
+    xfer_queue_move (queue, get_selected_id (), 1);
+    fill_view (queue);
+}
+
+
+static void on_pause (GtkButton *button, XferQueue *queue)
+{
+    guint id = get_selected_id ();
+    gboolean paused = FALSE;
+
+    for (GList *i = xfer_queue_get_jobs (queue); i; i = i->next)
+        if (((XferQueueJob *) i->data)->id==id)
+            paused = ((XferQueueJob *) i->data)->paused;
+
+    if (id && !xfer_queue_pause (queue, id, !paused))
+        gnome_cmd_show_message (GTK_WINDOW (queue_win), _("This transfer can't be paused."),
+                                _("Only copies and moves between local files can be paused while they run."));
+
+    fill_view (queue);
+}
+
+
+static void on_cancel (GtkButton *button, XferQueue *queue)
+{
+    xfer_queue_cancel (queue, get_selected_id ());
+    fill_view (queue);
+}
+
+
+static void on_close (GtkButton *button, GtkWidget *win)
+{
+    gtk_widget_destroy (win);
+}
+
+
+static void on_destroy (GtkWidget *win, gpointer not_used)
+{
+    g_source_remove (update_id);
+    update_id = 0;
+    queue_win = queue_view = NULL;
+}
+
+
+inline GtkWidget *create_view ()
+{
+    GtkListStore *store = gtk_list_store_new (NUM_COLS, G_TYPE_UINT, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_INT);
+    GtkWidget *view = gtk_tree_view_new_with_model (GTK_TREE_MODEL (store));
+    GtkCellRenderer *renderer = NULL;
+
+    g_object_unref (store);          // destroy model automatically with view
+
+    g_object_set (view, "rules-hint", TRUE, NULL);
+
+    gnome_cmd_treeview_create_new_text_column (GTK_TREE_VIEW (view), renderer, COL_TITLE, _("Transfer"));
+    g_object_set (renderer,
+                  "ellipsize-set", TRUE,
+                  "ellipsize", PANGO_ELLIPSIZE_MIDDLE,
+                  NULL);
+
+    gnome_cmd_treeview_create_new_text_column (GTK_TREE_VIEW (view), COL_STATE, _("State"));
+
+    renderer = gtk_cell_renderer_progress_new ();
+    gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (view), -1, _("Progress"), renderer, "value", COL_PROGRESS, NULL);
+
+    gtk_tree_selection_set_mode (gtk_tree_view_get_selection (GTK_TREE_VIEW (view)), GTK_SELECTION_BROWSE);
+
+    return view;
+}
+
+
+void gnome_cmd_xfer_queue_win_show (XferQueue *queue)
+{
+    g_return_if_fail (queue != NULL);
+
+    if (queue_win)
+    {
+        fill_view (queue);
+        gtk_window_present (GTK_WINDOW (queue_win));
+        return;
+    }
+
+    queue_win = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+
+    GtkWidget *w = queue_win;
+
+    gtk_window_set_title (GTK_WINDOW (w), _("Transfers"));
+    gtk_window_set_transient_for (GTK_WINDOW (w), *main_win);
+    gtk_window_set_default_size (GTK_WINDOW (w), 500, 250);
+
+    GtkWidget *vbox = create_vbox (w, FALSE, 6);
+    gtk_container_add (GTK_CONTAINER (w), vbox);
+    gtk_container_set_border_width (GTK_CONTAINER (vbox), 5);
+
+    GtkWidget *hbox = create_hbox (w, FALSE, 6);
+    gtk_box_pack_start (GTK_BOX (vbox), hbox, TRUE, TRUE, 0);
+
+    GtkWidget *scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+    gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window), GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+    gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (scrolled_window), GTK_SHADOW_IN);
+    gtk_box_pack_start (GTK_BOX (hbox), scrolled_window, TRUE, TRUE, 0);
+
+    queue_view = create_view ();
+    gtk_container_add (GTK_CONTAINER (scrolled_window), queue_view);
+
+    GtkWidget *bbox = create_vbuttonbox (w);
+    gtk_button_box_set_layout (GTK_BUTTON_BOX (bbox), GTK_BUTTONBOX_START);
+    gtk_box_pack_start (GTK_BOX (hbox), bbox, FALSE, FALSE, 0);
+
+    gtk_container_add (GTK_CONTAINER (bbox), create_stock_button_with_data (w, GTK_STOCK_GO_UP, GTK_SIGNAL_FUNC (on_up), queue));
+    gtk_container_add (GTK_CONTAINER (bbox), create_stock_button_with_data (w, GTK_STOCK_GO_DOWN, GTK_SIGNAL_FUNC (on_down), queue));
+    gtk_container_add (GTK_CONTAINER (bbox), create_button_with_data (w, _("_Pause/Resume"), GTK_SIGNAL_FUNC (on_pause), queue));
+    gtk_container_add (GTK_CONTAINER (bbox), create_stock_button_with_data (w, GTK_STOCK_CANCEL, GTK_SIGNAL_FUNC (on_cancel), queue));
+
+    bbox = create_hbuttonbox (w);
+    gtk_box_pack_start (GTK_BOX (vbox), bbox, FALSE, FALSE, 0);
+
+    gtk_container_add (GTK_CONTAINER (bbox), create_stock_button (w, GTK_STOCK_CLOSE, GTK_SIGNAL_FUNC (on_close)));
+
+    g_signal_connect (w, "destroy", G_CALLBACK (on_destroy), NULL);
+
+    fill_view (queue);
+
+    update_id = g_timeout_add (QUEUE_UPDATE_RATE, (GSourceFunc) update_view, queue);
+
+    gtk_widget_show_all (w);
+}
@@ -21,6 +21,7 @@
 
 #include <config.h>
 #include <unistd.h>
+#include <errno.h>
 
 #include "gnome-cmd-includes.h"
 #include "gnome-cmd-xfer.h"
@@ -28,20 +29,30 @@
 #include "gnome-cmd-file-list.h"
 #include "gnome-cmd-dir.h"
 #include "gnome-cmd-xfer-progress-win.h"
+#include "gnome-cmd-xfer-queue-win.h"
 #include "gnome-cmd-main-win.h"
 #include "gnome-cmd-data.h"
 #include "utils.h"
+#include "tree-size.h"
+#include "xfer-local.h"
+#include "xfer-stats.h"
+#include "xfer-queue.h"
 
 using namespace std;
 
 
 #define XFER_PRIORITY GNOME_VFS_PRIORITY_DEFAULT
+#define XFER_RATE_UPDATE_USEC   G_USEC_PER_SEC
 
 
 struct XferData
 {
     GnomeVFSXferOptions xferOptions;
+    GnomeVFSXferOverwriteMode xferOverwriteMode;
     GnomeVFSAsyncHandle *handle;
+    guint queue_id;                             // 0 for the downloads, which don't wait in the queue
+    XferLocalJob *local_job;                    // transfers between local files are done natively
+    gboolean asking;                            // a question about the native transfer is shown
 
     // Source and target uri's. The first src_uri should be transfered to the first dest_uri and so on...
     GList *src_uri_list;
@@ -67,6 +78,17 @@ struct XferData
     GnomeVFSFileSize bytes_copied;
     GnomeVFSFileSize bytes_total;
     GnomeVFSFileSize total_bytes_copied;
+    TreeSizeJob *tree_size_job;                 // sums up the local sources of a move in the background
+    GnomeVFSFileSize remote_bytes_total;
+    gulong remote_files_total;
+
+    // Used for the rate, the time left and the transfer log
+    XferStats stats;
+    XferRate rate;
+    gint64 start_time;
+    gint64 phase_started;                       // of the GnomeVFS phase reported last
+    gint64 file_started;
+    gint64 rate_shown;
 
     GFunc on_completed_func;
     gpointer on_completed_data;
@@ -77,11 +99,29 @@ struct XferData
 };
 
 
+// copies and moves take turns on each device
+static XferQueue *xfer_queue = NULL;
+
+
+inline XferQueue *get_xfer_queue ()
+{
+    if (!xfer_queue)
+        xfer_queue = xfer_queue_new (gnome_cmd_data.options.transfers_per_device);
+    else
+        xfer_queue_set_max_per_device (xfer_queue, gnome_cmd_data.options.transfers_per_device);
+
+    return xfer_queue;
+}
+
+
 inline void free_xfer_data (XferData *data)
 {
     if (data->on_completed_func)
         data->on_completed_func (data->on_completed_data, NULL);
 
+    tree_size_job_free (data->tree_size_job);
+    xfer_local_job_free (data->local_job);
+
     g_list_free (data->src_uri_list);
 
     //  free the list with target uris
@@ -123,17 +163,33 @@ create_xfer_data (GnomeVFSXferOptions xferOptions, GList *src_uri_list, GList *d
     data->on_completed_data = on_completed_data;
     data->done = FALSE;
     data->aborted = FALSE;
+    data->start_time = g_get_monotonic_time ();
+    xfer_stats_init (&data->stats);
+    xfer_rate_init (&data->rate);
 
     // If this is a move-operation, determine totals
     // The async_xfer_callback-results for file and byte totals are not reliable
+    // Local sources are summed up in the background, update_xfer_gui_func() picks up their totals
     if (xferOptions == GNOME_VFS_XFER_REMOVESOURCE) {
         GList *uris;
+        GList *local_paths = NULL;
         data->bytes_total = 0;
         data->files_total = 0;
         for (uris = data->src_uri_list; uris != NULL; uris = uris->next) {
             GnomeVFSURI *uri;
             uri = (GnomeVFSURI*)uris->data;
-            data->bytes_total += calc_tree_size(uri,&(data->files_total));
+            if (gnome_vfs_uri_is_local (uri))
+                local_paths = g_list_append (local_paths, gnome_vfs_unescape_string (gnome_vfs_uri_get_path (uri), NULL));
+            else
+                data->bytes_total += calc_tree_size(uri,&(data->files_total));
+        }
+        data->remote_bytes_total = data->bytes_total;
+        data->remote_files_total = data->files_total;
+        if (local_paths)
+        {
+            data->tree_size_job = tree_size_job_new (local_paths);
+            g_list_foreach (local_paths, (GFunc) g_free, NULL);
+            g_list_free (local_paths);
         }
     }
 
@@ -154,8 +210,118 @@ inline gchar *file_details(const gchar *text_uri)
 }
 
 
+/**
+ * Asks whether to replace @a target_name with @a source_name, returns a GnomeVFSXferOverwriteAction.
+ */
+static gint query_overwrite (XferData *data, const gchar *source_name, const gchar *target_name)
+{
+    gchar *s = NULL;
+    // Check if the src uri is from local ('file:///...'). If not, just use the base name.
+    if ( !(s = gnome_vfs_get_local_path_from_uri (source_name) )) s = str_uri_basename (source_name);
+    gchar *t = gnome_cmd_dir_is_local (data->to_dir) ? gnome_vfs_get_local_path_from_uri (target_name) : str_uri_basename (target_name);
+
+    gchar *source_filename = get_utf8 (s);
+    gchar *target_filename = get_utf8 (t);
+
+    g_free (s);
+    g_free (t);
+
+    gchar *source_details = file_details (source_name);
+    gchar *target_details = file_details (target_name);
+
+    gchar *text = g_strdup_printf (_("Overwrite file:\n\n<b>%s</b>\n<span color='dimgray' size='smaller'>%s</span>\n\nWith:\n\n<b>%s</b>\n<span color='dimgray' size='smaller'>%s</span>"), target_filename, target_details, source_filename, source_details);
+
+    g_free (source_filename);
+    g_free (target_filename);
+    g_free (source_details);
+    g_free (target_details);
+
+    gdk_threads_enter ();
+
+    gint ret = run_simple_dialog (*main_win, FALSE, GTK_MESSAGE_QUESTION, text, " ",
+                     1, _("Abort"), _("Replace"), _("Replace All"), _("Skip"), _("Skip All"), NULL);
+    g_free(text);
+
+    gdk_threads_leave ();
+    return ret==-1 ? 0 : ret;
+}
+
+
+/**
+ * Asks what to do after copying to @a target_name failed, returns a GnomeVFSXferErrorAction.
+ */
+static gint query_error (XferData *data, const gchar *target_name, GnomeVFSResult result)
+{
+    const gchar *error = gnome_vfs_result_to_string (result);
+    gchar *t = gnome_cmd_dir_is_local (data->to_dir) ? gnome_vfs_get_local_path_from_uri (target_name) :
+                                                       str_uri_basename (target_name);
+    gchar *fn = get_utf8 (t);
+    gchar *msg = g_strdup_printf (_("Error while copying to %s\n\n%s"), fn, error);
+
+    gdk_threads_enter ();
+    gint ret = run_simple_dialog (*main_win, FALSE, GTK_MESSAGE_ERROR, msg, _("Transfer problem"),
+                                  -1, _("Abort"), _("Retry"), _("Skip"), NULL);
+    g_free (msg);
+    g_free (fn);
+    g_free (t);
+    gdk_threads_leave ();
+    return ret==-1 ? 0 : ret;
+}
+
+
+inline XferPhase xfer_phase (GnomeVFSXferPhase phase)
+{
+    switch (phase)
+    {
+        case GNOME_VFS_XFER_PHASE_OPENSOURCE:
+        case GNOME_VFS_XFER_PHASE_OPENTARGET:
+        case GNOME_VFS_XFER_PHASE_MOVING:
+            return XFER_PHASE_CREATE;
+
+        case GNOME_VFS_XFER_PHASE_COPYING:
+            return XFER_PHASE_COPY;
+
+        case GNOME_VFS_XFER_PHASE_SETATTRIBUTES:
+        case GNOME_VFS_XFER_PHASE_CLOSESOURCE:
+        case GNOME_VFS_XFER_PHASE_CLOSETARGET:
+        case GNOME_VFS_XFER_PHASE_DELETESOURCE:
+        case GNOME_VFS_XFER_PHASE_FILECOMPLETED:
+            return XFER_PHASE_FINISH;
+
+        default:
+            return XFER_PHASE_SCAN;
+    }
+}
+
+
+/**
+ * Charges the time since the last callback to the phase reported then,
+ * and times each file from opening its source to its completion.
+ */
+static void time_vfs_phase (XferData *data, GnomeVFSXferProgressInfo *info)
+{
+    gint64 now = g_get_monotonic_time ();
+
+    if (data->phase_started)
+        data->stats.phase_usec[xfer_phase (data->cur_phase)] += now - data->phase_started;
+
+    data->phase_started = now;
+
+    if (info->phase==GNOME_VFS_XFER_PHASE_OPENSOURCE && !data->file_started)
+        data->file_started = now;
+
+    if (info->phase==GNOME_VFS_XFER_PHASE_FILECOMPLETED && data->file_started)
+    {
+        xfer_stats_add_file (&data->stats, info->file_size, now - data->file_started);
+        data->file_started = 0;
+    }
+}
+
+
 static gint async_xfer_callback (GnomeVFSAsyncHandle *handle, GnomeVFSXferProgressInfo *info, XferData *data)
 {
+    time_vfs_phase (data, info);
+
     data->cur_phase = info->phase;
     data->cur_file = info->file_index;
     // only update totals if larger than current value
@@ -182,56 +348,19 @@ static gint async_xfer_callback (GnomeVFSAsyncHandle *handle, GnomeVFSXferProgre
 
     if (info->status == GNOME_VFS_XFER_PROGRESS_STATUS_OVERWRITE)
     {
-    gchar *s = NULL;
-    // Check if the src uri is from local ('file:///...'). If not, just use the base name.
-    if ( !(s = gnome_vfs_get_local_path_from_uri (info->source_name) )) s = str_uri_basename (info->source_name);
-        gchar *t = gnome_cmd_dir_is_local (data->to_dir) ? gnome_vfs_get_local_path_from_uri (info->target_name) : str_uri_basename (info->target_name);
-
-        gchar *source_filename = get_utf8 (s);
-        gchar *target_filename = get_utf8 (t);
-
-        g_free (s);
-        g_free (t);
-
-        gchar *source_details = file_details (info->source_name);
-        gchar *target_details = file_details (info->target_name);
-
-        gchar *text = g_strdup_printf (_("Overwrite file:\n\n<b>%s</b>\n<span color='dimgray' size='smaller'>%s</span>\n\nWith:\n\n<b>%s</b>\n<span color='dimgray' size='smaller'>%s</span>"), target_filename, target_details, source_filename, source_details);
-
-        g_free (source_filename);
-        g_free (target_filename);
-        g_free (source_details);
-        g_free (target_details);
-
-        gdk_threads_enter ();
-
-        gint ret = run_simple_dialog (*main_win, FALSE, GTK_MESSAGE_QUESTION, text, " ",
-                         1, _("Abort"), _("Replace"), _("Replace All"), _("Skip"), _("Skip All"), NULL);
-        g_free(text);
-
+        gint ret = query_overwrite (data, info->source_name, info->target_name);
         data->prev_status = GNOME_VFS_XFER_PROGRESS_STATUS_OVERWRITE;
-        gdk_threads_leave ();
-        return ret==-1 ? 0 : ret;
+        data->phase_started = g_get_monotonic_time ();      // the time the question was shown doesn't count
+        return ret;
     }
 
     if (info->status == GNOME_VFS_XFER_PROGRESS_STATUS_VFSERROR
         && data->prev_status != GNOME_VFS_XFER_PROGRESS_STATUS_OVERWRITE)
     {
-        const gchar *error = gnome_vfs_result_to_string (info->vfs_status);
-        gchar *t = gnome_cmd_dir_is_local (data->to_dir) ? gnome_vfs_get_local_path_from_uri (info->target_name) :
-                                                           str_uri_basename (info->target_name);
-        gchar *fn = get_utf8 (t);
-        gchar *msg = g_strdup_printf (_("Error while copying to %s\n\n%s"), fn, error);
-
-        gdk_threads_enter ();
-        gint ret = run_simple_dialog (*main_win, FALSE, GTK_MESSAGE_ERROR, msg, _("Transfer problem"),
-                                      -1, _("Abort"), _("Retry"), _("Skip"), NULL);
-        g_free (msg);
-        g_free (fn);
-        g_free (t);
+        gint ret = query_error (data, info->target_name, info->vfs_status);
         data->prev_status = GNOME_VFS_XFER_PROGRESS_STATUS_VFSERROR;
-        gdk_threads_leave ();
-        return ret==-1 ? 0 : ret;
+        data->phase_started = g_get_monotonic_time ();
+        return ret;
     }
 
     if (info->phase == GNOME_VFS_XFER_PHASE_COMPLETED)
@@ -246,19 +375,185 @@ static gint async_xfer_callback (GnomeVFSAsyncHandle *handle, GnomeVFSXferProgre
 }
 
 
+/**
+ * Passes the progress of the native transfer on to the fields filled by
+ * async_xfer_callback() for GnomeVFS, and asks its questions.
+ */
+static void update_local_xfer (XferData *data)
+{
+    XferLocalProgress progress;
+    gboolean done = xfer_local_job_get_progress (data->local_job, &progress);
+
+    data->cur_phase = GNOME_VFS_XFER_PHASE_COPYING;
+    data->cur_file = progress.files_done;
+    data->files_total = MAX (data->files_total, progress.files_done);
+    data->file_size = progress.file_size;
+    data->bytes_copied = progress.file_bytes_copied;
+    data->total_bytes_copied = progress.bytes_copied;
+    data->bytes_total = MAX (data->bytes_total, progress.bytes_copied);
+    data->stats = progress.stats;
+
+    if (progress.file)
+    {
+        g_free (data->cur_file_name);
+        data->cur_file_name = gnome_vfs_get_uri_from_local_path (progress.file);
+        g_free (progress.file);
+    }
+
+    gchar *src, *dest;
+    gint error;
+    XferLocalQuestion question = xfer_local_job_get_question (data->local_job, &src, &dest, &error);
+
+    if (question)
+    {
+        gchar *src_uri = gnome_vfs_get_uri_from_local_path (src);
+        gchar *dest_uri = gnome_vfs_get_uri_from_local_path (dest ? dest : src);
+
+        data->asking = TRUE;
+
+        if (question==XFER_LOCAL_QUESTION_OVERWRITE)
+            xfer_local_job_answer (data->local_job, query_overwrite (data, src_uri, dest_uri));
+        else
+            xfer_local_job_answer (data->local_job, query_error (data, dest_uri, gnome_vfs_result_from_errno_code (error)));
+
+        data->asking = FALSE;
+
+        g_free (src_uri);
+        g_free (dest_uri);
+        g_free (src);
+        g_free (dest);
+    }
+
+    if (done)
+    {
+        data->cur_phase = GNOME_VFS_XFER_PHASE_COMPLETED;
+        data->done = TRUE;
+    }
+}
+
+
+static void update_rate (XferData *data)
+{
+    gint64 now = g_get_monotonic_time ();
+
+    xfer_rate_add (&data->rate, now, data->total_bytes_copied, data->cur_file);
+
+    // changing every tick, the numbers couldn't be read
+    if (now - data->rate_shown < XFER_RATE_UPDATE_USEC)
+        return;
+
+    data->rate_shown = now;
+
+    gdouble bytes_per_sec, files_per_sec;
+
+    if (!xfer_rate_get (&data->rate, &bytes_per_sec, &files_per_sec))
+        return;
+
+    guint64 bytes_left = data->bytes_total>data->total_bytes_copied ? data->bytes_total - data->total_bytes_copied : 0;
+    guint64 files_left = data->files_total>data->cur_file ? data->files_total - data->cur_file : 0;
+    const gchar *bottleneck = NULL;
+
+    switch (xfer_stats_main_phase (&data->stats))
+    {
+        case XFER_PHASE_SCAN:
+            bottleneck = _("reading directories");
+            break;
+
+        case XFER_PHASE_CREATE:
+            bottleneck = _("creating files");
+            break;
+
+        case XFER_PHASE_FINISH:
+            bottleneck = _("closing files");
+            break;
+
+        default:
+            break;
+    }
+
+    gnome_cmd_xfer_progress_win_set_rate (data->win, bytes_per_sec, files_per_sec,
+                                          xfer_rate_eta (&data->rate, bytes_left, files_left), bottleneck);
+}
+
+
+/**
+ * Appends the timing of the transfer to transfers.log in the config dir.
+ */
+static void log_xfer (XferData *data)
+{
+    if (!gnome_cmd_data.options.transfer_log)
+        return;
+
+    const gchar *operation = !data->to_dir ? "download" :
+                             data->xferOptions & GNOME_VFS_XFER_LINK_ITEMS ? "link" :
+                             data->xferOptions & GNOME_VFS_XFER_REMOVESOURCE ? "move" : "copy";
+    gulong files = data->cur_file==(gulong) -1 ? 0 : data->cur_file;
+    gchar *line = xfer_stats_to_log (&data->stats, operation, data->local_job ? "native" : "gnome-vfs",
+                                     files, data->total_bytes_copied, g_get_monotonic_time () - data->start_time,
+                                     data->aborted);
+    gchar *path = config_dir ? g_build_filename (config_dir, "transfers.log", NULL) : g_build_filename (g_get_home_dir (), "." PACKAGE, "transfers.log", NULL);
+
+    FILE *f = fopen (path, "a");
+
+    if (f)
+    {
+        fprintf (f, "%s\n", line);
+        fclose (f);
+    }
+    else
+        DEBUG ('x', "Can't append to %s: %s\n", path, g_strerror (errno));
+
+    g_free (path);
+    g_free (line);
+}
+
+
 static gboolean update_xfer_gui_func (XferData *data)
 {
+    // the dialogs run the main loop, wait until they are answered
+    if (data->asking)
+        return TRUE;
+
     if (data->win && data->win->cancel_pressed)
     {
         data->aborted = TRUE;
 
+        log_xfer (data);
+
         if (data->on_completed_func)
             data->on_completed_func (data->on_completed_data, NULL);
 
+        tree_size_job_free (data->tree_size_job);
+        data->tree_size_job = NULL;
+        xfer_local_job_free (data->local_job);
+        data->local_job = NULL;
+
+        if (data->queue_id)
+            xfer_queue_done (xfer_queue, data->queue_id);
+
         gtk_widget_destroy (GTK_WIDGET (data->win));
         return FALSE;
     }
 
+    if (data->tree_size_job)
+    {
+        guint64 bytes, files;
+        gboolean done = tree_size_job_get (data->tree_size_job, &bytes, &files);
+
+        // the remote sources were summed up already, and the callback may have reported more
+        data->bytes_total = MAX (data->bytes_total, data->remote_bytes_total + bytes);
+        data->files_total = MAX (data->files_total, data->remote_files_total + files);
+
+        if (done)
+        {
+            tree_size_job_free (data->tree_size_job);
+            data->tree_size_job = NULL;
+        }
+    }
+
+    if (data->local_job)
+        update_local_xfer (data);
+
     if (data->cur_phase == GNOME_VFS_XFER_PHASE_COPYING)
     {
         if (data->prev_phase != GNOME_VFS_XFER_PHASE_COPYING)
@@ -282,11 +577,16 @@ static gboolean update_xfer_gui_func (XferData *data)
             g_free (t);
         }
 
+        update_rate (data);
+
         if (data->bytes_total > 0)
         {
             gfloat total_prog = (gfloat)((gdouble)data->total_bytes_copied / (gdouble)data->bytes_total);
             gfloat total_diff = total_prog - data->prev_totalprog;
 
+            if (data->queue_id)
+                xfer_queue_set_progress (xfer_queue, data->queue_id, total_prog);
+
             if ((total_diff > (gfloat)0.01 && total_prog >= 0.0 && total_prog <= 1.0) || data->first_time)
             {
                 data->first_time = FALSE;
@@ -299,6 +599,11 @@ static gboolean update_xfer_gui_func (XferData *data)
 
     if (data->done)
     {
+        log_xfer (data);
+
+        if (data->queue_id)
+            xfer_queue_done (xfer_queue, data->queue_id);
+
         // Remove files from the source file list when a move operation has finished
         if (data->xferOptions & GNOME_VFS_XFER_REMOVESOURCE)
             if (data->src_fl && data->src_files)
@@ -351,6 +656,62 @@ static gboolean update_xfer_gui_func (XferData *data)
 }
 
 
+/**
+ * Returns TRUE if the native engine can do the transfer: plain copies and
+ * moves from local files to local files.
+ */
+static gboolean can_xfer_locally (GList *src_uri_list, GList *dest_uri_list, GnomeVFSXferOptions xferOptions)
+{
+    if (xferOptions & ~(GNOME_VFS_XFER_RECURSIVE | GNOME_VFS_XFER_FOLLOW_LINKS | GNOME_VFS_XFER_REMOVESOURCE))
+        return FALSE;
+
+    for (GList *i = src_uri_list; i; i = i->next)
+        if (!gnome_vfs_uri_is_local ((GnomeVFSURI *) i->data))
+            return FALSE;
+
+    for (GList *i = dest_uri_list; i; i = i->next)
+        if (!gnome_vfs_uri_is_local ((GnomeVFSURI *) i->data))
+            return FALSE;
+
+    return TRUE;
+}
+
+
+inline GList *uri_list_to_local_paths (GList *uri_list)
+{
+    GList *paths = NULL;
+
+    for (GList *i = uri_list; i; i = i->next)
+        paths = g_list_append (paths, gnome_vfs_unescape_string (gnome_vfs_uri_get_path ((GnomeVFSURI *) i->data), NULL));
+
+    return paths;
+}
+
+
+static void start_local_xfer (XferData *data, GnomeVFSXferOptions xferOptions, GnomeVFSXferOverwriteMode xferOverwriteMode)
+{
+    GList *src_paths = uri_list_to_local_paths (data->src_uri_list);
+    GList *dest_paths = uri_list_to_local_paths (data->dest_uri_list);
+
+    DEBUG ('x', "Transferring %u local files natively\n", g_list_length (src_paths));
+
+    // the totals for the progress bar, moves have them already
+    if (!data->tree_size_job && !(xferOptions & GNOME_VFS_XFER_REMOVESOURCE))
+        data->tree_size_job = tree_size_job_new (src_paths);
+
+    data->local_job = xfer_local_job_new (src_paths, dest_paths,
+                                          (xferOptions & GNOME_VFS_XFER_REMOVESOURCE) != 0,
+                                          (xferOptions & GNOME_VFS_XFER_FOLLOW_LINKS) != 0,
+                                          (XferLocalOverwriteMode) xferOverwriteMode,
+                                          gnome_cmd_data.options.transfer_checksums);
+
+    g_list_foreach (src_paths, (GFunc) g_free, NULL);
+    g_list_free (src_paths);
+    g_list_foreach (dest_paths, (GFunc) g_free, NULL);
+    g_list_free (dest_paths);
+}
+
+
 inline gboolean uri_is_parent_to_dir_or_equal (GnomeVFSURI *uri, GnomeCmdDir *dir)
 {
     GnomeVFSURI *dir_uri = GNOME_CMD_FILE (dir)->get_uri ();
@@ -400,6 +761,132 @@ inline gboolean file_is_already_in_dir (GnomeVFSURI *uri, GnomeCmdDir *dir)
 }
 
 
+/**
+ * Returns the key of the device @a uri is on for the queue. Remote
+ * files are limited by the connection to their host instead.
+ */
+static gchar *get_device_of_uri (GnomeVFSURI *uri)
+{
+    if (!gnome_vfs_uri_is_local (uri))
+    {
+        const gchar *host = gnome_vfs_uri_get_host_name (uri);
+
+        return g_strconcat (gnome_vfs_uri_get_scheme (uri), "://", host ? host : "", NULL);
+    }
+
+    gchar *path = gnome_vfs_unescape_string (gnome_vfs_uri_get_path (uri), NULL);
+    gchar *device = xfer_queue_device_of_path (path);
+
+    g_free (path);
+
+    return device;
+}
+
+
+static gchar **get_xfer_devices (XferData *data)
+{
+    GPtrArray *devices = g_ptr_array_new ();
+    GList *lists[] = {data->src_uri_list, data->dest_uri_list};
+
+    for (guint n=0; n<G_N_ELEMENTS (lists); ++n)
+        for (GList *i = lists[n]; i; i = i->next)
+        {
+            gchar *device = get_device_of_uri ((GnomeVFSURI *) i->data);
+
+            if (device)
+                g_ptr_array_add (devices, device);
+        }
+
+    g_ptr_array_add (devices, NULL);
+
+    return (gchar **) g_ptr_array_free (devices, FALSE);
+}
+
+
+static gchar *get_xfer_title (XferData *data)
+{
+    gchar *dest_uri = GNOME_CMD_FILE (data->to_dir)->get_uri_str();
+    gchar *dest = gnome_vfs_format_uri_for_display (dest_uri);
+    guint n = g_list_length (data->src_uri_list);
+    gchar *title;
+
+    if (n==1)
+    {
+        gchar *name = gnome_vfs_uri_extract_short_name ((GnomeVFSURI *) data->src_uri_list->data);
+        gchar *fn = get_utf8 (name);
+
+        title = g_strdup_printf (data->xferOptions & GNOME_VFS_XFER_REMOVESOURCE ? _("Move “%s” to %s") : _("Copy “%s” to %s"), fn, dest);
+
+        g_free (fn);
+        g_free (name);
+    }
+    else
+        title = g_strdup_printf (data->xferOptions & GNOME_VFS_XFER_REMOVESOURCE ? ngettext("Move %d file to %s", "Move %d files to %s", n)
+                                                                                 : ngettext("Copy %d file to %s", "Copy %d files to %s", n), n, dest);
+
+    g_free (dest);
+    g_free (dest_uri);
+
+    return title;
+}
+
+
+/**
+ * Starts the transfer once the queue gives it its turn.
+ */
+static void start_xfer (XferData *data)
+{
+    data->start_time = g_get_monotonic_time ();
+
+    gtk_widget_show (GTK_WIDGET (data->win));
+
+    if (can_xfer_locally (data->src_uri_list, data->dest_uri_list, data->xferOptions))
+        start_local_xfer (data, data->xferOptions, data->xferOverwriteMode);
+    else
+        gnome_vfs_async_xfer (&data->handle, data->src_uri_list, data->dest_uri_list,
+                              data->xferOptions, GNOME_VFS_XFER_ERROR_MODE_QUERY, data->xferOverwriteMode,
+                              XFER_PRIORITY,
+                              (GnomeVFSAsyncXferProgressCallback) async_xfer_callback, data,
+                              NULL, NULL);
+
+    g_timeout_add (gnome_cmd_data.gui_update_rate, (GSourceFunc) update_xfer_gui_func, data);
+}
+
+
+static gboolean pause_xfer (XferData *data, gboolean pause)
+{
+    // GnomeVFS transfers can only be stopped, not held
+    if (!data->local_job)
+        return FALSE;
+
+    xfer_local_job_pause (data->local_job, pause);
+    gnome_cmd_xfer_progress_win_set_action (data->win, pause ? _("paused") : _("copying…"));
+
+    return TRUE;
+}
+
+
+static void cancel_xfer (XferData *data, XferQueueState state)
+{
+    if (state==XFER_QUEUE_RUNNING)
+    {
+        data->win->cancel_pressed = TRUE;       // update_xfer_gui_func() stops it
+        return;
+    }
+
+    // never started
+    gnome_cmd_dir_unref (data->to_dir);
+    gtk_widget_destroy (GTK_WIDGET (data->win));
+    free_xfer_data (data);
+}
+
+
+void gnome_cmd_xfer_show_queue ()
+{
+    gnome_cmd_xfer_queue_win_show (get_xfer_queue ());
+}
+
+
 void
 gnome_cmd_xfer_uris_start (GList *src_uri_list,
                            GnomeCmdDir *to_dir,
@@ -464,16 +951,27 @@ gnome_cmd_xfer_uris_start (GList *src_uri_list,
     data->win = GNOME_CMD_XFER_PROGRESS_WIN (gnome_cmd_xfer_progress_win_new (num_files));
     gtk_widget_ref (GTK_WIDGET (data->win));
     gtk_window_set_title (GTK_WINDOW (data->win), _("preparing…"));
-    gtk_widget_show (GTK_WIDGET (data->win));
 
-    //  start the transfer
-    gnome_vfs_async_xfer (&data->handle, data->src_uri_list, data->dest_uri_list,
-                          xferOptions, GNOME_VFS_XFER_ERROR_MODE_QUERY, xferOverwriteMode,
-                          XFER_PRIORITY,
-                          (GnomeVFSAsyncXferProgressCallback) async_xfer_callback, data,
-                          NULL, NULL);
+    data->xferOverwriteMode = xferOverwriteMode;
 
-    g_timeout_add (gnome_cmd_data.gui_update_rate, (GSourceFunc) update_xfer_gui_func, data);
+    //  start the transfer, or let it wait for its devices
+    gchar *title = get_xfer_title (data);
+    gchar **devices = get_xfer_devices (data);
+    XferQueue *queue = get_xfer_queue ();
+
+    data->queue_id = xfer_queue_add (queue, title, devices,
+                                     (XferQueueStartFunc) start_xfer, (XferQueuePauseFunc) pause_xfer,
+                                     (XferQueueCancelFunc) cancel_xfer, data);
+
+    g_strfreev (devices);
+    g_free (title);
+
+    for (GList *i = xfer_queue_get_jobs (queue); i; i = i->next)
+        if (((XferQueueJob *) i->data)->id==data->queue_id && ((XferQueueJob *) i->data)->state==XFER_QUEUE_WAITING)
+        {
+            gnome_cmd_xfer_queue_win_show (queue);
+            break;
+        }
 }
 
 
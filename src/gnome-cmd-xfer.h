@@ -46,6 +46,11 @@ gnome_cmd_xfer_uris_start (GList *src_uri_list,
                            GtkSignalFunc on_completed_func,
                            gpointer on_completed_data);
 
+/**
+ * Shows the copies and moves that are running or waiting for their turn.
+ */
+void gnome_cmd_xfer_show_queue ();
+
 void
 gnome_cmd_xfer_tmp_download (GnomeVFSURI *src_uri,
                              GnomeVFSURI *dest_uri,
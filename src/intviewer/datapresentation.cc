@@ -34,11 +34,14 @@
 #include "gvtypes.h"
 
 #include "inputmodes.h"
+#include "line-index.h"
 #include "datapresentation.h"
 
 using namespace std;
 
 
+#define EOL_CHUNK   128     // characters decoded at a time while looking for the end of a line
+
 typedef offset_type (*align_offset_to_line_start_proc)(GVDataPresentation *dp, offset_type offset);
 typedef offset_type (*scroll_lines_proc)(GVDataPresentation *dp, offset_type current_offset, int delta);
 typedef offset_type (*get_end_of_line_offset_proc)(GVDataPresentation *dp, offset_type start_of_line);
@@ -50,6 +53,7 @@ struct GVDataPresentation
     guint fixed_count;
     offset_type max_offset;
     guint tab_size;
+    GVLineIndex *line_index;
 
     PRESENTATION presentation_mode;
 
@@ -158,6 +162,13 @@ void gv_set_wrap_limit(GVDataPresentation *dp, guint chars_per_line)
 }
 
 
+void gv_set_line_index(GVDataPresentation *dp, GVLineIndex *idx)
+{
+    g_return_if_fail (dp!=NULL);
+    dp->line_index = idx;
+}
+
+
 offset_type gv_align_offset_to_line_start(GVDataPresentation *dp, offset_type offset)
 {
     g_return_val_if_fail (dp!=NULL, 0);
@@ -237,6 +248,21 @@ static offset_type nowrap_scroll_lines(GVDataPresentation *dp, offset_type curre
     if (delta==0)
         return current_offset;
 
+    // Lines already indexed are found without reading all the lines in between
+    guint64 line;
+    offset_type offset;
+
+    if (dp->line_index && gv_line_index_get_line(dp->line_index, current_offset, &line))
+    {
+        if (delta<0)
+            line = (guint64) -(gint64) delta > line ? 0 : line + delta;
+        else
+            line += delta;
+
+        if (gv_line_index_get_offset(dp->line_index, line, &offset))
+            return offset;
+    }
+
     if (delta<0)
     {
         delta = abs(delta);
@@ -270,23 +296,25 @@ static offset_type nowrap_scroll_lines(GVDataPresentation *dp, offset_type curre
 
 static offset_type nowrap_get_eol(GVDataPresentation *dp, offset_type start_of_line)
 {
+    char_type chars[EOL_CHUNK];
+    offset_type offsets[EOL_CHUNK+1];
     offset_type offset = start_of_line;
 
     while (TRUE)
     {
-        char_type value = gv_input_mode_get_utf8_char(dp->imd, offset);
+        int count = gv_input_mode_get_utf8_chars(dp->imd, offset, chars, offsets, EOL_CHUNK);
 
-        if (value==INVALID_CHAR)
-            break;
+        for (int i=0; i<count; i++)
+            // break upon end of line
+            if (chars[i]=='\n' || chars[i]=='\r')
+                return offsets[i+1];
 
-        offset = gv_input_get_next_char_offset(dp->imd, offset);
+        // reached eof
+        if (count<EOL_CHUNK)
+            return offsets[count];
 
-        // break upon end of line
-        if (value=='\n' || value=='\r')
-            break;
+        offset = offsets[count];
     }
-
-    return offset;
 }
 
 
@@ -373,8 +401,9 @@ static offset_type wrap_scroll_lines(GVDataPresentation *dp, offset_type current
 
 static offset_type wrap_get_eol(GVDataPresentation *dp, offset_type start_of_line)
 {
-    offset_type offset;
-    char_type value;
+    char_type chars[EOL_CHUNK];
+    offset_type offsets[EOL_CHUNK+1];
+    offset_type offset = start_of_line;
 
     /* A Single TAB character in the file,
        Translates to several displayable characters on the screen.
@@ -382,31 +411,31 @@ static offset_type wrap_get_eol(GVDataPresentation *dp, offset_type start_of_lin
        characters before wraping the line */
     guint char_count = 0;
 
-    offset = start_of_line;
-
     while (TRUE)
     {
-        value = gv_input_mode_get_utf8_char(dp->imd, offset);
+        int count = gv_input_mode_get_utf8_chars(dp->imd, offset, chars, offsets, EOL_CHUNK);
 
-        if (value==INVALID_CHAR)
-            break;
+        for (int i=0; i<count; i++)
+        {
+            // break upon end of line
+            if (chars[i]=='\n' || chars[i]=='\r')
+                return offsets[i+1];
 
-        offset = gv_input_get_next_char_offset(dp->imd, offset);
+            if (chars[i]=='\t')
+                char_count += dp->tab_size;
+            else
+                char_count++;
 
-        // break upon end of line
-        if (value=='\n' || value=='\r')
-            break;
+            if (char_count >= dp->wrap_limit)
+                return offsets[i+1];
+        }
 
-        if (value=='\t')
-            char_count += dp->tab_size;
-        else
-            char_count++;
+        // reached eof
+        if (count<EOL_CHUNK)
+            return offsets[count];
 
-        if (char_count >= dp->wrap_limit)
-            break;
+        offset = offsets[count];
     }
-
-    return offset;
 }
 
 
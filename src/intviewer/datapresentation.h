@@ -46,6 +46,11 @@ void gv_set_wrap_limit(GVDataPresentation *dp, guint chars_per_line);
 void gv_set_fixed_count(GVDataPresentation *dp, guint chars_per_line);
 void gv_set_tab_size(GVDataPresentation *dp, guint tab_size);
 
+/*
+    lets the no-wrap presentation scroll through the lines at once, 'idx' is not owned
+*/
+void gv_set_line_index(GVDataPresentation *dp, GVLineIndex *idx);
+
 offset_type gv_align_offset_to_line_start(GVDataPresentation *dp, offset_type offset);
 offset_type gv_scroll_lines (GVDataPresentation *dp, offset_type current_offset, int delta);
 offset_type gv_get_end_of_line_offset(GVDataPresentation *dp, offset_type start_of_line);
@@ -53,13 +53,27 @@
 using namespace std;
 
 
+// A part of the file, mapped or read into memory
+struct GVWindow
+{
+    offset_type start;
+    unsigned char *data;
+    gsize len;
+    guint64 used;           // when it was used last, the least recently used one is dropped
+    gboolean mapped;
+};
+
+
 struct _ViewerFileOps
 {
     // File handling (based on 'Midnight Commander'-'s view.c)
     char *filename;        // Name of the file
-    unsigned char *data;    // Memory area for the file to be viewed
     int file;        // File descriptor (for mmap and munmap)
-    int mmapping;        // Did we use mmap on the file?
+
+    // The file is viewed through a few windows, so that its size doesn't matter
+    GVWindow windows[GV_WINDOWS_MAX];
+    GVWindow *current;      // the window used last
+    guint64 clock;
 
     // Growing buffers information
     int growing_buffer;    // Use the growing buffers?
@@ -101,6 +115,113 @@ inline const char *unix_error_string (int error_num)
 }
 
 
+static void unmap_window (GVWindow *w)
+{
+    if (!w->data)
+        return;
+
+#ifdef HAVE_MMAP
+    if (w->mapped)
+        munmap ((char *) w->data, w->len);
+    else
+#endif
+        g_free (w->data);
+
+    w->data = NULL;
+    w->len = 0;
+}
+
+
+static void unmap_windows (ViewerFileOps *ops)
+{
+    for (int i=0; i<GV_WINDOWS_MAX; ++i)
+        unmap_window (&ops->windows[i]);
+
+    ops->current = NULL;
+}
+
+
+static gboolean map_window (ViewerFileOps *ops, GVWindow *w, offset_type start)
+{
+    gsize len = MIN(GV_WINDOW_SIZE, (offset_type) ops->s.st_size - start);
+
+#ifdef HAVE_MMAP
+    void *data = mmap (0, len, PROT_READ, MAP_FILE | MAP_SHARED, ops->file, (off_t) start);
+
+    if (data != MAP_FAILED)
+    {
+        // reading on from the window before, as scrolling down and searching do
+        if (ops->current && start==ops->current->start+ops->current->len)
+            madvise (data, len, MADV_SEQUENTIAL);
+
+        w->start = start;
+        w->data = (unsigned char *) data;
+        w->len = len;
+        w->mapped = TRUE;
+        return TRUE;
+    }
+#endif                // HAVE_MMAP
+
+    /* For the OSes that don't provide mmap call, read the window into
+    * memory.  Also, mmap can fail for any reason, so we use this as
+    * fallback (pavel@ucw.cz) */
+    unsigned char *buff = (unsigned char *) g_try_malloc (len);
+
+    if (!buff || pread (ops->file, buff, len, (off_t) start) != (ssize_t) len)
+    {
+        g_free (buff);
+        return FALSE;
+    }
+
+    w->start = start;
+    w->data = buff;
+    w->len = len;
+    w->mapped = FALSE;
+    return TRUE;
+}
+
+
+/*
+    returns the window holding @byte_index, replacing the least recently used one if needed,
+    or NULL if it can't be read
+*/
+static GVWindow *get_window (ViewerFileOps *ops, offset_type byte_index)
+{
+    offset_type start = byte_index - byte_index % GV_WINDOW_SIZE;
+    GVWindow *w = NULL;
+    GVWindow *lru = &ops->windows[0];
+
+    for (int i=0; i<GV_WINDOWS_MAX && !w; ++i)
+    {
+        GVWindow *p = &ops->windows[i];
+
+        if (p->data && p->start==start)
+            w = p;
+        else
+            if (lru->data && (!p->data || p->used<lru->used))
+                lru = p;
+    }
+
+    if (!w)
+    {
+        if (lru==ops->current)
+            ops->current = NULL;
+
+        unmap_window (lru);
+
+        if (!map_window (ops, lru, start))
+            return NULL;
+
+        w = lru;
+    }
+
+    w->used = ++ops->clock;
+    ops->current = w;
+
+    return w;
+}
+
+
 static int gv_file_internal_open(ViewerFileOps *ops, int fd)
 {
     g_return_val_if_fail (ops!=NULL, -1);
@@ -195,6 +316,14 @@ offset_type gv_file_get_max_offset(ViewerFileOps *ops)
 }
 
 
+int gv_file_get_fd(ViewerFileOps *ops)
+{
+    g_return_val_if_fail (ops!=NULL, -1);
+
+    return ops->growing_buffer ? -1 : ops->file;
+}
+
+
 void gv_file_close (ViewerFileOps *ops)
 {
     g_return_if_fail (ops!=NULL);
@@ -227,6 +356,8 @@ const char *gv_file_load(ViewerFileOps *ops, int fd)
 {
     g_return_val_if_fail (ops!=NULL, "invalid ops parameter");
 
+    unmap_windows (ops);
+
     ops->file = fd;
 
     if (ops->s.st_size == 0)
@@ -235,51 +366,10 @@ const char *gv_file_load(ViewerFileOps *ops, int fd)
         gv_file_close (ops);
         return gv_file_init_growing_view (ops, ops->filename);
     }
-#ifdef HAVE_MMAP
- #if defined (__GNUC__)
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wsign-compare"
-#endif
-    if ((size_t) ops->s.st_size == ops->s.st_size)
-        ops->data = (unsigned char *) mmap (0, ops->s.st_size, PROT_READ, MAP_FILE | MAP_SHARED, ops->file, 0);
-    else
-        ops->data = (unsigned char *) MAP_FAILED;
-#if defined (__GNUC__)
-#pragma GCC diagnostic pop
-#endif
-
-    if (ops->data != MAP_FAILED)
-    {
-        // mmap worked
-        ops->first = 0;
-        ops->bytes_read = ops->s.st_size;
-        ops->mmapping = 1;
-        return NULL;
-    }
-#endif                // HAVE_MMAP
 
-    /* For the OSes that don't provide mmap call, try to load all the
-    * file into memory (alex@bcs.zaporizhzhe.ua).  Also, mmap can fail
-    * for any reason, so we use this as fallback (pavel@ucw.cz) */
-
-    // Make sure view->s.st_size is not truncated when passed to g_malloc
-#if defined (__GNUC__)
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wsign-compare"
-#endif
-    if ((gulong) ops->s.st_size == ops->s.st_size)
-        ops->data = (unsigned char *) g_try_malloc ((gulong) ops->s.st_size);
-    else
-        ops->data = NULL;
-#if defined (__GNUC__)
-#pragma GCC diagnostic pop
-#endif
-
-    if (ops->data == NULL ||
-        lseek (ops->file, 0, SEEK_SET) != 0 ||
-        read (ops->file, (char *) ops->data, ops->s.st_size) != ops->s.st_size)
+    // The rest of the file is mapped as it is looked at
+    if (!get_window (ops, 0))
     {
-        g_free (ops->data);
         gv_file_close (ops);
         return gv_file_init_growing_view (ops, ops->filename);
     }
@@ -338,8 +428,58 @@ int gv_file_get_byte (ViewerFileOps *ops, offset_type byte_index)
 
         return byte_index >= ops->bytes_read ? -1 : ops->block_ptr[page - 1][offset];
     }
-    else
-        return byte_index >= ops->last_byte ? -1 : ops->data[byte_index];
+
+    if (byte_index >= ops->last_byte)
+        return -1;
+
+    GVWindow *w = ops->current;
+
+    if (!w || byte_index<w->start || byte_index>=w->start+w->len)
+    {
+        w = get_window (ops, byte_index);
+
+        if (!w)
+            return -1;
+    }
+
+    return w->data[byte_index - w->start];
+}
+
+
+int gv_file_get_bytes (ViewerFileOps *ops, offset_type offset, unsigned char *buffer, int len)
+{
+    g_return_val_if_fail (ops!=NULL, 0);
+
+    int n = 0;
+
+    if (ops->growing_buffer)
+    {
+        for (int value; n<len && (value = gv_file_get_byte (ops, offset+n))>=0; n++)
+            buffer[n] = (unsigned char) value;
+
+        return n;
+    }
+
+    while (n<len && offset+n<ops->last_byte)
+    {
+        GVWindow *w = ops->current;
+
+        if (!w || offset+n<w->start || offset+n>=w->start+w->len)
+        {
+            w = get_window (ops, offset+n);
+
+            if (!w)
+                break;
+        }
+
+        gsize from = offset + n - w->start;
+        gsize count = MIN((gsize) (len-n), w->len-from);
+
+        memcpy (buffer+n, w->data+from, count);
+        n += count;
+    }
+
+    return n;
 }
 
 
@@ -348,10 +488,7 @@ void gv_file_free(ViewerFileOps *ops)
 {
     g_return_if_fail (ops!=NULL);
 
-#ifdef HAVE_MMAP
-    if (ops->mmapping)
-        munmap ((char *) ops->data, ops->s.st_size);
-#endif                // HAVE_MMAP
+    unmap_windows (ops);
     gv_file_close (ops);
 
     // Block_ptr may be zero if the file was a file with 0 bytes
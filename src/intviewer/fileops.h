@@ -31,8 +31,15 @@
     'load' & 'free' : allocate & free buffer memory, call mmap/munmap
 
     calling order should be: open->load->[use file with "get_byte"]->free (which calls close)
+
+    Regular files are mapped through up to GV_WINDOWS_MAX windows of GV_WINDOW_SIZE bytes,
+    the least recently used one is dropped for a new one, so files of any size open at once
+    and never take more memory than that.
 */
 
+#define GV_WINDOW_SIZE  (4 << 20)
+#define GV_WINDOWS_MAX  8
+
 
 typedef struct _ViewerFileOps ViewerFileOps;
 
@@ -62,8 +69,20 @@ const char *gv_file_init_growing_view (ViewerFileOps *ops, const char *filename)
 */
 int gv_file_get_byte (ViewerFileOps *ops, offset_type byte_index);
 
+/*
+    copies up to 'len' bytes from 'offset' into 'buffer',
+    returns the number of bytes copied, less than 'len' only at EOF (or on failure)
+*/
+int gv_file_get_bytes (ViewerFileOps *ops, offset_type offset, unsigned char *buffer, int len);
+
 offset_type gv_file_get_max_offset(ViewerFileOps *ops);
 
+/*
+    returns the descriptor of a regular file, for reading it in another thread,
+    or -1 for a growing view
+*/
+int gv_file_get_fd(ViewerFileOps *ops);
+
 void gv_file_close (ViewerFileOps *ops);
 
 void gv_file_free (ViewerFileOps *ops);
@@ -41,9 +41,5 @@
 */
 typedef guint32  char_type;
 #define INVALID_CHAR ((char_type) -1)
-/*
- Note:
- Currently on files<2GB are supported (even though this is unsigned)
-*/
-typedef unsigned long offset_type;
+typedef guint64 offset_type;
 #define INVALID_OFFSET ((offset_type) -1)
@@ -39,12 +39,14 @@ struct GVInputModesData
     gchar *input_mode_name;
 
     get_byte_proc   get_byte;
+    get_bytes_proc  get_bytes;
     void            *get_byte_user_data;
 
     /*
        Changing these function pointers is what constitues of an input mode chagne
     */
     input_get_char_proc get_char;
+    input_get_chars_proc get_chars;
     input_get_offset_proc get_next_offset;
     input_get_offset_proc get_prev_offset;
 
@@ -66,9 +68,11 @@ struct GVInputModesData
 static offset_type inputmode_ascii_get_next_offset(GVInputModesData *imd, offset_type offset);
 static offset_type inputmode_ascii_get_previous_offset(GVInputModesData *imd, offset_type offset);
 static char_type inputmode_ascii_get_char(GVInputModesData *imd, offset_type offset);
+static int inputmode_ascii_get_chars(GVInputModesData *imd, offset_type offset, char_type *chars, offset_type *offsets, int max_chars);
 static void inputmode_ascii_activate(GVInputModesData *imd, const gchar *encoding);
 
 static char_type inputmode_utf8_get_char(GVInputModesData *imd, offset_type offset);
+static int inputmode_utf8_get_chars(GVInputModesData *imd, offset_type offset, char_type *chars, offset_type *offsets, int max_chars);
 static offset_type inputmode_utf8_get_previous_offset(GVInputModesData *imd, offset_type offset);
 static offset_type inputmode_utf8_get_next_offset(GVInputModesData *imd, offset_type offset);
 static void inputmode_utf8_activate(GVInputModesData *imd);
@@ -81,7 +85,7 @@ GVInputModesData *gv_input_modes_new()
 /*
   General Input Mode Public Functions
 */
-void gv_init_input_modes(GVInputModesData *imd, get_byte_proc proc, void *get_byte_user_data)
+void gv_init_input_modes(GVInputModesData *imd, get_byte_proc proc, void *get_byte_user_data, get_bytes_proc bytes_proc)
 {
     g_return_if_fail (imd!=NULL);
 
@@ -90,6 +94,7 @@ void gv_init_input_modes(GVInputModesData *imd, get_byte_proc proc, void *get_by
     g_return_if_fail (proc!=NULL);
 
     imd->get_byte = proc;
+    imd->get_bytes = bytes_proc;
     imd->get_byte_user_data = get_byte_user_data;
 
     /*
@@ -156,6 +161,18 @@ char_type gv_input_mode_get_utf8_char(GVInputModesData *imd, offset_type offset)
 }
 
 
+int gv_input_mode_get_utf8_chars(GVInputModesData *imd, offset_type offset, char_type *chars, offset_type *offsets, int max_chars)
+{
+    g_return_val_if_fail (imd!=NULL, 0);
+    g_return_val_if_fail (imd->get_chars!=NULL, 0);
+    g_return_val_if_fail (chars!=NULL && offsets!=NULL, 0);
+
+    offsets[0] = offset;
+
+    return max_chars>0 ? imd->get_chars(imd, offset, chars, offsets, max_chars) : 0;
+}
+
+
 offset_type gv_input_get_next_char_offset(GVInputModesData *imd, offset_type current_offset)
 {
     g_return_val_if_fail (imd!=NULL, 0);
@@ -188,10 +205,41 @@ int gv_input_mode_get_raw_byte(GVInputModesData *imd, offset_type offset)
 }
 
 
+int gv_input_mode_get_raw_bytes(GVInputModesData *imd, offset_type offset, unsigned char *buffer, int len)
+{
+    g_return_val_if_fail (imd!=NULL, 0);
+
+    if (imd->get_bytes)
+        return imd->get_bytes(imd->get_byte_user_data, offset, buffer, len);
+
+    int n;
+
+    for (n=0; n<len; n++)
+    {
+        int value = gv_input_mode_get_byte(imd, offset+n);
+
+        if (value<0)
+            break;
+
+        buffer[n] = (unsigned char) value;
+    }
+
+    return n;
+}
+
+
 /*****************************************************************************
   Specific Input mode related function
 ******************************************************************************/
 
+/*
+    Block decoding: the bytes are read DECODE_CHUNK at a time, with a few more after them
+    to decide about the characters at the end of the chunk
+*/
+#define DECODE_CHUNK    4096
+#define DECODE_AHEAD    4
+
+
 /************ ASCII input mode *****************/
 
 static void inputmode_ascii_activate(GVInputModesData *imd, const gchar *encoding)
@@ -206,6 +254,7 @@ static void inputmode_ascii_activate(GVInputModesData *imd, const gchar *encodin
     for (i=0; i<256; i++)
         imd->ascii_charset_translation[i] = is_displayable(i) ? i : '.';
     imd->get_char = inputmode_ascii_get_char;
+    imd->get_chars = inputmode_ascii_get_chars;
     imd->get_next_offset = inputmode_ascii_get_next_offset;
     imd->get_prev_offset = inputmode_ascii_get_previous_offset;
     g_free (imd->input_mode_name);
@@ -291,6 +340,46 @@ static char_type inputmode_ascii_get_char(GVInputModesData *imd, offset_type off
 }
 
 
+static int inputmode_ascii_get_chars(GVInputModesData *imd, offset_type offset, char_type *chars, offset_type *offsets, int max_chars)
+{
+    unsigned char buffer[DECODE_CHUNK+DECODE_AHEAD];
+    int count = 0;
+
+    while (count<max_chars)
+    {
+        int want = MIN(max_chars-count, DECODE_CHUNK);
+        int n = gv_input_mode_get_raw_bytes(imd, offset, buffer, want+1);
+        int limit = n<want+1 ? n : want;
+        int p = 0;
+
+        while (p<limit)
+        {
+            unsigned char value = buffer[p++];
+
+            if (value=='\r' || value=='\n' || value=='\t')
+            {
+                chars[count] = value;
+
+                // "\r\n" is a single character
+                if (value=='\r' && p<n && buffer[p]=='\n')
+                    p++;
+            }
+            else
+                chars[count] = imd->ascii_charset_translation[value];
+
+            offsets[++count] = offset + p;
+        }
+
+        offset += p;
+
+        if (n<want+1)
+            break;
+    }
+
+    return count;
+}
+
+
 char_type gv_input_mode_byte_to_utf8(GVInputModesData *imd, unsigned char data)
 {
     g_return_val_if_fail (imd!=NULL, '.');
@@ -351,6 +440,7 @@ static void inputmode_utf8_activate(GVInputModesData *imd)
     g_return_if_fail (imd!=NULL);
 
     imd->get_char = inputmode_utf8_get_char;
+    imd->get_chars = inputmode_utf8_get_chars;
     imd->get_prev_offset = inputmode_utf8_get_previous_offset;
     imd->get_next_offset = inputmode_utf8_get_next_offset;
     g_free (imd->input_mode_name);
@@ -429,7 +519,7 @@ static char_type inputmode_utf8_get_char(GVInputModesData *imd, offset_type offs
 
     if (!utf8_is_valid_char(imd, offset))
     {
-        g_warning ("invalid UTF character at offset %lu (%02x)", offset,
+        g_warning ("invalid UTF character at offset %" G_GUINT64_FORMAT " (%02x)", offset,
             (unsigned char)gv_input_mode_get_byte(imd, offset));
         return '.';
     }
@@ -456,6 +546,87 @@ static char_type inputmode_utf8_get_char(GVInputModesData *imd, offset_type offs
 }
 
 
+/*
+    The same as inputmode_utf8_get_char, over a buffer: a character is valid only if the byte after it
+    can be read as well, an invalid one is decoded as '.' (without the warning) and skipped by a byte.
+    Runs of ASCII are recognised eight bytes at a time.
+*/
+static int inputmode_utf8_get_chars(GVInputModesData *imd, offset_type offset, char_type *chars, offset_type *offsets, int max_chars)
+{
+    unsigned char buffer[DECODE_CHUNK+DECODE_AHEAD];
+    int count = 0;
+
+    while (count<max_chars)
+    {
+        int want = MIN(max_chars-count, DECODE_CHUNK);
+        int n = gv_input_mode_get_raw_bytes(imd, offset, buffer, want+DECODE_AHEAD);
+        int limit = n<want+DECODE_AHEAD ? n : want;
+        int p = 0;
+
+        while (p<limit && count<max_chars)
+        {
+            if (p+8<n && count+8<=max_chars)
+            {
+                guint64 word;
+
+                memcpy (&word, buffer+p, sizeof(word));
+
+                if ((word & G_GUINT64_CONSTANT(0x8080808080808080))==0)
+                {
+                    for (int i=0; i<8; i++)
+                    {
+                        chars[count] = buffer[p++];
+                        offsets[++count] = offset + p;
+                    }
+                    continue;
+                }
+            }
+
+            unsigned char value = buffer[p];
+            int len = UTF8_SINGLE_CHAR(value) ? 1 :
+                      UTF8_HEADER_2BYTES(value) ? 2 :
+                      UTF8_HEADER_3BYTES(value) ? 3 :
+                      UTF8_HEADER_4BYTES(value) ? 4 : 0;
+
+            if (len==0 || p+len>=n)
+                len = 0;
+            else
+                for (int i=1; i<len; i++)
+                    if (!UTF8_TRAILER_CHAR(buffer[p+i]))
+                    {
+                        len = 0;
+                        break;
+                    }
+
+            if (len==0)
+            {
+                chars[count] = '.';
+                p++;
+            }
+            else
+            {
+                char_type c = 0;
+
+                for (int i=0; i<len; i++)
+                    c += (char_type) buffer[p+i] << (8*i);
+
+                chars[count] = c;
+                p += len;
+            }
+
+            offsets[++count] = offset + p;
+        }
+
+        offset += p;
+
+        if (n<want+DECODE_AHEAD)
+            break;
+    }
+
+    return count;
+}
+
+
 static offset_type inputmode_utf8_get_previous_offset(GVInputModesData *imd, offset_type offset)
 {
     if (offset==0)
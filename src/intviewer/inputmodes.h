@@ -31,6 +31,7 @@ struct GVInputModesData;
 /* input function types */
 typedef char_type (*input_get_char_proc)(GVInputModesData *imd, offset_type offset);
 typedef offset_type (*input_get_offset_proc)(GVInputModesData *imd, offset_type offset);
+typedef int (*input_get_chars_proc)(GVInputModesData *imd, offset_type offset, char_type *chars, offset_type *offsets, int max_chars);
 
 
 /*
@@ -40,6 +41,12 @@ typedef offset_type (*input_get_offset_proc)(GVInputModesData *imd, offset_type
 */
 typedef int (*get_byte_proc)(void *user_data, offset_type offset);
 
+/*
+  Optional, copies up to 'len' bytes from 'offset' into 'buffer' at once.
+  Should return the number of bytes copied, less than 'len' only at EOF.
+*/
+typedef int (*get_bytes_proc)(void *user_data, offset_type offset, unsigned char *buffer, int len);
+
 
 GVInputModesData *gv_input_modes_new();
 
@@ -50,7 +57,7 @@ GVInputModesData *gv_input_modes_new();
 
   Also activates the default ASCII input mode, without any character encodings
 */
-void gv_init_input_modes(GVInputModesData *imd, get_byte_proc proc, void *get_byte_user_data);
+void gv_init_input_modes(GVInputModesData *imd, get_byte_proc proc, void *get_byte_user_data, get_bytes_proc bytes_proc=NULL);
 
 /*
    Free any internal data used by the input mode translators
@@ -88,6 +95,17 @@ void gv_set_input_mode(GVInputModesData *imd, const gchar *input_mode);
 */
 char_type gv_input_mode_get_utf8_char(GVInputModesData *imd, offset_type offset);
 
+/*
+    decodes up to 'max_chars' characters from 'offset' on, stopping only at EOF.
+
+    'chars' receives the same characters as gv_input_mode_get_utf8_char would return one by one,
+    and 'offsets' (which holds max_chars+1 items) the offset of each of them,
+    followed by the offset of the next character.
+
+    returns the number of characters decoded.
+*/
+int gv_input_mode_get_utf8_chars(GVInputModesData *imd, offset_type offset, char_type *chars, offset_type *offsets, int max_chars);
+
 /*
     Special hack:
     Control Characters (\r \n \t) are NOT translated by 'gv_input_mode_get_utf8_char, ever.
@@ -108,6 +126,13 @@ void gv_input_mode_update_utf8_translation(GVInputModesData *imd, unsigned char
 */
 int gv_input_mode_get_raw_byte(GVInputModesData *imd, offset_type offset);
 
+/*
+    copies up to 'len' RAW bytes from 'offset' into 'buffer'.
+
+    returns the number of bytes copied, less than 'len' only at EOF.
+*/
+int gv_input_mode_get_raw_bytes(GVInputModesData *imd, offset_type offset, unsigned char *buffer, int len);
+
 /*
     returns the BYTE offset of the next logical character.
 
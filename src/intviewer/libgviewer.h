@@ -32,6 +32,7 @@
 #include "viewer-utils.h"
 #include "fileops.h"
 #include "inputmodes.h"
+#include "line-index.h"
 #include "datapresentation.h"
 #include "scroll-box.h"
 #include "image-render.h"
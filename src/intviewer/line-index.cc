@@ -0,0 +1,348 @@
+/**
+ * @file line-index.cc
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @copyright (C) 2006 Assaf Gordon\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "gvtypes.h"
+#include "line-index.h"
+
+using namespace std;
+
+
+#define BUILD_BLOCK_SIZE    (1 << 20)
+#define LOOKUP_BLOCK_SIZE   (64 << 10)
+
+
+/*
+    Reads the file in blocks from a line start, and returns the starts of the following lines.
+    The ends of lines are looked for with memchr(), which is vectorised.
+*/
+struct LineScanner
+{
+    int fd;
+    offset_type size;
+    gboolean crlf;
+    volatile gint *cancelled;
+
+    gchar *buff;
+    gsize buff_size;
+    offset_type buff_start;
+    gsize buff_len;
+    gsize pos;
+
+    offset_type last;       // the line start returned last
+    gboolean done;
+
+    LineScanner(int _fd, offset_type _size, gboolean _crlf, gsize _buff_size, offset_type from, volatile gint *_cancelled=NULL);
+    ~LineScanner()          {  g_free (buff);  }
+
+    int byte_at(offset_type offset);
+    gboolean fill();
+    gboolean next(offset_type &start);
+};
+
+
+LineScanner::LineScanner(int _fd, offset_type _size, gboolean _crlf, gsize _buff_size, offset_type from, volatile gint *_cancelled)
+{
+    fd = _fd;
+    size = _size;
+    crlf = _crlf;
+    cancelled = _cancelled;
+    buff_size = _buff_size;
+    buff = (gchar *) g_malloc (buff_size);
+    buff_start = from;
+    buff_len = 0;
+    pos = 0;
+    last = from;
+    done = FALSE;
+}
+
+
+int LineScanner::byte_at(offset_type offset)
+{
+    if (offset>=buff_start && offset<buff_start+buff_len)
+        return (guchar) buff[offset-buff_start];
+
+    guchar c;
+
+    if (offset>=size || pread (fd, &c, 1, (off_t) offset)!=1)
+        return -1;
+
+    return c;
+}
+
+
+/*
+    reads the next block, returns FALSE at the end of the file
+*/
+gboolean LineScanner::fill()
+{
+    buff_start += buff_len;
+    buff_len = 0;
+    pos = 0;
+
+    if (buff_start>=size)
+        return FALSE;
+
+    if (cancelled && g_atomic_int_get (cancelled))
+        return FALSE;
+
+    ssize_t n = pread (fd, buff, MIN(buff_size, size-buff_start), (off_t) buff_start);
+
+    if (n<=0)
+        return FALSE;
+
+    buff_len = n;
+
+    return TRUE;
+}
+
+
+gboolean LineScanner::next(offset_type &start)
+{
+    while (!done)
+    {
+        if (pos>=buff_len && !fill())
+        {
+            if (cancelled && g_atomic_int_get (cancelled))
+                return FALSE;
+
+            done = TRUE;
+
+            // the end of the file starts the last line, unless a line ends right there
+            if (last==size)
+                return FALSE;
+
+            start = last = size;
+            return TRUE;
+        }
+
+        const gchar *p = buff + pos;
+        const gchar *end = buff + buff_len;
+        const gchar *lf = (const gchar *) memchr (p, '\n', end-p);
+        const gchar *cr = (const gchar *) memchr (p, '\r', (lf ? lf : end) - p);
+        const gchar *hit = cr ? cr : lf;
+
+        if (!hit)
+        {
+            pos = buff_len;
+            continue;
+        }
+
+        pos = hit - buff + 1;
+
+        offset_type offset = buff_start + pos;
+
+        // "\r\n" ends a single line, after the '\n'
+        if (*hit=='\r' && crlf && byte_at (offset)=='\n')
+            continue;
+
+        start = last = offset;
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+
+struct GVLineIndex
+{
+    int fd;
+    offset_type size;
+    gboolean crlf;
+
+    GMutex lock;                        // for everything below
+    vector<offset_type> checkpoints;    // the start of every GV_LINE_INDEX_STEP-th line
+    offset_type indexed;                // the lines starting up to here are counted
+    guint64 n_lines;
+    gboolean complete;
+
+    gint cancelled;
+    GThread *thread;
+};
+
+
+static gpointer build_index (GVLineIndex *idx)
+{
+    LineScanner scanner(idx->fd, idx->size, idx->crlf, BUILD_BLOCK_SIZE, 0, &idx->cancelled);
+    guint64 n_lines = 1;
+    offset_type start;
+
+    while (scanner.next(start))
+    {
+        if (n_lines % GV_LINE_INDEX_STEP==0)
+        {
+            g_mutex_lock (&idx->lock);
+            idx->checkpoints.push_back(start);
+            idx->indexed = start;
+            g_mutex_unlock (&idx->lock);
+        }
+
+        ++n_lines;
+    }
+
+    if (g_atomic_int_get (&idx->cancelled))
+        return NULL;
+
+    g_mutex_lock (&idx->lock);
+    idx->indexed = idx->size;
+    idx->n_lines = n_lines;
+    idx->complete = TRUE;
+    g_mutex_unlock (&idx->lock);
+
+    return NULL;
+}
+
+
+GVLineIndex *gv_line_index_new(int fd, offset_type size, gboolean crlf)
+{
+    g_return_val_if_fail (fd>=0, NULL);
+
+    GVLineIndex *idx = new GVLineIndex;
+
+    idx->fd = dup (fd);
+    idx->size = size;
+    idx->crlf = crlf;
+    idx->checkpoints.push_back(0);
+    idx->indexed = 0;
+    idx->n_lines = 0;
+    idx->complete = FALSE;
+    idx->cancelled = FALSE;
+    g_mutex_init (&idx->lock);
+
+    idx->thread = idx->fd==-1 ? NULL : g_thread_new (NULL, (GThreadFunc) build_index, idx);
+
+    return idx;
+}
+
+
+void gv_line_index_free(GVLineIndex *idx)
+{
+    g_return_if_fail (idx!=NULL);
+
+    g_atomic_int_set (&idx->cancelled, TRUE);
+
+    if (idx->thread)
+        g_thread_join (idx->thread);
+
+    if (idx->fd!=-1)
+        close (idx->fd);
+
+    g_mutex_clear (&idx->lock);
+
+    delete idx;
+}
+
+
+gboolean gv_line_index_is_complete(GVLineIndex *idx)
+{
+    g_return_val_if_fail (idx!=NULL, FALSE);
+
+    g_mutex_lock (&idx->lock);
+    gboolean complete = idx->complete;
+    g_mutex_unlock (&idx->lock);
+
+    return complete;
+}
+
+
+guint64 gv_line_index_get_line_count(GVLineIndex *idx)
+{
+    g_return_val_if_fail (idx!=NULL, 0);
+
+    g_mutex_lock (&idx->lock);
+    guint64 n_lines = idx->n_lines;
+    g_mutex_unlock (&idx->lock);
+
+    return n_lines;
+}
+
+
+gboolean gv_line_index_get_line(GVLineIndex *idx, offset_type offset, guint64 *line)
+{
+    g_return_val_if_fail (idx!=NULL, FALSE);
+    g_return_val_if_fail (line!=NULL, FALSE);
+
+    offset = MIN(offset, idx->size);
+
+    g_mutex_lock (&idx->lock);
+
+    if (offset>idx->indexed)
+    {
+        g_mutex_unlock (&idx->lock);
+        return FALSE;
+    }
+
+    gsize k = upper_bound (idx->checkpoints.begin(), idx->checkpoints.end(), offset) - idx->checkpoints.begin() - 1;
+    offset_type checkpoint = idx->checkpoints[k];
+
+    g_mutex_unlock (&idx->lock);
+
+    LineScanner scanner(idx->fd, idx->size, idx->crlf, LOOKUP_BLOCK_SIZE, checkpoint);
+    offset_type start;
+
+    *line = (guint64) k * GV_LINE_INDEX_STEP;
+
+    while (scanner.next(start) && start<=offset)
+        ++*line;
+
+    return TRUE;
+}
+
+
+gboolean gv_line_index_get_offset(GVLineIndex *idx, guint64 line, offset_type *offset)
+{
+    g_return_val_if_fail (idx!=NULL, FALSE);
+    g_return_val_if_fail (offset!=NULL, FALSE);
+
+    g_mutex_lock (&idx->lock);
+
+    if (idx->complete && line>=idx->n_lines)
+        line = idx->n_lines - 1;
+
+    guint64 k = line / GV_LINE_INDEX_STEP;
+
+    if (k>=idx->checkpoints.size())
+    {
+        g_mutex_unlock (&idx->lock);
+        return FALSE;
+    }
+
+    *offset = idx->checkpoints[k];
+
+    g_mutex_unlock (&idx->lock);
+
+    LineScanner scanner(idx->fd, idx->size, idx->crlf, LOOKUP_BLOCK_SIZE, *offset);
+
+    for (guint64 n = line % GV_LINE_INDEX_STEP; n>0 && scanner.next(*offset); --n)
+        ;
+
+    return TRUE;
+}
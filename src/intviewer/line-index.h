@@ -0,0 +1,68 @@
+/**
+ * @file line-index.h
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @copyright (C) 2006 Assaf Gordon\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#pragma once
+
+/*
+    Line index (for the text presentation of large files)
+
+    A thread reads the file once and keeps the offset of every GV_LINE_INDEX_STEP-th line,
+    so that the start of any line, or the line of any offset, is found by reading at most
+    GV_LINE_INDEX_STEP lines from the nearest checkpoint.
+
+    Lines end after '\n' and after '\r', or after "\r\n" when 'crlf' is set, the same as
+    the input modes move by characters. The end of the file starts a last, empty line.
+*/
+
+#define GV_LINE_INDEX_STEP  1024
+
+struct GVLineIndex;
+
+/*
+    starts indexing 'size' bytes of 'fd' (which is dup'ed) in a thread
+*/
+GVLineIndex *gv_line_index_new(int fd, offset_type size, gboolean crlf);
+
+/*
+    stops the thread if it still runs
+*/
+void gv_line_index_free(GVLineIndex *idx);
+
+gboolean gv_line_index_is_complete(GVLineIndex *idx);
+
+/*
+    returns the number of lines, once the index is complete
+*/
+guint64 gv_line_index_get_line_count(GVLineIndex *idx);
+
+/*
+    returns FALSE if 'offset' isn't indexed yet
+*/
+gboolean gv_line_index_get_line(GVLineIndex *idx, offset_type offset, guint64 *line);
+
+/*
+    returns FALSE if 'line' isn't indexed yet,
+    lines beyond the end of a complete index give the start of the last one
+*/
+gboolean gv_line_index_get_offset(GVLineIndex *idx, guint64 line, offset_type *offset);
@@ -36,6 +36,9 @@
 using namespace std;
 
 
+#define DENSITY_STRIP_WIDTH     6
+
+
 static GtkTableClass *parent_class = NULL;
 
 // Class Private Data
@@ -44,6 +47,10 @@ struct ScrollBoxPrivate
     GtkWidget *hscroll;
     GtkWidget *vscroll;
     GtkWidget *client;
+
+    GtkWidget *density;     // the strip beside the vertical scrollbar
+    guint *bins;
+    guint n_bins;
 };
 
 // Gtk class related static functions
@@ -52,6 +59,7 @@ static void scroll_box_class_init (ScrollBoxClass *klass);
 
 static void scroll_box_destroy (GtkObject *widget);
 static gboolean scroll_box_button_press(GtkWidget *widget, GdkEventButton *event, gpointer data);
+static gboolean scroll_box_density_expose(GtkWidget *widget, GdkEventExpose *event, ScrollBox *w);
 
 /*****************************************
     public functions
@@ -103,7 +111,7 @@ static void scroll_box_init (ScrollBox *w)
 {
     w->priv = g_new0 (ScrollBoxPrivate, 1);
 
-    gtk_table_resize (GTK_TABLE (w), 2, 2);
+    gtk_table_resize (GTK_TABLE (w), 3, 2);
     gtk_table_set_homogeneous (GTK_TABLE (w), FALSE);
 
     w->priv->vscroll = gtk_vscrollbar_new (NULL);
@@ -119,6 +127,15 @@ static void scroll_box_init (ScrollBox *w)
             (GtkAttachOptions) (GTK_FILL), 0, 0);
     w->priv->client = NULL;
 
+    // shown once there are densities to show
+    w->priv->density = gtk_drawing_area_new ();
+    gtk_widget_set_size_request (w->priv->density, DENSITY_STRIP_WIDTH, -1);
+    gtk_widget_set_no_show_all (w->priv->density, TRUE);
+    gtk_table_attach (GTK_TABLE (w), w->priv->density, 2, 3, 0, 1,
+        (GtkAttachOptions) (GTK_FILL),
+        (GtkAttachOptions) (GTK_FILL), 0, 0);
+    g_signal_connect (w->priv->density, "expose-event", G_CALLBACK (scroll_box_density_expose), w);
+
     g_signal_connect (w, "button-press-event", G_CALLBACK (scroll_box_button_press), w);
     g_signal_connect (w, "destroy-event", G_CALLBACK (scroll_box_destroy), w);
 }
@@ -136,6 +153,8 @@ static void scroll_box_destroy (GtkObject *widget)
             g_object_unref (w->priv->client);
         w->priv->client=NULL;
 
+        g_free (w->priv->bins);
+
         g_free(w->priv);
         w->priv = NULL;
     }
@@ -223,3 +242,70 @@ GtkAdjustment *scroll_box_get_v_adjustment (ScrollBox *obj)
 
     return gtk_range_get_adjustment (GTK_RANGE (obj->priv->vscroll));
 }
+
+
+void scroll_box_set_density (ScrollBox *obj, const guint *bins, guint n_bins)
+{
+    g_return_if_fail (IS_SCROLL_BOX (obj));
+
+    g_free (obj->priv->bins);
+    obj->priv->bins = NULL;
+    obj->priv->n_bins = 0;
+
+    if (!bins || n_bins==0)
+    {
+        gtk_widget_hide (obj->priv->density);
+        return;
+    }
+
+    obj->priv->bins = (guint *) g_memdup (bins, n_bins * sizeof(guint));
+    obj->priv->n_bins = n_bins;
+
+    gtk_widget_show (obj->priv->density);
+    gtk_widget_queue_draw (obj->priv->density);
+}
+
+
+/*
+    Each row of the strip sums up the bins it covers, and is marked with a bar as long as its share
+    of the fullest row, so that a single match still shows.
+*/
+static gboolean scroll_box_density_expose(GtkWidget *widget, GdkEventExpose *event, ScrollBox *w)
+{
+    g_return_val_if_fail (IS_SCROLL_BOX (w), FALSE);
+
+    gint width = widget->allocation.width;
+    gint height = widget->allocation.height;
+    GtkStyle *style = gtk_widget_get_style (widget);
+
+    gdk_draw_rectangle (widget->window, style->bg_gc[GTK_STATE_NORMAL], TRUE, 0, 0, width, height);
+
+    if (!w->priv->bins || height<=0)
+        return TRUE;
+
+    guint n_bins = w->priv->n_bins;
+    guint *rows = g_new0 (guint, height);
+    guint max = 0;
+
+    for (gint y=0; y<height; ++y)
+    {
+        guint from = (guint64) y * n_bins / height;
+        guint to = MAX(from+1, (guint64) (y+1) * n_bins / height);
+
+        for (guint b=from; b<to; ++b)
+            rows[y] += w->priv->bins[b];
+
+        max = MAX(max, rows[y]);
+    }
+
+    for (gint y=0; y<height; ++y)
+        if (rows[y])
+        {
+            gint len = MAX(2, (gint) ((guint64) width * rows[y] / max));
+            gdk_draw_rectangle (widget->window, style->bg_gc[GTK_STATE_SELECTED], TRUE, width-len, y, len, 1);
+        }
+
+    g_free (rows);
+
+    return TRUE;
+}
@@ -52,3 +52,9 @@ GtkAdjustment *scroll_box_get_v_adjustment (ScrollBox *obj);
 void           scroll_box_set_v_adjustment (ScrollBox *obj, GtkAdjustment *adjustment);
 
 GtkRange      *scroll_box_get_v_range(ScrollBox *obj);
+
+/*
+    shows 'n_bins' counts, spread evenly over the height of a strip beside the vertical scrollbar,
+    NULL hides the strip
+*/
+void           scroll_box_set_density (ScrollBox *obj, const guint *bins, guint n_bins);
@@ -24,6 +24,10 @@
 
 #include <config.h>
 #include <string.h>
+
+#include <algorithm>
+#include <vector>
+
 #include "libgviewer.h"
 #include "bm_chartype.h"
 #include "bm_byte.h"
@@ -31,9 +35,17 @@
 using namespace std;
 
 
+#define SEARCH_CHARS        4096            // characters decoded at a time by the text search
+#define SEARCH_HEX_BLOCK    (256 << 10)     // bytes read at a time by the hex search
+#define SEARCH_RANGE_CHUNK  (4 << 20)       // bytes of the file searched by one thread at a time
+#define SEARCH_THREADS_MAX  8
+#define SEARCH_HITS_MAX     (4 << 20)       // matches "find all" keeps at most
+
+
 static void g_viewer_searcher_class_init(GViewerSearcherClass *klass);
 static void g_viewer_searcher_init(GViewerSearcher *sp);
 static void g_viewer_searcher_finalize(GObject *object);
+static void close_own_input(GVInputModesData *imd, ViewerFileOps *fops);
 
 enum SearchMode
 {
@@ -51,6 +63,7 @@ struct GViewerSearcherPrivate
     GThread *search_thread;
 
     GVInputModesData *imd;
+    ViewerFileOps *fops;            // the search's own view of the file, if it has one
     offset_type start_offset;
     offset_type max_offset;
     guint update_interval;
@@ -66,6 +79,14 @@ struct GViewerSearcherPrivate
     GViewerBMByteData *b_reverse_data;
 
     enum SearchMode searchmode;
+
+    // "find all", in a thread of its own
+    GThread *find_all_thread;
+    gint find_all_state;            // atomic, a FINDALLSTATE
+    gint find_all_abort;
+    gint find_all_progress;
+    gint n_hits;                    // atomic, the matches found so far
+    vector<offset_type> *hits;      // all of them, sorted, once the state is FIND_ALL_DONE
 };
 
 typedef struct _GViewerSearcherSignal GViewerSearcherSignal;
@@ -144,6 +165,14 @@ static void g_viewer_searcher_finalize(GObject *object)
     // Free private members, etc.
     if (cobj->priv)
     {
+        if (cobj->priv->find_all_thread!=NULL)
+        {
+            g_atomic_int_set (&cobj->priv->find_all_abort, TRUE);
+            g_thread_join (cobj->priv->find_all_thread);
+            cobj->priv->find_all_thread = NULL;
+        }
+        delete cobj->priv->hits;
+        cobj->priv->hits = NULL;
         if (cobj->priv->ct_data!=NULL)
         {
             free_bm_chartype_data(cobj->priv->ct_data);
@@ -164,6 +193,11 @@ static void g_viewer_searcher_finalize(GObject *object)
             free_bm_byte_data(cobj->priv->b_reverse_data);
             cobj->priv->b_reverse_data = NULL;
         }
+        if (cobj->priv->fops!=NULL)
+        {
+            close_own_input(cobj->priv->imd, cobj->priv->fops);
+            cobj->priv->fops = NULL;
+        }
         g_free (cobj->priv);
         cobj->priv = NULL;
     }
@@ -225,8 +259,59 @@ offset_type g_viewer_searcher_get_search_result(GViewerSearcher *src)
 }
 
 
+/*
+    The file ops keep only a few windows of the file mapped, and the viewer keeps using its own
+    while the search runs, so each search thread reads the file through a copy of them.
+    Growing views have no descriptor to share, NULL is returned for them.
+*/
+static GVInputModesData *open_own_input(ViewerFileOps *fops, const gchar *input_mode, ViewerFileOps **own_fops)
+{
+    int fd = fops ? gv_file_get_fd(fops) : -1;
+
+    if (fd==-1)
+        return NULL;
+
+    ViewerFileOps *ops = gv_fileops_new();
+
+    if (gv_file_open_fd(ops, fd)==-1)
+    {
+        g_free (ops);
+        return NULL;
+    }
+
+    GVInputModesData *imd = gv_input_modes_new();
+    gv_init_input_modes(imd, (get_byte_proc)gv_file_get_byte, ops, (get_bytes_proc)gv_file_get_bytes);
+    gv_set_input_mode(imd, input_mode);
+
+    *own_fops = ops;
+
+    return imd;
+}
+
+
+static void close_own_input(GVInputModesData *imd, ViewerFileOps *fops)
+{
+    gv_free_input_modes(imd);
+    g_free (imd);
+    gv_file_free(fops);
+    g_free (fops);
+}
+
+
+/*
+    Growing views are searched through the viewer's input mode
+*/
+static void setup_input(GViewerSearcher *srchr, GVInputModesData *imd, ViewerFileOps *fops)
+{
+    GVInputModesData *own_imd = open_own_input(fops, gv_get_input_mode(imd), &srchr->priv->fops);
+
+    srchr->priv->imd = own_imd ? own_imd : imd;
+}
+
+
 void g_viewer_searcher_setup_new_text_search(GViewerSearcher *srchr,
                                              GVInputModesData *imd,
+                                             ViewerFileOps *fops,
                                              offset_type start_offset,
                                              offset_type max_offset,
                                              const gchar *text,
@@ -244,7 +329,7 @@ void g_viewer_searcher_setup_new_text_search(GViewerSearcher *srchr,
     g_return_if_fail (strlen(text)>0);
 
     srchr->priv->progress_value = 0;
-    srchr->priv->imd = imd;
+    setup_input(srchr, imd, fops);
     srchr->priv->start_offset = start_offset;
     srchr->priv->max_offset = max_offset;
 
@@ -264,6 +349,7 @@ void g_viewer_searcher_setup_new_text_search(GViewerSearcher *srchr,
 
 void g_viewer_searcher_setup_new_hex_search(GViewerSearcher *srchr,
                                             GVInputModesData *imd,
+                                            ViewerFileOps *fops,
                                             offset_type start_offset,
                                             offset_type max_offset,
                                             const guint8 *buffer, guint buflen)
@@ -280,7 +366,7 @@ void g_viewer_searcher_setup_new_hex_search(GViewerSearcher *srchr,
     g_return_if_fail (buflen>0);
 
     srchr->priv->progress_value = 0;
-    srchr->priv->imd = imd;
+    setup_input(srchr, imd, fops);
     srchr->priv->start_offset = start_offset;
     srchr->priv->max_offset = max_offset;
 
@@ -318,53 +404,303 @@ static gboolean check_abort_request (GViewerSearcher *src)
 }
 
 
-static gboolean search_hex_forward (GViewerSearcher *src)
+/*
+    A forward search splits the rest of the file into chunks, which a few threads take in turn and
+    search each through its own copy of the input. The match in the earliest chunk wins, so a chunk
+    after one with a match is skipped, or given up on.
+    "Find all" splits the whole file the same way, and keeps the matches of every chunk.
+*/
+struct SearchRange
 {
-    offset_type m, n, j;
-    int i;
-    gboolean found = FALSE;
-    guint8 value;
-    GViewerBMByteData *data = src->priv->b_data;
+    GViewerSearcher *src;
+    offset_type begin;          // matches starting in [begin, end) are looked for
+    offset_type end;
+    gint n_chunks;
+    gint next_chunk;            // atomic, the chunk to take next
+    gint found_chunk;           // atomic, the earliest chunk a match was found in, or n_chunks
+    gint *abort;
+    gint *progress;
+
+    vector<offset_type> *hits;  // "find all" keeps every match of each chunk, NULL otherwise
+
+    GMutex lock;                // for everything below
+    offset_type scanned;        // the bytes looked at by all the threads
+    offset_type result;
+    offset_type next_offset;    // where "find next" continues from 'result'
+};
 
-    m = data->pattern_len;
-    n = src->priv->max_offset;
-    j = src->priv->start_offset;
-    int update_counter = src->priv->update_interval;
 
-    while (j <= n - m)
+inline gboolean chunk_is_needed (SearchRange *r, gint chunk)
+{
+    return !g_atomic_int_get (r->abort) && chunk<g_atomic_int_get (&r->found_chunk);
+}
+
+
+static void add_scanned (SearchRange *r, offset_type bytes)
+{
+    g_mutex_lock (&r->lock);
+    r->scanned += bytes;
+    g_atomic_int_set (r->progress, (gint) ((r->begin + r->scanned) * 1000.0 / r->src->priv->max_offset));
+    g_mutex_unlock (&r->lock);
+}
+
+
+static void set_found (SearchRange *r, gint chunk, offset_type result, offset_type next_offset)
+{
+    g_mutex_lock (&r->lock);
+    if (chunk<r->found_chunk)
     {
-        for (i = m - 1; i >= 0; --i)
+        r->result = result;
+        r->next_offset = next_offset;
+        g_atomic_int_set (&r->found_chunk, chunk);
+    }
+    g_mutex_unlock (&r->lock);
+}
+
+
+/*
+    returns FALSE once "find all" has found more matches than it keeps
+*/
+static gboolean add_hit (SearchRange *r, gint chunk, offset_type offset)
+{
+    r->hits[chunk].push_back(offset);
+
+    if (g_atomic_int_add (&r->src->priv->n_hits, 1)<SEARCH_HITS_MAX)
+        return TRUE;
+
+    g_atomic_int_set (r->abort, TRUE);
+
+    return FALSE;
+}
+
+
+/*
+    The bytes are read a block at a time, with the rest of a match starting at the end of the block
+*/
+static gboolean search_hex_chunk (SearchRange *r, GVInputModesData *imd, gint chunk, guint8 *buffer)
+{
+    GViewerBMByteData *data = r->src->priv->b_data;
+    int m = data->pattern_len;
+    offset_type from = r->begin + (offset_type) chunk * SEARCH_RANGE_CHUNK;
+    offset_type to = MIN(from + SEARCH_RANGE_CHUNK, r->end);
+
+    for (offset_type block=from; block<to; block+=SEARCH_HEX_BLOCK)
+    {
+        if (!chunk_is_needed(r, chunk))
+            return FALSE;
+
+        int len = MIN((offset_type) SEARCH_HEX_BLOCK, to-block);
+        int n = gv_input_mode_get_raw_bytes(imd, block, buffer, len+m-1);
+
+        for (int j=0; j<len && j+m<=n; )
         {
-            value = (guint8) gv_input_mode_get_raw_byte(src->priv->imd, i+j);
-            if (data->pattern[i] != value)
-                break;
+            int i;
+            guint8 value = 0;
+
+            for (i = m - 1; i >= 0; --i)
+            {
+                value = buffer[j+i];
+                if (data->pattern[i] != value)
+                    break;
+            }
+
+            if (i < 0)
+            {
+                if (!r->hits)
+                {
+                    set_found(r, chunk, block+j, block+j+1);
+                    return TRUE;
+                }
+
+                if (!add_hit(r, chunk, block+j))
+                    return FALSE;
+
+                j++;
+                continue;
+            }
+
+            j += MAX(data->good[i], data->bad[value] - m + 1 + i);
         }
 
-        if (i < 0)
+        add_scanned(r, len);
+    }
+
+    return FALSE;
+}
+
+
+/*
+    The characters are decoded from a few bytes before the chunk, so that they start where they would
+    if decoded from the start of the search: whether a character starts at a byte depends only on the
+    3 bytes before it, in every input mode.
+*/
+static gboolean search_text_chunk (SearchRange *r, GVInputModesData *imd, gint chunk, char_type *chars, offset_type *offsets)
+{
+    GViewerBMChartypeData *data = r->src->priv->ct_data;
+    int m = data->pattern_len;
+    offset_type from = r->begin + (offset_type) chunk * SEARCH_RANGE_CHUNK;
+    offset_type to = MIN(from + SEARCH_RANGE_CHUNK, r->end);
+    offset_type reported = from;
+    gboolean eof = FALSE;
+    int count = 0;
+    int i, j = 0;
+
+    offsets[0] = chunk==0 ? from : from - 3;
+
+    while (TRUE)
+    {
+        // Keep the whole pattern's length decoded, the advancement is never more than that
+        while (j+m>count && !eof)
         {
-            src->priv->search_result = j;
-            j ++;
-            found = TRUE;
-            break;
+            if (offsets[j]>reported)
+            {
+                add_scanned(r, MIN(offsets[j], to) - reported);
+                reported = MIN(offsets[j], to);
+            }
+
+            if (!chunk_is_needed(r, chunk))
+                return FALSE;
+
+            memmove (chars, chars+j, (count-j)*sizeof(char_type));
+            memmove (offsets, offsets+j, (count-j+1)*sizeof(offset_type));
+            count -= j;
+            j = 0;
+
+            int decoded = gv_input_mode_get_utf8_chars(imd, offsets[count], chars+count, offsets+count, SEARCH_CHARS);
+            eof = decoded<SEARCH_CHARS;
+            count += decoded;
         }
 
-        j += MAX((offset_type)data->good[i], data->bad[value] - m + 1 + i);
+        if (j+m>count || offsets[j]>=to)
+            break;
 
-        if (--update_counter==0)
+        for (i = m - 1; i >= 0; --i)
+            if (!bm_chartype_equal(data, i, chars[j+i]))
+                break;
+
+        // Found a match, unless it starts in the chunk before
+        if (i < 0)
         {
-            update_progress_indicator(src, j);
-            update_counter = src->priv->update_interval;
+            if (offsets[j]>=from)
+            {
+                if (!r->hits)
+                {
+                    set_found(r, chunk, offsets[j], offsets[j+1]);
+                    return TRUE;
+                }
+
+                if (!add_hit(r, chunk, offsets[j]))
+                    return FALSE;
+            }
+
+            j++;
+            continue;
         }
 
-        if (check_abort_request(src))
+        // didn't find a match, calculate new index
+        j += bm_chartype_get_advancement(data, i, chars[j+i]);
+    }
+
+    add_scanned(r, to - reported);
+
+    return FALSE;
+}
+
+
+static void search_range (SearchRange *r, GVInputModesData *imd)
+{
+    int m = r->src->priv->searchmode==TEXT ? r->src->priv->ct_data->pattern_len : r->src->priv->b_data->pattern_len;
+    char_type *chars = NULL;
+    offset_type *offsets = NULL;
+    guint8 *buffer = NULL;
+
+    if (r->src->priv->searchmode==TEXT)
+    {
+        chars = g_new (char_type, SEARCH_CHARS+m);
+        offsets = g_new (offset_type, SEARCH_CHARS+m+1);
+    }
+    else
+        buffer = g_new (guint8, SEARCH_HEX_BLOCK+m);
+
+    while (TRUE)
+    {
+        gint chunk = g_atomic_int_add (&r->next_chunk, 1);
+
+        if (chunk>=r->n_chunks || !chunk_is_needed(r, chunk))
             break;
+
+        if (r->src->priv->searchmode==TEXT)
+            search_text_chunk(r, imd, chunk, chars, offsets);
+        else
+            search_hex_chunk(r, imd, chunk, buffer);
     }
 
+    g_free (chars);
+    g_free (offsets);
+    g_free (buffer);
+}
+
+
+static gpointer search_range_thread (SearchRange *r)
+{
+    ViewerFileOps *fops;
+    GVInputModesData *imd = open_own_input(r->src->priv->fops, gv_get_input_mode(r->src->priv->imd), &fops);
+
+    // the other threads search the chunks this one can't
+    if (!imd)
+        return NULL;
+
+    search_range(r, imd);
+    close_own_input(imd, fops);
+
+    return NULL;
+}
+
+
+static gboolean search_forward (GViewerSearcher *src)
+{
+    SearchRange r;
+    offset_type m = src->priv->searchmode==TEXT ? src->priv->ct_data->pattern_len : src->priv->b_data->pattern_len;
+    offset_type n = src->priv->max_offset;
+
+    if (n<m || src->priv->start_offset>n-m)
+        return FALSE;
+
+    r.src = src;
+    r.begin = src->priv->start_offset;
+    r.end = n-m+1;
+    r.n_chunks = (r.end - r.begin + SEARCH_RANGE_CHUNK - 1) / SEARCH_RANGE_CHUNK;
+    r.next_chunk = 0;
+    r.found_chunk = r.n_chunks;
+    r.abort = &src->priv->abort_indicator;
+    r.progress = &src->priv->progress_value;
+    r.hits = NULL;
+    r.scanned = 0;
+    g_mutex_init (&r.lock);
+
+    // Growing views are searched by this thread alone, through the viewer's input mode
+    int n_threads = src->priv->fops ? MIN(MIN((gint) g_get_num_processors (), SEARCH_THREADS_MAX), r.n_chunks) : 1;
+    GThread *threads[SEARCH_THREADS_MAX];
+
+    for (int i=1; i<n_threads; ++i)
+        threads[i] = g_thread_new (NULL, (GThreadFunc) search_range_thread, &r);
+
+    search_range(&r, src->priv->imd);
+
+    for (int i=1; i<n_threads; ++i)
+        g_thread_join (threads[i]);
+
+    g_mutex_clear (&r.lock);
+
+    if (r.found_chunk==r.n_chunks)
+        return FALSE;
+
+    src->priv->search_result = r.result;
+
     // Store the current offset, we'll use it if the user chooses "find next"
-    if (found)
-        src->priv->start_offset = j;
+    src->priv->start_offset = r.next_offset;
 
-    return found;
+    return TRUE;
 }
 
 
@@ -421,70 +757,6 @@ static gboolean search_hex_backward (GViewerSearcher *src)
 }
 
 
-static gboolean search_text_forward (GViewerSearcher *src)
-{
-    offset_type m, n, j;
-    int i;
-    gboolean found = FALSE;
-    char_type value;
-    GViewerBMChartypeData *data = src->priv->ct_data;
-
-    m = data->pattern_len;
-    n = src->priv->max_offset;
-    j = src->priv->start_offset;
-    int update_counter = src->priv->update_interval;
-
-    while (j <= n - m)
-    {
-        offset_type t, delta;
-
-        delta = m - 1;
-        t = j;
-        while (delta--)
-            t = gv_input_get_next_char_offset(src->priv->imd, t);
-        for (i = m - 1; i >= 0; --i)
-        {
-            value = gv_input_mode_get_utf8_char(src->priv->imd, t);
-            t = gv_input_get_previous_char_offset(src->priv->imd, t);
-            if (!bm_chartype_equal(data, i, value))
-                break;
-        }
-
-        // Found a match
-        if (i < 0)
-        {
-            src->priv->search_result = j;
-
-            // Advance the current offset, from which "find next" will begin
-            j = gv_input_get_next_char_offset(src->priv->imd, j);
-
-            found = TRUE;
-            break;
-        }
-
-        // didn't find a match, calculate new index
-        delta = bm_chartype_get_advancement(data, i, value);
-        while (delta--)
-            j = gv_input_get_next_char_offset(src->priv->imd, j);
-
-        if (--update_counter==0)
-        {
-            update_progress_indicator(src, j);
-            update_counter = src->priv->update_interval;
-        }
-
-        if (check_abort_request(src))
-            break;
-    }
-
-    // Store the current offset, we'll use it if the user chooses "find next"
-    if (found)
-        src->priv->start_offset = j;
-
-    return found;
-}
-
-
 static gboolean search_text_backward (GViewerSearcher *src)
 {
     offset_type m, j;
@@ -562,10 +834,10 @@ static gpointer search_func (gpointer user_data)
 
     gboolean found;
     
-    if (src->priv->searchmode==TEXT)
-        found = (src->priv->search_forward) ? search_text_forward(src) : search_text_backward(src);
+    if (src->priv->search_forward)
+        found = search_forward(src);
     else
-        found = (src->priv->search_forward) ? search_hex_forward(src) : search_hex_backward(src);
+        found = (src->priv->searchmode==TEXT) ? search_text_backward(src) : search_hex_backward(src);
 
     src->priv->search_reached_end = !found;
 
@@ -603,3 +875,210 @@ void g_viewer_searcher_start_search(GViewerSearcher *src, gboolean forward)
     src->priv->search_thread = g_thread_new (NULL, search_func, (gpointer) src);
     g_return_if_fail (src->priv->search_thread!=NULL);
 }
+
+
+static gpointer find_all_func (GViewerSearcher *src)
+{
+    SearchRange r;
+    offset_type m = src->priv->searchmode==TEXT ? src->priv->ct_data->pattern_len : src->priv->b_data->pattern_len;
+    offset_type n = src->priv->max_offset;
+    vector<offset_type> *hits = new vector<offset_type>;
+    gint state = FIND_ALL_DONE;
+
+    if (n>=m)
+    {
+        r.src = src;
+        r.begin = 0;
+        r.end = n-m+1;
+        r.n_chunks = (r.end + SEARCH_RANGE_CHUNK - 1) / SEARCH_RANGE_CHUNK;
+        r.next_chunk = 0;
+        r.found_chunk = r.n_chunks;
+        r.abort = &src->priv->find_all_abort;
+        r.progress = &src->priv->find_all_progress;
+        r.hits = new vector<offset_type>[r.n_chunks];
+        r.scanned = 0;
+        g_mutex_init (&r.lock);
+
+        int n_threads = MIN(MIN((gint) g_get_num_processors (), SEARCH_THREADS_MAX), r.n_chunks);
+        GThread *threads[SEARCH_THREADS_MAX];
+
+        for (int i=1; i<n_threads; ++i)
+            threads[i] = g_thread_new (NULL, (GThreadFunc) search_range_thread, &r);
+
+        // this thread reads through an input of its own as well, "find next" keeps the searcher's
+        search_range_thread(&r);
+
+        for (int i=1; i<n_threads; ++i)
+            g_thread_join (threads[i]);
+
+        g_mutex_clear (&r.lock);
+
+        if (g_atomic_int_get (&src->priv->n_hits)>SEARCH_HITS_MAX)
+            state = FIND_ALL_TOO_MANY;
+        else
+            if (r.scanned<r.end)
+                state = FIND_ALL_ABORTED;
+            else
+            {
+                gsize count = 0;
+
+                for (gint i=0; i<r.n_chunks; ++i)
+                    count += r.hits[i].size();
+
+                hits->reserve(count);
+
+                // the chunks follow each other, and so do their matches
+                for (gint i=0; i<r.n_chunks; ++i)
+                    hits->insert(hits->end(), r.hits[i].begin(), r.hits[i].end());
+            }
+
+        delete [] r.hits;
+    }
+
+    if (state==FIND_ALL_DONE)
+        src->priv->hits = hits;
+    else
+        delete hits;
+
+    g_atomic_int_set (&src->priv->find_all_progress, 1000);
+    g_atomic_int_set (&src->priv->find_all_state, state);
+
+    return NULL;
+}
+
+
+gboolean g_viewer_searcher_start_find_all(GViewerSearcher *src)
+{
+    g_return_val_if_fail (src!=NULL, FALSE);
+    g_return_val_if_fail (src->priv!=NULL, FALSE);
+    g_return_val_if_fail (src->priv->find_all_thread==NULL, FALSE);
+
+    // Growing views can't be read by more than one thread
+    if (!src->priv->fops)
+        return FALSE;
+
+    src->priv->find_all_state = FIND_ALL_RUNNING;
+    src->priv->find_all_abort = 0;
+    src->priv->find_all_progress = 0;
+    src->priv->n_hits = 0;
+
+    src->priv->find_all_thread = g_thread_new (NULL, (GThreadFunc) find_all_func, src);
+
+    return TRUE;
+}
+
+
+FINDALLSTATE g_viewer_searcher_get_find_all_state(GViewerSearcher *src)
+{
+    g_return_val_if_fail (src!=NULL, FIND_ALL_NONE);
+    g_return_val_if_fail (src->priv!=NULL, FIND_ALL_NONE);
+
+    return (FINDALLSTATE) g_atomic_int_get (&src->priv->find_all_state);
+}
+
+
+gint g_viewer_searcher_get_find_all_progress(GViewerSearcher *src)
+{
+    g_return_val_if_fail (src!=NULL, 0);
+    g_return_val_if_fail (src->priv!=NULL, 0);
+
+    return g_atomic_int_get (&src->priv->find_all_progress);
+}
+
+
+gint g_viewer_searcher_get_hit_count(GViewerSearcher *src)
+{
+    g_return_val_if_fail (src!=NULL, 0);
+    g_return_val_if_fail (src->priv!=NULL, 0);
+
+    return MIN(g_atomic_int_get (&src->priv->n_hits), SEARCH_HITS_MAX);
+}
+
+
+/*
+    the offset of the last character (or byte) of the match at 'hit'
+*/
+static offset_type hit_last_offset(GViewerSearcher *src, offset_type hit)
+{
+    if (src->priv->searchmode==HEX)
+        return hit + src->priv->b_data->pattern_len - 1;
+
+    for (int i=1; i<src->priv->ct_data->pattern_len; ++i)
+        hit = gv_input_get_next_char_offset(src->priv->imd, hit);
+
+    return hit;
+}
+
+
+gboolean g_viewer_searcher_find_indexed(GViewerSearcher *src, gboolean forward)
+{
+    g_return_val_if_fail (src!=NULL, FALSE);
+    g_return_val_if_fail (src->priv!=NULL, FALSE);
+    g_return_val_if_fail (src->priv->search_thread==NULL, FALSE);
+
+    if (g_viewer_searcher_get_find_all_state(src)!=FIND_ALL_DONE)
+        return FALSE;
+
+    vector<offset_type> &hits = *src->priv->hits;
+    gboolean found = FALSE;
+
+    if (forward)
+    {
+        vector<offset_type>::iterator i = lower_bound (hits.begin(), hits.end(), src->priv->start_offset);
+
+        if (i!=hits.end())
+        {
+            src->priv->search_result = *i;
+            src->priv->start_offset = src->priv->searchmode==TEXT ? gv_input_get_next_char_offset(src->priv->imd, *i) : *i+1;
+            found = TRUE;
+        }
+    }
+    else
+    {
+        // The match ending last by the start offset, like the backward search finds it:
+        // only the few matches starting less than a match's length before the start offset end after it
+        vector<offset_type>::iterator i = upper_bound (hits.begin(), hits.end(), src->priv->start_offset);
+
+        while (i!=hits.begin() && !found)
+        {
+            offset_type last = hit_last_offset(src, *--i);
+            offset_type end = src->priv->searchmode==TEXT ? gv_input_get_next_char_offset(src->priv->imd, last) : last+1;
+
+            if (end<=src->priv->start_offset)
+            {
+                src->priv->search_result = src->priv->searchmode==TEXT ? end : last;
+                src->priv->start_offset = last;
+                found = TRUE;
+            }
+        }
+    }
+
+    src->priv->search_reached_end = !found;
+
+    return TRUE;
+}
+
+
+void g_viewer_searcher_get_hit_density(GViewerSearcher *src, guint *bins, guint n_bins)
+{
+    g_return_if_fail (src!=NULL);
+    g_return_if_fail (src->priv!=NULL);
+    g_return_if_fail (bins!=NULL);
+
+    memset (bins, 0, n_bins*sizeof(guint));
+
+    if (g_viewer_searcher_get_find_all_state(src)!=FIND_ALL_DONE)
+        return;
+
+    vector<offset_type> &hits = *src->priv->hits;
+    vector<offset_type>::iterator from = hits.begin();
+
+    for (guint b=0; b<n_bins; ++b)
+    {
+        vector<offset_type>::iterator to = b+1==n_bins ? hits.end() :
+                                           lower_bound (from, hits.end(), (offset_type) ((b+1) * (gdouble) src->priv->max_offset / n_bins));
+
+        bins[b] = to - from;
+        from = to;
+    }
+}
@@ -36,6 +36,15 @@
 
 struct GViewerSearcherPrivate;
 
+enum FINDALLSTATE
+{
+    FIND_ALL_NONE,
+    FIND_ALL_RUNNING,
+    FIND_ALL_DONE,          // every match is indexed
+    FIND_ALL_TOO_MANY,      // more matches than are kept
+    FIND_ALL_ABORTED
+};
+
 struct GViewerSearcher
 {
     GObject parent;
@@ -54,6 +63,7 @@ GViewerSearcher *g_viewer_searcher_new();
 
 void g_viewer_searcher_setup_new_text_search(GViewerSearcher *srchr,
                  GVInputModesData *imd,
+                 ViewerFileOps *fops,
                  offset_type start_offset,
                  offset_type max_offset,
                  const gchar *text,
@@ -61,6 +71,7 @@ void g_viewer_searcher_setup_new_text_search(GViewerSearcher *srchr,
 
 void g_viewer_searcher_setup_new_hex_search(GViewerSearcher *srchr,
                  GVInputModesData *imd,
+                 ViewerFileOps *fops,
                  offset_type start_offset,
                  offset_type max_offset,
                  const guint8 *buffer, guint buflen);
@@ -121,3 +132,39 @@ gint * g_viewer_searcher_get_abort_indicator(GViewerSearcher *src);
    (read glib's "atomic operations").
    */
 gint * g_viewer_searcher_get_complete_indicator(GViewerSearcher *src);
+
+
+/*
+    "Find all" looks for every match of the pattern in the whole file, in a thread of its own,
+    which keeps running alongside the searches. Once it is done, the matches are kept in a sorted
+    array, and "g_viewer_searcher_find_indexed" finds the next or previous one in it.
+
+    Returns FALSE for growing views, which can't be read by more than one thread.
+    The thread is stopped when the searcher is unref'ed.
+*/
+gboolean g_viewer_searcher_start_find_all(GViewerSearcher *src);
+
+FINDALLSTATE g_viewer_searcher_get_find_all_state(GViewerSearcher *src);
+
+/*
+    in 0.1% increments, as the progress indicator
+*/
+gint g_viewer_searcher_get_find_all_progress(GViewerSearcher *src);
+
+/*
+    returns the number of matches found so far
+*/
+gint g_viewer_searcher_get_hit_count(GViewerSearcher *src);
+
+/*
+    does what "g_viewer_searcher_start_search" and "g_viewer_searcher_join" do,
+    by a lookup of the matches "find all" found.
+    Returns FALSE, and does nothing, unless "find all" is FIND_ALL_DONE.
+*/
+gboolean g_viewer_searcher_find_indexed(GViewerSearcher *src, gboolean forward);
+
+/*
+    counts the matches in each of 'n_bins' equal parts of the file,
+    all the counts are 0 unless "find all" is FIND_ALL_DONE
+*/
+void g_viewer_searcher_get_hit_density(GViewerSearcher *src, guint *bins, guint n_bins);
@@ -36,6 +36,7 @@
 #include "gvtypes.h"
 #include "fileops.h"
 #include "inputmodes.h"
+#include "line-index.h"
 #include "datapresentation.h"
 #include "text-render.h"
 
@@ -46,6 +47,8 @@ using namespace std;
 #define TEXT_RENDER_DEFAULT_HEIGHT      200
 
 #define HEXDUMP_FIXED_LIMIT              16
+#define LINE_INDEX_POLL_MSEC            100
+#define DISPLAY_CHUNK                   256     // characters of a line decoded at a time
 #define MAX_CLIPBOARD_COPY_LENGTH  0xFFFFFF
 
 #define NEED_PANGO_ESCAPING(x) ((x)=='<' || (x)=='>' || (x)=='&')
@@ -83,14 +86,19 @@ struct TextRender::Private
 
     GtkAdjustment *v_adjustment;
     // Old values from v_adjustment stored so we know when something changes
-    gfloat old_v_adj_value;
-    gfloat old_v_adj_lower;
-    gfloat old_v_adj_upper;
+    gdouble old_v_adj_value;
+    gdouble old_v_adj_lower;
+    gdouble old_v_adj_upper;
 
     ViewerFileOps *fops;
     GVInputModesData *im;
     GVDataPresentation *dp;
 
+    // The vertical adjustment counts lines instead of bytes once they are indexed
+    GVLineIndex *line_index;
+    gboolean line_index_crlf;
+    guint line_index_poll_id;
+
     gchar *encoding;
     int tab_size;
     int fixed_limit;
@@ -147,6 +155,9 @@ static void text_render_h_adjustment_update (TextRender *obj);
 static void text_render_h_adjustment_changed (GtkAdjustment *adjustment, gpointer data);
 static void text_render_h_adjustment_value_changed (GtkAdjustment *adjustment, gpointer data);
 static void text_render_v_adjustment_update (TextRender *obj);
+static void text_render_start_line_index (TextRender *w);
+static void text_render_stop_line_index (TextRender *w);
+static gdouble text_render_offset_to_v_value (TextRender *w, offset_type offset);
 static void text_render_v_adjustment_changed (GtkAdjustment *adjustment, gpointer data);
 static void text_render_v_adjustment_value_changed (GtkAdjustment *adjustment, gpointer data);
 static gboolean text_render_key_pressed(GtkWidget *widget, GdkEventKey *event, gpointer data);
@@ -356,7 +367,7 @@ static void text_render_position_changed(TextRender *w)
     // update the hotz & vert adjustments
     if (w->priv->v_adjustment)
     {
-        w->priv->v_adjustment->value = w->priv->current_offset;
+        w->priv->v_adjustment->value = text_render_offset_to_v_value (w, w->priv->current_offset);
         gtk_adjustment_changed (w->priv->v_adjustment);
     }
 
@@ -756,12 +767,45 @@ static void text_render_h_adjustment_value_changed (GtkAdjustment *adjustment, g
 }
 
 
+/*
+    The vertical adjustment counts lines in text mode, once all of them are indexed,
+    and bytes otherwise
+*/
+static gboolean text_render_scrolls_by_lines (TextRender *w)
+{
+    return w->priv->line_index && gv_line_index_is_complete (w->priv->line_index) &&
+           gv_get_data_presentation_mode (w->priv->dp)!=PRSNT_BIN_FIXED;
+}
+
+
+static gdouble text_render_offset_to_v_value (TextRender *w, offset_type offset)
+{
+    guint64 line;
+
+    if (text_render_scrolls_by_lines (w) && gv_line_index_get_line (w->priv->line_index, offset, &line))
+        return line;
+
+    return offset;
+}
+
+
+static offset_type text_render_v_value_to_offset (TextRender *w, gdouble value)
+{
+    offset_type offset;
+
+    if (text_render_scrolls_by_lines (w) && gv_line_index_get_offset (w->priv->line_index, (guint64) value, &offset))
+        return offset;
+
+    return (offset_type) value;
+}
+
+
 static void text_render_v_adjustment_update (TextRender *obj)
 {
     g_return_if_fail (obj != NULL);
     g_return_if_fail (IS_TEXT_RENDER (obj));
 
-    gfloat new_value = obj->priv->v_adjustment->value;
+    gdouble new_value = obj->priv->v_adjustment->value;
 
     if (new_value < obj->priv->v_adjustment->lower)
         new_value = obj->priv->v_adjustment->lower;
@@ -769,11 +813,15 @@ static void text_render_v_adjustment_update (TextRender *obj)
     if (new_value > obj->priv->v_adjustment->upper-1)
         new_value = obj->priv->v_adjustment->upper-1;
 
-    if ((offset_type)new_value==obj->priv->current_offset)
+    if (!obj->priv->dp)
         return;
 
-    if (obj->priv->dp)
-        new_value = gv_align_offset_to_line_start(obj->priv->dp, (offset_type) new_value);
+    if ((guint64) new_value==(guint64) text_render_offset_to_v_value (obj, obj->priv->current_offset))
+        return;
+
+    offset_type offset = gv_align_offset_to_line_start(obj->priv->dp, text_render_v_value_to_offset (obj, new_value));
+
+    new_value = text_render_offset_to_v_value (obj, offset);
 
     if (new_value != obj->priv->v_adjustment->value)
     {
@@ -781,7 +829,7 @@ static void text_render_v_adjustment_update (TextRender *obj)
         gtk_signal_emit_by_name (GTK_OBJECT (obj->priv->v_adjustment), "value-changed");
     }
 
-    obj->priv->current_offset = (offset_type)new_value;
+    obj->priv->current_offset = offset;
 
     text_render_redraw(obj);
 }
@@ -822,10 +870,59 @@ static void text_render_v_adjustment_value_changed (GtkAdjustment *adjustment, g
 }
 
 
+static gboolean text_render_line_index_poll (TextRender *w)
+{
+    if (!gv_line_index_is_complete (w->priv->line_index))
+        return TRUE;
+
+    w->priv->line_index_poll_id = 0;
+
+    text_render_update_adjustments_limits(w);
+    text_render_position_changed(w);
+
+    return FALSE;
+}
+
+
+static void text_render_start_line_index (TextRender *w)
+{
+    text_render_stop_line_index (w);
+
+    int fd = gv_file_get_fd (w->priv->fops);
+
+    if (fd==-1)
+        return;
+
+    // only the ASCII input modes take "\r\n" as a single end of line
+    w->priv->line_index_crlf = g_ascii_strcasecmp (gv_get_input_mode (w->priv->im), "UTF8")!=0;
+    w->priv->line_index = gv_line_index_new (fd, gv_file_get_max_offset (w->priv->fops), w->priv->line_index_crlf);
+    gv_set_line_index (w->priv->dp, w->priv->line_index);
+
+    w->priv->line_index_poll_id = g_timeout_add (LINE_INDEX_POLL_MSEC, (GSourceFunc) text_render_line_index_poll, w);
+}
+
+
+static void text_render_stop_line_index (TextRender *w)
+{
+    if (w->priv->line_index_poll_id)
+        g_source_remove (w->priv->line_index_poll_id);
+    w->priv->line_index_poll_id = 0;
+
+    if (w->priv->dp)
+        gv_set_line_index (w->priv->dp, NULL);
+
+    if (w->priv->line_index)
+        gv_line_index_free (w->priv->line_index);
+    w->priv->line_index = NULL;
+}
+
+
 static void text_render_free_data(TextRender *w)
 {
     g_return_if_fail (IS_TEXT_RENDER (w));
 
+    text_render_stop_line_index (w);
+
     if (w->priv->dp)
         gv_free_data_presentation(w->priv->dp);
     w->priv->dp = NULL;
@@ -853,7 +950,7 @@ static void text_render_internal_load(TextRender *w)
 
     // Setup the input mode translations
     w->priv->im = gv_input_modes_new();
-    gv_init_input_modes(w->priv->im, (get_byte_proc)gv_file_get_byte, w->priv->fops);
+    gv_init_input_modes(w->priv->im, (get_byte_proc)gv_file_get_byte, w->priv->fops, (get_bytes_proc)gv_file_get_bytes);
     gv_set_input_mode(w->priv->im, w->priv->encoding);
 
     // Setup the data presentation mode
@@ -865,6 +962,8 @@ static void text_render_internal_load(TextRender *w)
     gv_set_fixed_count(w->priv->dp, w->priv->fixed_limit);
     gv_set_tab_size(w->priv->dp, w->priv->tab_size);
 
+    text_render_start_line_index(w);
+
     text_render_set_display_mode (w, TextRender::DISPLAYMODE_TEXT);
 
     text_render_update_adjustments_limits(w);
@@ -915,7 +1014,10 @@ static void text_render_update_adjustments_limits(TextRender *w)
     if (w->priv->v_adjustment)
     {
         w->priv->v_adjustment->lower = 0;
-        w->priv->v_adjustment->upper = gv_file_get_max_offset(w->priv->fops)-1;
+        if (text_render_scrolls_by_lines(w))
+            w->priv->v_adjustment->upper = gv_line_index_get_line_count(w->priv->line_index);
+        else
+            w->priv->v_adjustment->upper = gv_file_get_max_offset(w->priv->fops)-1;
         gtk_adjustment_changed (w->priv->v_adjustment);
     }
 
@@ -1243,6 +1345,10 @@ void  text_render_set_display_mode (TextRender *w, TextRender::DISPLAYMODE mode)
     w->priv->dispmode = mode;
     w->priv->current_offset = gv_align_offset_to_line_start (w->priv->dp, w->priv->current_offset);
 
+    // the vertical adjustment counts bytes in the binary modes
+    text_render_update_adjustments_limits(w);
+    text_render_position_changed(w);
+
     text_render_redraw(w);
 }
 
@@ -1419,6 +1525,12 @@ void text_render_set_encoding(TextRender *w, const char *encoding)
     g_free (w->priv->encoding);
     w->priv->encoding = g_strdup (encoding);
     gv_set_input_mode(w->priv->im, encoding);
+    if (w->priv->line_index && w->priv->line_index_crlf!=(g_ascii_strcasecmp (gv_get_input_mode (w->priv->im), "UTF8")!=0))
+    {
+        text_render_start_line_index(w);
+        text_render_update_adjustments_limits(w);
+        text_render_position_changed(w);
+    }
     text_render_filter_undisplayable_chars(w);
     text_render_redraw(w);
 }
@@ -1613,6 +1725,8 @@ static int text_mode_display_line(TextRender *w, int y, int column, offset_type
 
     offset_type current;
     char_type value;
+    char_type chars[DISPLAY_CHUNK];
+    offset_type offsets[DISPLAY_CHUNK+1];
     int char_count = 0;
     offset_type marker_start;
     offset_type marker_end;
@@ -1639,34 +1753,41 @@ static int text_mode_display_line(TextRender *w, int y, int column, offset_type
     current = start_of_line;
     while (current < end_of_line)
     {
-        if (show_marker)
-            marker_shown = marker_helper(w, marker_shown, current, marker_start, marker_end);
-
-        // Read a UTF8 character from the input file. The "inputmode" module is responsible for converting the file into UTF8
-        value = gv_input_mode_get_utf8_char(w->priv->im, current);
-        if (value==INVALID_CHAR)
+        // Read UTF8 characters from the input file. The "inputmode" module is responsible for converting the file into UTF8
+        int count = gv_input_mode_get_utf8_chars(w->priv->im, current, chars, offsets, MIN(DISPLAY_CHUNK, end_of_line-current));
+        if (count==0)
             break;
 
-        // move to the next character's offset
-        current = gv_input_get_next_char_offset(w->priv->im, current);
-
-        if (value=='\r' || value=='\n')
-            continue;
+        int n;
 
-        if (value=='\t')
+        for (n=0; n<count && offsets[n]<end_of_line; n++)
         {
-            for (int i=0; i<w->priv->tab_size; i++)
-                text_render_utf8_print_char(w, ' ');
-            char_count += w->priv->tab_size;
-            continue;
-        }
+            if (show_marker)
+                marker_shown = marker_helper(w, marker_shown, offsets[n], marker_start, marker_end);
 
-        if (NEED_PANGO_ESCAPING(value))
-            text_render_utf8_printf (w, escape_pango_char(value));
-        else
-            text_render_utf8_print_char(w, value);
+            value = chars[n];
 
-        char_count++;
+            if (value=='\r' || value=='\n')
+                continue;
+
+            if (value=='\t')
+            {
+                for (int i=0; i<w->priv->tab_size; i++)
+                    text_render_utf8_print_char(w, ' ');
+                char_count += w->priv->tab_size;
+                continue;
+            }
+
+            if (NEED_PANGO_ESCAPING(value))
+                text_render_utf8_printf (w, escape_pango_char(value));
+            else
+                text_render_utf8_print_char(w, value);
+
+            char_count++;
+        }
+
+        // move to the next character's offset
+        current = offsets[n];
     }
 
     if (char_count > w->priv->max_column)
@@ -1691,6 +1812,8 @@ static int binary_mode_display_line(TextRender *w, int y, int column, offset_typ
 
     offset_type current;
     char_type value;
+    char_type chars[DISPLAY_CHUNK];
+    offset_type offsets[DISPLAY_CHUNK+1];
     offset_type marker_start;
     offset_type marker_end;
     gboolean show_marker;
@@ -1712,26 +1835,32 @@ static int binary_mode_display_line(TextRender *w, int y, int column, offset_typ
     current = start_of_line;
     while (current < end_of_line)
     {
-
-        if (show_marker)
-            marker_shown = marker_helper(w, marker_shown, current, marker_start, marker_end);
-
-        /* Read a UTF8 character from the input file.
+        /* Read UTF8 characters from the input file.
            The "inputmode" module is responsible for converting the file into UTF8 */
-        value = gv_input_mode_get_utf8_char(w->priv->im, current);
-        if (value==INVALID_CHAR)
+        int count = gv_input_mode_get_utf8_chars(w->priv->im, current, chars, offsets, MIN(DISPLAY_CHUNK, end_of_line-current));
+        if (count==0)
             break;
 
-        // move to the next character's offset
-        current = gv_input_get_next_char_offset(w->priv->im, current);
+        int n;
 
-        if (value=='\r' || value=='\n' || value=='\t')
-            value = gv_input_mode_byte_to_utf8(w->priv->im, (unsigned char)value);
+        for (n=0; n<count && offsets[n]<end_of_line; n++)
+        {
+            if (show_marker)
+                marker_shown = marker_helper(w, marker_shown, offsets[n], marker_start, marker_end);
 
-        if (NEED_PANGO_ESCAPING(value))
-            text_render_utf8_printf (w, escape_pango_char(value));
-        else
-            text_render_utf8_print_char(w, value);
+            value = chars[n];
+
+            if (value=='\r' || value=='\n' || value=='\t')
+                value = gv_input_mode_byte_to_utf8(w->priv->im, (unsigned char)value);
+
+            if (NEED_PANGO_ESCAPING(value))
+                text_render_utf8_printf (w, escape_pango_char(value));
+            else
+                text_render_utf8_print_char(w, value);
+        }
+
+        // move to the next character's offset
+        current = offsets[n];
     }
 
     if (show_marker)
@@ -1864,9 +1993,9 @@ static int hex_mode_display_line(TextRender *w, int y, int column, offset_type s
     text_render_utf8_clear_buf(w);
 
     if (w->priv->hex_offset_display)
-        text_render_utf8_printf (w, "%08lx  ", (unsigned long)start_of_line);
+        text_render_utf8_printf (w, "%08" G_GINT64_MODIFIER "x  ", start_of_line);
     else
-        text_render_utf8_printf (w, "%09lu ", (unsigned long)start_of_line);
+        text_render_utf8_printf (w, "%09" G_GUINT64_FORMAT " ", start_of_line);
 
     for (offset_type current=start_of_line; current<end_of_line; ++current)
     {
@@ -206,13 +206,20 @@ static void gviewer_text_status_update(TextRender *obj, TextRender::Status *stat
 
     static gchar temp[MAX_STATUS_LENGTH];
 
+    /* the offsets are formatted apart, G_GUINT64_FORMAT can't be in a translated string */
+    gchar *offset = g_strdup_printf ("%" G_GUINT64_FORMAT, (guint64) status->current_offset);
+    gchar *size = g_strdup_printf ("%" G_GUINT64_FORMAT, (guint64) status->size);
+
     g_snprintf(temp, sizeof (temp),
-               _("Position: %lu of %lu\tColumn: %d\t%s"),
-               (unsigned long) status->current_offset,
-               (unsigned long) status->size,
+               _("Position: %s of %s\tColumn: %d\t%s"),
+               offset,
+               size,
                status->column,
                status->wrap_mode?_("Wrap"):"");
 
+    g_free (offset);
+    g_free (size);
+
     gtk_signal_emit (GTK_OBJECT (viewer), gviewer_signals[STATUS_LINE_CHANGED], temp);
 }
 
@@ -621,6 +628,15 @@ TextRender *gviewer_get_text_render(GViewer *obj)
 }
 
 
+void gviewer_set_text_density(GViewer *obj, const guint *bins, guint n_bins)
+{
+    g_return_if_fail (IS_GVIEWER (obj));
+    g_return_if_fail (obj->priv->tscrollbox);
+
+    scroll_box_set_density (SCROLL_BOX (obj->priv->tscrollbox), bins, n_bins);
+}
+
+
 void gviewer_image_operation(GViewer *obj, ImageRender::DISPLAYMODE op)
 {
     g_return_if_fail (IS_GVIEWER (obj));
@@ -97,3 +97,9 @@ void        gviewer_image_operation(GViewer *obj, ImageRender::DISPLAYMODE op);
 void        gviewer_copy_selection(GtkMenuItem *item, GViewer *obj);
 
 TextRender  *gviewer_get_text_render(GViewer *obj);
+
+/*
+    marks the counts of 'n_bins' equal parts of the file (of search matches, say) beside the text's scrollbar,
+    NULL removes the marks
+*/
+void        gviewer_set_text_density(GViewer *obj, const guint *bins, guint n_bins);
@@ -54,6 +54,9 @@ using namespace std;
 
 #define NUMBER_OF_CHARSETS       22
 
+#define FIND_ALL_POLL_MSEC       200
+#define FIND_ALL_DENSITY_BINS    1024   // parts of the file the density of matches is shown for
+
 /***********************************
  * Functions for using GSettings
  ***********************************/
@@ -131,10 +134,12 @@ struct GViewerWindowPrivate
     gchar *filename;
     guint statusbar_ctx_id;
     gboolean status_bar_msg;
+    gchar *status_line;         // the viewer's, followed by the matches "find all" found
 
     GViewerSearcher *srchr;
     gchar *search_pattern;
     gint  search_pattern_len;
+    guint find_all_poll_id;
 };
 
 static void gviewer_window_init(GViewerWindow *w);
@@ -159,6 +164,7 @@ static void menu_edit_copy(GtkMenuItem *item, GViewerWindow *obj);
 static void menu_edit_find(GtkMenuItem *item, GViewerWindow *obj);
 static void menu_edit_find_next(GtkMenuItem *item, GViewerWindow *obj);
 static void menu_edit_find_prev(GtkMenuItem *item, GViewerWindow *obj);
+static void menu_edit_find_all(GtkMenuItem *item, GViewerWindow *obj);
 
 static void menu_view_wrap(GtkMenuItem *item, GViewerWindow *obj);
 static void menu_view_display_mode(GtkMenuItem *item, GViewerWindow *obj);
@@ -305,19 +311,63 @@ static void gviewer_window_init (GViewerWindow *w)
 }
 
 
-static void gviewer_window_status_line_changed(GViewer *obj, const gchar *status_line, GViewerWindow *wnd)
+/*
+    returns what "find all" found so far, or NULL
+*/
+static gchar *find_all_status(GViewerWindow *w)
 {
-    g_return_if_fail (IS_GVIEWER_WINDOW (wnd));
+    if (!w->priv->srchr)
+        return NULL;
 
-    GViewerWindow *w = GVIEWER_WINDOW (wnd);
+    gint n = g_viewer_searcher_get_hit_count(w->priv->srchr);
+
+    switch (g_viewer_searcher_get_find_all_state(w->priv->srchr))
+    {
+        case FIND_ALL_RUNNING:
+            return g_strdup_printf (ngettext("Finding all: %d match (%d%%)", "Finding all: %d matches (%d%%)", n),
+                                    n, g_viewer_searcher_get_find_all_progress(w->priv->srchr)/10);
+
+        case FIND_ALL_DONE:
+            return g_strdup_printf (ngettext("%d match of “%s”", "%d matches of “%s”", n), n, w->priv->search_pattern);
+
+        case FIND_ALL_TOO_MANY:
+            return g_strdup_printf (_("More than %d matches of “%s”"), n, w->priv->search_pattern);
+
+        default:
+            return NULL;
+    }
+}
+
+
+static void gviewer_window_update_status_bar(GViewerWindow *w)
+{
+    gchar *found = find_all_status(w);
+    gchar *msg = found && w->priv->status_line ? g_strconcat (w->priv->status_line, "    ", found, NULL) :
+                 found ? g_strdup (found) : g_strdup (w->priv->status_line);
 
     if (w->priv->status_bar_msg)
         gtk_statusbar_pop (GTK_STATUSBAR (w->priv->statusbar), w->priv->statusbar_ctx_id);
 
-    if (status_line)
-        gtk_statusbar_push (GTK_STATUSBAR (w->priv->statusbar), w->priv->statusbar_ctx_id, status_line);
+    if (msg)
+        gtk_statusbar_push (GTK_STATUSBAR (w->priv->statusbar), w->priv->statusbar_ctx_id, msg);
+
+    w->priv->status_bar_msg = msg!=NULL;
 
-    w->priv->status_bar_msg = status_line!=NULL;
+    g_free (msg);
+    g_free (found);
+}
+
+
+static void gviewer_window_status_line_changed(GViewer *obj, const gchar *status_line, GViewerWindow *wnd)
+{
+    g_return_if_fail (IS_GVIEWER_WINDOW (wnd));
+
+    GViewerWindow *w = GVIEWER_WINDOW (wnd);
+
+    g_free (w->priv->status_line);
+    w->priv->status_line = g_strdup (status_line);
+
+    gviewer_window_update_status_bar(w);
 }
 
 
@@ -496,6 +546,21 @@ static void gviewer_window_destroy (GtkObject *widget)
 
     if (w->priv)
     {
+        if (w->priv->find_all_poll_id)
+            g_source_remove (w->priv->find_all_poll_id);
+        w->priv->find_all_poll_id = 0;
+
+        // stops "find all"
+        if (w->priv->srchr)
+            g_object_unref (w->priv->srchr);
+        w->priv->srchr = NULL;
+
+        g_free (w->priv->search_pattern);
+        w->priv->search_pattern = NULL;
+
+        g_free (w->priv->status_line);
+        w->priv->status_line = NULL;
+
         g_object_unref (w->priv->viewer);
 
         g_free (w->priv->filename);
@@ -870,6 +935,10 @@ static void create_menu_items (GtkWidget *container, GtkAccelGroup *accel, gpoin
                 GNOME_APP_PIXMAP_NONE, NO_PIXMAP_INFO,
                 NO_GOBJ_KEY, NO_GOBJ_VAL,
                 NO_MENU_ITEM, NO_GSLIST},
+        {MI_NORMAL, _("Find _All…"), GDK_F, GDK_CONTROL_MASK | GDK_SHIFT_MASK, G_CALLBACK (menu_edit_find_all),
+                GNOME_APP_PIXMAP_NONE, NO_PIXMAP_INFO,
+                NO_GOBJ_KEY, NO_GOBJ_VAL,
+                NO_MENU_ITEM, NO_GSLIST},
         {MI_SEPERATOR},
         {MI_CHECK, _("_Wrap lines"), GDK_W, NO_MODIFIER, G_CALLBACK (menu_view_wrap),
                 GNOME_APP_PIXMAP_NONE, NO_PIXMAP_INFO,
@@ -1255,14 +1324,18 @@ static void menu_edit_copy(GtkMenuItem *item, GViewerWindow *obj)
 
 static void start_find_thread(GViewerWindow *obj, gboolean forward)
 {
-    g_viewer_searcher_start_search(obj->priv->srchr, forward);
-    gviewer_show_search_progress_dlg(GTK_WINDOW (obj),
-                                     obj->priv->search_pattern,
-                                     g_viewer_searcher_get_abort_indicator(obj->priv->srchr),
-                                     g_viewer_searcher_get_complete_indicator(obj->priv->srchr),
-                                     g_viewer_searcher_get_progress_indicator(obj->priv->srchr));
-
-    g_viewer_searcher_join(obj->priv->srchr);
+    // Once "find all" is done, the next match is looked up instead
+    if (!g_viewer_searcher_find_indexed(obj->priv->srchr, forward))
+    {
+        g_viewer_searcher_start_search(obj->priv->srchr, forward);
+        gviewer_show_search_progress_dlg(GTK_WINDOW (obj),
+                                         obj->priv->search_pattern,
+                                         g_viewer_searcher_get_abort_indicator(obj->priv->srchr),
+                                         g_viewer_searcher_get_complete_indicator(obj->priv->srchr),
+                                         g_viewer_searcher_get_progress_indicator(obj->priv->srchr));
+
+        g_viewer_searcher_join(obj->priv->srchr);
+    }
 
     if (g_viewer_searcher_get_end_of_search(obj->priv->srchr))
     {
@@ -1285,26 +1358,34 @@ static void start_find_thread(GViewerWindow *obj, gboolean forward)
 }
 
 
-static void menu_edit_find(GtkMenuItem *item, GViewerWindow *obj)
+/*
+    returns FALSE if the search dialog is cancelled
+*/
+static gboolean setup_search(GViewerWindow *obj)
 {
-    g_return_if_fail (obj);
-
     // Show the Search Dialog
     GtkWidget *w = gviewer_search_dlg_new (GTK_WINDOW (obj));
     if (gtk_dialog_run (GTK_DIALOG (w))!=GTK_RESPONSE_OK)
     {
         gtk_widget_destroy (w);
-        return;
+        return FALSE;
     }
 
-    // If a previous search is active, delete it
+    // If a previous search is active, delete it, along with what "find all" found
     if (obj->priv->srchr!=NULL)
     {
+        if (obj->priv->find_all_poll_id)
+            g_source_remove (obj->priv->find_all_poll_id);
+        obj->priv->find_all_poll_id = 0;
+
         g_object_unref (obj->priv->srchr);
         obj->priv->srchr = NULL;
 
         g_free (obj->priv->search_pattern);
         obj->priv->search_pattern = NULL;
+
+        gviewer_set_text_density(obj->priv->viewer, NULL, 0);
+        gviewer_window_update_status_bar(obj);
     }
 
     // Get the search information from the search dialog
@@ -1319,6 +1400,7 @@ static void menu_edit_find(GtkMenuItem *item, GViewerWindow *obj)
         // Text search
         g_viewer_searcher_setup_new_text_search(obj->priv->srchr,
             text_render_get_input_mode_data(gviewer_get_text_render(obj->priv->viewer)),
+            text_render_get_file_ops(gviewer_get_text_render(obj->priv->viewer)),
             text_render_get_current_offset(gviewer_get_text_render(obj->priv->viewer)),
             gv_file_get_max_offset (text_render_get_file_ops (gviewer_get_text_render(obj->priv->viewer))),
             obj->priv->search_pattern,
@@ -1331,11 +1413,12 @@ static void menu_edit_find(GtkMenuItem *item, GViewerWindow *obj)
         guint buflen;
         guint8 *buffer = gviewer_search_dlg_get_search_hex_buffer (srch_dlg, buflen);
 
-        g_return_if_fail (buffer!=NULL);
+        g_return_val_if_fail (buffer!=NULL, FALSE);
 
         obj->priv->search_pattern_len = buflen;
         g_viewer_searcher_setup_new_hex_search(obj->priv->srchr,
             text_render_get_input_mode_data(gviewer_get_text_render(obj->priv->viewer)),
+            text_render_get_file_ops(gviewer_get_text_render(obj->priv->viewer)),
             text_render_get_current_offset(gviewer_get_text_render(obj->priv->viewer)),
             gv_file_get_max_offset (text_render_get_file_ops(gviewer_get_text_render(obj->priv->viewer))),
             buffer, buflen);
@@ -1345,12 +1428,73 @@ static void menu_edit_find(GtkMenuItem *item, GViewerWindow *obj)
 
     gtk_widget_destroy (w);
 
+    return TRUE;
+}
+
+
+static void menu_edit_find(GtkMenuItem *item, GViewerWindow *obj)
+{
+    g_return_if_fail (obj);
+
+    if (!setup_search(obj))
+        return;
 
     // call  "find_next" to actually do the search
     start_find_thread(obj, TRUE);
 }
 
 
+static gboolean find_all_poll(GViewerWindow *obj)
+{
+    gviewer_window_update_status_bar(obj);
+
+    switch (g_viewer_searcher_get_find_all_state(obj->priv->srchr))
+    {
+        case FIND_ALL_RUNNING:
+            return TRUE;
+
+        case FIND_ALL_DONE:
+            {
+                guint bins[FIND_ALL_DENSITY_BINS];
+
+                g_viewer_searcher_get_hit_density(obj->priv->srchr, bins, G_N_ELEMENTS(bins));
+                gviewer_set_text_density(obj->priv->viewer, bins, G_N_ELEMENTS(bins));
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    obj->priv->find_all_poll_id = 0;
+
+    return FALSE;
+}
+
+
+/*
+    Finds all the matches in the background, while the file can still be read. Their count shows
+    in the status bar, and their density beside the scrollbar, "find next" and "find previous"
+    look them up once they are all found.
+*/
+static void menu_edit_find_all(GtkMenuItem *item, GViewerWindow *obj)
+{
+    g_return_if_fail (obj);
+
+    if (!setup_search(obj))
+        return;
+
+    // Growing views are only searched a match at a time
+    if (!g_viewer_searcher_start_find_all(obj->priv->srchr))
+    {
+        start_find_thread(obj, TRUE);
+        return;
+    }
+
+    obj->priv->find_all_poll_id = g_timeout_add (FIND_ALL_POLL_MSEC, (GSourceFunc) find_all_poll, obj);
+}
+
+
 static void menu_edit_find_next(GtkMenuItem *item, GViewerWindow *obj)
 {
     g_return_if_fail (obj);
@@ -1561,7 +1705,7 @@ inline void fill_model (GtkTreeStore *tree, GnomeCmdFile *f)
 
     for (GnomeCmdFileMetadata::METADATA_COLL::const_iterator i=f->metadata->begin(); i!=f->metadata->end(); ++i)
     {
-        const GnomeCmdTag t = i->first;
+        const GnomeCmdTag t = i->tag;
         GnomeCmdTagClass curr_tagclass = gcmd_tags_get_class(t);
 
         if (curr_tagclass==TAG_NONE_CLASS)
@@ -1576,18 +1720,15 @@ inline void fill_model (GtkTreeStore *tree, GnomeCmdFile *f)
                                 -1);
         }
 
-        for (set<std::string>::const_iterator j=i->second.begin(); j!=i->second.end(); ++j)
-        {
-            GtkTreeIter child;
-
-            gtk_tree_store_append (tree, &child, &toplevel);
-            gtk_tree_store_set (tree, &child,
-                                COL_TAG, t,
-                                COL_NAME, gcmd_tags_get_title(t),
-                                COL_VALUE, j->c_str(),
-                                COL_DESC, gcmd_tags_get_description(t),
-                                -1);
-        }
+        GtkTreeIter child;
+
+        gtk_tree_store_append (tree, &child, &toplevel);
+        gtk_tree_store_set (tree, &child,
+                            COL_TAG, t,
+                            COL_NAME, gcmd_tags_get_title(t),
+                            COL_VALUE, f->metadata->value(*i),
+                            COL_DESC, gcmd_tags_get_description(t),
+                            -1);
 
         prev_tagclass = curr_tagclass;
     }
@@ -0,0 +1,36 @@
+/**
+ * @file local-fs.h
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @details Small helpers shared by the native local file engines, which
+ * walk directories with the POSIX calls instead of GnomeVFS.
+ *
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+// directories changed this shortly before they were read may change again within the same time stamp
+#define LOCAL_FS_RACY_NSEC  (2 * G_GINT64_CONSTANT (1000000000))
+
+
+inline gboolean is_dot_or_dotdot (const gchar *name)
+{
+    return name[0]=='.' && (name[1]=='\0' || (name[1]=='.' && name[2]=='\0'));
+}
@@ -45,6 +45,7 @@ extern "C"
 #include "imageloader.h"
 #include "plugin_manager.h"
 #include "tags/gnome-cmd-tags.h"
+#include "dialogs/gnome-cmd-search-dialog.h"
 
 using namespace std;
 
@@ -186,6 +187,7 @@ int main (int argc, char *argv[])
 
         gtk_main ();
 
+        gnome_cmd_search_dialog_stop_index_update ();
         plugin_manager_shutdown ();
         gcmd_tags_shutdown ();
         gcmd_user_actions.shutdown();
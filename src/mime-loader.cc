@@ -0,0 +1,183 @@
+/**
+ * @file mime-loader.cc
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include "gnome-cmd-includes.h"
+#include "mime-loader.h"
+#include "utils.h"
+
+using namespace std;
+
+
+#define MIME_LOADER_THREADS 2
+
+
+struct MimeRequest
+{
+    GnomeCmdFile *f;
+    gchar *path;                // local path, NULL for remote files
+    gchar *uri_str;
+    gchar *mime_type;           // filled by the worker thread
+    guint seq;
+
+    MimeLoadedFunc func;
+    gpointer user_data;
+};
+
+
+static GThreadPool *pool = NULL;
+static GHashTable *pending = NULL;          // GnomeCmdFile * -> MimeRequest *, only used from the main loop
+static guint last_seq = 0;
+
+
+static gchar *detect_mime_type (const gchar *path, const gchar *uri_str)
+{
+    if (path)
+        return g_strdup (gnome_vfs_get_file_mime_type_fast (path, NULL));
+
+    GnomeVFSFileInfo *info = gnome_vfs_file_info_new ();
+    GnomeVFSFileInfoOptions infoOpts = (GnomeVFSFileInfoOptions) (GNOME_VFS_FILE_INFO_FOLLOW_LINKS | GNOME_VFS_FILE_INFO_GET_MIME_TYPE);
+    gchar *mime_type = NULL;
+
+    if (gnome_vfs_get_file_info (uri_str, info, infoOpts)==GNOME_VFS_OK && info->mime_type)
+        mime_type = g_strdup (info->mime_type);
+
+    gnome_vfs_file_info_unref (info);
+
+    return mime_type ? mime_type : g_strdup ("application/octet-stream");
+}
+
+
+gchar *mime_loader_detect (GnomeCmdFile *f)
+{
+    g_return_val_if_fail (f != NULL, NULL);
+    g_return_val_if_fail (f->info != NULL, NULL);
+
+    if (f->info->type == GNOME_VFS_FILE_TYPE_DIRECTORY)
+        return g_strdup ("x-directory/normal");
+
+    // asking a remote server would block the main loop, mime_loader_request() does that in the background
+    if (!f->is_local())
+        return gnome_vfs_get_mime_type_for_name (f->get_name());
+
+    gchar *path = f->get_real_path();
+    gchar *mime_type = detect_mime_type (path, NULL);
+
+    g_free (path);
+
+    return mime_type;
+}
+
+
+static gboolean on_mime_type_loaded (MimeRequest *req)
+{
+    if (g_hash_table_lookup (pending, req->f) == req)
+        g_hash_table_remove (pending, req->f);
+
+    req->f->set_mime_type(req->mime_type);
+
+    if (req->func)
+        req->func (req->f, req->user_data);
+
+    req->f->unref();
+    g_free (req->path);
+    g_free (req->uri_str);
+    g_free (req);
+
+    return FALSE;
+}
+
+
+static void load_mime_type (MimeRequest *req, gpointer unused)
+{
+    req->mime_type = detect_mime_type (req->path, req->uri_str);
+
+    g_idle_add ((GSourceFunc) on_mime_type_loaded, req);
+}
+
+
+static gint compare_requests (MimeRequest *req1, MimeRequest *req2, gpointer unused)
+{
+    // newest first
+    return req1->seq < req2->seq ? 1 : req1->seq > req2->seq ? -1 : 0;
+}
+
+
+void mime_loader_request (GnomeCmdFile *f, MimeLoadedFunc func, gpointer user_data)
+{
+    g_return_if_fail (f != NULL);
+    g_return_if_fail (f->info != NULL);
+
+    if (f->info->mime_type)
+        return;
+
+    if (!pool)
+    {
+        pool = g_thread_pool_new ((GFunc) load_mime_type, NULL, MIME_LOADER_THREADS, FALSE, NULL);
+        g_thread_pool_set_sort_function (pool, (GCompareDataFunc) compare_requests, NULL);
+        pending = g_hash_table_new (g_direct_hash, g_direct_equal);
+    }
+
+    if (MimeRequest *req = (MimeRequest *) g_hash_table_lookup (pending, f))
+    {
+        if (!req->func)                 // cancelled earlier, let the new requester be notified
+        {
+            req->func = func;
+            req->user_data = user_data;
+        }
+        return;
+    }
+
+    if (f->info->type == GNOME_VFS_FILE_TYPE_DIRECTORY)
+    {
+        f->set_mime_type(g_strdup ("x-directory/normal"));
+        if (func)
+            func (f, user_data);
+        return;
+    }
+
+    MimeRequest *req = g_new0 (MimeRequest, 1);
+
+    req->f = f->ref();
+    req->path = f->is_local() ? f->get_real_path() : NULL;
+    req->uri_str = req->path ? NULL : f->get_uri_str();
+    req->seq = ++last_seq;
+    req->func = func;
+    req->user_data = user_data;
+
+    g_hash_table_insert (pending, f, req);
+    g_thread_pool_push (pool, req, NULL);
+}
+
+
+static void cancel_request (GnomeCmdFile *f, MimeRequest *req, gpointer user_data)
+{
+    if (req->user_data == user_data)
+        req->func = NULL;
+}
+
+
+void mime_loader_cancel (gpointer user_data)
+{
+    if (pending)
+        g_hash_table_foreach (pending, (GHFunc) cancel_request, user_data);
+}
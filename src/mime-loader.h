@@ -0,0 +1,48 @@
+/**
+ * @file mime-loader.h
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include "gnome-cmd-file.h"
+
+typedef void (* MimeLoadedFunc) (GnomeCmdFile *f, gpointer user_data);
+
+/**
+ * Directory listings don't sniff MIME types any more, they are detected
+ * on demand: synchronously by GnomeCmdFile::get_mime_type() or in the
+ * background for the rows a file list actually shows. The synchronous
+ * detection of remote files only looks at their names, so that it never
+ * waits for the network.
+ */
+gchar *mime_loader_detect (GnomeCmdFile *f);
+
+/**
+ * Queues MIME type detection of @a f on a background thread. @a func is
+ * called from the main loop once the type has been stored in f->info.
+ * Requests made last are served first, so a quickly scrolled list shows
+ * icons for the current rows before the ones scrolled over.
+ */
+void mime_loader_request (GnomeCmdFile *f, MimeLoadedFunc func, gpointer user_data);
+
+/**
+ * Drops the notifications of all pending requests made with @a user_data.
+ */
+void mime_loader_cancel (gpointer user_data);
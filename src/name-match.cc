@@ -0,0 +1,272 @@
+/**
+ * @file name-match.cc
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE             // memmem()
+#endif
+
+#include <glib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "name-match.h"
+
+using namespace std;
+
+
+#define CANCEL_CHECK_MASK   0x3fff          // names looked at between checks for cancellation
+
+
+struct NameMatch
+{
+    gboolean case_sens;
+    NameMatchMode mode;
+
+    string names;                           // the folded names, each followed by a NUL
+    vector<guint32> starts;                 // where each name starts, and where the last one ends
+
+    vector<pair<string,vector<guint32> > > results;     // each query narrows down the one before
+
+    const gchar *name(guint32 i) const      {  return names.data() + starts[i];  }
+    gsize length(guint32 i) const           {  return starts[i+1] - starts[i] - 1;  }
+};
+
+
+/**
+ * Appends @a s to @a folded, in lower case unless @a case_sens. Whole
+ * characters are folded in valid UTF-8, ASCII letters only otherwise.
+ */
+static void fold (const gchar *s, gboolean case_sens, string &folded)
+{
+    if (case_sens)
+    {
+        folded += s;
+        return;
+    }
+
+    gboolean ascii = TRUE;
+
+    for (const gchar *p=s; *p; ++p)
+        if ((guchar) *p>=0x80)
+        {
+            ascii = FALSE;
+            break;
+        }
+
+    if (ascii || !g_utf8_validate (s, -1, NULL))
+    {
+        for (const gchar *p=s; *p; ++p)
+            folded += g_ascii_tolower (*p);
+        return;
+    }
+
+    for (const gchar *p=s; *p; p=g_utf8_next_char (p))
+    {
+        gchar buff[6];
+        gint n = g_unichar_to_utf8 (g_unichar_tolower (g_utf8_get_char (p)), buff);
+
+        folded.append(buff, n);
+    }
+}
+
+
+NameMatch *name_match_new (const vector<const gchar *> &names, gboolean case_sens, NameMatchMode mode)
+{
+    NameMatch *m = new NameMatch;
+
+    m->case_sens = case_sens;
+    m->mode = mode;
+    m->starts.reserve(names.size() + 1);
+
+    for (vector<const gchar *>::const_iterator i=names.begin(); i!=names.end(); ++i)
+    {
+        m->starts.push_back(m->names.size());
+        fold (*i ? *i : "", case_sens, m->names);
+        m->names += '\0';
+    }
+
+    m->starts.push_back(m->names.size());
+
+    return m;
+}
+
+
+void name_match_free (NameMatch *m)
+{
+    delete m;
+}
+
+
+gboolean name_match_is_plain (const gchar *text)
+{
+    g_return_val_if_fail (text != NULL, FALSE);
+
+    return strpbrk (text, "*?[")==NULL;
+}
+
+
+/**
+ * Returns TRUE if every name matching @a text matches @a query as well,
+ * so that the results of @a query can be narrowed down to those of
+ * @a text.
+ */
+inline gboolean narrows (NameMatchMode mode, const string &query, const string &text)
+{
+    if (query.size()>text.size())
+        return FALSE;
+
+    switch (mode)
+    {
+        case NAME_MATCH_SUBSTRING:
+            return text.find(query)!=string::npos;
+
+        case NAME_MATCH_PREFIX:
+            return text.compare(0, query.size(), query)==0;
+
+        case NAME_MATCH_SUFFIX:
+            return text.compare(text.size()-query.size(), query.size(), query)==0;
+
+        case NAME_MATCH_EXACT:
+        default:
+            return text==query;
+    }
+}
+
+
+inline gboolean matches (NameMatch *m, guint32 i, const string &text)
+{
+    const gchar *name = m->name(i);
+    gsize len = m->length(i);
+
+    if (len<text.size())
+        return FALSE;
+
+    switch (m->mode)
+    {
+        case NAME_MATCH_SUBSTRING:
+            return memmem (name, len, text.data(), text.size())!=NULL;
+
+        case NAME_MATCH_PREFIX:
+            return memcmp (name, text.data(), text.size())==0;
+
+        case NAME_MATCH_SUFFIX:
+            return memcmp (name+len-text.size(), text.data(), text.size())==0;
+
+        case NAME_MATCH_EXACT:
+        default:
+            return len==text.size() && memcmp (name, text.data(), len)==0;
+    }
+}
+
+
+/**
+ * Looks for @a text in the whole buffer at once, skipping to the next
+ * name after each hit.
+ */
+static gboolean scan_substring (NameMatch *m, const string &text, vector<guint32> &found, volatile gint *cancelled)
+{
+    const gchar *begin = m->names.data();
+    const gchar *end = begin + m->names.size();
+    guint32 n_hits = 0;
+
+    for (const gchar *p=begin; p<end; )
+    {
+        const gchar *hit = (const gchar *) memmem (p, end-p, text.data(), text.size());
+
+        if (!hit)
+            break;
+
+        // the name the hit is in, a hit never spans two names as there are no NULs in the text
+        guint32 i = upper_bound (m->starts.begin(), m->starts.end(), (guint32) (hit-begin)) - m->starts.begin() - 1;
+
+        found.push_back(i);
+        p = begin + m->starts[i+1];
+
+        if ((++n_hits & CANCEL_CHECK_MASK)==0 && cancelled && g_atomic_int_get (cancelled))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+gboolean name_match_find (NameMatch *m, const gchar *text, vector<guint32> &found, volatile gint *cancelled)
+{
+    g_return_val_if_fail (m != NULL, FALSE);
+    g_return_val_if_fail (text != NULL, FALSE);
+
+    string query;
+
+    fold (text, m->case_sens, query);
+
+    while (!m->results.empty() && !narrows (m->mode, m->results.back().first, query))
+        m->results.pop_back();
+
+    found.clear();
+
+    if (!m->results.empty() && m->results.back().first==query)
+    {
+        found = m->results.back().second;
+        return TRUE;
+    }
+
+    guint32 n_names = m->starts.size() - 1;
+
+    if (!m->results.empty())
+    {
+        const vector<guint32> &candidates = m->results.back().second;
+
+        for (guint32 j=0; j<candidates.size(); ++j)
+        {
+            if ((j & CANCEL_CHECK_MASK)==0 && cancelled && g_atomic_int_get (cancelled))
+                return FALSE;
+
+            if (matches (m, candidates[j], query))
+                found.push_back(candidates[j]);
+        }
+    }
+    else
+        if (m->mode==NAME_MATCH_SUBSTRING && !query.empty())
+        {
+            if (!scan_substring (m, query, found, cancelled))
+                return FALSE;
+        }
+        else
+            for (guint32 i=0; i<n_names; ++i)
+            {
+                if ((i & CANCEL_CHECK_MASK)==0 && cancelled && g_atomic_int_get (cancelled))
+                    return FALSE;
+
+                if (matches (m, i, query))
+                    found.push_back(i);
+            }
+
+    if (m->results.size()>=NAME_MATCH_DEPTH_MAX)
+        m->results.erase(m->results.begin());
+
+    m->results.push_back(make_pair(query, found));
+
+    return TRUE;
+}
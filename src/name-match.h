@@ -0,0 +1,68 @@
+/**
+ * @file name-match.h
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include <vector>
+
+#define NAME_MATCH_ASYNC_MIN    50000           // listings with more names are searched off the UI thread
+#define NAME_MATCH_DEPTH_MAX    64              // results of the queries typed before kept for narrowing them down
+
+enum NameMatchMode
+{
+    NAME_MATCH_SUBSTRING,
+    NAME_MATCH_PREFIX,
+    NAME_MATCH_SUFFIX,
+    NAME_MATCH_EXACT
+};
+
+/**
+ * Finds the names of a listing containing a text, for the quick search.
+ *
+ * The names are copied once into a single buffer, lower-cased unless the
+ * search is case sensitive, and searched with memmem() rather than a
+ * pattern per name. The results of the queries typed before are kept, so
+ * that a query extending one of them only looks at the names it matched,
+ * and going back to one of them costs nothing.
+ *
+ * It isn't locked, but a single query may run in another thread while the
+ * others wait.
+ */
+struct NameMatch;
+
+NameMatch *name_match_new (const std::vector<const gchar *> &names, gboolean case_sens, NameMatchMode mode);
+
+void name_match_free (NameMatch *m);
+
+/**
+ * Returns TRUE if @a text has no fnmatch() wildcards, so that it can be
+ * looked for with a NameMatch.
+ */
+gboolean name_match_is_plain (const gchar *text);
+
+/**
+ * Stores the indices of the names matching @a text in @a matches, in
+ * ascending order. Returns FALSE if @a cancelled was set in the meantime,
+ * @a matches is incomplete then.
+ */
+gboolean name_match_find (NameMatch *m, const gchar *text, std::vector<guint32> &matches, volatile gint *cancelled=NULL);
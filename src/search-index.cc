@@ -0,0 +1,761 @@
+/**
+ * @file search-index.cc
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <string>
+#include <vector>
+
+#include "local-fs.h"
+#include "search-index.h"
+
+using namespace std;
+
+
+#define INDEX_MAGIC "GCMDIX01"
+
+#define IS_FILE         G_MAXUINT32             // IndexEntry::dir of files
+#define NOT_INDEXED    (G_MAXUINT32 - 1)        // IndexEntry::dir of subdirectories that aren't in the index (mount points...)
+#define NO_PARENT       G_MAXUINT32
+
+
+struct IndexHeader
+{
+    gchar magic[8];
+    guint32 n_dirs;
+    guint32 n_entries;
+    guint32 strings_size;
+    guint32 root;               // offset of the path of the mount point in the strings
+    guint64 dev;
+};
+
+
+struct IndexDir
+{
+    guint32 name;
+    guint32 parent;
+    guint32 end;                // one past the last directory of the subtree
+    guint32 first_entry;
+    guint32 n_entries;
+    guint32 depth;
+    guint64 ino;
+    gint64 ctime;               // in nanoseconds, 0 if the directory has to be read again
+};
+
+
+struct IndexEntry
+{
+    guint32 name;
+    guint32 dir;                // the IndexDir of subdirectories, IS_FILE or NOT_INDEXED
+};
+
+
+struct SearchIndex
+{
+    gchar *map;
+    gsize size;
+
+    const IndexHeader *header;
+    const IndexDir *dirs;
+    const IndexEntry *entries;
+    const gchar *strings;
+
+    const gchar *name(guint32 offset) const     {  return strings + offset;  }
+};
+
+
+inline gint64 ctime_nsec (const struct stat &st)
+{
+    return (gint64) st.st_ctim.tv_sec * 1000000000 + st.st_ctim.tv_nsec;
+}
+
+
+inline gboolean is_cancelled (volatile gint *cancelled)
+{
+    return cancelled && g_atomic_int_get (cancelled);
+}
+
+
+inline void append_name (string &path, const gchar *name)
+{
+    if (path.empty() || path[path.size()-1]!=G_DIR_SEPARATOR)
+        path += G_DIR_SEPARATOR;
+
+    path += name;
+}
+
+
+/**
+ * Tells whether @a name in @a dirfd is a directory or something to be
+ * searched like a regular file: one, or a symbolic link to one.
+ */
+static gboolean classify (gint dirfd, struct dirent *d, gboolean &is_dir, gboolean &is_reg, struct stat &st)
+{
+    is_dir = FALSE;
+    is_reg = FALSE;
+
+#ifdef _DIRENT_HAVE_D_TYPE
+    if (d->d_type==DT_DIR || d->d_type==DT_REG)
+    {
+        is_dir = d->d_type==DT_DIR;
+        is_reg = d->d_type==DT_REG;
+
+        return TRUE;
+    }
+#endif
+
+    if (fstatat (dirfd, d->d_name, &st, AT_SYMLINK_NOFOLLOW)!=0)
+        return FALSE;
+
+    is_dir = S_ISDIR (st.st_mode);
+    is_reg = S_ISREG (st.st_mode);
+
+    // links to regular files are searched, links to directories are not followed
+    if (S_ISLNK (st.st_mode) && fstatat (dirfd, d->d_name, &st, 0)==0)
+        is_reg = S_ISREG (st.st_mode);
+
+    return TRUE;
+}
+
+
+gchar *search_index_mount_root (const gchar *path)
+{
+    gchar *root = realpath (path, NULL);
+    struct stat st;
+
+    if (!root || stat (root, &st)!=0)
+    {
+        free (root);
+        return NULL;
+    }
+
+    gchar *retval = g_strdup (root);
+    free (root);
+
+    while (strcmp (retval, G_DIR_SEPARATOR_S)!=0)
+    {
+        gchar *parent = g_path_get_dirname (retval);
+        struct stat parent_st;
+
+        if (stat (parent, &parent_st)!=0 || parent_st.st_dev!=st.st_dev)
+        {
+            g_free (parent);
+            break;
+        }
+
+        g_free (retval);
+        retval = parent;
+    }
+
+    return retval;
+}
+
+
+static gboolean index_is_valid (SearchIndex *index)
+{
+    const IndexHeader *h = index->header;
+
+    if (index->size<sizeof(IndexHeader) || memcmp (h->magic, INDEX_MAGIC, sizeof(h->magic))!=0)
+        return FALSE;
+
+    if (sizeof(IndexHeader) + (guint64) h->n_dirs * sizeof(IndexDir) + (guint64) h->n_entries * sizeof(IndexEntry) + h->strings_size != index->size)
+        return FALSE;
+
+    if (h->n_dirs==0 || h->strings_size==0 || index->strings[h->strings_size-1]!='\0' || h->root>=h->strings_size)
+        return FALSE;
+
+    // check every offset once here, so that a damaged index can't make searches read outside of the map
+    for (guint32 i=0; i<h->n_dirs; ++i)
+    {
+        const IndexDir &dir = index->dirs[i];
+
+        if (dir.name>=h->strings_size || dir.end<=i || dir.end>h->n_dirs || (guint64) dir.first_entry + dir.n_entries > h->n_entries)
+            return FALSE;
+
+        if (i==0 ? dir.parent!=NO_PARENT || dir.depth!=0 : dir.parent>=i || dir.depth!=index->dirs[dir.parent].depth+1)
+            return FALSE;
+    }
+
+    for (guint32 i=0; i<h->n_entries; ++i)
+    {
+        const IndexEntry &e = index->entries[i];
+
+        if (e.name>=h->strings_size || (e.dir>=h->n_dirs && e.dir!=IS_FILE && e.dir!=NOT_INDEXED))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+SearchIndex *search_index_open (const gchar *index_file)
+{
+    gint fd = open (index_file, O_RDONLY | O_CLOEXEC);
+
+    if (fd<0)
+        return NULL;
+
+    struct stat st;
+    gpointer map = MAP_FAILED;
+
+    if (fstat (fd, &st)==0 && st.st_size>=(off_t) sizeof(IndexHeader))
+        map = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    close (fd);
+
+    if (map==MAP_FAILED)
+        return NULL;
+
+    SearchIndex *index = g_new0 (SearchIndex, 1);
+
+    index->map = (gchar *) map;
+    index->size = st.st_size;
+    index->header = (const IndexHeader *) map;
+    index->dirs = (const IndexDir *) (index->map + sizeof(IndexHeader));
+    index->entries = (const IndexEntry *) (index->dirs + index->header->n_dirs);
+    index->strings = (const gchar *) (index->entries + index->header->n_entries);
+
+    if (!index_is_valid (index))
+    {
+        g_warning ("Ignoring invalid search index %s", index_file);
+        search_index_close (index);
+        return NULL;
+    }
+
+    return index;
+}
+
+
+void search_index_close (SearchIndex *index)
+{
+    if (!index)
+        return;
+
+    munmap (index->map, index->size);
+    g_free (index);
+}
+
+
+const gchar *search_index_root (SearchIndex *index)
+{
+    g_return_val_if_fail (index != NULL, NULL);
+
+    return index->name(index->header->root);
+}
+
+
+static guint32 find_subdir (SearchIndex *index, guint32 d, const gchar *name)
+{
+    const IndexDir &dir = index->dirs[d];
+
+    for (guint32 i=dir.first_entry; i<dir.first_entry+dir.n_entries; ++i)
+    {
+        const IndexEntry &e = index->entries[i];
+
+        if (e.dir!=IS_FILE && strcmp (index->name(e.name), name)==0)
+            return e.dir;
+    }
+
+    return NOT_INDEXED;
+}
+
+
+/**
+ * Maps the names of the subdirectories of @a d to their directory
+ * records + 1, for looking up all entries of a directory read again.
+ */
+static GHashTable *map_subdirs (SearchIndex *index, guint32 d)
+{
+    const IndexDir &dir = index->dirs[d];
+    GHashTable *subdirs = g_hash_table_new (g_str_hash, g_str_equal);
+
+    for (guint32 i=dir.first_entry; i<dir.first_entry+dir.n_entries; ++i)
+    {
+        const IndexEntry &e = index->entries[i];
+
+        if (e.dir<index->header->n_dirs)
+            g_hash_table_insert (subdirs, (gpointer) index->name(e.name), GUINT_TO_POINTER (e.dir + 1));
+    }
+
+    return subdirs;
+}
+
+
+/**
+ * Returns the directory record of @a path, or NOT_INDEXED.
+ */
+static guint32 find_dir (SearchIndex *index, const gchar *path)
+{
+    gchar *real_path = realpath (path, NULL);
+
+    if (!real_path)
+        return NOT_INDEXED;
+
+    const gchar *root = search_index_root (index);
+    gsize root_len = strlen (root);
+    guint32 d = NOT_INDEXED;
+
+    if (strcmp (root, G_DIR_SEPARATOR_S)==0)
+        root_len = 0;
+
+    if (strncmp (real_path, root, root_len)==0 && (real_path[root_len]=='\0' || real_path[root_len]==G_DIR_SEPARATOR))
+    {
+        gchar **names = g_strsplit (real_path + root_len, G_DIR_SEPARATOR_S, -1);
+
+        d = 0;
+
+        for (gchar **name=names; *name && d!=NOT_INDEXED; ++name)
+            if (**name)
+                d = find_subdir (index, d, *name);
+
+        g_strfreev (names);
+    }
+
+    free (real_path);
+
+    return d;
+}
+
+
+inline gboolean wanted (const SearchIndexQuery &query, const gchar *name)
+{
+    return !query.name_matches || query.name_matches (name, query.user_data);
+}
+
+
+inline gboolean has_stat_filter (const SearchIndexQuery &query)
+{
+    return query.min_size>0 || query.max_size<G_MAXUINT64 || query.min_mtime>G_MININT64 || query.max_mtime<G_MAXINT64;
+}
+
+
+/**
+ * Checks the size and time of a file whose name matched. They are always
+ * read from the file, as writing to a file doesn't change its directory.
+ */
+static gboolean stat_matches (const SearchIndexQuery &query, const gchar *path)
+{
+    struct stat st;
+
+    if (!has_stat_filter (query))
+        return TRUE;
+
+    if (stat (path, &st)!=0)
+        return FALSE;
+
+    return (guint64) st.st_size>=query.min_size && (guint64) st.st_size<=query.max_size &&
+           st.st_mtime>=query.min_mtime && st.st_mtime<=query.max_mtime;
+}
+
+
+static void report (const SearchIndexQuery &query, string &path, const gchar *name)
+{
+    gsize len = path.size();
+
+    append_name (path, name);
+
+    if (stat_matches (query, path.c_str()))
+        query.found (path.c_str(), query.user_data);
+
+    path.resize(len);
+}
+
+
+static void report_unindexed (const SearchIndexQuery &query, string &path, const gchar *name, gint depth)
+{
+    if (!query.unindexed_dir || (query.max_depth>=0 && depth>=query.max_depth))
+        return;
+
+    gsize len = path.size();
+
+    append_name (path, name);
+    query.unindexed_dir (path.c_str(), query.max_depth<0 ? -1 : query.max_depth-depth-1, query.user_data);
+    path.resize(len);
+}
+
+
+/**
+ * Searches a directory that has changed since the index was written
+ * as it is now. New subdirectories are left to query.unindexed_dir.
+ */
+static void search_changed_dir (SearchIndex *index, guint32 d, string &path, gint depth, const SearchIndexQuery &query)
+{
+    gint dirfd = open (path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (dirfd<0)
+        return;
+
+    DIR *dir = fdopendir (dirfd);
+
+    if (!dir)
+    {
+        close (dirfd);
+        return;
+    }
+
+    GHashTable *subdirs = map_subdirs (index, d);
+
+    while (struct dirent *d_ent = readdir (dir))
+    {
+        if (is_cancelled (query.cancelled))
+            break;
+
+        if (is_dot_or_dotdot (d_ent->d_name))
+            continue;
+
+        gboolean is_dir, is_reg;
+        struct stat st;
+
+        if (!classify (dirfd, d_ent, is_dir, is_reg, st))
+            continue;
+
+        if (is_dir || is_reg)
+            if (wanted (query, d_ent->d_name))
+                report (query, path, d_ent->d_name);
+
+        // the subdirectories still in the index are searched from there
+        if (is_dir && !g_hash_table_lookup (subdirs, d_ent->d_name))
+            report_unindexed (query, path, d_ent->d_name, depth);
+    }
+
+    g_hash_table_destroy (subdirs);
+    closedir (dir);
+}
+
+
+gint search_index_query (SearchIndex *index, const gchar *path, const SearchIndexQuery &query, guint *n_stale)
+{
+    g_return_val_if_fail (index != NULL, EINVAL);
+    g_return_val_if_fail (query.found != NULL, EINVAL);
+
+    guint32 start = find_dir (index, path);
+
+    if (n_stale)
+        *n_stale = 0;
+
+    if (start==NOT_INDEXED)
+        return ENOENT;
+
+    // the path of the directory at each depth below the start, found results are reported below the path given
+    vector<string> paths(1, path);
+    guint32 start_depth = index->dirs[start].depth;
+
+    for (guint32 d=start; d<index->dirs[start].end && !is_cancelled (query.cancelled); )
+    {
+        const IndexDir &dir = index->dirs[d];
+        gint depth = dir.depth - start_depth;
+
+        if (query.max_depth>=0 && depth>query.max_depth)
+        {
+            d = dir.end;
+            continue;
+        }
+
+        if (depth>0)
+        {
+            paths.resize(depth+1);
+            paths[depth] = paths[depth-1];
+            append_name (paths[depth], index->name(dir.name));
+        }
+
+        string &dir_path = paths[depth];
+        struct stat st;
+
+        // gone, the whole subtree is
+        if (lstat (dir_path.c_str(), &st)!=0 || !S_ISDIR (st.st_mode))
+        {
+            if (n_stale)
+                ++*n_stale;
+            d = dir.end;
+            continue;
+        }
+
+        if (st.st_ino==dir.ino && ctime_nsec (st)==dir.ctime)
+        {
+            for (guint32 i=dir.first_entry; i<dir.first_entry+dir.n_entries; ++i)
+            {
+                const IndexEntry &e = index->entries[i];
+                const gchar *name = index->name(e.name);
+
+                // subdirectories match by name as files do
+                if (wanted (query, name))
+                    report (query, dir_path, name);
+
+                if (e.dir==NOT_INDEXED)
+                    report_unindexed (query, dir_path, name, depth);
+            }
+        }
+        else
+        {
+            if (n_stale)
+                ++*n_stale;
+            search_changed_dir (index, d, dir_path, depth, query);
+        }
+
+        ++d;
+    }
+
+    return 0;
+}
+
+
+struct IndexBuilder
+{
+    SearchIndex *old;
+    dev_t dev;
+    gint64 racy_since;          // directories changed after this are stored as changed
+    volatile gint *cancelled;
+
+    vector<IndexDir> dirs;
+    vector<IndexEntry> entries;
+    string strings;
+
+    guint32 add_string(const gchar *s)
+    {
+        guint32 offset = strings.size();
+        strings.append(s, strlen (s) + 1);
+        return offset;
+    }
+};
+
+
+struct Subdir
+{
+    guint32 entry;
+    guint32 old_dir;
+};
+
+
+/**
+ * Reads the entries of a directory that changed since the old index,
+ * finding the subdirectories it had then by their names.
+ */
+static void read_dir (IndexBuilder &b, const gchar *path, guint32 old_dir, vector<Subdir> &subdirs)
+{
+    gint dirfd = open (path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (dirfd<0)
+        return;
+
+    DIR *dir = fdopendir (dirfd);
+
+    if (!dir)
+    {
+        close (dirfd);
+        return;
+    }
+
+    GHashTable *old_subdirs = b.old && old_dir!=NOT_INDEXED ? map_subdirs (b.old, old_dir) : NULL;
+
+    while (struct dirent *d = readdir (dir))
+    {
+        if (is_cancelled (b.cancelled))
+            break;
+
+        if (is_dot_or_dotdot (d->d_name))
+            continue;
+
+        gboolean is_dir, is_reg;
+        struct stat st;
+
+        if (!classify (dirfd, d, is_dir, is_reg, st) || (!is_dir && !is_reg))
+            continue;
+
+        IndexEntry e = {b.add_string(d->d_name), is_dir ? NOT_INDEXED : IS_FILE};
+
+        if (is_dir)
+        {
+            guint old_subdir = old_subdirs ? GPOINTER_TO_UINT (g_hash_table_lookup (old_subdirs, d->d_name)) : 0;
+            Subdir subdir = {(guint32) b.entries.size(), old_subdir ? old_subdir-1 : NOT_INDEXED};
+
+            subdirs.push_back(subdir);
+        }
+
+        b.entries.push_back(e);
+    }
+
+    if (old_subdirs)
+        g_hash_table_destroy (old_subdirs);
+
+    closedir (dir);
+}
+
+
+static void add_dir (IndexBuilder &b, string &path, guint32 name, guint32 parent, guint32 depth, guint32 old_dir, const struct stat &st)
+{
+    guint32 d = b.dirs.size();
+    gint64 ctime = ctime_nsec (st);
+    IndexDir dir = {name, parent, 0, (guint32) b.entries.size(), 0, depth, (guint64) st.st_ino, ctime<b.racy_since ? ctime : 0};
+    vector<Subdir> subdirs;
+
+    b.dirs.push_back(dir);
+
+    const IndexDir *od = b.old && old_dir!=NOT_INDEXED ? &b.old->dirs[old_dir] : NULL;
+
+    if (od && od->ino==(guint64) st.st_ino && od->ctime==ctime && ctime!=0)
+    {
+        // unchanged, take the entries from the old index
+        for (guint32 i=od->first_entry; i<od->first_entry+od->n_entries; ++i)
+        {
+            const IndexEntry &oe = b.old->entries[i];
+            IndexEntry e = {b.add_string(b.old->name(oe.name)), oe.dir==IS_FILE ? IS_FILE : NOT_INDEXED};
+
+            if (oe.dir!=IS_FILE)
+            {
+                Subdir subdir = {(guint32) b.entries.size(), oe.dir};
+                subdirs.push_back(subdir);
+            }
+
+            b.entries.push_back(e);
+        }
+    }
+    else
+        read_dir (b, path.c_str(), od ? old_dir : NOT_INDEXED, subdirs);
+
+    b.dirs[d].n_entries = b.entries.size() - b.dirs[d].first_entry;
+
+    for (vector<Subdir>::iterator i=subdirs.begin(); i!=subdirs.end() && !is_cancelled (b.cancelled); ++i)
+    {
+        gsize len = path.size();
+        struct stat sub_st;
+
+        append_name (path, &b.strings[b.entries[i->entry].name]);
+
+        // other file systems have their own index
+        if (lstat (path.c_str(), &sub_st)==0 && S_ISDIR (sub_st.st_mode) && sub_st.st_dev==b.dev)
+        {
+            b.entries[i->entry].dir = b.dirs.size();
+            add_dir (b, path, b.entries[i->entry].name, d, depth+1, i->old_dir, sub_st);
+        }
+
+        path.resize(len);
+    }
+
+    b.dirs[d].end = b.dirs.size();
+}
+
+
+static gint write_index (IndexBuilder &b, const gchar *index_file, const gchar *root)
+{
+    IndexHeader h;
+
+    if (b.strings.size()>G_MAXUINT32 || b.entries.size()>=NOT_INDEXED)
+        return EFBIG;
+
+    memcpy (h.magic, INDEX_MAGIC, sizeof(h.magic));
+    h.root = b.add_string(root);
+    h.n_dirs = b.dirs.size();
+    h.n_entries = b.entries.size();
+    h.strings_size = b.strings.size();
+    h.dev = b.dev;
+
+    gchar *tmp_file = g_strconcat (index_file, ".XXXXXX", NULL);
+    gint fd = mkstemp (tmp_file);
+
+    if (fd<0)
+    {
+        gint err = errno;
+        g_free (tmp_file);
+        return err;
+    }
+
+    FILE *f = fdopen (fd, "wb");
+    gint err = 0;
+
+    if (!f)
+    {
+        err = errno;
+        close (fd);
+    }
+    else
+    {
+        errno = 0;
+
+        if (fwrite (&h, sizeof(h), 1, f)!=1 ||
+            (h.n_dirs && fwrite (&b.dirs[0], sizeof(IndexDir), h.n_dirs, f)!=h.n_dirs) ||
+            (h.n_entries && fwrite (&b.entries[0], sizeof(IndexEntry), h.n_entries, f)!=h.n_entries) ||
+            fwrite (b.strings.data(), 1, h.strings_size, f)!=h.strings_size)
+            err = errno ? errno : EIO;
+
+        if (fclose (f)!=0 && !err)
+            err = errno;
+    }
+
+    // the old index is replaced at once, maps of it stay valid
+    if (!err && rename (tmp_file, index_file)!=0)
+        err = errno;
+
+    if (err)
+        unlink (tmp_file);
+
+    g_free (tmp_file);
+
+    return err;
+}
+
+
+gint search_index_update (const gchar *index_file, const gchar *root, volatile gint *cancelled)
+{
+    g_return_val_if_fail (index_file != NULL, EINVAL);
+    g_return_val_if_fail (root != NULL, EINVAL);
+
+    struct stat st;
+
+    if (lstat (root, &st)!=0)
+        return errno;
+
+    if (!S_ISDIR (st.st_mode))
+        return ENOTDIR;
+
+    IndexBuilder b;
+
+    b.old = search_index_open (index_file);
+    b.dev = st.st_dev;
+    b.racy_since = g_get_real_time () * 1000 - LOCAL_FS_RACY_NSEC;
+    b.cancelled = cancelled;
+
+    if (b.old && (strcmp (search_index_root (b.old), root)!=0 || b.old->header->dev!=(guint64) st.st_dev))
+    {
+        search_index_close (b.old);
+        b.old = NULL;
+    }
+
+    string path = root;
+
+    add_dir (b, path, b.add_string(""), NO_PARENT, 0, b.old ? 0 : NOT_INDEXED, st);
+
+    search_index_close (b.old);
+
+    if (is_cancelled (cancelled))
+        return ECANCELED;
+
+    return write_index (b, index_file, root);
+}
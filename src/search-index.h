@@ -0,0 +1,109 @@
+/**
+ * @file search-index.h
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "search-local.h"
+
+/**
+ * An index of the names, sizes and modification times of all files below
+ * a mount point, kept in a file that is mapped into memory for searching.
+ *
+ * Directories are stored in depth first order, so each subtree is a
+ * contiguous range of directories and of file entries, and a search is a
+ * linear scan over that range. The status change time (ctime) of every
+ * directory is recorded too: a search only trusts the entries of
+ * directories that haven't changed since, and reads the others again. The index itself is
+ * refreshed by search_index_update(), which only reads the directories
+ * that have changed.
+ */
+struct SearchIndex;
+
+/**
+ * Called with the path of a directory that isn't in the index yet, and
+ * the number of levels below it still to be searched (-1 for no limit).
+ */
+typedef void (* SearchIndexDirFunc) (const gchar *path, gint max_depth, gpointer user_data);
+
+
+struct SearchIndexQuery
+{
+    gint max_depth;                     // -1 for no limit, 0 to search the start directory only
+    SearchLocalNameFunc name_matches;   // NULL matches every name
+    guint64 min_size;
+    guint64 max_size;
+    gint64 min_mtime;                   // seconds since the epoch
+    gint64 max_mtime;
+    SearchLocalFunc found;
+    SearchIndexDirFunc unindexed_dir;   // has to search the directories created since the index was updated
+    gpointer user_data;
+    volatile gint *cancelled;           // stops the search as soon as possible once set to non-zero
+
+    SearchIndexQuery(): max_depth(-1), name_matches(NULL), min_size(0), max_size(G_MAXUINT64), min_mtime(G_MININT64), max_mtime(G_MAXINT64),
+                        found(NULL), unindexed_dir(NULL), user_data(NULL), cancelled(NULL)   {}
+};
+
+/**
+ * Returns the mount point of the file system @a path is on, found by
+ * walking up the path until the device changes, or NULL on errors.
+ */
+gchar *search_index_mount_root (const gchar *path);
+
+/**
+ * Maps the index in @a index_file. Returns NULL if it doesn't exist or
+ * isn't a valid index.
+ */
+SearchIndex *search_index_open (const gchar *index_file);
+
+void search_index_close (SearchIndex *index);
+
+/**
+ * Returns the directory @a index covers.
+ */
+const gchar *search_index_root (SearchIndex *index);
+
+/**
+ * Searches the files below @a path for regular files (or symbolic links
+ * to them) and directories whose names, sizes and modification times
+ * match @a query, the same ones search_local() would find for a name
+ * pattern.
+ *
+ * Directories that changed since the index was written are read again,
+ * and new subdirectories in them are passed to query.unindexed_dir.
+ * Their number is returned in @a n_stale, if given, as a hint that the
+ * index should be updated.
+ *
+ * @returns 0 on success, ENOENT if @a path isn't in the index
+ */
+gint search_index_query (SearchIndex *index, const gchar *path, const SearchIndexQuery &query, guint *n_stale=NULL);
+
+/**
+ * Writes a new index of the file system mounted at @a root to
+ * @a index_file. The entries of directories that haven't changed since
+ * the index already in @a index_file was written are taken from it, so
+ * only changed directories are read. The new index replaces the old one
+ * atomically, indexes already opened keep seeing the old one.
+ *
+ * @returns 0 on success, an errno value otherwise, ECANCELED if cancelled
+ */
+gint search_index_update (const gchar *index_file, const gchar *root, volatile gint *cancelled=NULL);
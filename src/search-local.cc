@@ -0,0 +1,828 @@
+/**
+ * @file search-local.cc
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "local-fs.h"
+#include "search-local.h"
+
+using namespace std;
+
+
+#define MAX_WORKERS 64
+#define IDLE_WAIT_USEC 2000
+
+
+struct SearchTask
+{
+    gchar *path;
+    gint depth;                 // levels left to descend, -1 for no limit
+    gboolean is_dir;
+};
+
+
+struct SearchContext;
+
+
+struct SearchWorker
+{
+    SearchContext *ctx;
+    guint index;
+    GMutex lock;                // protects tasks, which the other workers steal from
+    deque<SearchTask> tasks;
+    regex_t re;
+    gchar *buf;
+};
+
+
+struct SearchContext
+{
+    const SearchLocalParams *params;
+    gchar *literal;             // text every match has to contain, NULL if there is none
+    gsize literal_len;
+    gboolean ignore_case;
+    vector<SearchWorker *> workers;
+    gint pending;               // tasks queued or running, the search is over when it drops to 0
+
+    GMutex idle_lock;
+    GCond idle_cond;
+    gint n_idle;
+};
+
+
+inline gboolean is_cancelled (const SearchLocalParams *params)
+{
+    return params->cancelled && g_atomic_int_get (params->cancelled);
+}
+
+
+static void push_task (SearchWorker *w, gchar *path, gint depth, gboolean is_dir)
+{
+    SearchTask task = {path, depth, is_dir};
+    SearchContext *ctx = w->ctx;
+
+    g_atomic_int_inc (&ctx->pending);
+
+    g_mutex_lock (&w->lock);
+    w->tasks.push_back(task);
+    g_mutex_unlock (&w->lock);
+
+    if (g_atomic_int_get (&ctx->n_idle))
+    {
+        g_mutex_lock (&ctx->idle_lock);
+        g_cond_signal (&ctx->idle_cond);
+        g_mutex_unlock (&ctx->idle_lock);
+    }
+}
+
+
+static gboolean pop_task (SearchWorker *w, SearchTask &task)
+{
+    // newest first from the own queue, so each worker goes depth first...
+    g_mutex_lock (&w->lock);
+
+    gboolean found = !w->tasks.empty();
+
+    if (found)
+    {
+        task = w->tasks.back();
+        w->tasks.pop_back();
+    }
+
+    g_mutex_unlock (&w->lock);
+
+    if (found)
+        return TRUE;
+
+    // ...and oldest first from the others, these are the tasks closest to the root, i.e. the largest ones
+    vector<SearchWorker *> &workers = w->ctx->workers;
+
+    for (guint i=1; i<workers.size(); ++i)
+    {
+        SearchWorker *victim = workers[(w->index + i) % workers.size()];
+
+        g_mutex_lock (&victim->lock);
+
+        found = !victim->tasks.empty();
+
+        if (found)
+        {
+            task = victim->tasks.front();
+            victim->tasks.pop_front();
+        }
+
+        g_mutex_unlock (&victim->lock);
+
+        if (found)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+
+static gboolean read_content_matches (gint fd, regex_t *re, gchar *buf, volatile gint *cancelled)
+{
+    regmatch_t match;
+    gsize keep = 0;
+
+    for (;;)
+    {
+        if (cancelled && g_atomic_int_get (cancelled))
+            return FALSE;
+
+        ssize_t n = read (fd, buf + keep, SEARCH_LOCAL_BUFFER_SIZE - 1 - keep);
+
+        if (n<0 && errno==EINTR)
+            continue;
+
+        if (n<=0)
+            return FALSE;
+
+        gsize len = keep + n;
+
+        buf[len] = '\0';
+
+        if (regexec (re, buf, 1, &match, 0) != REG_NOMATCH)
+            return TRUE;
+
+        // keep the tail to give the regex a chance to match across chunks
+        keep = MIN (len, SEARCH_LOCAL_JUMP_SIZE);
+        memmove (buf, buf + len - keep, keep);
+    }
+}
+
+
+inline gboolean is_ascii_letter (guchar c)
+{
+    return (c>='a' && c<='z') || (c>='A' && c<='Z');
+}
+
+
+static void remove_last_char (string &s)
+{
+    // the whole UTF-8 sequence
+    while (!s.empty() && (s[s.size()-1] & 0xC0)==0x80)
+        s.erase(s.size()-1);
+
+    if (!s.empty())
+        s.erase(s.size()-1);
+}
+
+
+gchar *search_local_required_literal (const gchar *pattern, gint cflags)
+{
+    g_return_val_if_fail (pattern != NULL, NULL);
+
+    gboolean ere = (cflags & REG_EXTENDED) != 0;
+    gboolean icase = (cflags & REG_ICASE) != 0;
+    string best, run;
+    gint depth = 0;
+
+#define END_RUN()   {  if (run.size()>best.size()) best = run;  run.clear();  }
+
+    for (const gchar *p=pattern; *p; ++p)
+    {
+        guchar c = *p;
+
+        if (c=='[')                         // bracket expression
+        {
+            END_RUN();
+            ++p;
+            if (*p=='^')  ++p;
+            if (*p==']')  ++p;
+            for (; *p && *p!=']'; ++p)
+                if (*p=='[' && (p[1]==':' || p[1]=='=' || p[1]=='.'))
+                {
+                    gchar delim = p[1];
+                    for (p+=2; *p && !(*p==delim && p[1]==']'); ++p);
+                    if (!*p)
+                        return NULL;
+                    ++p;
+                }
+            if (!*p)
+                return NULL;
+            continue;
+        }
+
+        gboolean open_group = ere ? c=='(' : c=='\\' && p[1]=='(';
+        gboolean close_group = ere ? c==')' : c=='\\' && p[1]==')';
+        gboolean alternation = ere ? c=='|' : c=='\\' && p[1]=='|';
+        gboolean interval = ere ? c=='{' : c=='\\' && p[1]=='{';
+
+        if (alternation && depth==0)        // a|b has no text that all matches share
+            return NULL;
+
+        if (open_group || close_group)
+        {
+            // the content of groups is left alone, it may be optional or repeated
+            END_RUN();
+            depth += open_group ? 1 : -1;
+            if (depth<0)
+                return NULL;
+            if (!ere)
+                ++p;
+            continue;
+        }
+
+        if (depth>0)
+        {
+            if (c=='\\' && p[1])
+                ++p;
+            continue;
+        }
+
+        if (interval)
+        {
+            remove_last_char (run);
+            END_RUN();
+            const gchar *close = ere ? strchr (p, '}') : strstr (p, "\\}");
+            if (!close)
+                return NULL;
+            p = ere ? close : close+1;
+            continue;
+        }
+
+        if (c=='*' || (ere && (c=='?' || c=='+')) || (!ere && c=='\\' && (p[1]=='?' || p[1]=='+')))
+        {
+            // x+ still needs one x, but what follows needn't be next to it
+            if (c=='*' || c=='?' || p[1]=='?')
+                remove_last_char (run);
+            END_RUN();
+            if (c=='\\')
+                ++p;
+            continue;
+        }
+
+        if (c=='.' || c=='^' || c=='$')
+        {
+            END_RUN();
+            continue;
+        }
+
+        if (c=='\\')
+        {
+            c = *++p;
+
+            // backreferences and GNU extensions like \w, \b, \<
+            if (!c || g_ascii_isalnum (c) || c=='<' || c=='>' || c=='`' || c=='\'')
+            {
+                END_RUN();
+                if (!c)
+                    break;
+                continue;
+            }
+        }
+
+        // case folding may match non-ASCII characters to these (KELVIN SIGN, LONG S, dotless i)
+        if (icase && (c>=0x80 || strchr ("kKsSiI", c)))
+        {
+            END_RUN();
+            continue;
+        }
+
+        run += icase ? g_ascii_tolower (c) : c;
+    }
+
+    END_RUN();
+
+#undef END_RUN
+
+    return best.empty() ? NULL : g_strndup (best.data(), best.size());
+}
+
+
+inline gboolean literal_equal (const gchar *s, const gchar *literal, gsize n, gboolean ignore_case)
+{
+    if (!ignore_case)
+        return memcmp (s, literal, n)==0;
+
+    for (gsize i=0; i<n; ++i)
+        if ((is_ascii_letter (literal[i]) ? s[i] | 0x20 : s[i]) != literal[i])
+            return FALSE;
+
+    return TRUE;
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * Compares the first and the last byte of the literal with 16 candidate
+ * positions at once, only positions where both match are compared in full.
+ */
+#ifdef __SSE2__
+static gssize find_literal_sse2 (const gchar *buf, gsize end, gsize &i, const gchar *literal, gsize n, gboolean ignore_case)
+{
+    __m128i first = _mm_set1_epi8 (literal[0]);
+    __m128i last = _mm_set1_epi8 (literal[n-1]);
+    __m128i first_mask = _mm_set1_epi8 (ignore_case && is_ascii_letter (literal[0]) ? 0x20 : 0);
+    __m128i last_mask = _mm_set1_epi8 (ignore_case && is_ascii_letter (literal[n-1]) ? 0x20 : 0);
+
+    for (; i+16<=end; i+=16)
+    {
+        __m128i a = _mm_or_si128 (_mm_loadu_si128 ((const __m128i *) (buf + i)), first_mask);
+        __m128i b = _mm_or_si128 (_mm_loadu_si128 ((const __m128i *) (buf + i + n - 1)), last_mask);
+        guint mask = _mm_movemask_epi8 (_mm_and_si128 (_mm_cmpeq_epi8 (a, first), _mm_cmpeq_epi8 (b, last)));
+
+        for (; mask; mask&=mask-1)
+        {
+            gsize pos = i + __builtin_ctz (mask);
+
+            if (literal_equal (buf + pos, literal, n, ignore_case))
+                return pos;
+        }
+    }
+
+    return -1;
+}
+#endif
+
+
+#if defined(__GNUC__) && !defined(__clang__) || defined(__clang__) && __clang_major__>=4
+#define HAVE_AVX2_DISPATCH
+__attribute__ ((target ("avx2")))
+static gssize find_literal_avx2 (const gchar *buf, gsize end, gsize &i, const gchar *literal, gsize n, gboolean ignore_case)
+{
+    __m256i first = _mm256_set1_epi8 (literal[0]);
+    __m256i last = _mm256_set1_epi8 (literal[n-1]);
+    __m256i first_mask = _mm256_set1_epi8 (ignore_case && is_ascii_letter (literal[0]) ? 0x20 : 0);
+    __m256i last_mask = _mm256_set1_epi8 (ignore_case && is_ascii_letter (literal[n-1]) ? 0x20 : 0);
+
+    for (; i+32<=end; i+=32)
+    {
+        __m256i a = _mm256_or_si256 (_mm256_loadu_si256 ((const __m256i *) (buf + i)), first_mask);
+        __m256i b = _mm256_or_si256 (_mm256_loadu_si256 ((const __m256i *) (buf + i + n - 1)), last_mask);
+        guint mask = _mm256_movemask_epi8 (_mm256_and_si256 (_mm256_cmpeq_epi8 (a, first), _mm256_cmpeq_epi8 (b, last)));
+
+        for (; mask; mask&=mask-1)
+        {
+            gsize pos = i + __builtin_ctz (mask);
+
+            if (literal_equal (buf + pos, literal, n, ignore_case))
+                return pos;
+        }
+    }
+
+    return -1;
+}
+#endif
+#endif
+
+
+gssize search_local_find_literal (const gchar *buf, gsize len, const gchar *literal, gsize n, gboolean ignore_case)
+{
+    g_return_val_if_fail (literal != NULL, -1);
+
+    if (n==0)
+        return 0;
+
+    if (len<n)
+        return -1;
+
+    gsize end = len - n + 1;        // candidate positions are [0, end)
+    gsize i = 0;
+
+#if defined(__x86_64__) || defined(__i386__)
+#ifdef HAVE_AVX2_DISPATCH
+    static gint have_avx2 = -1;
+
+    if (have_avx2<0)
+        g_atomic_int_set (&have_avx2, __builtin_cpu_supports ("avx2") ? 1 : 0);
+
+    if (have_avx2)
+    {
+        gssize pos = find_literal_avx2 (buf, end, i, literal, n, ignore_case);
+
+        if (pos>=0)
+            return pos;
+    }
+#endif
+#ifdef __SSE2__
+    gssize pos = find_literal_sse2 (buf, end, i, literal, n, ignore_case);
+
+    if (pos>=0)
+        return pos;
+#endif
+#endif
+
+    // the rest, or everything without SIMD
+    if (!ignore_case)
+    {
+        while (i<end)
+        {
+            const gchar *p = (const gchar *) memchr (buf + i, literal[0], end - i);
+
+            if (!p)
+                return -1;
+
+            i = p - buf;
+
+            if (memcmp (p, literal, n)==0)
+                return i;
+
+            ++i;
+        }
+
+        return -1;
+    }
+
+    for (; i<end; ++i)
+        if (literal_equal (buf + i, literal, n, TRUE))
+            return i;
+
+    return -1;
+}
+
+
+gboolean search_local_is_binary (const gchar *buf, gsize len)
+{
+    return memchr (buf, '\0', MIN (len, SEARCH_LOCAL_BINARY_PROBE)) != NULL;
+}
+
+
+#ifdef REG_STARTEND
+inline gboolean regex_matches (regex_t *re, const gchar *buf, gsize start, gsize end)
+{
+    regmatch_t match;
+
+    match.rm_so = start;
+    match.rm_eo = end;
+
+    return regexec (re, buf, 1, &match, REG_STARTEND) != REG_NOMATCH;
+}
+
+
+/**
+ * Matches the regex on windows of SEARCH_LOCAL_BUFFER_SIZE-1 bytes that
+ * overlap by SEARCH_LOCAL_JUMP_SIZE, like read_content_matches(). With a
+ * literal only windows starting SEARCH_LOCAL_JUMP_SIZE bytes before one of
+ * its occurrences are looked at, which covers every match of up to that
+ * length containing it.
+ */
+static gboolean buffer_matches (SearchWorker *w, const gchar *buf, gsize len)
+{
+    SearchContext *ctx = w->ctx;
+    const gsize window = SEARCH_LOCAL_BUFFER_SIZE - 1;
+
+    for (gsize pos=0; pos<len;)
+    {
+        if (is_cancelled (ctx->params))
+            return FALSE;
+
+        gsize start = pos;
+
+        if (ctx->literal)
+        {
+            gssize hit = search_local_find_literal (buf + pos, len - pos, ctx->literal, ctx->literal_len, ctx->ignore_case);
+
+            if (hit<0)
+                return FALSE;
+
+            start = pos + hit>SEARCH_LOCAL_JUMP_SIZE ? pos + hit - SEARCH_LOCAL_JUMP_SIZE : 0;
+        }
+
+        gsize end = MIN (len, start + window);
+
+        if (regex_matches (&w->re, buf, start, end))
+            return TRUE;
+
+        if (end==len)
+            break;
+
+        pos = end - SEARCH_LOCAL_JUMP_SIZE;
+    }
+
+    return FALSE;
+}
+
+
+/**
+ * Reads the file in chunks of SEARCH_LOCAL_CHUNK_SIZE bytes, each starting
+ * with the last SEARCH_LOCAL_JUMP_SIZE bytes of the one before, and matches
+ * them with buffer_matches(). The file isn't mapped, as one truncated while
+ * it is searched would raise SIGBUS.
+ */
+static gboolean chunks_match (SearchWorker *w, gint fd)
+{
+    gsize keep = 0;
+
+    for (gboolean first=TRUE;; first=FALSE)
+    {
+        gsize len = keep;
+
+        while (len<SEARCH_LOCAL_CHUNK_SIZE)
+        {
+            ssize_t n = read (fd, w->buf + len, SEARCH_LOCAL_CHUNK_SIZE - len);
+
+            if (n<0 && errno==EINTR)
+                continue;
+
+            if (n<=0)
+                break;
+
+            len += n;
+        }
+
+        if (len==keep)
+            return FALSE;
+
+        if (first && search_local_is_binary (w->buf, len))
+            return FALSE;
+
+        if (buffer_matches (w, w->buf, len))
+            return TRUE;
+
+        if (len<SEARCH_LOCAL_CHUNK_SIZE || is_cancelled (w->ctx->params))
+            return FALSE;
+
+        keep = SEARCH_LOCAL_JUMP_SIZE;
+        memmove (w->buf, w->buf + len - keep, keep);
+    }
+}
+#endif
+
+
+static gboolean file_content_matches (SearchWorker *w, const gchar *path)
+{
+    gint fd = open (path, O_RDONLY | O_CLOEXEC | O_NOCTTY);
+
+    if (fd<0)
+        return FALSE;
+
+    if (!w->buf)
+        w->buf = (gchar *) g_malloc (SEARCH_LOCAL_CHUNK_SIZE);
+
+    gboolean retval;
+
+#ifdef REG_STARTEND
+    struct stat st;
+
+    if (fstat (fd, &st)==0 && S_ISREG (st.st_mode))
+        retval = chunks_match (w, fd);
+    else
+#endif
+        retval = read_content_matches (fd, &w->re, w->buf, w->ctx->params->cancelled);
+
+    close (fd);
+
+    return retval;
+}
+
+
+static void search_dir (SearchWorker *w, const gchar *path, gint depth)
+{
+    const SearchLocalParams *params = w->ctx->params;
+
+    if (params->entering_dir)
+        params->entering_dir (path, params->user_data);
+
+    gint dirfd = open (path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (dirfd<0)
+        return;
+
+    DIR *dir = fdopendir (dirfd);
+
+    if (!dir)
+    {
+        close (dirfd);
+        return;
+    }
+
+    while (struct dirent *d = readdir (dir))
+    {
+        if (is_cancelled (params))
+            break;
+
+        if (is_dot_or_dotdot (d->d_name))
+            continue;
+
+        gboolean is_dir = FALSE;
+        gboolean is_reg = FALSE;
+
+#ifdef _DIRENT_HAVE_D_TYPE
+        is_dir = d->d_type==DT_DIR;
+        is_reg = d->d_type==DT_REG;
+
+        if (d->d_type==DT_LNK || d->d_type==DT_UNKNOWN)
+#endif
+        {
+            struct stat st;
+
+            if (fstatat (dirfd, d->d_name, &st, AT_SYMLINK_NOFOLLOW)!=0)
+                continue;
+
+            is_dir = S_ISDIR (st.st_mode);
+            is_reg = S_ISREG (st.st_mode);
+
+            // links to regular files are searched, links to directories are not followed
+            if (S_ISLNK (st.st_mode) && fstatat (dirfd, d->d_name, &st, 0)==0)
+                is_reg = S_ISREG (st.st_mode);
+        }
+
+        if (is_dir)
+        {
+            // directories have no content, they only match names
+            if (!params->content_pattern && (!params->name_matches || params->name_matches (d->d_name, params->user_data)))
+            {
+                gchar *dir_path = g_build_filename (path, d->d_name, NULL);
+                params->found (dir_path, params->user_data);
+                g_free (dir_path);
+            }
+
+            if (depth!=0)
+                push_task (w, g_build_filename (path, d->d_name, NULL), depth-1, TRUE);
+        }
+        else
+            if (is_reg && (!params->name_matches || params->name_matches (d->d_name, params->user_data)))
+            {
+                gchar *file_path = g_build_filename (path, d->d_name, NULL);
+
+                if (params->content_pattern)
+                    push_task (w, file_path, 0, FALSE);         // let idle workers steal the reading
+                else
+                {
+                    params->found (file_path, params->user_data);
+                    g_free (file_path);
+                }
+            }
+    }
+
+    closedir (dir);
+}
+
+
+static void run_task (SearchWorker *w, SearchTask &task)
+{
+    const SearchLocalParams *params = w->ctx->params;
+
+    // cancelled tasks are just dropped, so that pending still drops to 0
+    if (!is_cancelled (params))
+    {
+        if (task.is_dir)
+            search_dir (w, task.path, task.depth);
+        else
+            if (file_content_matches (w, task.path))
+                params->found (task.path, params->user_data);
+    }
+
+    g_free (task.path);
+}
+
+
+static gpointer worker_func (SearchWorker *w)
+{
+    SearchContext *ctx = w->ctx;
+
+    for (;;)
+    {
+        SearchTask task;
+
+        if (pop_task (w, task))
+        {
+            run_task (w, task);
+
+            if (g_atomic_int_dec_and_test (&ctx->pending))
+            {
+                g_mutex_lock (&ctx->idle_lock);
+                g_cond_broadcast (&ctx->idle_cond);
+                g_mutex_unlock (&ctx->idle_lock);
+            }
+
+            continue;
+        }
+
+        g_mutex_lock (&ctx->idle_lock);
+
+        if (g_atomic_int_get (&ctx->pending)==0)
+        {
+            g_mutex_unlock (&ctx->idle_lock);
+            break;
+        }
+
+        // the timeout covers tasks pushed between pop_task() and here
+        g_atomic_int_inc (&ctx->n_idle);
+        g_cond_wait_until (&ctx->idle_cond, &ctx->idle_lock, g_get_monotonic_time () + IDLE_WAIT_USEC);
+        g_atomic_int_add (&ctx->n_idle, -1);
+
+        g_mutex_unlock (&ctx->idle_lock);
+    }
+
+    return NULL;
+}
+
+
+gint search_local (const gchar *path, const SearchLocalParams &params)
+{
+    g_return_val_if_fail (path != NULL, EINVAL);
+    g_return_val_if_fail (params.found != NULL, EINVAL);
+
+    gint fd = open (path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd<0)
+        return errno;
+
+    close (fd);
+
+    guint n_workers = params.n_workers ? params.n_workers : g_get_num_processors ();
+
+    n_workers = CLAMP (n_workers, 1, MAX_WORKERS);
+
+    SearchContext ctx;
+
+    ctx.params = &params;
+    ctx.literal = params.content_pattern ? search_local_required_literal (params.content_pattern, params.content_cflags) : NULL;
+    ctx.literal_len = ctx.literal ? strlen (ctx.literal) : 0;
+    ctx.ignore_case = (params.content_cflags & REG_ICASE) != 0;
+    ctx.pending = 0;
+    ctx.n_idle = 0;
+    g_mutex_init (&ctx.idle_lock);
+    g_cond_init (&ctx.idle_cond);
+
+    gint err = 0;
+
+    for (guint i=0; i<n_workers; ++i)
+    {
+        SearchWorker *w = new SearchWorker;
+
+        w->ctx = &ctx;
+        w->index = i;
+        w->buf = NULL;
+        g_mutex_init (&w->lock);
+
+        // glibc serializes regexec() calls on the same pattern, so every worker gets its own copy
+        if (params.content_pattern && regcomp (&w->re, params.content_pattern, params.content_cflags)!=0)
+        {
+            g_mutex_clear (&w->lock);
+            delete w;
+            err = EINVAL;
+            break;
+        }
+
+        ctx.workers.push_back(w);
+    }
+
+    if (!err)
+    {
+        push_task (ctx.workers[0], g_strdup (path), params.max_depth, TRUE);
+
+        vector<GThread *> threads;
+
+        for (guint i=1; i<n_workers; ++i)
+            threads.push_back(g_thread_new ("search-local", (GThreadFunc) worker_func, ctx.workers[i]));
+
+        worker_func (ctx.workers[0]);
+
+        for (vector<GThread *>::iterator t=threads.begin(); t!=threads.end(); ++t)
+            g_thread_join (*t);
+    }
+
+    for (vector<SearchWorker *>::iterator i=ctx.workers.begin(); i!=ctx.workers.end(); ++i)
+    {
+        SearchWorker *w = *i;
+
+        if (params.content_pattern)
+            regfree (&w->re);
+
+        g_free (w->buf);
+        g_mutex_clear (&w->lock);
+        delete w;
+    }
+
+    g_cond_clear (&ctx.idle_cond);
+    g_mutex_clear (&ctx.idle_lock);
+    g_free (ctx.literal);
+
+    return err;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file search-local.h
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <regex.h>
+
+#define SEARCH_LOCAL_JUMP_SIZE     4096U
+#define SEARCH_LOCAL_BUFFER_SIZE  (SEARCH_LOCAL_JUMP_SIZE * 10U)
+#define SEARCH_LOCAL_BINARY_PROBE  8192U
+#define SEARCH_LOCAL_CHUNK_SIZE   (SEARCH_LOCAL_BUFFER_SIZE * 8U)
+
+/**
+ * Decides whether a file name is wanted, called from the worker threads.
+ */
+typedef gboolean (* SearchLocalNameFunc) (const gchar *name, gpointer user_data);
+
+/**
+ * Called from the worker threads with the full path of a matching file or
+ * directory, or of a directory about to be searched.
+ */
+typedef void (* SearchLocalFunc) (const gchar *path, gpointer user_data);
+
+
+struct SearchLocalParams
+{
+    gint max_depth;                     // -1 for no limit, 0 to search the start directory only
+    SearchLocalNameFunc name_matches;   // NULL matches every name
+    const gchar *content_pattern;       // POSIX regex the content has to match, NULL to match names only
+    gint content_cflags;                // regcomp() flags for content_pattern
+    SearchLocalFunc found;
+    SearchLocalFunc entering_dir;       // may be NULL
+    gpointer user_data;
+    volatile gint *cancelled;           // stops the search as soon as possible once set to non-zero
+    guint n_workers;                    // 0 = one per CPU
+
+    SearchLocalParams(): max_depth(-1), name_matches(NULL), content_pattern(NULL), content_cflags(0),
+                         found(NULL), entering_dir(NULL), user_data(NULL), cancelled(NULL), n_workers(0)   {}
+};
+
+/**
+ * Searches the local directory tree below @a path for regular files (or
+ * symbolic links to them) whose names and, if given, content match.
+ * Without a content pattern, directories whose names match are found
+ * too. Symbolic links to directories are not followed.
+ *
+ * Reading directories and matching file content are spread over
+ * @a params.n_workers threads: each one works depth first on its own
+ * queue of directories and files and steals from the others when it runs
+ * dry, so a single huge directory or file doesn't leave the others idle.
+ * Matches are reported while the search goes on. Returns once everything
+ * has been searched.
+ *
+ * Files are mapped into memory and skipped if they look binary. If every
+ * match of the content pattern has to contain some literal text, files
+ * without it are rejected before the regex is run at all, and the regex
+ * only looks at the parts of the file around that text.
+ *
+ * @returns 0 on success, an errno value if @a path can't be read or
+ * EINVAL if the content pattern doesn't compile
+ */
+gint search_local (const gchar *path, const SearchLocalParams &params);
+
+/**
+ * Returns the longest run of characters every match of the POSIX regex
+ * @a pattern has to contain, or NULL if there is none that can be found
+ * safely (alternations, case folding beyond ASCII...). Letters are
+ * returned in lower case if @a cflags contains REG_ICASE.
+ */
+gchar *search_local_required_literal (const gchar *pattern, gint cflags);
+
+/**
+ * Returns the offset of the first occurrence of @a literal (of length
+ * @a n) in @a buf, or -1. With @a ignore_case ASCII letters in @a buf
+ * match their lower case form in @a literal. Candidates are found 16 or 32
+ * bytes at a time with SSE2 or AVX2 where available.
+ */
+gssize search_local_find_literal (const gchar *buf, gsize len, const gchar *literal, gsize n, gboolean ignore_case);
+
+/**
+ * Tells whether @a buf looks like the start of a binary file, i.e.
+ * contains a NUL byte within its first SEARCH_LOCAL_BINARY_PROBE bytes.
+ */
+gboolean search_local_is_binary (const gchar *buf, gsize len);
@@ -0,0 +1,565 @@
+/**
+ * @file tag-cache.cc
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tag-cache.h"
+
+using namespace std;
+
+
+#define CACHE_MAGIC "GCMDTC01"
+
+
+struct CacheHeader
+{
+    gchar magic[8];
+    guint32 n_files;
+    guint32 n_values;
+    guint32 strings_size;
+    guint32 clock;              // the number of sessions that used the cache
+};
+
+
+struct CacheFile
+{
+    guint64 dev;
+    guint64 ino;
+    guint64 size;
+    gint64 mtime;               // in nanoseconds
+    guint32 used;               // the session the file was used last in
+    guint32 parsers;            // the parsers that read the file, whether they found something or not
+    guint32 first_value;
+    guint32 n_values;
+};
+
+
+struct CacheValue
+{
+    guint32 parser;
+    guint32 name;               // offsets in the strings
+    guint32 value;
+};
+
+
+struct CachedFile
+{
+    guint64 size;
+    gint64 mtime;
+    guint32 used;
+    guint32 parsers;
+    vector<CacheValue> values;
+};
+
+
+typedef pair<guint64,guint64> FileKey;         // the device and the inode
+
+
+struct TagCache
+{
+    GMutex lock;                // for everything below
+
+    map<FileKey,CachedFile> files;
+    string strings;
+    map<string,guint32> string_offsets;
+    guint32 clock;
+    gboolean changed;
+
+    guint32 add_string(const string &s)
+    {
+        map<string,guint32>::const_iterator i = string_offsets.find(s);
+
+        if (i!=string_offsets.end())
+            return i->second;
+
+        guint32 offset = strings.size();
+        strings.append(s.c_str(), s.size() + 1);
+        string_offsets[s] = offset;
+
+        return offset;
+    }
+};
+
+
+struct TagCacheJob
+{
+    TagCache *cache;
+    TagCacheReadFunc read;
+    GThreadPool *pool;
+    gint cancelled;
+
+    GMutex lock;                // for everything below
+    guint done;
+    guint total;
+};
+
+
+struct ReadTask
+{
+    gchar *path;
+    guint parsers;
+};
+
+
+inline gint64 mtime_nsec (const struct stat &st)
+{
+    return (gint64) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+
+static gboolean load_cache (TagCache *cache, const gchar *cache_file)
+{
+    gchar *contents;
+    gsize size;
+
+    if (!g_file_get_contents (cache_file, &contents, &size, NULL))
+        return FALSE;
+
+    const CacheHeader *h = (const CacheHeader *) contents;
+    const CacheFile *files = (const CacheFile *) (contents + sizeof(CacheHeader));
+    const CacheValue *values = NULL;
+    const gchar *strings = NULL;
+    gboolean valid = size>=sizeof(CacheHeader) && memcmp (h->magic, CACHE_MAGIC, sizeof(h->magic))==0;
+
+    if (valid)
+    {
+        values = (const CacheValue *) (files + h->n_files);
+        strings = (const gchar *) (values + h->n_values);
+
+        valid = sizeof(CacheHeader) + (guint64) h->n_files * sizeof(CacheFile) + (guint64) h->n_values * sizeof(CacheValue) + h->strings_size == size &&
+                (h->strings_size==0 || strings[h->strings_size-1]=='\0');
+    }
+
+    // check every offset before anything is taken over
+    for (guint32 i=0; valid && i<h->n_files; ++i)
+        valid = (guint64) files[i].first_value + files[i].n_values <= h->n_values;
+
+    for (guint32 i=0; valid && i<h->n_values; ++i)
+        valid = values[i].name<h->strings_size && values[i].value<h->strings_size;
+
+    if (valid)
+    {
+        cache->strings.assign(strings, h->strings_size);
+
+        for (guint32 offset=0; offset<h->strings_size; offset+=strlen (strings+offset)+1)
+            cache->string_offsets[strings+offset] = offset;
+
+        for (guint32 i=0; i<h->n_files; ++i)
+        {
+            CachedFile &file = cache->files[FileKey(files[i].dev, files[i].ino)];
+
+            file.size = files[i].size;
+            file.mtime = files[i].mtime;
+            file.used = files[i].used;
+            file.parsers = files[i].parsers;
+            file.values.assign(values + files[i].first_value, values + files[i].first_value + files[i].n_values);
+        }
+
+        cache->clock = h->clock;
+    }
+
+    g_free (contents);
+
+    return valid;
+}
+
+
+TagCache *tag_cache_open (const gchar *cache_file)
+{
+    TagCache *cache = new TagCache;
+
+    g_mutex_init (&cache->lock);
+    cache->clock = 0;
+    cache->changed = FALSE;
+
+    if (cache_file && g_file_test (cache_file, G_FILE_TEST_EXISTS) && !load_cache (cache, cache_file))
+    {
+        g_warning ("Ignoring invalid tag cache %s", cache_file);
+        cache->files.clear();
+        cache->strings.clear();
+        cache->string_offsets.clear();
+        cache->clock = 0;
+    }
+
+    ++cache->clock;
+
+    return cache;
+}
+
+
+inline bool used_later (const pair<const FileKey,CachedFile> *a, const pair<const FileKey,CachedFile> *b)
+{
+    return a->second.used>b->second.used;
+}
+
+
+static gint write_cache (TagCache *cache, const gchar *cache_file)
+{
+    vector<const pair<const FileKey,CachedFile> *> kept;
+
+    for (map<FileKey,CachedFile>::const_iterator i=cache->files.begin(); i!=cache->files.end(); ++i)
+        kept.push_back(&*i);
+
+    if (kept.size()>TAG_CACHE_MAX_FILES)
+    {
+        nth_element (kept.begin(), kept.begin()+TAG_CACHE_MAX_FILES, kept.end(), used_later);
+        kept.resize(TAG_CACHE_MAX_FILES);
+    }
+
+    // the strings of the files dropped are left out
+    vector<CacheFile> files;
+    vector<CacheValue> values;
+    string strings;
+    map<guint32,guint32> new_offsets;
+
+    for (vector<const pair<const FileKey,CachedFile> *>::const_iterator i=kept.begin(); i!=kept.end(); ++i)
+    {
+        const CachedFile &cached = (*i)->second;
+        CacheFile file;
+
+        file.dev = (*i)->first.first;
+        file.ino = (*i)->first.second;
+        file.size = cached.size;
+        file.mtime = cached.mtime;
+        file.used = cached.used;
+        file.parsers = cached.parsers;
+        file.first_value = values.size();
+        file.n_values = cached.values.size();
+
+        for (vector<CacheValue>::const_iterator v=cached.values.begin(); v!=cached.values.end(); ++v)
+        {
+            CacheValue value = *v;
+            guint32 *offsets[] = {&value.name, &value.value};
+
+            for (guint j=0; j<G_N_ELEMENTS(offsets); ++j)
+            {
+                map<guint32,guint32>::const_iterator o = new_offsets.find(*offsets[j]);
+
+                if (o==new_offsets.end())
+                {
+                    const gchar *s = cache->strings.c_str() + *offsets[j];
+                    o = new_offsets.insert(make_pair(*offsets[j], (guint32) strings.size())).first;
+                    strings.append(s, strlen (s) + 1);
+                }
+
+                *offsets[j] = o->second;
+            }
+
+            values.push_back(value);
+        }
+
+        files.push_back(file);
+    }
+
+    if (strings.size()>G_MAXUINT32 || values.size()>G_MAXUINT32)
+        return EFBIG;
+
+    CacheHeader h;
+
+    memcpy (h.magic, CACHE_MAGIC, sizeof(h.magic));
+    h.n_files = files.size();
+    h.n_values = values.size();
+    h.strings_size = strings.size();
+    h.clock = cache->clock;
+
+    gchar *tmp_file = g_strconcat (cache_file, ".XXXXXX", NULL);
+    gint fd = mkstemp (tmp_file);
+
+    if (fd<0)
+    {
+        gint err = errno;
+        g_free (tmp_file);
+        return err;
+    }
+
+    FILE *f = fdopen (fd, "wb");
+    gint err = 0;
+
+    if (!f)
+    {
+        err = errno;
+        close (fd);
+    }
+    else
+    {
+        errno = 0;
+
+        if (fwrite (&h, sizeof(h), 1, f)!=1 ||
+            (h.n_files && fwrite (&files[0], sizeof(CacheFile), h.n_files, f)!=h.n_files) ||
+            (h.n_values && fwrite (&values[0], sizeof(CacheValue), h.n_values, f)!=h.n_values) ||
+            fwrite (strings.data(), 1, h.strings_size, f)!=h.strings_size)
+            err = errno ? errno : EIO;
+
+        if (fclose (f)!=0 && !err)
+            err = errno;
+    }
+
+    if (!err && rename (tmp_file, cache_file)!=0)
+        err = errno;
+
+    if (err)
+        unlink (tmp_file);
+
+    g_free (tmp_file);
+
+    return err;
+}
+
+
+gint tag_cache_save (TagCache *cache, const gchar *cache_file)
+{
+    g_return_val_if_fail (cache != NULL, EINVAL);
+    g_return_val_if_fail (cache_file != NULL, EINVAL);
+
+    g_mutex_lock (&cache->lock);
+
+    gint err = cache->changed ? write_cache (cache, cache_file) : 0;
+
+    if (!err)
+        cache->changed = FALSE;
+
+    g_mutex_unlock (&cache->lock);
+
+    return err;
+}
+
+
+void tag_cache_free (TagCache *cache)
+{
+    if (!cache)
+        return;
+
+    g_mutex_clear (&cache->lock);
+    delete cache;
+}
+
+
+guint tag_cache_size (TagCache *cache)
+{
+    g_return_val_if_fail (cache != NULL, 0);
+
+    g_mutex_lock (&cache->lock);
+    guint n = cache->files.size();
+    g_mutex_unlock (&cache->lock);
+
+    return n;
+}
+
+
+/**
+ * Returns the cached file @a st is about if it is still the same, the
+ * cache must be locked.
+ */
+static CachedFile *find_file (TagCache *cache, const struct stat &st)
+{
+    map<FileKey,CachedFile>::iterator i = cache->files.find(FileKey(st.st_dev, st.st_ino));
+
+    if (i==cache->files.end())
+        return NULL;
+
+    CachedFile &file = i->second;
+
+    if (file.size!=(guint64) st.st_size || file.mtime!=mtime_nsec (st))
+        return NULL;
+
+    file.used = cache->clock;
+
+    return &file;
+}
+
+
+gboolean tag_cache_lookup (TagCache *cache, const struct stat &st, guint parser, TagCacheValues &values)
+{
+    g_return_val_if_fail (cache != NULL, FALSE);
+
+    g_mutex_lock (&cache->lock);
+
+    CachedFile *file = find_file (cache, st);
+    gboolean found = file && (file->parsers & parser)==parser;
+
+    if (found)
+        for (vector<CacheValue>::const_iterator i=file->values.begin(); i!=file->values.end(); ++i)
+            if (i->parser & parser)
+                values.push_back(make_pair(string(cache->strings.c_str() + i->name), string(cache->strings.c_str() + i->value)));
+
+    g_mutex_unlock (&cache->lock);
+
+    return found;
+}
+
+
+void tag_cache_store (TagCache *cache, const struct stat &st, guint parser, const TagCacheValues &values)
+{
+    g_return_if_fail (cache != NULL);
+
+    g_mutex_lock (&cache->lock);
+
+    CachedFile *file = find_file (cache, st);
+
+    if (!file)
+    {
+        // a new file, or a new version of it
+        file = &cache->files[FileKey(st.st_dev, st.st_ino)];
+        file->size = st.st_size;
+        file->mtime = mtime_nsec (st);
+        file->used = cache->clock;
+        file->parsers = 0;
+        file->values.clear();
+    }
+
+    if (file->parsers & parser)
+    {
+        vector<CacheValue>::iterator end = file->values.begin();
+
+        for (vector<CacheValue>::const_iterator i=file->values.begin(); i!=file->values.end(); ++i)
+            if (!(i->parser & parser))
+                *end++ = *i;
+
+        file->values.erase(end, file->values.end());
+    }
+
+    file->parsers |= parser;
+
+    for (TagCacheValues::const_iterator i=values.begin(); i!=values.end(); ++i)
+    {
+        CacheValue value;
+
+        value.parser = parser;
+        value.name = cache->add_string(i->first);
+        value.value = cache->add_string(i->second);
+        file->values.push_back(value);
+    }
+
+    cache->changed = TRUE;
+
+    g_mutex_unlock (&cache->lock);
+}
+
+
+static void read_file (ReadTask *task, TagCacheJob *job)
+{
+    struct stat st;
+
+    if (!g_atomic_int_get (&job->cancelled) && stat (task->path, &st)==0 && S_ISREG (st.st_mode))
+        for (guint parser=1; parser && parser<=task->parsers; parser<<=1)
+        {
+            if (!(task->parsers & parser))
+                continue;
+
+            TagCacheValues values;
+
+            if (tag_cache_lookup (job->cache, st, parser, values))
+                continue;
+
+            job->read (task->path, parser, values);
+            tag_cache_store (job->cache, st, parser, values);
+        }
+
+    g_mutex_lock (&job->lock);
+    ++job->done;
+    g_mutex_unlock (&job->lock);
+
+    g_free (task->path);
+    g_free (task);
+}
+
+
+TagCacheJob *tag_cache_job_new (TagCache *cache, TagCacheReadFunc read)
+{
+    g_return_val_if_fail (cache != NULL, NULL);
+    g_return_val_if_fail (read != NULL, NULL);
+
+    TagCacheJob *job = g_new0 (TagCacheJob, 1);
+
+    job->cache = cache;
+    job->read = read;
+
+    g_mutex_init (&job->lock);
+
+    job->pool = g_thread_pool_new ((GFunc) read_file, job, TAG_CACHE_THREADS, FALSE, NULL);
+
+    return job;
+}
+
+
+void tag_cache_job_add (TagCacheJob *job, const gchar *path, guint parsers)
+{
+    g_return_if_fail (job != NULL);
+    g_return_if_fail (path != NULL);
+
+    if (!parsers)
+        return;
+
+    ReadTask *task = g_new (ReadTask, 1);
+
+    task->path = g_strdup (path);
+    task->parsers = parsers;
+
+    g_mutex_lock (&job->lock);
+    ++job->total;
+    g_mutex_unlock (&job->lock);
+
+    g_thread_pool_push (job->pool, task, NULL);
+}
+
+
+gboolean tag_cache_job_get_progress (TagCacheJob *job, guint *done, guint *total)
+{
+    g_return_val_if_fail (job != NULL, TRUE);
+
+    g_mutex_lock (&job->lock);
+
+    if (done)
+        *done = job->done;
+    if (total)
+        *total = job->total;
+
+    gboolean finished = job->done==job->total;
+
+    g_mutex_unlock (&job->lock);
+
+    return finished;
+}
+
+
+void tag_cache_job_free (TagCacheJob *job)
+{
+    if (!job)
+        return;
+
+    // the files left are only counted, not read
+    g_atomic_int_set (&job->cancelled, TRUE);
+    g_thread_pool_free (job->pool, FALSE, TRUE);
+
+    g_mutex_clear (&job->lock);
+    g_free (job);
+}
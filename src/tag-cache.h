@@ -0,0 +1,118 @@
+/**
+ * @file tag-cache.h
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#define TAG_CACHE_MAX_FILES     100000          // the files used least recently are dropped beyond that
+#define TAG_CACHE_THREADS       4
+
+/**
+ * A cache of the metadata tags read from files, kept across sessions.
+ *
+ * Files are known by their device and inode, and their tags are only
+ * trusted while their size and modification time stay the same. Tags are
+ * kept for each parser separately, a parser is one bit chosen by the
+ * caller, and so is the fact that a parser found nothing. Tag names and
+ * values are stored once in a string table, as most of them repeat from
+ * file to file.
+ *
+ * All functions may be called from any thread.
+ */
+struct TagCache;
+
+/**
+ * Reads the tags of files into a TagCache in the background, with a
+ * bounded thread pool.
+ */
+struct TagCacheJob;
+
+typedef std::vector<std::pair<std::string,std::string> > TagCacheValues;     // tag names and their values
+
+/**
+ * Reads the tags @a parser finds in @a path into @a values. Called by the
+ * workers of a TagCacheJob, so it must be thread safe.
+ */
+typedef void (* TagCacheReadFunc) (const gchar *path, guint parser, TagCacheValues &values);
+
+/**
+ * Loads the cache kept in @a cache_file. The cache is empty if the file
+ * doesn't exist or isn't valid.
+ */
+TagCache *tag_cache_open (const gchar *cache_file);
+
+/**
+ * Writes the cache to @a cache_file if anything was added since it was
+ * opened, keeping the TAG_CACHE_MAX_FILES files used most recently. The
+ * file is replaced atomically.
+ *
+ * @returns 0 on success, an errno value otherwise
+ */
+gint tag_cache_save (TagCache *cache, const gchar *cache_file);
+
+void tag_cache_free (TagCache *cache);
+
+/**
+ * Returns the number of files in the cache.
+ */
+guint tag_cache_size (TagCache *cache);
+
+/**
+ * Stores the tags @a parser found in the file @a st is about in
+ * @a values, and returns TRUE, if the cache has them for this version of
+ * the file.
+ */
+gboolean tag_cache_lookup (TagCache *cache, const struct stat &st, guint parser, TagCacheValues &values);
+
+/**
+ * Keeps the tags @a parser found in the file @a st is about, which may be
+ * none.
+ */
+void tag_cache_store (TagCache *cache, const struct stat &st, guint parser, const TagCacheValues &values);
+
+/**
+ * Starts a job reading tags into @a cache with @a read.
+ */
+TagCacheJob *tag_cache_job_new (TagCache *cache, TagCacheReadFunc read);
+
+/**
+ * Queues @a path to be read by the parsers in the bit mask @a parsers,
+ * unless the cache has their tags already.
+ */
+void tag_cache_job_add (TagCacheJob *job, const gchar *path, guint parsers);
+
+/**
+ * Stores the number of files done and queued in @a done and @a total,
+ * both may be NULL. Returns TRUE once all queued files are done.
+ */
+gboolean tag_cache_job_get_progress (TagCacheJob *job, guint *done, guint *total);
+
+/**
+ * Drops the files not read yet and waits for the ones being read, then
+ * frees the job. What was read stays in the cache.
+ */
+void tag_cache_job_free (TagCacheJob *job);
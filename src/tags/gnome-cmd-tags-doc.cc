@@ -477,25 +477,10 @@ void gcmd_tags_libgsf_shutdown()
 }
 
 
-void gcmd_tags_libgsf_load_metadata(GnomeCmdFile *f)
+void gcmd_tags_libgsf_read_metadata(const gchar *fname, GnomeCmdFileMetadata &metadata)
 {
-    g_return_if_fail (f != NULL);
-    g_return_if_fail (f->info != NULL);
-
 #ifdef HAVE_GSF
-    if (f->metadata && f->metadata->is_accessed(TAG_DOC))  return;
-
-    if (!f->metadata)
-        f->metadata = new GnomeCmdFileMetadata;
-
-    if (!f->metadata)  return;
-
-    f->metadata->mark_as_accessed(TAG_DOC);
-
-    if (!f->is_local())  return;
-
     GError *err = NULL;
-    gchar *fname = f->get_real_path();
 
     DEBUG('t', "Loading doc metadata for '%s'\n", fname);
 
@@ -508,19 +493,16 @@ void gcmd_tags_libgsf_load_metadata(GnomeCmdFile *f)
         g_return_if_fail (err != NULL);
         g_warning ("'%s' error: %s", fname, err->message);
         g_error_free (err);
-        g_free (fname);
         return;
     }
 
-    g_free (fname);
-
     GsfInfile *infile = NULL;
 
     if ((infile = gsf_infile_msole_new (input, NULL)))
-        process_msole_infile(infile, f->metadata);
+        process_msole_infile(infile, &metadata);
     else
         if ((infile = gsf_infile_zip_new (input, NULL)))
-            process_opendoc_infile(infile, f->metadata);
+            process_opendoc_infile(infile, &metadata);
 
     if (infile)
         g_object_unref (infile);
@@ -531,3 +513,25 @@ void gcmd_tags_libgsf_load_metadata(GnomeCmdFile *f)
     g_object_unref (input);
 #endif
 }
+
+
+void gcmd_tags_libgsf_load_metadata(GnomeCmdFile *f)
+{
+    g_return_if_fail (f != NULL);
+    g_return_if_fail (f->info != NULL);
+
+#ifdef HAVE_GSF
+    if (f->metadata && f->metadata->is_accessed(TAG_DOC))  return;
+
+    if (!f->metadata)
+        f->metadata = new GnomeCmdFileMetadata;
+
+    if (!f->metadata)  return;
+
+    f->metadata->mark_as_accessed(TAG_DOC);
+
+    if (!f->is_local())  return;
+
+    gcmd_tags_load_cached(f, TAG_PARSER_LIBGSF);
+#endif
+}
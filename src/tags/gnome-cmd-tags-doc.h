@@ -27,4 +27,5 @@
 void gcmd_tags_libgsf_init();
 void gcmd_tags_libgsf_shutdown();
 
+void gcmd_tags_libgsf_read_metadata(const gchar *fname, GnomeCmdFileMetadata &metadata);
 void gcmd_tags_libgsf_load_metadata(GnomeCmdFile *f);
@@ -33,6 +33,10 @@
 #ifdef HAVE_EXIV2
 #include <exiv2/exif.hpp>
 #include <exiv2/image.hpp>
+#include <exiv2/version.hpp>
+#if EXIV2_TEST_VERSION(0,16,0)
+#include <exiv2/xmp.hpp>
+#endif
 #endif
 
 using namespace std;
@@ -368,32 +372,17 @@ void gcmd_tags_exiv2_init()
                    };
 
     load_data (exiv2_tags, exiv2_data, G_N_ELEMENTS(exiv2_data));
+
+#if EXIV2_TEST_VERSION(0,16,0)
+    // the XMP toolkit isn't thread safe until it is set up, and the tag cache reads files in a pool of threads
+    XmpParser::initialize();
+#endif
 #endif
 }
 
 
-void gcmd_tags_exiv2_load_metadata(GnomeCmdFile *f)
+void gcmd_tags_exiv2_read_metadata(const gchar *fname, GnomeCmdFileMetadata &metadata)
 {
-    g_return_if_fail (f != NULL);
-    g_return_if_fail (f->info != NULL);
-
-    if (f->metadata && f->metadata->is_accessed(TAG_IMAGE))  return;
-
-    if (!f->metadata)
-        f->metadata = new GnomeCmdFileMetadata;
-
-    if (!f->metadata)  return;
-
-    f->metadata->mark_as_accessed(TAG_IMAGE);
-#ifdef HAVE_EXIV2
-    f->metadata->mark_as_accessed(TAG_EXIF);
-    f->metadata->mark_as_accessed(TAG_IPTC);
-#endif
-
-    if (!f->is_local())  return;
-
-    gchar *fname = f->get_real_path();
-
     DEBUG('t', "Loading image metadata for '%s'\n", fname);
 
 #ifdef HAVE_EXIV2
@@ -403,8 +392,8 @@ void gcmd_tags_exiv2_load_metadata(GnomeCmdFile *f)
 
         image->readMetadata();
 
-        readTags(f->metadata, image->exifData());
-        readTags(f->metadata, image->iptcData());
+        readTags(&metadata, image->exifData());
+        readTags(&metadata, image->iptcData());
     }
 
     catch (AnyError &e)
@@ -415,11 +404,33 @@ void gcmd_tags_exiv2_load_metadata(GnomeCmdFile *f)
     gint width, height;
     GdkPixbufFormat *fmt = gdk_pixbuf_get_file_info (fname, &width, &height);
 
-    g_free (fname);
-
     if (!fmt)
         return;
 
-    f->metadata->addf (TAG_IMAGE_WIDTH, "%i", width);
-    f->metadata->addf (TAG_IMAGE_HEIGHT, "%i", height);
+    metadata.addf (TAG_IMAGE_WIDTH, "%i", width);
+    metadata.addf (TAG_IMAGE_HEIGHT, "%i", height);
+}
+
+
+void gcmd_tags_exiv2_load_metadata(GnomeCmdFile *f)
+{
+    g_return_if_fail (f != NULL);
+    g_return_if_fail (f->info != NULL);
+
+    if (f->metadata && f->metadata->is_accessed(TAG_IMAGE))  return;
+
+    if (!f->metadata)
+        f->metadata = new GnomeCmdFileMetadata;
+
+    if (!f->metadata)  return;
+
+    f->metadata->mark_as_accessed(TAG_IMAGE);
+#ifdef HAVE_EXIV2
+    f->metadata->mark_as_accessed(TAG_EXIF);
+    f->metadata->mark_as_accessed(TAG_IPTC);
+#endif
+
+    if (!f->is_local())  return;
+
+    gcmd_tags_load_cached(f, TAG_PARSER_EXIV2);
 }
@@ -27,4 +27,5 @@
 void gcmd_tags_exiv2_init();
 inline void gcmd_tags_exiv2_shutdown()      {}
 
+void gcmd_tags_exiv2_read_metadata(const gchar *fname, GnomeCmdFileMetadata &metadata);
 void gcmd_tags_exiv2_load_metadata(GnomeCmdFile *f);
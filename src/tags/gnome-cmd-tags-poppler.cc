@@ -121,34 +121,13 @@ static gchar *paper_name (gdouble doc_width, double doc_height)
 #endif
 
 
-void gcmd_tags_poppler_load_metadata(GnomeCmdFile *f)
+void gcmd_tags_poppler_read_metadata(const gchar *fname, GnomeCmdFileMetadata &metadata)
 {
-    g_return_if_fail (f != NULL);
-    g_return_if_fail (f->info != NULL);
-
 #ifdef HAVE_PDF
-    if (f->metadata && f->metadata->is_accessed(TAG_PDF))  return;
-
-    if (!f->metadata)
-        f->metadata = new GnomeCmdFileMetadata;
-
-    if (!f->metadata)  return;
-
-    f->metadata->mark_as_accessed(TAG_PDF);
-
-    if (!f->is_local())  return;
-
-    // skip non pdf files, as pdf metatags extraction is very expensive...
-    if (f->info->mime_type == NULL) return;
-    if (!strstr (f->info->mime_type, "pdf"))  return;
-
-    gchar *fname = f->get_real_path();
-
     DEBUG('t', "Loading PDF metadata for '%s'\n", fname);
 
     GError *error = NULL;
     gchar *uri = g_filename_to_uri(fname, NULL, &error);
-    g_free (fname);
 
     if (error)
     {
@@ -160,16 +139,11 @@ void gcmd_tags_poppler_load_metadata(GnomeCmdFile *f)
     if (error)
     {
         if (error->code == POPPLER_ERROR_ENCRYPTED)
-        {
-            f->metadata->mark_as_accessed(TAG_DOC);
-            f->metadata->addf(TAG_DOC_SECURITY, "%u", 1);
-        }
+            metadata.addf(TAG_DOC_SECURITY, "%u", 1);
 	g_error_free(error);
         return;
     }
 
-    f->metadata->mark_as_accessed(TAG_DOC);
-
     gchar *title, *author, *subject, *keywords, *creator, *producer;
     gchar *str;
     GTime creation_date, mod_date;
@@ -189,49 +163,49 @@ void gcmd_tags_poppler_load_metadata(GnomeCmdFile *f)
                  "format-minor", &format_minor,
                  NULL);
 
-    f->metadata->addf(TAG_PDF_VERSION, "%u.%u", format_major, format_minor);
+    metadata.addf(TAG_PDF_VERSION, "%u.%u", format_major, format_minor);
 
-    f->metadata->addf(TAG_DOC_PAGECOUNT, "%i", poppler_document_get_n_pages(document));
+    metadata.addf(TAG_DOC_PAGECOUNT, "%i", poppler_document_get_n_pages(document));
 
-    f->metadata->addf(TAG_PDF_OPTIMIZED, "%u", poppler_document_is_linearized(document));
+    metadata.addf(TAG_PDF_OPTIMIZED, "%u", poppler_document_is_linearized(document));
 
-    f->metadata->addf(TAG_DOC_SECURITY, "%u", 0);
+    metadata.addf(TAG_DOC_SECURITY, "%u", 0);
 
-    f->metadata->addf(TAG_PDF_PRINTING, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_PRINT));
-    f->metadata->addf(TAG_PDF_MODIFYING, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_MODIFY));
-    f->metadata->addf(TAG_PDF_COPYING, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_COPY));
-    f->metadata->addf(TAG_PDF_COMMENTING, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_ADD_NOTES));
-    f->metadata->addf(TAG_PDF_FORMFILLING, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_FILL_FORM));
-    f->metadata->addf(TAG_PDF_HIRESPRINTING, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_PRINT_HIGH_RESOLUTION));
-    f->metadata->addf(TAG_PDF_DOCASSEMBLY, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_ASSEMBLE));
-    f->metadata->addf(TAG_PDF_ACCESSIBILITYSUPPORT, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_EXTRACT_CONTENTS));
+    metadata.addf(TAG_PDF_PRINTING, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_PRINT));
+    metadata.addf(TAG_PDF_MODIFYING, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_MODIFY));
+    metadata.addf(TAG_PDF_COPYING, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_COPY));
+    metadata.addf(TAG_PDF_COMMENTING, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_ADD_NOTES));
+    metadata.addf(TAG_PDF_FORMFILLING, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_FILL_FORM));
+    metadata.addf(TAG_PDF_HIRESPRINTING, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_PRINT_HIGH_RESOLUTION));
+    metadata.addf(TAG_PDF_DOCASSEMBLY, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_ASSEMBLE));
+    metadata.addf(TAG_PDF_ACCESSIBILITYSUPPORT, "%u", enum_bit_to_01(permissions, POPPLER_PERMISSIONS_OK_TO_EXTRACT_CONTENTS));
 
-    f->metadata->add(TAG_DOC_TITLE, title);
+    metadata.add(TAG_DOC_TITLE, title);
     g_free(title);
 
-    f->metadata->add(TAG_DOC_SUBJECT, subject);
+    metadata.add(TAG_DOC_SUBJECT, subject);
     g_free(subject);
 
     // FIXME:  split keywords here
-    f->metadata->add(TAG_DOC_KEYWORDS, keywords);
-    f->metadata->add(TAG_FILE_KEYWORDS, keywords);
+    metadata.add(TAG_DOC_KEYWORDS, keywords);
+    metadata.add(TAG_FILE_KEYWORDS, keywords);
     g_free(keywords);
 
-    f->metadata->add(TAG_DOC_AUTHOR, author);
-    f->metadata->add(TAG_FILE_PUBLISHER, author);
+    metadata.add(TAG_DOC_AUTHOR, author);
+    metadata.add(TAG_FILE_PUBLISHER, author);
     g_free(author);
 
-    f->metadata->add(TAG_PDF_PRODUCER, creator);
+    metadata.add(TAG_PDF_PRODUCER, creator);
     g_free(creator);
 
-    f->metadata->add(TAG_DOC_GENERATOR, producer);
+    metadata.add(TAG_DOC_GENERATOR, producer);
     g_free(producer);
 
     str = pgd_format_date (creation_date);
-    f->metadata->add(TAG_DOC_DATECREATED, str);
+    metadata.add(TAG_DOC_DATECREATED, str);
 
     str = pgd_format_date (mod_date);
-    f->metadata->add(TAG_DOC_DATEMODIFIED, str);
+    metadata.add(TAG_DOC_DATEMODIFIED, str);
 
     g_free (str);
 
@@ -244,12 +218,12 @@ void gcmd_tags_poppler_load_metadata(GnomeCmdFile *f)
         double width = page_width/72.0f*25.4f;
         double height = page_height/72.0f*25.4f;
 
-        f->metadata->addf(TAG_PDF_PAGEWIDTH, "%.0f", width);
-        f->metadata->addf(TAG_PDF_PAGEHEIGHT, "%.0f", height);
+        metadata.addf(TAG_PDF_PAGEWIDTH, "%.0f", width);
+        metadata.addf(TAG_PDF_PAGEHEIGHT, "%.0f", height);
 
         gchar *paper_size = paper_name (width, height);
 
-        f->metadata->add(TAG_PDF_PAGESIZE, paper_size);
+        metadata.add(TAG_PDF_PAGESIZE, paper_size);
 
 	g_object_unref(page);
         g_free (paper_size);
@@ -259,15 +233,44 @@ void gcmd_tags_poppler_load_metadata(GnomeCmdFile *f)
     {
 	GList *list = poppler_document_get_attachments(document);
 
-        f->metadata->addf(TAG_PDF_EMBEDDEDFILES, "%u", g_list_length(list));
+        metadata.addf(TAG_PDF_EMBEDDEDFILES, "%u", g_list_length(list));
 
         g_list_free_full(list, g_object_unref);
     }
     else
     {
-        f->metadata->addf(TAG_PDF_EMBEDDEDFILES, "%u", 0);
+        metadata.addf(TAG_PDF_EMBEDDEDFILES, "%u", 0);
     }
 
     g_object_unref(document);
 #endif
 }
+
+
+void gcmd_tags_poppler_load_metadata(GnomeCmdFile *f)
+{
+    g_return_if_fail (f != NULL);
+    g_return_if_fail (f->info != NULL);
+
+#ifdef HAVE_PDF
+    if (f->metadata && f->metadata->is_accessed(TAG_PDF))  return;
+
+    if (!f->metadata)
+        f->metadata = new GnomeCmdFileMetadata;
+
+    if (!f->metadata)  return;
+
+    f->metadata->mark_as_accessed(TAG_PDF);
+
+    if (!f->is_local())  return;
+
+    // skip non pdf files, as pdf metatags extraction is very expensive...
+    const gchar *mime_type = f->get_mime_type();
+    if (mime_type == NULL) return;
+    if (!strstr (mime_type, "pdf"))  return;
+
+    // nothing is found in documents that couldn't be opened
+    if (gcmd_tags_load_cached(f, TAG_PARSER_POPPLER))
+        f->metadata->mark_as_accessed(TAG_DOC);
+#endif
+}
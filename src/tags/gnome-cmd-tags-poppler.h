@@ -22,5 +22,7 @@
 #pragma once
 
 #include "gnome-cmd-file.h"
+#include "gnome-cmd-tags.h"
 
+void gcmd_tags_poppler_read_metadata(const gchar *fname, GnomeCmdFileMetadata &metadata);
 void gcmd_tags_poppler_load_metadata(GnomeCmdFile *f);
@@ -436,6 +436,22 @@ void gcmd_tags_taglib_init()
 }
 
 
+void gcmd_tags_taglib_read_metadata(const gchar *fname, GnomeCmdFileMetadata &metadata)
+{
+#ifdef HAVE_ID3
+    DEBUG('t', "Loading audio metadata for '%s'\n", fname);
+
+    TagLib::FileRef f(fname, true, TagLib::AudioProperties::Accurate);
+
+    if (f.isNull())
+        return;
+
+    getAudioProperties(metadata, f.audioProperties());
+    getTag(metadata, f.file(), f.tag());
+#endif
+}
+
+
 void gcmd_tags_taglib_load_metadata(GnomeCmdFile *finfo)
 {
     g_return_if_fail (finfo != NULL);
@@ -457,16 +473,6 @@ void gcmd_tags_taglib_load_metadata(GnomeCmdFile *finfo)
 
     if (!finfo->is_local())  return;
 
-    const gchar *fname = finfo->get_real_path();
-
-    DEBUG('t', "Loading audio metadata for '%s'\n", fname);
-
-    TagLib::FileRef f(fname, true, TagLib::AudioProperties::Accurate);
-
-    if (f.isNull())
-        return;
-
-    getAudioProperties(*finfo->metadata, f.audioProperties());
-    getTag(*finfo->metadata, f.file(), f.tag());
+    gcmd_tags_load_cached(finfo, TAG_PARSER_TAGLIB);
 #endif
 }
@@ -22,8 +22,10 @@
 #pragma once
 
 #include "gnome-cmd-file.h"
+#include "gnome-cmd-tags.h"
 
 void gcmd_tags_taglib_init();
 inline void gcmd_tags_taglib_shutdown()     {}
 
+void gcmd_tags_taglib_read_metadata(const gchar *fname, GnomeCmdFileMetadata &metadata);
 void gcmd_tags_taglib_load_metadata(GnomeCmdFile *f);
@@ -23,6 +23,8 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
+#include <sys/stat.h>
 
 #include <vector>
 
@@ -33,6 +35,7 @@
 #include "gnome-cmd-tags-taglib.h"
 #include "gnome-cmd-tags-doc.h"
 #include "gnome-cmd-tags-poppler.h"
+#include "gnome-cmd-data.h"
 #include "utils.h"
 #include "dict.h"
 
@@ -57,6 +60,8 @@ static GnomeCmdTagName TAG_NONE_NAME = {"", TAG_NONE_CLASS, "", ""};
 
 static DICT<GnomeCmdTag,GnomeCmdTagName> metatags(TAG_NONE, TAG_NONE_NAME);
 
+static TagCache *tag_cache = NULL;
+
 
 static char empty_string[] = "";
 
@@ -81,7 +86,7 @@ static char no_support_for_poppler_tags_string[] = N_("<PDF tags not supported>"
 
 void GnomeCmdFileMetadata::addf(const GnomeCmdTag tag, const gchar *fmt, ...)
 {
-    static vector<char> buff(16);
+    vector<char> buff(64);
 
     va_list args;
 
@@ -107,6 +112,49 @@ void GnomeCmdFileMetadata::addf(const GnomeCmdTag tag, const gchar *fmt, ...)
 }
 
 
+inline gchar *tag_cache_file()
+{
+    return config_dir ? g_build_filename (config_dir, "tag-cache", NULL) : g_build_filename (g_get_home_dir (), "." PACKAGE, "tag-cache", NULL);
+}
+
+
+/**
+ * Reads the tags @a parser finds in the local file @a path. Called by the
+ * workers prefetching tags as well, so the parsers only fill a metadata
+ * object of their own.
+ */
+static void read_tags(const gchar *path, guint parser, TagCacheValues &values)
+{
+    GnomeCmdFileMetadata metadata;
+
+    switch (parser)
+    {
+        case TAG_PARSER_EXIV2:
+            gcmd_tags_exiv2_read_metadata(path, metadata);
+            break;
+
+        case TAG_PARSER_TAGLIB:
+            gcmd_tags_taglib_read_metadata(path, metadata);
+            break;
+
+        case TAG_PARSER_LIBGSF:
+            gcmd_tags_libgsf_read_metadata(path, metadata);
+            break;
+
+        case TAG_PARSER_POPPLER:
+            gcmd_tags_poppler_read_metadata(path, metadata);
+            break;
+
+        default:
+            break;
+    }
+
+    for (GnomeCmdFileMetadata::METADATA_COLL::const_iterator i=metadata.begin(); i!=metadata.end(); ++i)
+        if (i->tag!=TAG_NONE)
+            values.push_back(make_pair(string(gcmd_tags_get_name(i->tag)), string(metadata.value(*i))));
+}
+
+
 void gcmd_tags_init()
 {
     static struct
@@ -548,11 +596,25 @@ void gcmd_tags_init()
     gcmd_tags_exiv2_init();
     gcmd_tags_taglib_init();
     gcmd_tags_libgsf_init();
+
+    gchar *path = tag_cache_file();
+    tag_cache = tag_cache_open (path);
+    g_free (path);
 }
 
 
 void gcmd_tags_shutdown()
 {
+    gchar *path = tag_cache_file();
+    gint err = tag_cache_save (tag_cache, path);
+
+    if (err)
+        g_warning ("Couldn't save the tag cache %s: %s", path, g_strerror (err));
+
+    g_free (path);
+    tag_cache_free (tag_cache);
+    tag_cache = NULL;
+
     gcmd_tags_exiv2_shutdown();
     gcmd_tags_taglib_shutdown();
     gcmd_tags_libgsf_shutdown();
@@ -573,6 +635,81 @@ GnomeCmdFileMetadata *gcmd_tags_bulk_load(GnomeCmdFile *f)
 }
 
 
+gboolean gcmd_tags_load_cached(GnomeCmdFile *f, const GnomeCmdTagParser parser)
+{
+    g_return_val_if_fail (f != NULL, FALSE);
+    g_return_val_if_fail (f->metadata != NULL, FALSE);
+
+    gchar *fname = f->get_real_path();
+    TagCacheValues values;
+    struct stat st;
+
+    if (!tag_cache || stat (fname, &st)!=0)
+        read_tags(fname, parser, values);
+    else
+        if (!tag_cache_lookup (tag_cache, st, parser, values))
+        {
+            read_tags(fname, parser, values);
+            tag_cache_store (tag_cache, st, parser, values);
+        }
+
+    g_free (fname);
+
+    for (TagCacheValues::const_iterator i=values.begin(); i!=values.end(); ++i)
+        f->metadata->add(gcmd_tags_get_tag_by_name(i->first.c_str()), i->second);
+
+    return !values.empty();
+}
+
+
+TagCacheJob *gcmd_tags_prefetch(GList *files, const int tag_classes)
+{
+    if (!tag_cache || tag_classes==TAG_FILE)
+        return NULL;
+
+    guint parsers = 0;
+    guint pdf_parsers = 0;
+
+    // the image size is read without Exiv2 as well
+    if (tag_classes & TAG_IMAGE)
+        parsers |= TAG_PARSER_EXIV2;
+#ifdef HAVE_ID3
+    if (tag_classes & TAG_AUDIO)
+        parsers |= TAG_PARSER_TAGLIB;
+#endif
+#ifdef HAVE_GSF
+    if (tag_classes & TAG_DOC)
+        parsers |= TAG_PARSER_LIBGSF;
+#endif
+#ifdef HAVE_PDF
+    if (tag_classes & (TAG_DOC | TAG_PDF))
+        pdf_parsers = TAG_PARSER_POPPLER;
+#endif
+
+    if (!parsers && !pdf_parsers)
+        return NULL;
+
+    TagCacheJob *job = tag_cache_job_new (tag_cache, read_tags);
+
+    for (GList *i = files; i; i = i->next)
+    {
+        GnomeCmdFile *f = (GnomeCmdFile *) i->data;
+
+        if (!f->is_local() || f->info->type!=GNOME_VFS_FILE_TYPE_REGULAR)
+            continue;
+
+        // as when they are loaded, only pdf files are given to poppler
+        const gchar *mime_type = pdf_parsers ? f->get_mime_type() : NULL;
+        gchar *fname = f->get_real_path();
+
+        tag_cache_job_add (job, fname, mime_type && strstr (mime_type, "pdf") ? parsers | pdf_parsers : parsers);
+        g_free (fname);
+    }
+
+    return job;
+}
+
+
 GnomeCmdTag gcmd_tags_get_tag_by_name(const gchar *tag_name, const GnomeCmdTagClass tag_class)
 {
     GnomeCmdTagName t;
@@ -820,5 +957,37 @@ void GnomeCmdFileMetadata::add (const GnomeCmdTag tag, std::string value)
 
     value.erase(string_end+1);
 
-    metadata[tag].insert(value);
+    // the values are kept as C strings
+    value.resize(strlen (value.c_str()));
+
+    if (value.empty())
+        return;
+
+    METADATA_COLL::iterator pos = std::lower_bound (metadata.begin(), metadata.end(), tag);
+
+    for (; pos!=metadata.end() && pos->tag==tag; ++pos)
+    {
+        gint cmp = strcmp (this->value(*pos), value.c_str());
+
+        if (cmp==0)
+            return;
+
+        if (cmp>0)
+            break;
+    }
+
+    Tag t = {tag, (guint32) strings.size()};
+
+    // a value the file has for another tag already is kept once
+    for (METADATA_COLL::const_iterator i=metadata.begin(); i!=metadata.end(); ++i)
+        if (strcmp (this->value(*i), value.c_str())==0)
+        {
+            t.value = i->value;
+            break;
+        }
+
+    if (t.value==strings.size())
+        strings.append(value.c_str(), value.size() + 1);
+
+    metadata.insert(pos, t);
 }
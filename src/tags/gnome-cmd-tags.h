@@ -22,11 +22,12 @@
 #pragma once
 
 #include <string>
-#include <map>
-#include <set>
+#include <vector>
+#include <algorithm>
 #include <sstream>
 
 #include "gnome-cmd-file.h"
+#include "tag-cache.h"
 #include "utils.h"
 
 enum GnomeCmdTagClass
@@ -480,11 +481,35 @@ enum GnomeCmdTag
 };
 
 
+enum GnomeCmdTagParser                      // the libraries tags are read with, as they are kept in the tag cache
+{
+    TAG_PARSER_EXIV2    = 1 << 0,
+    TAG_PARSER_TAGLIB   = 1 << 1,
+    TAG_PARSER_LIBGSF   = 1 << 2,
+    TAG_PARSER_POPPLER  = 1 << 3
+};
+
+
 void gcmd_tags_init();
 void gcmd_tags_shutdown();
 
 GnomeCmdFileMetadata *gcmd_tags_bulk_load(GnomeCmdFile *f);
 
+/**
+ * gcmd_tags_load_cached() adds the tags @a parser finds in the local file
+ * @a f to its metadata. They are taken from the tag cache unless the file
+ * changed since they were read. Returns FALSE if there are none.
+ */
+gboolean gcmd_tags_load_cached(GnomeCmdFile *f, const GnomeCmdTagParser parser);
+
+/**
+ * gcmd_tags_prefetch() starts reading the tags of @a tag_classes for the
+ * local files in @a files, a list of GnomeCmdFile *, into the tag cache in
+ * the background, so that loading them later is quick. The job must be
+ * freed with tag_cache_job_free(), it is NULL if there is nothing to read.
+ */
+TagCacheJob *gcmd_tags_prefetch(GList *files, const int tag_classes);
+
 const gchar *gcmd_tags_get_name(const GnomeCmdTag tag);
 GnomeCmdTagClass gcmd_tags_get_class(const GnomeCmdTag tag);
 const gchar *gcmd_tags_get_class_name(const GnomeCmdTag tag);
@@ -514,29 +539,37 @@ inline const gchar *gcmd_tags_get_value_by_name(GnomeCmdFile *f, const gchar *ta
 }
 
 
+/**
+ * The tags of a file. They are kept in a vector sorted by tag and value,
+ * and the values in a single string of their own, each value once. This
+ * takes two allocations per file, however many tags it has.
+ */
 class GnomeCmdFileMetadata
 {
   public:
 
-    typedef std::map<GnomeCmdTag,std::set<std::string> >   METADATA_COLL;
+    struct Tag
+    {
+        GnomeCmdTag tag;
+        guint32 value;                                              // offset of the value in the strings
+    };
 
-  private:
+    typedef std::vector<Tag> METADATA_COLL;                         // a tag may have several values
 
-    typedef std::map<GnomeCmdTagClass,gboolean>  ACCESSED_COLL;
+  private:
 
-    ACCESSED_COLL accessed;
+    guint32 accessed;                                               // the class_bit() of the tag classes read already
     METADATA_COLL metadata;
+    std::string strings;
 
-    const std::string NODATA;
+    static guint32 class_bit (const GnomeCmdTagClass tag_class);
 
   public:
 
-    GnomeCmdFileMetadata() {}
+    GnomeCmdFileMetadata(): accessed(0) {}
 
-    gboolean is_accessed (const GnomeCmdTagClass tag_class) const;
-    gboolean is_accessed (const GnomeCmdTag tag) const;
-    void mark_as_accessed (const GnomeCmdTagClass tag_class)        {  accessed[tag_class] = TRUE;  }
-    void mark_as_accessed (const GnomeCmdTag tag);
+    gboolean is_accessed (const GnomeCmdTagClass tag_class) const   {  return (accessed & class_bit(tag_class))!=0;  }
+    void mark_as_accessed (const GnomeCmdTagClass tag_class)        {  accessed |= class_bit(tag_class);  }
 
     void add (const GnomeCmdTag tag, std::string value);
     void add (const GnomeCmdTag tag, const gchar *value);
@@ -547,22 +580,37 @@ class GnomeCmdFileMetadata
 #else
     void addf (const GnomeCmdTag tag, const gchar *fmt, ...);
 #endif
-    gboolean has_tag (const GnomeCmdTag tag);
+    gboolean has_tag (const GnomeCmdTag tag) const;
 
-    const std::string operator[] (const GnomeCmdTag tag);
+    const gchar *value (const Tag &t) const                         {  return strings.c_str() + t.value;  }
+    const std::string operator[] (const GnomeCmdTag tag) const;
 
-    METADATA_COLL::const_iterator begin()                           {  return metadata.begin();     }
-    METADATA_COLL::const_iterator end()                             {  return metadata.end();       }
+    METADATA_COLL::const_iterator begin() const                     {  return metadata.begin();     }
+    METADATA_COLL::const_iterator end() const                       {  return metadata.end();       }
 };
 
 
-inline gboolean GnomeCmdFileMetadata::is_accessed (const GnomeCmdTagClass tag_class) const
+inline bool operator < (const GnomeCmdFileMetadata::Tag &t, const GnomeCmdTag tag)
 {
-    ACCESSED_COLL::const_iterator elem = accessed.find(tag_class);
+    return t.tag<tag;
+}
 
-    return elem==accessed.end() ? FALSE : elem->second;
+
+inline guint32 GnomeCmdFileMetadata::class_bit (const GnomeCmdTagClass tag_class)
+{
+    //  the classes made of others, and TAG_FILE, get the bits below TAG_CHM
+    switch (tag_class)
+    {
+        case TAG_NONE_CLASS:    return 1 << 0;
+        case TAG_FILE:          return 1 << 1;
+        case TAG_AUDIO:         return 1 << 2;
+        case TAG_DOC:           return 1 << 3;
+        case TAG_IMAGE:         return 1 << 4;
+        default:                return tag_class;
+    }
 }
 
+
 inline void GnomeCmdFileMetadata::add (const GnomeCmdTag tag, const gchar *value)
 {
     if (value && *value)
@@ -580,17 +628,24 @@ void GnomeCmdFileMetadata::add (const GnomeCmdTag tag, const T &value)
 }
 
 
-inline gboolean GnomeCmdFileMetadata::has_tag (const GnomeCmdTag tag)
+inline gboolean GnomeCmdFileMetadata::has_tag (const GnomeCmdTag tag) const
 {
-    METADATA_COLL::const_iterator pos = metadata.find(tag);
+    METADATA_COLL::const_iterator pos = std::lower_bound (metadata.begin(), metadata.end(), tag);
 
-    return pos!=metadata.end();
+    return pos!=metadata.end() && pos->tag==tag;
 }
 
 
-inline const std::string GnomeCmdFileMetadata::operator[] (const GnomeCmdTag tag)
+inline const std::string GnomeCmdFileMetadata::operator[] (const GnomeCmdTag tag) const
 {
-    METADATA_COLL::const_iterator pos = metadata.find(tag);
+    std::string s;
+
+    for (METADATA_COLL::const_iterator pos = std::lower_bound (metadata.begin(), metadata.end(), tag); pos!=metadata.end() && pos->tag==tag; ++pos)
+    {
+        if (!s.empty())
+            s += ", ";
+        s += value(*pos);
+    }
 
-    return pos==metadata.end() ? NODATA : join(pos->second, ", ");
+    return s;
 }
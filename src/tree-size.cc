@@ -0,0 +1,368 @@
+/**
+ * @file tree-size.cc
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "local-fs.h"
+#include "tree-size.h"
+
+using namespace std;
+
+
+struct TreeSizeJob
+{
+    GMutex lock;
+    GCond done_cond;
+    gint pending;               // directories queued or being read, the job is done when it drops to 0, under lock
+    gint cancelled;
+
+    guint64 bytes;
+    guint64 files;
+};
+
+
+struct TreeSizeTask
+{
+    TreeSizeJob *job;
+    gchar *path;
+};
+
+
+typedef pair<dev_t, ino_t> DirKey;
+
+
+struct DirTotals
+{
+    gint64 mtime;               // in nanoseconds
+    guint64 bytes;              // of the entries that aren't directories
+    guint64 files;              // the entries that aren't directories
+    vector<string> subdirs;
+};
+
+
+static GMutex cache_lock;
+static map<DirKey, DirTotals> cache;
+static GThreadPool *pool = NULL;
+
+
+inline gint64 mtime_nsec (const struct stat &st)
+{
+    return (gint64) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+
+static gboolean lookup_cached (const DirKey &key, gint64 mtime, DirTotals &totals)
+{
+    g_mutex_lock (&cache_lock);
+
+    map<DirKey, DirTotals>::iterator i = cache.find(key);
+    gboolean found = i!=cache.end() && i->second.mtime==mtime;
+
+    if (found)
+        totals = i->second;
+
+    g_mutex_unlock (&cache_lock);
+
+    return found;
+}
+
+
+static void store_cached (const DirKey &key, DirTotals &totals)
+{
+    g_mutex_lock (&cache_lock);
+
+    // plain and simple: start over once it's full
+    if (cache.size()>=TREE_SIZE_CACHE_MAX)
+        cache.clear();
+
+    cache[key] = totals;
+
+    g_mutex_unlock (&cache_lock);
+}
+
+
+static gboolean read_dir (gint dirfd, TreeSizeJob *job, DirTotals &totals)
+{
+    DIR *dir = fdopendir (dirfd);
+
+    if (!dir)
+    {
+        close (dirfd);
+        return FALSE;
+    }
+
+    while (struct dirent *d = readdir (dir))
+    {
+        if (g_atomic_int_get (&job->cancelled))
+        {
+            closedir (dir);
+            return FALSE;
+        }
+
+        if (is_dot_or_dotdot (d->d_name))
+            continue;
+
+#ifdef _DIRENT_HAVE_D_TYPE
+        if (d->d_type==DT_DIR)
+        {
+            totals.subdirs.push_back(d->d_name);
+            continue;
+        }
+#endif
+
+        struct stat st;
+
+        if (fstatat (dirfd, d->d_name, &st, AT_SYMLINK_NOFOLLOW)!=0)
+            continue;
+
+        if (S_ISDIR (st.st_mode))
+            totals.subdirs.push_back(d->d_name);
+        else
+        {
+            totals.bytes += st.st_size;
+            totals.files++;
+        }
+    }
+
+    closedir (dir);
+
+    return TRUE;
+}
+
+
+static void push_dir (TreeSizeJob *job, gchar *path)
+{
+    TreeSizeTask *task = g_new (TreeSizeTask, 1);
+
+    task->job = job;
+    task->path = path;
+
+    g_mutex_lock (&job->lock);
+    job->pending++;
+    g_mutex_unlock (&job->lock);
+
+    g_thread_pool_push (pool, task, NULL);
+}
+
+
+/**
+ * The waiter frees the job as soon as it sees it done, which it can
+ * only do once the lock is released here, so this is the last time the
+ * job is touched.
+ */
+static void task_done (TreeSizeJob *job)
+{
+    g_mutex_lock (&job->lock);
+
+    if (--job->pending==0)
+        g_cond_broadcast (&job->done_cond);
+
+    g_mutex_unlock (&job->lock);
+}
+
+
+static void size_dir (TreeSizeJob *job, const gchar *path)
+{
+    gint dirfd = open (path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (dirfd<0)
+        return;
+
+    struct stat st;
+
+    if (fstat (dirfd, &st)!=0)
+    {
+        close (dirfd);
+        return;
+    }
+
+    DirKey key(st.st_dev, st.st_ino);
+    DirTotals totals;
+    gint64 mtime = mtime_nsec (st);
+
+    if (lookup_cached (key, mtime, totals))
+        close (dirfd);
+    else
+    {
+        totals.mtime = mtime;
+        totals.bytes = 0;
+        totals.files = 0;
+
+        if (!read_dir (dirfd, job, totals))
+            return;
+
+        if (mtime < g_get_real_time () * 1000 - LOCAL_FS_RACY_NSEC)
+            store_cached (key, totals);
+    }
+
+    g_mutex_lock (&job->lock);
+    job->bytes += totals.bytes;
+    job->files += totals.files + 1;         // the directory itself counts too
+    g_mutex_unlock (&job->lock);
+
+    for (vector<string>::iterator i=totals.subdirs.begin(); i!=totals.subdirs.end(); ++i)
+        push_dir (job, g_build_filename (path, i->c_str(), NULL));
+}
+
+
+static void run_task (TreeSizeTask *task, gpointer unused)
+{
+    TreeSizeJob *job = task->job;
+
+    if (!g_atomic_int_get (&job->cancelled))
+        size_dir (job, task->path);
+
+    g_free (task->path);
+    g_free (task);
+
+    task_done (job);
+}
+
+
+TreeSizeJob *tree_size_job_new (GList *paths)
+{
+    TreeSizeJob *job = g_new0 (TreeSizeJob, 1);
+
+    g_mutex_init (&job->lock);
+    g_cond_init (&job->done_cond);
+
+    g_mutex_lock (&cache_lock);
+    if (!pool)
+        pool = g_thread_pool_new ((GFunc) run_task, NULL, CLAMP (g_get_num_processors () * 2, 4, TREE_SIZE_THREADS_MAX), FALSE, NULL);
+    g_mutex_unlock (&cache_lock);
+
+    // held until everything is queued, so that the job can't be done in between
+    job->pending = 1;
+
+    for (GList *i=paths; i; i=i->next)
+    {
+        const gchar *path = (const gchar *) i->data;
+        struct stat st;
+
+        if (stat (path, &st)!=0)
+            continue;
+
+        if (S_ISDIR (st.st_mode))
+            push_dir (job, g_strdup (path));
+        else
+        {
+            lstat (path, &st);
+
+            g_mutex_lock (&job->lock);
+            job->bytes += st.st_size;
+            job->files++;
+            g_mutex_unlock (&job->lock);
+        }
+    }
+
+    task_done (job);
+
+    return job;
+}
+
+
+gboolean tree_size_job_get (TreeSizeJob *job, guint64 *bytes, guint64 *files)
+{
+    g_return_val_if_fail (job != NULL, TRUE);
+
+    g_mutex_lock (&job->lock);
+
+    if (bytes)
+        *bytes = job->bytes;
+    if (files)
+        *files = job->files;
+
+    gboolean done = job->pending==0;
+
+    g_mutex_unlock (&job->lock);
+
+    return done;
+}
+
+
+void tree_size_job_cancel (TreeSizeJob *job)
+{
+    g_return_if_fail (job != NULL);
+
+    g_atomic_int_set (&job->cancelled, TRUE);
+}
+
+
+void tree_size_job_wait (TreeSizeJob *job)
+{
+    g_return_if_fail (job != NULL);
+
+    g_mutex_lock (&job->lock);
+
+    while (job->pending)
+        g_cond_wait (&job->done_cond, &job->lock);
+
+    g_mutex_unlock (&job->lock);
+}
+
+
+void tree_size_job_free (TreeSizeJob *job)
+{
+    if (!job)
+        return;
+
+    // the queued tasks still point to the job
+    tree_size_job_cancel (job);
+    tree_size_job_wait (job);
+
+    g_mutex_clear (&job->lock);
+    g_cond_clear (&job->done_cond);
+    g_free (job);
+}
+
+
+guint64 tree_size_calc (const gchar *path, guint64 *files)
+{
+    GList *paths = g_list_append (NULL, (gpointer) path);
+    TreeSizeJob *job = tree_size_job_new (paths);
+    guint64 bytes = 0;
+
+    tree_size_job_wait (job);
+    tree_size_job_get (job, &bytes, files);
+    tree_size_job_free (job);
+
+    g_list_free (paths);
+
+    return bytes;
+}
+
+
+void tree_size_cache_clear ()
+{
+    g_mutex_lock (&cache_lock);
+    cache.clear();
+    g_mutex_unlock (&cache_lock);
+}
@@ -0,0 +1,81 @@
+/**
+ * @file tree-size.h
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#define TREE_SIZE_THREADS_MAX  16
+#define TREE_SIZE_CACHE_MAX    (256 * 1024)
+
+/**
+ * Sums up the sizes of local directory trees in the background.
+ *
+ * The directories are read by a thread pool shared by all jobs, so a job
+ * never blocks its caller, and the totals found so far can be polled at
+ * any time, e.g. from a g_timeout_add() handler. What was read from each
+ * directory is cached by its device, inode and modification time, so
+ * asking again for the same or an overlapping tree only reads the
+ * directories that changed since; the unchanged ones just get a stat().
+ *
+ * The totals are those of calc_tree_size(): the apparent sizes of all
+ * files, symbolic links are not followed, and every directory counts as
+ * one file.
+ */
+struct TreeSizeJob;
+
+/**
+ * Starts summing up the trees below the local paths in @a paths, a list
+ * of gchar *. Paths that aren't directories count as single files.
+ */
+TreeSizeJob *tree_size_job_new (GList *paths);
+
+/**
+ * Stores the totals found so far in @a bytes and @a files, which may be
+ * NULL. Returns TRUE once the job is done.
+ */
+gboolean tree_size_job_get (TreeSizeJob *job, guint64 *bytes, guint64 *files);
+
+/**
+ * Stops reading directories as soon as possible, the totals stay where
+ * they are.
+ */
+void tree_size_job_cancel (TreeSizeJob *job);
+
+/**
+ * Waits until the job is done. Cancel it first to return quickly.
+ */
+void tree_size_job_wait (TreeSizeJob *job);
+
+/**
+ * Cancels the job if it is still running and frees it.
+ */
+void tree_size_job_free (TreeSizeJob *job);
+
+/**
+ * Sums up the tree below @a path and waits for the result.
+ */
+guint64 tree_size_calc (const gchar *path, guint64 *files=NULL);
+
+/**
+ * Forgets everything read so far.
+ */
+void tree_size_cache_clear ();
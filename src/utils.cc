@@ -32,6 +32,7 @@
 #include "gnome-cmd-data.h"
 #include "imageloader.h"
 #include "gnome-cmd-main-win.h"
+#include "tree-size.h"
 
 using namespace std;
 
@@ -470,6 +471,22 @@ GnomeVFSFileSize calc_tree_size (const GnomeVFSURI *dir_uri, gulong *count)
 
     g_return_val_if_fail (dir_uri_str != NULL, -1);
 
+    // local trees are read natively, in parallel and from the cache of unchanged directories
+    if (gnome_vfs_uri_is_local (dir_uri))
+        if (gchar *path = gnome_vfs_get_local_path_from_uri (dir_uri_str))
+        {
+            guint64 files = 0;
+            GnomeVFSFileSize size = tree_size_calc (path, &files);
+
+            if (count!=NULL)
+                *count += files;
+
+            g_free (path);
+            g_free (dir_uri_str);
+
+            return size;
+        }
+
     GList *list = NULL;
     GnomeVFSFileSize size = 0;
 
@@ -711,7 +728,7 @@ gboolean app_needs_terminal (GnomeCmdFile *f)
 {
     gboolean need_term = TRUE;
 
-    if (strcmp (f->info->mime_type, "application/x-executable") && strcmp (f->info->mime_type, "application/x-executable-binary"))
+    if (!f->has_mime_type("application/x-executable") && !f->has_mime_type("application/x-executable-binary"))
         return need_term;
 
     GList *libs = app_get_linked_libs (f);
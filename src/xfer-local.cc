@@ -0,0 +1,1250 @@
+/**
+ * @file xfer-local.cc
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+#include "local-fs.h"
+#include "xfer-local.h"
+#include "xfer-resume.h"
+
+using namespace std;
+
+
+#define COPY_BUFFER_MIN  (64 * 1024)
+
+
+/**
+ * A directory being copied. It is done once all its entries are, then it
+ * gets its permissions and times and, for a move, its source is removed.
+ * The roots stand for the directories holding the top level paths.
+ */
+struct XferDir
+{
+    XferDir *parent;            // NULL for the roots
+    gchar *src;
+    gchar *dest;
+    gint pending;               // entries not done yet, plus one while the directory is read
+    gint keep_src;              // something below was skipped or failed
+    gboolean created;           // FALSE if merged with an existing directory
+    gint depth;                 // directories above it copied into by the same worker
+    mode_t mode;
+    struct timespec times[2];
+};
+
+
+struct XferTask
+{
+    XferDir *dir;
+    gchar *src_name;
+    gchar *dest_name;
+};
+
+
+struct XferLocalJob
+{
+    GThreadPool *pool;
+    gboolean move;
+    gboolean follow_links;
+    gboolean checksums;         // for the chunks of large files
+
+    gint pending;               // roots not done yet, plus one while the job is started
+    gint cancelled;
+    gint cross_device;          // renaming failed once, so don't try again
+    gint no_clone;              // the same for cloning
+    gint no_copy_range;         // and for copy_file_range()
+    gint paused;
+
+    GMutex lock;                // for everything below
+    GCond done_cond;
+    GCond pause_cond;
+
+    XferLocalOverwriteMode overwrite_mode;
+
+    guint64 bytes_copied;
+    guint64 files_done;
+    guint cur_id;
+    gchar *cur_file;
+    guint64 cur_size;
+    guint64 cur_copied;
+    XferStats stats;
+
+    GMutex ask_lock;            // one question at a time
+    GCond answer_cond;
+    XferLocalQuestion question;
+    gchar *question_src;
+    gchar *question_dest;
+    gint question_error;
+    gint answer;
+};
+
+
+typedef gint (*CreateFunc) (XferLocalJob *job, const gchar *src, const gchar *dest, const struct stat &st);
+
+
+static void copy_entry (XferLocalJob *job, XferDir *dir, const gchar *name, const gchar *dest_name);
+
+
+inline gboolean is_cancelled (XferLocalJob *job)
+{
+    return g_atomic_int_get (&job->cancelled);
+}
+
+
+/**
+ * Holds the worker while the job is paused, the file it is copying stays
+ * open meanwhile.
+ */
+inline void wait_while_paused (XferLocalJob *job)
+{
+    if (!g_atomic_int_get (&job->paused))
+        return;
+
+    g_mutex_lock (&job->lock);
+
+    while (g_atomic_int_get (&job->paused) && !is_cancelled (job))
+        g_cond_wait (&job->pause_cond, &job->lock);
+
+    g_mutex_unlock (&job->lock);
+}
+
+
+inline void count_file (XferLocalJob *job)
+{
+    g_mutex_lock (&job->lock);
+    job->files_done++;
+    g_mutex_unlock (&job->lock);
+}
+
+
+/**
+ * Adds the time since @a start to @a phase and returns the current time,
+ * so the next phase can start from there.
+ */
+inline gint64 add_time (XferLocalJob *job, XferPhase phase, gint64 start)
+{
+    gint64 now = g_get_monotonic_time ();
+
+    g_mutex_lock (&job->lock);
+    job->stats.phase_usec[phase] += now - start;
+    g_mutex_unlock (&job->lock);
+
+    return now;
+}
+
+
+inline void job_done_one (XferLocalJob *job)
+{
+    if (g_atomic_int_dec_and_test (&job->pending))
+    {
+        g_mutex_lock (&job->lock);
+        g_cond_broadcast (&job->done_cond);
+        g_mutex_unlock (&job->lock);
+    }
+}
+
+
+inline gint overwrite_mode_action (XferLocalOverwriteMode mode)
+{
+    switch (mode)
+    {
+        case XFER_LOCAL_OVERWRITE_MODE_REPLACE:
+            return XFER_LOCAL_OVERWRITE_ACTION_REPLACE;
+
+        case XFER_LOCAL_OVERWRITE_MODE_SKIP:
+            return XFER_LOCAL_OVERWRITE_ACTION_SKIP;
+
+        default:
+            return XFER_LOCAL_OVERWRITE_ACTION_ABORT;
+    }
+}
+
+
+/**
+ * Waits for the answer to a question. ABORT, which is 0 for both kinds of
+ * questions, cancels the job.
+ */
+static gint ask (XferLocalJob *job, XferLocalQuestion question, const gchar *src, const gchar *dest, gint error)
+{
+    g_mutex_lock (&job->ask_lock);
+    g_mutex_lock (&job->lock);
+
+    gint answer;
+
+    if (is_cancelled (job))
+        answer = 0;
+    else
+        if (question==XFER_LOCAL_QUESTION_OVERWRITE && job->overwrite_mode!=XFER_LOCAL_OVERWRITE_MODE_QUERY)
+            answer = overwrite_mode_action (job->overwrite_mode);      // answered "all" meanwhile
+        else
+        {
+            job->question = question;
+            job->question_src = g_strdup (src);
+            job->question_dest = g_strdup (dest);
+            job->question_error = error;
+            job->answer = -1;
+
+            while (job->answer<0 && !is_cancelled (job))
+                g_cond_wait (&job->answer_cond, &job->lock);
+
+            answer = is_cancelled (job) ? 0 : job->answer;
+
+            job->question = XFER_LOCAL_NO_QUESTION;
+            g_free (job->question_src);
+            g_free (job->question_dest);
+            job->question_src = job->question_dest = NULL;
+
+            if (question==XFER_LOCAL_QUESTION_OVERWRITE)
+            {
+                if (answer==XFER_LOCAL_OVERWRITE_ACTION_REPLACE_ALL)
+                    job->overwrite_mode = XFER_LOCAL_OVERWRITE_MODE_REPLACE;
+                if (answer==XFER_LOCAL_OVERWRITE_ACTION_SKIP_ALL)
+                    job->overwrite_mode = XFER_LOCAL_OVERWRITE_MODE_SKIP;
+            }
+        }
+
+    g_mutex_unlock (&job->lock);
+    g_mutex_unlock (&job->ask_lock);
+
+    if (answer==0)
+        xfer_local_job_cancel (job);
+
+    return answer;
+}
+
+
+/**
+ * Returns TRUE if @a dest, which is in the way of @a src, may be replaced.
+ */
+static gboolean may_replace (XferLocalJob *job, XferDir *dir, const gchar *src, const gchar *dest)
+{
+    switch (ask (job, XFER_LOCAL_QUESTION_OVERWRITE, src, dest, 0))
+    {
+        case XFER_LOCAL_OVERWRITE_ACTION_REPLACE:
+        case XFER_LOCAL_OVERWRITE_ACTION_REPLACE_ALL:
+            return TRUE;
+
+        default:
+            g_atomic_int_set (&dir->keep_src, TRUE);
+            return FALSE;
+    }
+}
+
+
+/**
+ * Returns TRUE if the failed operation should be tried again.
+ */
+static gboolean retry_after_error (XferLocalJob *job, XferDir *dir, const gchar *src, const gchar *dest, gint error)
+{
+    if (!is_cancelled (job) && ask (job, XFER_LOCAL_QUESTION_ERROR, src, dest, error)==XFER_LOCAL_ERROR_ACTION_RETRY)
+        return TRUE;
+
+    g_atomic_int_set (&dir->keep_src, TRUE);
+
+    return FALSE;
+}
+
+
+static guint start_file (XferLocalJob *job, const gchar *src, guint64 size)
+{
+    g_mutex_lock (&job->lock);
+
+    guint id = ++job->cur_id;
+
+    g_free (job->cur_file);
+    job->cur_file = g_strdup (src);
+    job->cur_size = size;
+    job->cur_copied = 0;
+
+    g_mutex_unlock (&job->lock);
+
+    return id;
+}
+
+
+static void add_progress (XferLocalJob *job, guint id, gint64 bytes)
+{
+    g_mutex_lock (&job->lock);
+
+    job->bytes_copied += bytes;
+
+    if (job->cur_id==id)
+        job->cur_copied += bytes;
+
+    g_mutex_unlock (&job->lock);
+}
+
+
+/**
+ * Copies all data from @a src_fd to @a dest_fd by sharing the extents on
+ * copy on write file systems, so nothing is copied at all. Returns FALSE
+ * if that isn't possible.
+ */
+static gboolean clone_data (XferLocalJob *job, guint id, gint src_fd, gint dest_fd, guint64 &copied)
+{
+#ifdef FICLONE
+    if (g_atomic_int_get (&job->no_clone))
+        return FALSE;
+
+    if (ioctl (dest_fd, FICLONE, src_fd)==0)
+    {
+        struct stat st;
+
+        if (fstat (dest_fd, &st)==0)
+        {
+            copied = st.st_size;
+            add_progress (job, id, copied);
+        }
+
+        return TRUE;
+    }
+
+    if (errno==EOPNOTSUPP || errno==ENOTTY || errno==EXDEV || errno==EINVAL || errno==ENOSYS)
+        g_atomic_int_set (&job->no_clone, TRUE);
+#endif
+
+    return FALSE;
+}
+
+
+/**
+ * Copies all data from @a src_fd to @a dest_fd and counts it in
+ * @a copied, returns 0 or an errno value.
+ */
+static gint copy_data (XferLocalJob *job, guint id, gint src_fd, gint dest_fd, guint64 size, guint64 &copied)
+{
+    if (size && clone_data (job, id, src_fd, dest_fd, copied))
+        return 0;
+
+    gboolean in_kernel = !g_atomic_int_get (&job->no_copy_range);
+    gchar *buf = NULL;
+    gsize buf_size = CLAMP (size, COPY_BUFFER_MIN, XFER_LOCAL_CHUNK_SIZE);
+    gint error = 0;
+
+    for (;;)
+    {
+        wait_while_paused (job);
+
+        if (is_cancelled (job))
+        {
+            error = ECANCELED;
+            break;
+        }
+
+        ssize_t n = -1;
+
+#ifdef SYS_copy_file_range
+        if (in_kernel)
+        {
+            n = syscall (SYS_copy_file_range, src_fd, NULL, dest_fd, NULL, (size_t) XFER_LOCAL_CHUNK_SIZE, 0);
+
+            // not across these file systems or not at all, copy through the buffer instead
+            if (n<0 && copied==0 && (errno==ENOSYS || errno==EXDEV || errno==EINVAL || errno==EOPNOTSUPP || errno==EPERM))
+            {
+                g_atomic_int_set (&job->no_copy_range, TRUE);
+                in_kernel = FALSE;
+                continue;
+            }
+        }
+        else
+#endif
+        {
+            if (!buf)
+                buf = (gchar *) g_malloc (buf_size);
+
+            n = read (src_fd, buf, buf_size);
+
+            for (ssize_t written=0; n>0 && written<n; )
+            {
+                ssize_t w = write (dest_fd, buf + written, n - written);
+
+                if (w<0 && errno!=EINTR)
+                {
+                    n = -1;
+                    break;
+                }
+
+                if (w>0)
+                    written += w;
+            }
+        }
+
+        if (n<0)
+        {
+            if (errno==EINTR)
+                continue;
+
+            error = errno;
+            break;
+        }
+
+        if (n==0)
+            break;
+
+        copied += n;
+        add_progress (job, id, n);
+
+        // saves asking for the end of small files, files of size 0 like in /proc are read up to their end
+        if (size && copied>=size)
+            break;
+    }
+
+    g_free (buf);
+
+    return error;
+}
+
+
+/**
+ * Copies the chunks of @a src_fd from @a copied on to @a part_fd, each
+ * at its own offset, and records them in @a journal.
+ */
+static gint copy_chunks (XferLocalJob *job, guint id, gint src_fd, gint part_fd, XferResumeJournal *journal,
+                         guint64 size, guint64 &copied)
+{
+    // checksums need the data, so it goes through the buffer then
+    gboolean checksums = xfer_resume_has_checksums (journal);
+    gboolean in_kernel = !checksums && !g_atomic_int_get (&job->no_copy_range);
+    gchar *buf = NULL;
+    gint error = 0;
+
+    while (!error && copied<size)
+    {
+        wait_while_paused (job);
+
+        if (is_cancelled (job))
+        {
+            error = ECANCELED;
+            break;
+        }
+
+        guint64 offset = copied;
+        gsize length = MIN (XFER_RESUME_CHUNK_SIZE, size - offset);
+        gsize done = 0;
+
+        while (done<length)
+        {
+            ssize_t n = -1;
+
+#ifdef SYS_copy_file_range
+            if (in_kernel)
+            {
+                gint64 src_offset = offset + done;          // loff_t for the kernel
+                gint64 dest_offset = offset + done;
+
+                n = syscall (SYS_copy_file_range, src_fd, &src_offset, part_fd, &dest_offset, length - done, 0);
+
+                if (n<0 && (errno==ENOSYS || errno==EXDEV || errno==EINVAL || errno==EOPNOTSUPP || errno==EPERM))
+                {
+                    g_atomic_int_set (&job->no_copy_range, TRUE);
+                    in_kernel = FALSE;
+                    continue;
+                }
+            }
+            else
+#endif
+            {
+                if (!buf)
+                    buf = (gchar *) g_malloc (XFER_RESUME_CHUNK_SIZE);
+
+                n = pread (src_fd, buf + done, length - done, offset + done);
+
+                for (ssize_t written=0; n>0 && written<n; )
+                {
+                    ssize_t w = pwrite (part_fd, buf + done + written, n - written, offset + done + written);
+
+                    if (w<0 && errno!=EINTR)
+                    {
+                        n = -1;
+                        break;
+                    }
+
+                    if (w>0)
+                        written += w;
+                }
+            }
+
+            if (n<0 && errno==EINTR)
+                continue;
+
+            if (n<=0)
+            {
+                error = n<0 ? errno : EAGAIN;       // shrunk meanwhile
+                break;
+            }
+
+            done += n;
+            copied += n;
+            add_progress (job, id, n);
+        }
+
+        if (!error)
+            error = xfer_resume_chunk_done (journal, part_fd, offset, checksums ? buf : NULL, length);
+    }
+
+    g_free (buf);
+
+    return error;
+}
+
+
+/**
+ * Copies a large file into its partial copy next to @a dest, continuing
+ * an earlier copy of the same file, and renames it to @a dest once it is
+ * complete. If the copy fails or is cancelled, the partial copy and its
+ * journal are kept for the next time, see XferResumeJournal.
+ */
+static gint copy_large_file (XferLocalJob *job, const gchar *src, const gchar *dest, const struct stat &st)
+{
+    gint64 start = g_get_monotonic_time ();
+    struct stat dest_st;
+
+    // asked about as for any other file, although it is only replaced at the end
+    if (lstat (dest, &dest_st)==0)
+    {
+        add_time (job, XFER_PHASE_CREATE, start);
+        return EEXIST;
+    }
+
+    gint src_fd = open (src, O_RDONLY | O_CLOEXEC | (job->follow_links ? 0 : O_NOFOLLOW));
+
+    if (src_fd<0)
+    {
+        gint error = errno;
+        add_time (job, XFER_PHASE_CREATE, start);
+        return error;
+    }
+
+    gchar *part = xfer_resume_part_path (dest);
+    gint part_fd = open (part, O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, 0600);
+    XferResumeJournal *journal = NULL;
+    guint64 copied = 0;
+    gint error = part_fd<0 ? errno : 0;
+
+    if (!error)
+    {
+        journal = xfer_resume_open (dest, st, job->checksums, src_fd, part_fd, &copied);
+
+        if (!journal)
+            error = errno;
+    }
+
+    gint64 t = add_time (job, XFER_PHASE_CREATE, start);
+    guint id = start_file (job, src, st.st_size);
+
+    if (!error)
+    {
+        // what was copied before counts as copied now
+        add_progress (job, id, copied);
+
+        if (copied || !clone_data (job, id, src_fd, part_fd, copied))
+            error = copy_chunks (job, id, src_fd, part_fd, journal, st.st_size, copied);
+    }
+
+    t = add_time (job, XFER_PHASE_COPY, t);
+
+    if (error)
+    {
+        xfer_resume_close (journal, part_fd, FALSE);
+
+        if (part_fd>=0)
+            close (part_fd);
+
+        if (!journal)
+            unlink (part);
+
+        add_progress (job, 0, - (gint64) copied);
+    }
+    else
+    {
+        struct timespec times[2] = {st.st_atim, st.st_mtim};
+
+        fchmod (part_fd, st.st_mode & 07777);
+        futimens (part_fd, times);
+
+        if (close (part_fd)!=0 || rename (part, dest)!=0)
+            error = errno;
+
+        xfer_resume_close (journal, -1, !error);
+
+        if (error)
+            add_progress (job, 0, - (gint64) copied);
+    }
+
+    close (src_fd);
+    g_free (part);
+
+    gint64 end = add_time (job, XFER_PHASE_FINISH, t);
+
+    if (!error)
+    {
+        g_mutex_lock (&job->lock);
+        xfer_stats_add_file (&job->stats, copied, end - start);
+        g_mutex_unlock (&job->lock);
+    }
+
+    return error;
+}
+
+
+static gint copy_file (XferLocalJob *job, const gchar *src, const gchar *dest, const struct stat &st)
+{
+    if (st.st_size>=XFER_RESUME_MIN_SIZE)
+        return copy_large_file (job, src, dest, st);
+
+    gint64 start = g_get_monotonic_time ();
+    gint src_fd = open (src, O_RDONLY | O_CLOEXEC | (job->follow_links ? 0 : O_NOFOLLOW));
+
+    if (src_fd<0)
+        return errno;
+
+    // only for the owner until it is complete
+    gint dest_fd = open (dest, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+
+    if (dest_fd<0)
+    {
+        gint error = errno;
+        close (src_fd);
+        add_time (job, XFER_PHASE_CREATE, start);
+        return error;
+    }
+
+    gint64 t = add_time (job, XFER_PHASE_CREATE, start);
+    guint64 copied = 0;
+    gint error = copy_data (job, start_file (job, src, st.st_size), src_fd, dest_fd, st.st_size, copied);
+
+    t = add_time (job, XFER_PHASE_COPY, t);
+
+    if (!error)
+    {
+        struct timespec times[2] = {st.st_atim, st.st_mtim};
+
+        fchmod (dest_fd, st.st_mode & 07777);
+        futimens (dest_fd, times);
+    }
+
+    if (close (dest_fd)!=0 && !error)
+        error = errno;
+
+    close (src_fd);
+
+    if (error)
+    {
+        unlink (dest);
+        add_progress (job, 0, - (gint64) copied);
+    }
+
+    gint64 end = add_time (job, XFER_PHASE_FINISH, t);
+
+    if (!error)
+    {
+        g_mutex_lock (&job->lock);
+        xfer_stats_add_file (&job->stats, copied, end - start);
+        g_mutex_unlock (&job->lock);
+    }
+
+    return error;
+}
+
+
+static gint copy_link (XferLocalJob *job, const gchar *src, const gchar *dest, const struct stat &st)
+{
+    gint64 start = g_get_monotonic_time ();
+    gchar *target = (gchar *) g_malloc (st.st_size + 1);
+    ssize_t n = readlink (src, target, st.st_size + 1);
+    gint error = 0;
+
+    if (n<0)
+        error = errno;
+    else
+        if (n>st.st_size)
+            error = EAGAIN;                 // changed meanwhile
+        else
+        {
+            struct timespec times[2] = {st.st_atim, st.st_mtim};
+
+            target[n] = '\0';
+
+            if (symlink (target, dest)==0)
+                utimensat (AT_FDCWD, dest, times, AT_SYMLINK_NOFOLLOW);
+            else
+                error = errno;
+        }
+
+    g_free (target);
+
+    add_time (job, XFER_PHASE_CREATE, start);
+
+    return error;
+}
+
+
+static gint copy_node (XferLocalJob *job, const gchar *src, const gchar *dest, const struct stat &st)
+{
+    gint64 start = g_get_monotonic_time ();
+    gint error = mknod (dest, st.st_mode, st.st_rdev)==0 ? 0 : errno;
+
+    if (!error)
+    {
+        struct timespec times[2] = {st.st_atim, st.st_mtim};
+
+        chmod (dest, st.st_mode & 07777);
+        utimensat (AT_FDCWD, dest, times, 0);
+    }
+
+    add_time (job, XFER_PHASE_CREATE, start);
+
+    return error;
+}
+
+
+/**
+ * Creates @a dest with @a create and asks before replacing what is in the
+ * way. Returns TRUE once it is created.
+ */
+static gboolean create_entry (XferLocalJob *job, XferDir *dir, const gchar *src, const gchar *dest, const struct stat &st,
+                              gboolean replace, CreateFunc create)
+{
+    for (;;)
+    {
+        gint error = create (job, src, dest, st);
+
+        if (!error)
+            return TRUE;
+
+        if (error==EEXIST)
+        {
+            if (!replace && !may_replace (job, dir, src, dest))
+                return FALSE;
+
+            replace = TRUE;
+
+            if (unlink (dest)==0 || errno==ENOENT)
+                continue;
+
+            error = errno;
+        }
+
+        if (!retry_after_error (job, dir, src, dest, error))
+            return FALSE;
+    }
+}
+
+
+/**
+ * Tries to move @a src by renaming it. Returns FALSE if it has to be
+ * copied instead, with @a replace telling if the target may be replaced.
+ */
+static gboolean rename_entry (XferLocalJob *job, XferDir *dir, const gchar *src, const gchar *dest, const struct stat &st,
+                              gboolean &replace)
+{
+    struct stat dest_st;
+    gint64 start = g_get_monotonic_time ();
+    gboolean found = lstat (dest, &dest_st)==0;
+
+    add_time (job, XFER_PHASE_CREATE, start);
+
+    if (found)
+    {
+        if (S_ISDIR (dest_st.st_mode) && S_ISDIR (st.st_mode))
+            return FALSE;                   // merged entry by entry
+
+        if (!may_replace (job, dir, src, dest))
+            return TRUE;
+
+        replace = TRUE;
+
+        // rename() replaces files and empty directories only with their own kind
+        if (S_ISDIR (st.st_mode) || S_ISDIR (dest_st.st_mode))
+            while (remove (dest)!=0 && errno!=ENOENT)
+            {
+                gint error = errno;
+
+                if (!retry_after_error (job, dir, src, dest, error))
+                    return TRUE;
+            }
+    }
+
+    for (;;)
+    {
+        start = g_get_monotonic_time ();
+        gint error = rename (src, dest)==0 ? 0 : errno;
+
+        add_time (job, XFER_PHASE_CREATE, start);
+
+        if (!error)
+        {
+            count_file (job);
+            return TRUE;
+        }
+
+        if (error==EXDEV)
+        {
+            g_atomic_int_set (&job->cross_device, TRUE);
+            return FALSE;
+        }
+
+        if (!retry_after_error (job, dir, src, dest, error))
+            return TRUE;
+    }
+}
+
+
+static XferDir *make_dir (XferLocalJob *job, XferDir *dir, gchar *src, gchar *dest, const struct stat &st, gboolean replace)
+{
+    gboolean created = TRUE;
+
+    for (;;)
+    {
+        // open for the owner until everything is copied in
+        gint64 start = g_get_monotonic_time ();
+        gint error = mkdir (dest, 0700)==0 ? 0 : errno;
+
+        add_time (job, XFER_PHASE_CREATE, start);
+
+        if (!error)
+            break;
+
+        if (error==EEXIST)
+        {
+            struct stat dest_st;
+
+            // a link to a directory is in the way like any other entry, the copy doesn't go through it
+            gboolean is_dir = lstat (dest, &dest_st)==0 && S_ISDIR (dest_st.st_mode);
+
+            // replacing a directory means merging into it, as with GnomeVFS
+            if (!replace && !may_replace (job, dir, src, dest))
+                return NULL;
+
+            replace = TRUE;
+
+            if (is_dir)
+            {
+                created = FALSE;
+                break;
+            }
+
+            if (unlink (dest)==0 || errno==ENOENT)
+                continue;
+
+            error = errno;
+        }
+
+        if (!retry_after_error (job, dir, src, dest, error))
+            return NULL;
+    }
+
+    XferDir *subdir = g_new0 (XferDir, 1);
+
+    subdir->parent = dir;
+    subdir->src = src;
+    subdir->dest = dest;
+    subdir->pending = 1;
+    subdir->created = created;
+    subdir->depth = dir->depth + 1;
+    subdir->mode = st.st_mode & 07777;
+    subdir->times[0] = st.st_atim;
+    subdir->times[1] = st.st_mtim;
+
+    count_file (job);
+
+    return subdir;
+}
+
+
+/**
+ * Gives the created directory @a dir the mode and times of its source.
+ * Returns 0 or the error.
+ */
+static gint set_dir_attributes (XferDir *dir)
+{
+    gint fd = open (dir->dest, O_RDONLY | O_DIRECTORY);
+
+    if (fd==-1)
+        return errno;
+
+    gint error = futimens (fd, dir->times)==0 && fchmod (fd, dir->mode)==0 ? 0 : errno;
+
+    close (fd);
+
+    return error;
+}
+
+
+static void finish_entry (XferLocalJob *job, XferDir *dir)
+{
+    if (!g_atomic_int_dec_and_test (&dir->pending))
+        return;
+
+    XferDir *parent = dir->parent;
+
+    if (parent)
+    {
+        gint64 start = g_get_monotonic_time ();
+
+        // even after a cancel, so that no directory is left open for the owner only
+        for (gint error; dir->created && (error = set_dir_attributes (dir)); )
+            if (!retry_after_error (job, parent, dir->src, dir->dest, error))
+                break;
+
+        if (job->move && !is_cancelled (job) && (g_atomic_int_get (&dir->keep_src) || rmdir (dir->src)!=0))
+            g_atomic_int_set (&parent->keep_src, TRUE);
+
+        add_time (job, XFER_PHASE_FINISH, start);
+    }
+
+    g_free (dir->src);
+    g_free (dir->dest);
+    g_free (dir);
+
+    if (parent)
+        finish_entry (job, parent);
+    else
+        job_done_one (job);
+}
+
+
+static void run_task (XferTask *task, XferLocalJob *job)
+{
+    wait_while_paused (job);
+
+    if (is_cancelled (job))
+        finish_entry (job, task->dir);
+    else
+        copy_entry (job, task->dir, task->src_name, task->dest_name);
+
+    g_free (task->src_name);
+    g_free (task->dest_name);
+    g_free (task);
+}
+
+
+static void push_entry (XferLocalJob *job, XferDir *dir, const gchar *name, const gchar *dest_name)
+{
+    XferTask *task = g_new (XferTask, 1);
+
+    task->dir = dir;
+    task->src_name = g_strdup (name);
+    task->dest_name = g_strdup (dest_name);
+
+    g_thread_pool_push (job->pool, task, NULL);
+}
+
+
+static void read_dir (XferLocalJob *job, XferDir *dir)
+{
+    DIR *d;
+    gint64 scan_usec = 0;       // the entries copied inline meanwhile have their own times
+
+    for (;;)
+    {
+        gint64 start = g_get_monotonic_time ();
+        d = opendir (dir->src);
+        gint error = d ? 0 : errno;
+        scan_usec += g_get_monotonic_time () - start;
+
+        if (d)
+            break;
+
+        if (!retry_after_error (job, dir, dir->src, NULL, error))
+            return;
+    }
+
+    for (;;)
+    {
+        gint64 start = g_get_monotonic_time ();
+        struct dirent *e = readdir (d);
+        scan_usec += g_get_monotonic_time () - start;
+
+        if (!e || is_cancelled (job))
+            break;
+
+        if (is_dot_or_dotdot (e->d_name))
+            continue;
+
+        g_atomic_int_inc (&dir->pending);
+
+        // the files found run far ahead of the copying, so the queue is kept short,
+        // unless the worker is already that deep in the tree
+        if (g_thread_pool_unprocessed (job->pool)<XFER_LOCAL_QUEUE_MAX || dir->depth>=XFER_LOCAL_DEPTH_MAX)
+            push_entry (job, dir, e->d_name, e->d_name);
+        else
+            copy_entry (job, dir, e->d_name, e->d_name);
+    }
+
+    closedir (d);
+
+    g_mutex_lock (&job->lock);
+    job->stats.phase_usec[XFER_PHASE_SCAN] += scan_usec;
+    g_mutex_unlock (&job->lock);
+}
+
+
+static void copy_entry (XferLocalJob *job, XferDir *dir, const gchar *name, const gchar *dest_name)
+{
+    gchar *src = g_build_filename (dir->src, name, NULL);
+    gchar *dest = g_build_filename (dir->dest, dest_name, NULL);
+    XferDir *subdir = NULL;
+    gboolean replace = FALSE;
+    gboolean found = TRUE;
+    struct stat st;
+
+    for (;;)
+    {
+        gint64 start = g_get_monotonic_time ();
+        gint error = (job->follow_links ? stat (src, &st) : lstat (src, &st))==0 ? 0 : errno;
+
+        add_time (job, XFER_PHASE_SCAN, start);
+
+        if (!error)
+            break;
+
+        if (!retry_after_error (job, dir, src, NULL, error))
+        {
+            found = FALSE;
+            break;
+        }
+    }
+
+    // a move within the file system is done with renaming
+    if (found && !is_cancelled (job) && !(job->move && !g_atomic_int_get (&job->cross_device) && rename_entry (job, dir, src, dest, st, replace)))
+    {
+        if (S_ISDIR (st.st_mode))
+            subdir = make_dir (job, dir, src, dest, st, replace);
+        else
+        {
+            CreateFunc create = S_ISREG (st.st_mode) ? copy_file :
+                                S_ISLNK (st.st_mode) ? copy_link : copy_node;
+
+            if (create_entry (job, dir, src, dest, st, replace, create))
+            {
+                while (job->move)
+                {
+                    gint64 start = g_get_monotonic_time ();
+                    gint error = unlink (src)==0 ? 0 : errno;
+
+                    add_time (job, XFER_PHASE_FINISH, start);
+
+                    if (!error || !retry_after_error (job, dir, src, NULL, error))
+                        break;
+                }
+
+                count_file (job);
+            }
+        }
+    }
+
+    if (subdir)
+    {
+        read_dir (job, subdir);
+        finish_entry (job, subdir);
+        return;
+    }
+
+    g_free (src);
+    g_free (dest);
+
+    finish_entry (job, dir);
+}
+
+
+XferLocalJob *xfer_local_job_new (GList *src_paths, GList *dest_paths, gboolean move, gboolean follow_links,
+                                  XferLocalOverwriteMode overwrite_mode, gboolean checksums)
+{
+    XferLocalJob *job = g_new0 (XferLocalJob, 1);
+
+    job->move = move;
+    job->follow_links = follow_links;
+    job->checksums = checksums;
+    job->overwrite_mode = overwrite_mode;
+    job->pending = 1;
+
+    g_mutex_init (&job->lock);
+    g_mutex_init (&job->ask_lock);
+    g_cond_init (&job->done_cond);
+    g_cond_init (&job->answer_cond);
+    g_cond_init (&job->pause_cond);
+
+    job->pool = g_thread_pool_new ((GFunc) run_task, job, XFER_LOCAL_THREADS, FALSE, NULL);
+
+    for (GList *i=src_paths, *j=dest_paths; i && j; i=i->next, j=j->next)
+    {
+        const gchar *src = (const gchar *) i->data;
+        const gchar *dest = (const gchar *) j->data;
+        XferDir *root = g_new0 (XferDir, 1);
+
+        root->src = g_path_get_dirname (src);
+        root->dest = g_path_get_dirname (dest);
+        root->pending = 1;
+
+        gchar *src_name = g_path_get_basename (src);
+        gchar *dest_name = g_path_get_basename (dest);
+
+        g_atomic_int_inc (&job->pending);
+        push_entry (job, root, src_name, dest_name);
+
+        g_free (src_name);
+        g_free (dest_name);
+    }
+
+    job_done_one (job);
+
+    return job;
+}
+
+
+gboolean xfer_local_job_get_progress (XferLocalJob *job, XferLocalProgress *progress)
+{
+    g_return_val_if_fail (job != NULL, TRUE);
+    g_return_val_if_fail (progress != NULL, TRUE);
+
+    g_mutex_lock (&job->lock);
+
+    progress->bytes_copied = job->bytes_copied;
+    progress->files_done = job->files_done;
+    progress->file_size = job->cur_size;
+    progress->file_bytes_copied = job->cur_copied;
+    progress->file = g_strdup (job->cur_file);
+    progress->stats = job->stats;
+
+    g_mutex_unlock (&job->lock);
+
+    return g_atomic_int_get (&job->pending)==0;
+}
+
+
+XferLocalQuestion xfer_local_job_get_question (XferLocalJob *job, gchar **src, gchar **dest, gint *error)
+{
+    g_return_val_if_fail (job != NULL, XFER_LOCAL_NO_QUESTION);
+
+    g_mutex_lock (&job->lock);
+
+    XferLocalQuestion question = job->answer<0 ? job->question : XFER_LOCAL_NO_QUESTION;
+
+    if (src)
+        *src = question ? g_strdup (job->question_src) : NULL;
+    if (dest)
+        *dest = question ? g_strdup (job->question_dest) : NULL;
+    if (error)
+        *error = job->question_error;
+
+    g_mutex_unlock (&job->lock);
+
+    return question;
+}
+
+
+void xfer_local_job_answer (XferLocalJob *job, gint answer)
+{
+    g_return_if_fail (job != NULL);
+    g_return_if_fail (answer >= 0);
+
+    g_mutex_lock (&job->lock);
+
+    if (job->question && job->answer<0)
+    {
+        job->answer = answer;
+        g_cond_broadcast (&job->answer_cond);
+    }
+
+    g_mutex_unlock (&job->lock);
+}
+
+
+gboolean xfer_local_job_aborted (XferLocalJob *job)
+{
+    g_return_val_if_fail (job != NULL, TRUE);
+
+    return is_cancelled (job);
+}
+
+
+void xfer_local_job_cancel (XferLocalJob *job)
+{
+    g_return_if_fail (job != NULL);
+
+    g_atomic_int_set (&job->cancelled, TRUE);
+
+    // wake up the worker waiting for an answer, and the paused ones
+    g_mutex_lock (&job->lock);
+    g_cond_broadcast (&job->answer_cond);
+    g_cond_broadcast (&job->pause_cond);
+    g_mutex_unlock (&job->lock);
+}
+
+
+void xfer_local_job_pause (XferLocalJob *job, gboolean pause)
+{
+    g_return_if_fail (job != NULL);
+
+    g_mutex_lock (&job->lock);
+    g_atomic_int_set (&job->paused, pause);
+    g_cond_broadcast (&job->pause_cond);
+    g_mutex_unlock (&job->lock);
+}
+
+
+void xfer_local_job_wait (XferLocalJob *job)
+{
+    g_return_if_fail (job != NULL);
+
+    g_mutex_lock (&job->lock);
+
+    while (g_atomic_int_get (&job->pending))
+        g_cond_wait (&job->done_cond, &job->lock);
+
+    g_mutex_unlock (&job->lock);
+}
+
+
+void xfer_local_job_free (XferLocalJob *job)
+{
+    if (!job)
+        return;
+
+    if (g_atomic_int_get (&job->pending))
+    {
+        xfer_local_job_cancel (job);
+        xfer_local_job_wait (job);
+    }
+
+    g_thread_pool_free (job->pool, FALSE, TRUE);
+
+    g_mutex_clear (&job->lock);
+    g_mutex_clear (&job->ask_lock);
+    g_cond_clear (&job->done_cond);
+    g_cond_clear (&job->answer_cond);
+    g_cond_clear (&job->pause_cond);
+
+    g_free (job->cur_file);
+    g_free (job);
+}
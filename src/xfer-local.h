@@ -0,0 +1,158 @@
+/**
+ * @file xfer-local.h
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "xfer-stats.h"
+
+#define XFER_LOCAL_THREADS      8
+#define XFER_LOCAL_QUEUE_MAX    4096            // files waiting for a worker, directory readers copy the rest themselves
+#define XFER_LOCAL_DEPTH_MAX    64              // directories copied into at once by a worker
+#define XFER_LOCAL_CHUNK_SIZE   (4 * 1024 * 1024)
+
+/**
+ * Copies or moves local files and directory trees natively.
+ *
+ * Directories are read and created by the same bounded thread pool that
+ * copies the files, so creating the target tree overlaps with copying
+ * the files already found, and many small files are copied at once.
+ * File data is cloned with FICLONE where the file system supports it,
+ * copied in the kernel with copy_file_range() otherwise, and only as a
+ * last resort read and written through a buffer. Moves within a file
+ * system are plain renames.
+ *
+ * Large files are copied in chunks recorded in a journal, so copying one
+ * again after it was cancelled or interrupted continues where it stopped,
+ * see XferResumeJournal.
+ *
+ * Permissions and times are kept, symbolic links are copied as links.
+ * Existing target directories are merged with the copied ones, once the
+ * overwrite mode or the answer to the question about them allows to
+ * replace them.
+ *
+ * The job never blocks its caller: progress is polled, and so are the
+ * questions about existing targets and errors, which a worker waits on
+ * until they are answered.
+ */
+struct XferLocalJob;
+
+// same values as GnomeVFSXferOverwriteMode
+enum XferLocalOverwriteMode
+{
+    XFER_LOCAL_OVERWRITE_MODE_ABORT,
+    XFER_LOCAL_OVERWRITE_MODE_QUERY,
+    XFER_LOCAL_OVERWRITE_MODE_REPLACE,
+    XFER_LOCAL_OVERWRITE_MODE_SKIP
+};
+
+enum XferLocalQuestion
+{
+    XFER_LOCAL_NO_QUESTION,
+    XFER_LOCAL_QUESTION_OVERWRITE,      // answered with an XferLocalOverwriteAction
+    XFER_LOCAL_QUESTION_ERROR           // answered with an XferLocalErrorAction
+};
+
+// same values as GnomeVFSXferOverwriteAction
+enum XferLocalOverwriteAction
+{
+    XFER_LOCAL_OVERWRITE_ACTION_ABORT,
+    XFER_LOCAL_OVERWRITE_ACTION_REPLACE,
+    XFER_LOCAL_OVERWRITE_ACTION_REPLACE_ALL,
+    XFER_LOCAL_OVERWRITE_ACTION_SKIP,
+    XFER_LOCAL_OVERWRITE_ACTION_SKIP_ALL
+};
+
+// same values as GnomeVFSXferErrorAction
+enum XferLocalErrorAction
+{
+    XFER_LOCAL_ERROR_ACTION_ABORT,
+    XFER_LOCAL_ERROR_ACTION_RETRY,
+    XFER_LOCAL_ERROR_ACTION_SKIP
+};
+
+struct XferLocalProgress
+{
+    guint64 bytes_copied;               // of all files
+    guint64 files_done;                 // files and directories, each directory counts as one file
+    guint64 file_size;                  // of the file started last
+    guint64 file_bytes_copied;
+    gchar *file;                        // its source path or NULL, g_free() it
+    XferStats stats;
+};
+
+/**
+ * Starts copying each path in @a src_paths to the path at the same
+ * position in @a dest_paths, both lists of gchar *. With @a move the
+ * sources are removed once they are copied. With @a follow_links the
+ * files symbolic links point to are copied instead of the links. With
+ * @a checksums the chunks of large files are checked by their checksums
+ * when resuming, instead of comparing them with the source.
+ */
+XferLocalJob *xfer_local_job_new (GList *src_paths, GList *dest_paths, gboolean move, gboolean follow_links,
+                                  XferLocalOverwriteMode overwrite_mode, gboolean checksums=FALSE);
+
+/**
+ * Fills @a progress and returns TRUE once the job is done.
+ */
+gboolean xfer_local_job_get_progress (XferLocalJob *job, XferLocalProgress *progress);
+
+/**
+ * Returns the question a worker is waiting on, if any. @a src and
+ * @a dest, which may be NULL, get the paths it is about and must be
+ * freed, @a error gets the errno value of an XFER_LOCAL_QUESTION_ERROR.
+ */
+XferLocalQuestion xfer_local_job_get_question (XferLocalJob *job, gchar **src, gchar **dest, gint *error);
+
+/**
+ * Answers the pending question, see XferLocalQuestion for the values.
+ * Answering with ABORT cancels the job.
+ */
+void xfer_local_job_answer (XferLocalJob *job, gint answer);
+
+/**
+ * Returns TRUE if the job was cancelled or aborted.
+ */
+gboolean xfer_local_job_aborted (XferLocalJob *job);
+
+/**
+ * Stops copying as soon as possible. A file copied only partly is
+ * removed again, unless it is large enough to be resumed later.
+ */
+void xfer_local_job_cancel (XferLocalJob *job);
+
+/**
+ * Pauses or resumes the job. The workers stop between two chunks of data,
+ * so a paused job keeps its files open.
+ */
+void xfer_local_job_pause (XferLocalJob *job, gboolean pause);
+
+/**
+ * Waits until the job is done. Questions must be answered meanwhile by
+ * another thread, or the job cancelled first.
+ */
+void xfer_local_job_wait (XferLocalJob *job);
+
+/**
+ * Cancels the job if it is still running and frees it.
+ */
+void xfer_local_job_free (XferLocalJob *job);
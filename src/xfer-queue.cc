@@ -0,0 +1,392 @@
+/**
+ * @file xfer-queue.cc
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
+
+#include "xfer-queue.h"
+
+using namespace std;
+
+
+struct XferQueue
+{
+    GList *jobs;                        // XferQueueJob *, in queue order
+    guint max_per_device;
+    guint last_id;
+    gboolean scheduling;
+    gboolean reschedule;                // something changed while scheduling
+};
+
+
+static void schedule (XferQueue *queue);
+
+
+inline void free_job (XferQueueJob *job)
+{
+    g_free (job->title);
+    g_strfreev (job->devices);
+    g_free (job);
+}
+
+
+inline GList *find_job (XferQueue *queue, guint id)
+{
+    for (GList *i = queue->jobs; i; i = i->next)
+        if (((XferQueueJob *) i->data)->id==id)
+            return i;
+
+    return NULL;
+}
+
+
+inline guint count_of (GHashTable *counts, const gchar *device)
+{
+    return GPOINTER_TO_UINT (g_hash_table_lookup (counts, device));
+}
+
+
+/**
+ * Returns TRUE if @a job may start with @a busy jobs on its devices and
+ * @a reserved devices kept for jobs before it.
+ */
+static gboolean may_start (XferQueue *queue, XferQueueJob *job, GHashTable *busy, GHashTable *reserved)
+{
+    if (job->devices)
+        for (gchar **d = job->devices; *d; ++d)
+            if (count_of (busy, *d)>=queue->max_per_device || g_hash_table_lookup (reserved, *d))
+                return FALSE;
+
+    return TRUE;
+}
+
+
+/**
+ * Starts the first job that may run now. Returns FALSE if there is none.
+ */
+static gboolean start_next (XferQueue *queue)
+{
+    GHashTable *busy = g_hash_table_new (g_str_hash, g_str_equal);
+    GHashTable *reserved = g_hash_table_new (g_str_hash, g_str_equal);
+    XferQueueJob *next = NULL;
+
+    for (GList *i = queue->jobs; i; i = i->next)
+    {
+        XferQueueJob *job = (XferQueueJob *) i->data;
+
+        if (job->state==XFER_QUEUE_RUNNING && job->devices)
+            for (gchar **d = job->devices; *d; ++d)
+                g_hash_table_insert (busy, *d, GUINT_TO_POINTER (count_of (busy, *d) + 1));
+    }
+
+    for (GList *i = queue->jobs; i && !next; i = i->next)
+    {
+        XferQueueJob *job = (XferQueueJob *) i->data;
+
+        if (job->state!=XFER_QUEUE_WAITING || job->paused)
+            continue;
+
+        if (may_start (queue, job, busy, reserved))
+            next = job;
+        else
+            if (job->devices)
+                for (gchar **d = job->devices; *d; ++d)
+                    g_hash_table_insert (reserved, *d, GUINT_TO_POINTER (TRUE));
+    }
+
+    g_hash_table_destroy (reserved);
+    g_hash_table_destroy (busy);
+
+    if (!next)
+        return FALSE;
+
+    next->state = XFER_QUEUE_RUNNING;
+    next->start (next->data);
+
+    return TRUE;
+}
+
+
+static void schedule (XferQueue *queue)
+{
+    // the callbacks may change the queue, so it is gone through again after each of them
+    if (queue->scheduling)
+    {
+        queue->reschedule = TRUE;
+        return;
+    }
+
+    queue->scheduling = TRUE;
+
+    do
+        queue->reschedule = FALSE;
+    while (start_next (queue) || queue->reschedule);
+
+    queue->scheduling = FALSE;
+}
+
+
+XferQueue *xfer_queue_new (guint max_per_device)
+{
+    XferQueue *queue = g_new0 (XferQueue, 1);
+
+    queue->max_per_device = MAX (max_per_device, 1);
+
+    return queue;
+}
+
+
+void xfer_queue_free (XferQueue *queue)
+{
+    if (!queue)
+        return;
+
+    g_list_foreach (queue->jobs, (GFunc) free_job, NULL);
+    g_list_free (queue->jobs);
+    g_free (queue);
+}
+
+
+void xfer_queue_set_max_per_device (XferQueue *queue, guint max_per_device)
+{
+    g_return_if_fail (queue != NULL);
+
+    queue->max_per_device = MAX (max_per_device, 1);
+
+    schedule (queue);
+}
+
+
+guint xfer_queue_add (XferQueue *queue, const gchar *title, gchar **devices,
+                      XferQueueStartFunc start, XferQueuePauseFunc pause, XferQueueCancelFunc cancel,
+                      gpointer data)
+{
+    g_return_val_if_fail (queue != NULL, 0);
+    g_return_val_if_fail (start != NULL, 0);
+    g_return_val_if_fail (cancel != NULL, 0);
+
+    XferQueueJob *job = g_new0 (XferQueueJob, 1);
+
+    job->id = ++queue->last_id;
+    job->title = g_strdup (title);
+    job->state = XFER_QUEUE_WAITING;
+    job->progress = -1.0f;
+    job->start = start;
+    job->pause = pause;
+    job->cancel = cancel;
+    job->data = data;
+
+    // each device once, or the job would wait for itself
+    if (devices)
+    {
+        GPtrArray *unique = g_ptr_array_new ();
+
+        for (gchar **d = devices; *d; ++d)
+        {
+            gboolean seen = FALSE;
+
+            for (guint i=0; i<unique->len && !seen; ++i)
+                seen = strcmp ((gchar *) g_ptr_array_index (unique, i), *d)==0;
+
+            if (!seen)
+                g_ptr_array_add (unique, g_strdup (*d));
+        }
+
+        g_ptr_array_add (unique, NULL);
+        job->devices = (gchar **) g_ptr_array_free (unique, FALSE);
+    }
+
+    guint id = job->id;
+
+    queue->jobs = g_list_append (queue->jobs, job);
+
+    schedule (queue);
+
+    return id;
+}
+
+
+void xfer_queue_done (XferQueue *queue, guint id)
+{
+    g_return_if_fail (queue != NULL);
+
+    GList *i = find_job (queue, id);
+
+    if (!i)
+        return;
+
+    free_job ((XferQueueJob *) i->data);
+    queue->jobs = g_list_delete_link (queue->jobs, i);
+
+    schedule (queue);
+}
+
+
+gboolean xfer_queue_pause (XferQueue *queue, guint id, gboolean pause)
+{
+    g_return_val_if_fail (queue != NULL, FALSE);
+
+    GList *i = find_job (queue, id);
+
+    if (!i)
+        return FALSE;
+
+    XferQueueJob *job = (XferQueueJob *) i->data;
+
+    if (job->paused==pause)
+        return TRUE;
+
+    if (job->state==XFER_QUEUE_RUNNING && (!job->pause || !job->pause (job->data, pause)))
+        return FALSE;
+
+    job->paused = pause;
+
+    // a waiting job held back doesn't keep its devices
+    schedule (queue);
+
+    return TRUE;
+}
+
+
+void xfer_queue_move (XferQueue *queue, guint id, gint offset)
+{
+    g_return_if_fail (queue != NULL);
+
+    GList *i = find_job (queue, id);
+
+    if (!i)
+        return;
+
+    gpointer job = i->data;
+    gint pos = g_list_position (queue->jobs, i) + offset;
+
+    queue->jobs = g_list_delete_link (queue->jobs, i);
+    queue->jobs = g_list_insert (queue->jobs, job, CLAMP (pos, 0, (gint) g_list_length (queue->jobs)));
+
+    schedule (queue);
+}
+
+
+void xfer_queue_cancel (XferQueue *queue, guint id)
+{
+    g_return_if_fail (queue != NULL);
+
+    GList *i = find_job (queue, id);
+
+    if (!i)
+        return;
+
+    XferQueueJob *job = (XferQueueJob *) i->data;
+
+    if (job->state==XFER_QUEUE_RUNNING)
+    {
+        job->cancel (job->data, XFER_QUEUE_RUNNING);
+        return;
+    }
+
+    queue->jobs = g_list_delete_link (queue->jobs, i);
+
+    job->cancel (job->data, XFER_QUEUE_WAITING);
+    free_job (job);
+
+    schedule (queue);
+}
+
+
+void xfer_queue_set_progress (XferQueue *queue, guint id, gfloat progress)
+{
+    g_return_if_fail (queue != NULL);
+
+    GList *i = find_job (queue, id);
+
+    if (i)
+        ((XferQueueJob *) i->data)->progress = progress;
+}
+
+
+GList *xfer_queue_get_jobs (XferQueue *queue)
+{
+    g_return_val_if_fail (queue != NULL, NULL);
+
+    return queue->jobs;
+}
+
+
+gchar *xfer_queue_device_of_path (const gchar *path)
+{
+    g_return_val_if_fail (path != NULL, NULL);
+
+    gchar *p = g_strdup (path);
+    struct stat st;
+
+    // the target of a copy may not exist yet
+    while (stat (p, &st)!=0)
+    {
+        gchar *parent = g_path_get_dirname (p);
+        gboolean at_top = strcmp (parent, p)==0;
+
+        g_free (p);
+        p = parent;
+
+        if (at_top)
+        {
+            g_free (p);
+            return NULL;
+        }
+    }
+
+    g_free (p);
+
+    gchar *key = NULL;
+
+#ifdef __linux__
+    // sysfs puts partitions below their disk, with a "partition" file each
+    gchar *sys_path = g_strdup_printf ("/sys/dev/block/%u:%u", major (st.st_dev), minor (st.st_dev));
+    gchar *real_path = realpath (sys_path, NULL);
+
+    if (real_path)
+    {
+        gchar *partition = g_build_filename (real_path, "partition", NULL);
+        gchar *disk = g_file_test (partition, G_FILE_TEST_EXISTS) ? g_path_get_dirname (real_path) : g_strdup (real_path);
+        gchar *name = g_path_get_basename (disk);
+
+        key = g_strconcat ("disk:", name, NULL);
+
+        g_free (name);
+        g_free (disk);
+        g_free (partition);
+        free (real_path);
+    }
+
+    g_free (sys_path);
+#endif
+
+    if (!key)
+        key = g_strdup_printf ("dev:%lu", (gulong) st.st_dev);
+
+    return key;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file xfer-queue.h
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+/**
+ * Schedules transfers so that the ones touching the same device take
+ * turns while the ones on different devices run side by side.
+ *
+ * Every job names the devices it reads from and writes to. It starts
+ * once fewer than the limit of jobs use each of them. Jobs are started
+ * in queue order, but one that has to wait doesn't hold up later jobs
+ * on other devices; it only keeps its own devices for itself, so it
+ * isn't overtaken forever by jobs sharing one of them.
+ *
+ * The queue is not thread safe, it is meant to be driven from the main
+ * loop. The callbacks are called from within the queue functions, so
+ * the start callback may run before xfer_queue_add() returns.
+ */
+struct XferQueue;
+
+enum XferQueueState
+{
+    XFER_QUEUE_WAITING,
+    XFER_QUEUE_RUNNING
+};
+
+typedef void (*XferQueueStartFunc) (gpointer data);
+typedef gboolean (*XferQueuePauseFunc) (gpointer data, gboolean pause);     // FALSE if the running job can't pause
+typedef void (*XferQueueCancelFunc) (gpointer data, XferQueueState state);
+
+struct XferQueueJob
+{
+    guint id;
+    gchar *title;
+    gchar **devices;                    // NULL terminated
+    XferQueueState state;
+    gboolean paused;
+    gfloat progress;                    // from 0 to 1, negative if not known
+    XferQueueStartFunc start;
+    XferQueuePauseFunc pause;
+    XferQueueCancelFunc cancel;
+    gpointer data;
+};
+
+XferQueue *xfer_queue_new (guint max_per_device);
+
+/**
+ * Frees the queue and forgets the jobs in it without calling back.
+ */
+void xfer_queue_free (XferQueue *queue);
+
+/**
+ * Changes the number of jobs a device is shared by and starts what may
+ * run now.
+ */
+void xfer_queue_set_max_per_device (XferQueue *queue, guint max_per_device);
+
+/**
+ * Appends a job using @a devices, a NULL terminated list of device keys
+ * which may be NULL for none, and starts it right away if they are free.
+ * @a pause may be NULL if the running job can't pause. Returns the id
+ * of the job.
+ */
+guint xfer_queue_add (XferQueue *queue, const gchar *title, gchar **devices,
+                      XferQueueStartFunc start, XferQueuePauseFunc pause, XferQueueCancelFunc cancel,
+                      gpointer data);
+
+/**
+ * Removes the finished job and starts the ones waiting for its devices.
+ */
+void xfer_queue_done (XferQueue *queue, guint id);
+
+/**
+ * Holds back a waiting job, or pauses a running one if it can. A
+ * paused running job keeps its devices. Returns FALSE if it can't pause.
+ */
+gboolean xfer_queue_pause (XferQueue *queue, guint id, gboolean pause);
+
+/**
+ * Moves the job @a offset places up (negative) or down in the queue.
+ */
+void xfer_queue_move (XferQueue *queue, guint id, gint offset);
+
+/**
+ * Cancels the job. A waiting job is removed right away, a running one
+ * is told to stop and calls xfer_queue_done() once it has.
+ */
+void xfer_queue_cancel (XferQueue *queue, guint id);
+
+void xfer_queue_set_progress (XferQueue *queue, guint id, gfloat progress);
+
+/**
+ * Returns the XferQueueJob structures in queue order, owned by the queue.
+ */
+GList *xfer_queue_get_jobs (XferQueue *queue);
+
+/**
+ * Returns a key for the device @a path is on, or on the nearest
+ * existing parent of @a path. Partitions of one disk get the key of the
+ * disk, as they share its heads. Returns NULL if there is no such device.
+ */
+gchar *xfer_queue_device_of_path (const gchar *path);
@@ -0,0 +1,336 @@
+/**
+ * @file xfer-resume.cc
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "xfer-resume.h"
+
+using namespace std;
+
+
+#define JOURNAL_VERSION  1
+
+
+struct XferResumeJournal
+{
+    gchar *path;
+    gint fd;
+    gboolean checksums;
+    GString *pending;           // lines of the chunks not synced yet
+    guint n_pending;
+};
+
+
+/**
+ * The first line of the journal, it tells which source the partial copy
+ * is of and how it is made.
+ */
+inline gchar *make_header (const struct stat &src_st, gboolean checksums)
+{
+    return g_strdup_printf ("gcmd-resume %d %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %ld %ld %d %d\n",
+                            JOURNAL_VERSION,
+                            (guint64) src_st.st_ino, (guint64) src_st.st_size,
+                            (glong) src_st.st_mtim.tv_sec, (glong) src_st.st_mtim.tv_nsec,
+                            XFER_RESUME_CHUNK_SIZE, checksums ? 1 : 0);
+}
+
+
+inline guint64 chunk_length (guint64 size, guint64 index)
+{
+    guint64 offset = index * XFER_RESUME_CHUNK_SIZE;
+
+    return offset>=size ? 0 : MIN (XFER_RESUME_CHUNK_SIZE, size - offset);
+}
+
+
+static gboolean read_all (gint fd, gchar *buf, gsize length, guint64 offset)
+{
+    while (length)
+    {
+        ssize_t n = pread (fd, buf, length, offset);
+
+        if (n<0 && errno==EINTR)
+            continue;
+
+        if (n<=0)
+            return FALSE;
+
+        buf += n;
+        length -= n;
+        offset += n;
+    }
+
+    return TRUE;
+}
+
+
+static gint write_all (gint fd, const gchar *buf, gsize length)
+{
+    while (length)
+    {
+        ssize_t n = write (fd, buf, length);
+
+        if (n<0 && errno==EINTR)
+            continue;
+
+        if (n<0)
+            return errno;
+
+        buf += n;
+        length -= n;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Returns TRUE if chunk @a index of the partial copy is what the journal
+ * says, judged by its @a checksum or else by the source.
+ */
+static gboolean chunk_is_intact (gint src_fd, gint part_fd, guint64 size, guint64 index, const gchar *checksum)
+{
+    gsize length = chunk_length (size, index);
+    guint64 offset = index * XFER_RESUME_CHUNK_SIZE;
+    gchar *data = (gchar *) g_malloc (length);
+    gboolean intact = read_all (part_fd, data, length, offset);
+
+    if (intact)
+    {
+        if (checksum)
+        {
+            gchar *sum = xfer_resume_checksum (data, length);
+            intact = strcmp (sum, checksum)==0;
+            g_free (sum);
+        }
+        else
+        {
+            gchar *src_data = (gchar *) g_malloc (length);
+            intact = read_all (src_fd, src_data, length, offset) && memcmp (data, src_data, length)==0;
+            g_free (src_data);
+        }
+    }
+
+    g_free (data);
+
+    return intact;
+}
+
+
+/**
+ * Reads the chunks recorded in @a contents after @a header into
+ * @a checksums, up to the first one missing or not intact, and returns
+ * their number.
+ */
+static guint64 read_journal (const gchar *contents, const gchar *header, gboolean with_checksums,
+                             gint src_fd, gint part_fd, guint64 size, GPtrArray *checksums)
+{
+    if (!g_str_has_prefix (contents, header))
+        return 0;
+
+    guint64 n = 0;
+
+    // a line cut off by a crash has no newline yet, so it is left out as well
+    for (const gchar *line = contents + strlen (header), *end; (end = strchr (line, '\n')); line = end + 1)
+    {
+        gchar *rest;
+        guint64 index = g_ascii_strtoull (line, &rest, 10);
+
+        if (rest==line || index!=n || !chunk_length (size, index))
+            break;
+
+        gchar *checksum = NULL;
+
+        if (with_checksums)
+        {
+            if (*rest!=' ' || end-rest<2)
+                break;
+
+            checksum = g_strndup (rest + 1, end - rest - 1);
+        }
+
+        g_ptr_array_add (checksums, checksum);
+        ++n;
+    }
+
+    // the partial copy must hold all of them
+    struct stat part_st;
+
+    if (fstat (part_fd, &part_st)!=0)
+        n = 0;
+
+    while (n && (guint64) part_st.st_size < (n-1) * XFER_RESUME_CHUNK_SIZE + chunk_length (size, n-1))
+        --n;
+
+    // what was written last is checked again, what came before is trusted
+    for (guint64 i = n>XFER_RESUME_VERIFY_CHUNKS ? n-XFER_RESUME_VERIFY_CHUNKS : 0; i<n; ++i)
+        if (!chunk_is_intact (src_fd, part_fd, size, i, (const gchar *) g_ptr_array_index (checksums, i)))
+        {
+            n = i;
+            break;
+        }
+
+    return n;
+}
+
+
+static gint flush (XferResumeJournal *journal, gint part_fd)
+{
+    if (!journal->n_pending)
+        return 0;
+
+    // the data has to be on disk before the journal says so
+    if (fdatasync (part_fd)!=0)
+        return errno;
+
+    gint error = write_all (journal->fd, journal->pending->str, journal->pending->len);
+
+    g_string_truncate (journal->pending, 0);
+    journal->n_pending = 0;
+
+    return error;
+}
+
+
+XferResumeJournal *xfer_resume_open (const gchar *dest, const struct stat &src_st, gboolean checksums,
+                                     gint src_fd, gint part_fd, guint64 *done)
+{
+    g_return_val_if_fail (dest != NULL, NULL);
+    g_return_val_if_fail (done != NULL, NULL);
+
+    gchar *path = g_strconcat (dest, XFER_RESUME_JOURNAL_SUFFIX, NULL);
+    gchar *header = make_header (src_st, checksums);
+    GPtrArray *sums = g_ptr_array_new ();
+    gchar *contents = NULL;
+    guint64 n = 0;
+
+    if (g_file_get_contents (path, &contents, NULL, NULL))
+        n = read_journal (contents, header, checksums, src_fd, part_fd, src_st.st_size, sums);
+
+    g_free (contents);
+
+    // written again with only the chunks kept
+    GString *lines = g_string_new (header);
+
+    for (guint64 i=0; i<n; ++i)
+        if (checksums)
+            g_string_append_printf (lines, "%" G_GUINT64_FORMAT " %s\n", i, (const gchar *) g_ptr_array_index (sums, i));
+        else
+            g_string_append_printf (lines, "%" G_GUINT64_FORMAT "\n", i);
+
+    for (guint i=0; i<sums->len; ++i)
+        g_free (g_ptr_array_index (sums, i));
+    g_ptr_array_free (sums, TRUE);
+    g_free (header);
+
+    gint fd = open (path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW, 0600);
+    gint error = fd<0 ? errno : write_all (fd, lines->str, lines->len);
+
+    g_string_free (lines, TRUE);
+
+    // anything after the kept chunks is copied again
+    if (!error && ftruncate (part_fd, n * XFER_RESUME_CHUNK_SIZE)!=0)
+        error = errno;
+
+    if (error)
+    {
+        if (fd>=0)
+            close (fd);
+        g_free (path);
+        errno = error;
+        return NULL;
+    }
+
+    XferResumeJournal *journal = g_new0 (XferResumeJournal, 1);
+
+    journal->path = path;
+    journal->fd = fd;
+    journal->checksums = checksums;
+    journal->pending = g_string_new (NULL);
+
+    *done = MIN (n * XFER_RESUME_CHUNK_SIZE, (guint64) src_st.st_size);
+
+    return journal;
+}
+
+
+gboolean xfer_resume_has_checksums (XferResumeJournal *journal)
+{
+    g_return_val_if_fail (journal != NULL, FALSE);
+
+    return journal->checksums;
+}
+
+
+gint xfer_resume_chunk_done (XferResumeJournal *journal, gint part_fd, guint64 offset, const gchar *data, gsize length)
+{
+    g_return_val_if_fail (journal != NULL, EINVAL);
+
+    guint64 index = offset / XFER_RESUME_CHUNK_SIZE;
+
+    if (journal->checksums && data)
+    {
+        gchar *sum = xfer_resume_checksum (data, length);
+        g_string_append_printf (journal->pending, "%" G_GUINT64_FORMAT " %s\n", index, sum);
+        g_free (sum);
+    }
+    else
+        g_string_append_printf (journal->pending, "%" G_GUINT64_FORMAT "\n", index);
+
+    return ++journal->n_pending<XFER_RESUME_SYNC_CHUNKS ? 0 : flush (journal, part_fd);
+}
+
+
+void xfer_resume_close (XferResumeJournal *journal, gint part_fd, gboolean completed)
+{
+    if (!journal)
+        return;
+
+    if (!completed && part_fd>=0)
+        flush (journal, part_fd);
+
+    close (journal->fd);
+
+    if (completed)
+        unlink (journal->path);
+
+    g_string_free (journal->pending, TRUE);
+    g_free (journal->path);
+    g_free (journal);
+}
+
+
+gchar *xfer_resume_part_path (const gchar *dest)
+{
+    g_return_val_if_fail (dest != NULL, NULL);
+
+    return g_strconcat (dest, XFER_RESUME_PART_SUFFIX, NULL);
+}
+
+
+gchar *xfer_resume_checksum (const gchar *data, gsize length)
+{
+    return g_compute_checksum_for_data (G_CHECKSUM_MD5, (const guchar *) data, length);
+}
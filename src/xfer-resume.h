@@ -0,0 +1,91 @@
+/**
+ * @file xfer-resume.h
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <sys/stat.h>
+
+#define XFER_RESUME_MIN_SIZE        (64 * 1024 * 1024)      // smaller files are simply copied again
+#define XFER_RESUME_CHUNK_SIZE      (8 * 1024 * 1024)
+#define XFER_RESUME_SYNC_CHUNKS     8                       // chunks written between two journal updates
+#define XFER_RESUME_VERIFY_CHUNKS   2                       // chunks at the end checked again when resuming
+
+#define XFER_RESUME_PART_SUFFIX     ".gcmd-part"
+#define XFER_RESUME_JOURNAL_SUFFIX  ".gcmd-part.journal"
+
+/**
+ * The journal of a large file being copied.
+ *
+ * A large file is copied into DEST.gcmd-part in chunks and renamed to
+ * DEST when complete. Next to it, DEST.gcmd-part.journal records which
+ * source it is a copy of and which chunks are done, optionally with a
+ * checksum of each. Chunks are only recorded after the data is synced,
+ * so a copy that was cancelled or cut off by a crash continues after
+ * the last recorded chunk when the same file is copied to the same
+ * place again.
+ *
+ * Before continuing, the last XFER_RESUME_VERIFY_CHUNKS recorded chunks
+ * are checked: against their checksums if there are any, otherwise
+ * against the source. The chunks before them are trusted.
+ */
+struct XferResumeJournal;
+
+/**
+ * Opens the journal for copying @a src_fd, described by @a src_st, to
+ * @a part_fd, the partial copy of @a dest. If the journal belongs to the
+ * same source and its tail checks out, @a done gets the number of bytes
+ * that need not be copied again, otherwise a new journal is started and
+ * @a done is 0. Returns NULL and sets errno if the journal can't be
+ * written.
+ */
+XferResumeJournal *xfer_resume_open (const gchar *dest, const struct stat &src_st, gboolean checksums,
+                                     gint src_fd, gint part_fd, guint64 *done);
+
+/**
+ * Returns TRUE if chunks get checksums.
+ */
+gboolean xfer_resume_has_checksums (XferResumeJournal *journal);
+
+/**
+ * Notes that the chunk starting at @a offset was written, with @a data
+ * for its checksum, which may be NULL if the journal has no checksums.
+ * Pending chunks are recorded every XFER_RESUME_SYNC_CHUNKS chunks,
+ * after syncing @a part_fd.
+ */
+gint xfer_resume_chunk_done (XferResumeJournal *journal, gint part_fd, guint64 offset, const gchar *data, gsize length);
+
+/**
+ * Syncs and records the pending chunks and closes the journal. With
+ * @a completed the journal is removed, as the copy doesn't need it
+ * anymore.
+ */
+void xfer_resume_close (XferResumeJournal *journal, gint part_fd, gboolean completed);
+
+/**
+ * Returns the path of the partial copy of @a dest, g_free() it.
+ */
+gchar *xfer_resume_part_path (const gchar *dest);
+
+/**
+ * Returns the checksum of a chunk as a hex string, g_free() it.
+ */
+gchar *xfer_resume_checksum (const gchar *data, gsize length);
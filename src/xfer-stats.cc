@@ -0,0 +1,194 @@
+/**
+ * @file xfer-stats.cc
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <time.h>
+
+#include "xfer-stats.h"
+
+using namespace std;
+
+
+static const gchar *phase_names[XFER_N_PHASES] = {"scan", "create", "copy", "finish"};
+static const gchar *size_class_names[XFER_N_SIZE_CLASSES] = {"small", "medium", "large"};
+
+
+inline const gchar *seconds (gchar *buf, gint64 usec)
+{
+    // the decimal point is a point whatever the locale
+    return g_ascii_formatd (buf, G_ASCII_DTOSTR_BUF_SIZE, "%.3f", usec / (gdouble) G_USEC_PER_SEC);
+}
+
+
+const gchar *xfer_phase_name (XferPhase phase)
+{
+    g_return_val_if_fail (phase < XFER_N_PHASES, NULL);
+
+    return phase_names[phase];
+}
+
+
+XferSizeClass xfer_size_class (guint64 size)
+{
+    return size<=XFER_SMALL_FILE_MAX ? XFER_SIZE_SMALL :
+           size<=XFER_MEDIUM_FILE_MAX ? XFER_SIZE_MEDIUM : XFER_SIZE_LARGE;
+}
+
+
+void xfer_stats_add_file (XferStats *stats, guint64 size, gint64 usec)
+{
+    XferSizeClass size_class = xfer_size_class (size);
+
+    stats->files[size_class]++;
+    stats->bytes[size_class] += size;
+    stats->usec[size_class] += usec;
+}
+
+
+XferPhase xfer_stats_main_phase (const XferStats *stats)
+{
+    gint main_phase = XFER_PHASE_COPY;
+
+    for (gint i=0; i<XFER_N_PHASES; ++i)
+        if (stats->phase_usec[i] > stats->phase_usec[main_phase])
+            main_phase = i;
+
+    return (XferPhase) main_phase;
+}
+
+
+gchar *xfer_stats_to_log (const XferStats *stats, const gchar *operation, const gchar *engine,
+                          guint64 files, guint64 bytes, gint64 usec, gboolean aborted)
+{
+    GString *s = g_string_sized_new (512);
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+    gchar date[32];
+    time_t now = time (NULL);
+    struct tm tm;
+
+    strftime (date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime_r (&now, &tm));
+
+    gdouble secs = usec / (gdouble) G_USEC_PER_SEC;
+
+    g_string_append_printf (s, "{\"time\":\"%s\",\"operation\":\"%s\",\"engine\":\"%s\",\"result\":\"%s\"",
+                            date, operation, engine, aborted ? "aborted" : "done");
+    g_string_append_printf (s, ",\"files\":%" G_GUINT64_FORMAT ",\"bytes\":%" G_GUINT64_FORMAT, files, bytes);
+    g_string_append_printf (s, ",\"seconds\":%s", seconds (buf, usec));
+    g_string_append_printf (s, ",\"bytes_per_sec\":%s", g_ascii_formatd (buf, sizeof(buf), "%.0f", secs>0 ? bytes / secs : 0.0));
+    g_string_append_printf (s, ",\"files_per_sec\":%s", g_ascii_formatd (buf, sizeof(buf), "%.1f", secs>0 ? files / secs : 0.0));
+    g_string_append_printf (s, ",\"main_phase\":\"%s\"", phase_names[xfer_stats_main_phase (stats)]);
+
+    g_string_append (s, ",\"phases\":{");
+    for (gint i=0; i<XFER_N_PHASES; ++i)
+        g_string_append_printf (s, "%s\"%s\":%s", i ? "," : "", phase_names[i], seconds (buf, stats->phase_usec[i]));
+    g_string_append (s, "}");
+
+    g_string_append (s, ",\"sizes\":{");
+    for (gint i=0; i<XFER_N_SIZE_CLASSES; ++i)
+    {
+        g_string_append_printf (s, "%s\"%s\":{\"files\":%" G_GUINT64_FORMAT ",\"bytes\":%" G_GUINT64_FORMAT,
+                                i ? "," : "", size_class_names[i], stats->files[i], stats->bytes[i]);
+        g_string_append_printf (s, ",\"seconds\":%s}", seconds (buf, stats->usec[i]));
+    }
+    g_string_append (s, "}}");
+
+    return g_string_free (s, FALSE);
+}
+
+
+void xfer_rate_add (XferRate *rate, gint64 time, guint64 bytes, guint64 files)
+{
+    guint last = (rate->first + rate->n - 1) % XFER_RATE_SAMPLES;
+
+    if (rate->n && rate->time[last]>=time)
+    {
+        // no time passed, only the totals changed
+        rate->bytes[last] = bytes;
+        rate->files[last] = files;
+        return;
+    }
+
+    if (rate->n==XFER_RATE_SAMPLES)
+    {
+        rate->first = (rate->first + 1) % XFER_RATE_SAMPLES;
+        rate->n--;
+    }
+
+    last = (rate->first + rate->n) % XFER_RATE_SAMPLES;
+
+    rate->time[last] = time;
+    rate->bytes[last] = bytes;
+    rate->files[last] = files;
+    rate->n++;
+
+    // keep one sample from before the window, so the window is covered completely
+    while (rate->n>2 && rate->time[(rate->first + 1) % XFER_RATE_SAMPLES] <= time - XFER_RATE_WINDOW_USEC)
+    {
+        rate->first = (rate->first + 1) % XFER_RATE_SAMPLES;
+        rate->n--;
+    }
+}
+
+
+gboolean xfer_rate_get (const XferRate *rate, gdouble *bytes_per_sec, gdouble *files_per_sec)
+{
+    if (rate->n<2)
+        return FALSE;
+
+    guint first = rate->first;
+    guint last = (rate->first + rate->n - 1) % XFER_RATE_SAMPLES;
+    gint64 usec = rate->time[last] - rate->time[first];
+
+    if (usec<XFER_RATE_MIN_USEC)
+        return FALSE;
+
+    gdouble secs = usec / (gdouble) G_USEC_PER_SEC;
+
+    if (bytes_per_sec)
+        *bytes_per_sec = (rate->bytes[last] - rate->bytes[first]) / secs;
+    if (files_per_sec)
+        *files_per_sec = (rate->files[last] - rate->files[first]) / secs;
+
+    return TRUE;
+}
+
+
+gint64 xfer_rate_eta (const XferRate *rate, guint64 bytes_left, guint64 files_left)
+{
+    if (!bytes_left && !files_left)
+        return 0;
+
+    gdouble bytes_per_sec, files_per_sec;
+
+    if (!xfer_rate_get (rate, &bytes_per_sec, &files_per_sec))
+        return -1;
+
+    gdouble secs = -1.0;
+
+    // whichever takes longer, a slow stream of small files doesn't show in the bytes
+    if (bytes_left && bytes_per_sec>0)
+        secs = bytes_left / bytes_per_sec;
+
+    if (files_left && files_per_sec>0)
+        secs = MAX (secs, files_left / files_per_sec);
+
+    return secs<0 ? -1 : (gint64) (secs + 0.5);
+}
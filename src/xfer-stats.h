@@ -0,0 +1,131 @@
+/**
+ * @file xfer-stats.h
+ * @copyright (C) 2001-2006 Marcus Bjurman\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <string.h>
+
+#define XFER_RATE_WINDOW_USEC   (5 * G_USEC_PER_SEC)
+#define XFER_RATE_MIN_USEC      (G_USEC_PER_SEC / 2)    // rates over shorter times are too jumpy to show
+#define XFER_RATE_SAMPLES       128
+
+#define XFER_SMALL_FILE_MAX     (64 * 1024)
+#define XFER_MEDIUM_FILE_MAX    (4 * 1024 * 1024)
+
+/**
+ * Where the time of a transfer goes. Scanning is reading directories and
+ * file information, creating is making directories, links and opening
+ * files, copying is moving the data, and finishing is setting permissions
+ * and times and closing, where delayed write errors and network file
+ * system flushes show up.
+ */
+enum XferPhase
+{
+    XFER_PHASE_SCAN,
+    XFER_PHASE_CREATE,
+    XFER_PHASE_COPY,
+    XFER_PHASE_FINISH,
+    XFER_N_PHASES
+};
+
+enum XferSizeClass
+{
+    XFER_SIZE_SMALL,                    // up to XFER_SMALL_FILE_MAX
+    XFER_SIZE_MEDIUM,                   // up to XFER_MEDIUM_FILE_MAX
+    XFER_SIZE_LARGE,
+    XFER_N_SIZE_CLASSES
+};
+
+/**
+ * Timing of a transfer. Small files taking much more time per
+ * byte than the large ones points to latency, seeks or metadata updates,
+ * large files copied at a low rate to the bandwidth.
+ */
+struct XferStats
+{
+    gint64 phase_usec[XFER_N_PHASES];   // summed up over all threads, so more than the time passed
+    guint64 files[XFER_N_SIZE_CLASSES];
+    guint64 bytes[XFER_N_SIZE_CLASSES];
+    gint64 usec[XFER_N_SIZE_CLASSES];   // from opening the file to closing it
+};
+
+/**
+ * Recent progress samples, giving the rate over the last
+ * XFER_RATE_WINDOW_USEC instead of the average since the start.
+ */
+struct XferRate
+{
+    gint64 time[XFER_RATE_SAMPLES];
+    guint64 bytes[XFER_RATE_SAMPLES];
+    guint64 files[XFER_RATE_SAMPLES];
+    guint first;
+    guint n;
+};
+
+inline void xfer_stats_init (XferStats *stats)
+{
+    memset (stats, 0, sizeof(XferStats));
+}
+
+inline void xfer_rate_init (XferRate *rate)
+{
+    memset (rate, 0, sizeof(XferRate));
+}
+
+const gchar *xfer_phase_name (XferPhase phase);
+
+XferSizeClass xfer_size_class (guint64 size);
+
+/**
+ * Counts a file of @a size bytes, copied in @a usec microseconds.
+ */
+void xfer_stats_add_file (XferStats *stats, guint64 size, gint64 usec);
+
+/**
+ * Returns the phase most of the time went into.
+ */
+XferPhase xfer_stats_main_phase (const XferStats *stats);
+
+/**
+ * Formats the stats as a single line of JSON for the transfer log.
+ * @a operation and @a engine are plain words like "copy" and "native".
+ */
+gchar *xfer_stats_to_log (const XferStats *stats, const gchar *operation, const gchar *engine,
+                          guint64 files, guint64 bytes, gint64 usec, gboolean aborted);
+
+/**
+ * Adds a sample of the totals done at @a time, in microseconds.
+ */
+void xfer_rate_add (XferRate *rate, gint64 time, guint64 bytes, guint64 files);
+
+/**
+ * Stores the bytes and files per second over the recent samples in
+ * @a bytes_per_sec and @a files_per_sec, which may be NULL. Returns
+ * FALSE if the samples don't cover XFER_RATE_MIN_USEC yet.
+ */
+gboolean xfer_rate_get (const XferRate *rate, gdouble *bytes_per_sec, gdouble *files_per_sec);
+
+/**
+ * Returns the seconds left for @a bytes_left and @a files_left at the
+ * recent rate, or -1 if that isn't known yet.
+ */
+gint64 xfer_rate_eta (const XferRate *rate, guint64 bytes_left, guint64 files_left);
@@ -0,0 +1,293 @@
+/**
+ * @file attr_local_test.cc
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @details Tests for the native local chmod and chown engine.
+ *
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <gtest/gtest.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../src/attr-local.h"
+#include "gcmd_tests_fs.h"
+
+using namespace std;
+
+
+static mode_t mode_of (const gchar *dir, const gchar *name=NULL)
+{
+    gchar *path = g_build_filename (dir, name, NULL);
+    struct stat st;
+
+    if (lstat (path, &st)!=0)
+        st.st_mode = 0;
+
+    g_free (path);
+
+    return st.st_mode & 07777;
+}
+
+
+static AttrLocalChange mode_change (mode_t mode, gboolean dirs_only=FALSE)
+{
+    AttrLocalChange change = {TRUE, mode, dirs_only, FALSE, (uid_t) -1, (gid_t) -1};
+    return change;
+}
+
+
+/**
+ * Runs a job changing @a path to its end and returns the number of
+ * errors.
+ */
+static guint run_job (const gchar *path, const AttrLocalChange &change, gboolean recursive,
+                      guint64 *files=NULL, guint64 *changed=NULL)
+{
+    GList *paths = g_list_append (NULL, (gpointer) path);
+    AttrLocalJob *job = attr_local_job_new (paths, &change, recursive);
+
+    g_list_free (paths);
+
+    while (!attr_local_job_get_progress (job, files, changed))
+        g_usleep (1000);
+
+    guint n_errors = attr_local_job_get_errors (job, NULL, NULL);
+
+    attr_local_job_free (job);
+
+    return n_errors;
+}
+
+
+class AttrLocalTest : public GcmdTmpDirTest
+{
+};
+
+
+TEST_F(AttrLocalTest, ChangesTrees)
+{
+    gchar *tree = g_build_filename (base, "tree", NULL);
+
+    mkdir (tree, 0755);
+
+    // more directories than there are workers, so they are changed side by side
+    guint64 n = make_tree (tree, 50, 20) + 1;
+    guint64 files = 0;
+    guint64 changed = 0;
+
+    EXPECT_EQ (0, run_job (tree, mode_change (0750), TRUE, &files, &changed));
+
+    EXPECT_EQ (n, files);
+    EXPECT_EQ (n, changed);
+    EXPECT_EQ (0750, mode_of (tree));
+    EXPECT_EQ (0750, mode_of (tree, "dir-0049/deeper"));
+    EXPECT_EQ (0750, mode_of (tree, "dir-0049/deeper/file-0019"));
+
+    g_free (tree);
+}
+
+
+TEST_F(AttrLocalTest, ChangesOnlyTheTopLevelUnlessRecursive)
+{
+    gchar *tree = g_build_filename (base, "tree", NULL);
+
+    mkdir (tree, 0755);
+    make_tree (tree, 1, 2);
+
+    EXPECT_EQ (0, run_job (tree, mode_change (0700), FALSE));
+
+    EXPECT_EQ (0700, mode_of (tree));
+    EXPECT_EQ (0755, mode_of (tree, "dir-0000"));
+    EXPECT_EQ (0644, mode_of (tree, "dir-0000/file-0000"));
+
+    g_free (tree);
+}
+
+
+TEST_F(AttrLocalTest, LeavesFilesAloneForDirectoriesOnly)
+{
+    gchar *tree = g_build_filename (base, "tree", NULL);
+
+    mkdir (tree, 0755);
+    make_tree (tree, 2, 2);
+
+    EXPECT_EQ (0, run_job (tree, mode_change (0711, TRUE), TRUE));
+
+    EXPECT_EQ (0711, mode_of (tree));
+    EXPECT_EQ (0711, mode_of (tree, "dir-0001/deeper"));
+    EXPECT_EQ (0644, mode_of (tree, "dir-0001/file-0000"));
+    EXPECT_EQ (0644, mode_of (tree, "dir-0001/deeper/file-0001"));
+
+    g_free (tree);
+}
+
+
+TEST_F(AttrLocalTest, SkipsWhatIsChangedAlready)
+{
+    gchar *tree = g_build_filename (base, "tree", NULL);
+
+    mkdir (tree, 0755);
+    write_file (tree, "same", "x");
+    write_file (tree, "other", "x");
+
+    gchar *other = g_build_filename (tree, "other", NULL);
+    chmod (other, 0600);
+
+    guint64 files = 0;
+    guint64 changed = 0;
+
+    EXPECT_EQ (0, run_job (tree, mode_change (0644), TRUE, &files, &changed));
+
+    // the directory itself is locked out, but still gets its mode last
+    EXPECT_EQ (3, files);
+    EXPECT_EQ (2, changed);
+    EXPECT_EQ (0644, mode_of (tree));
+
+    chmod (tree, 0755);
+    EXPECT_EQ (0644, mode_of (tree, "other"));
+
+    g_free (other);
+    g_free (tree);
+}
+
+
+TEST_F(AttrLocalTest, DoesntFollowLinksBelowTheTopLevel)
+{
+    gchar *tree = g_build_filename (base, "tree", NULL);
+    gchar *target = g_build_filename (base, "target", NULL);
+    gchar *link = g_build_filename (base, "link", NULL);
+    gchar *inner_link = g_build_filename (tree, "link", NULL);
+
+    mkdir (tree, 0755);
+    mkdir (target, 0755);
+    write_file (target, "file", "x");
+
+    EXPECT_EQ (0, symlink (target, inner_link));
+
+    EXPECT_EQ (0, run_job (tree, mode_change (0700), TRUE));
+
+    EXPECT_EQ (0755, mode_of (target));
+    EXPECT_EQ (0644, mode_of (target, "file"));
+
+    // a link given as the top level path is followed
+    EXPECT_EQ (0, symlink (target, link));
+    EXPECT_EQ (0, run_job (link, mode_change (0700), TRUE));
+
+    EXPECT_EQ (0700, mode_of (target));
+    EXPECT_EQ (0700, mode_of (target, "file"));
+
+    g_free (inner_link);
+    g_free (link);
+    g_free (target);
+    g_free (tree);
+}
+
+
+TEST_F(AttrLocalTest, ChangesLockedOutDirectoriesLast)
+{
+    gchar *tree = g_build_filename (base, "tree", NULL);
+
+    mkdir (tree, 0755);
+    make_tree (tree, 3, 4);
+
+    EXPECT_EQ (0, run_job (tree, mode_change (0600), TRUE));
+
+    EXPECT_EQ (0600, mode_of (tree));
+
+    chmod (tree, 0700);
+
+    gchar *top = g_build_filename (tree, "dir-0002", NULL);
+    EXPECT_EQ (0600, mode_of (top));
+    chmod (top, 0700);
+    EXPECT_EQ (0600, mode_of (top, "file-0002"));
+
+    g_free (top);
+    g_free (tree);
+}
+
+
+TEST_F(AttrLocalTest, ChangesOwners)
+{
+    gchar *tree = g_build_filename (base, "tree", NULL);
+
+    mkdir (tree, 0755);
+    make_tree (tree, 2, 2);
+
+    // the current owner and group, which anyone may set
+    AttrLocalChange change = {FALSE, 0, FALSE, TRUE, (uid_t) -1, getegid ()};
+    guint64 files = 0;
+    guint64 changed = 0;
+
+    EXPECT_EQ (0, run_job (tree, change, TRUE, &files, &changed));
+
+    EXPECT_EQ (9, files);
+    EXPECT_EQ (0, changed);
+    EXPECT_EQ (0755, mode_of (tree));
+
+    g_free (tree);
+}
+
+
+TEST_F(AttrLocalTest, CountsErrors)
+{
+    gchar *missing = g_build_filename (base, "missing", NULL);
+
+    GList *paths = g_list_append (NULL, missing);
+    AttrLocalChange change = mode_change (0700);
+    AttrLocalJob *job = attr_local_job_new (paths, &change, TRUE);
+
+    attr_local_job_wait (job);
+
+    gchar *path = NULL;
+    gint error = 0;
+
+    EXPECT_EQ (1, attr_local_job_get_errors (job, &path, &error));
+    EXPECT_STREQ (missing, path);
+    EXPECT_EQ (ENOENT, error);
+
+    g_free (path);
+    attr_local_job_free (job);
+    g_list_free (paths);
+    g_free (missing);
+}
+
+
+TEST_F(AttrLocalTest, CanBeCancelled)
+{
+    gchar *tree = g_build_filename (base, "tree", NULL);
+
+    mkdir (tree, 0755);
+    make_tree (tree, 10, 10);
+
+    GList *paths = g_list_append (NULL, tree);
+    AttrLocalChange change = mode_change (0700);
+    AttrLocalJob *job = attr_local_job_new (paths, &change, TRUE);
+
+    attr_local_job_cancel (job);
+    attr_local_job_wait (job);
+
+    EXPECT_TRUE (attr_local_job_get_progress (job, NULL, NULL));
+
+    attr_local_job_free (job);
+    g_list_free (paths);
+    g_free (tree);
+}
@@ -0,0 +1,224 @@
+/**
+ * @file delete_local_test.cc
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @details Tests for the native local delete engine, and a benchmark
+ * deleting a tree of 100k small files with it and one by one. The
+ * benchmark only runs if GCMD_BENCHMARK is set in the environment.
+ *
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../src/delete-local.h"
+#include "gcmd_tests_fs.h"
+
+using namespace std;
+
+
+/**
+ * Runs the job to its end, giving @a answer to every question. Returns
+ * the number of questions asked.
+ */
+static gint run_job (DeleteLocalJob *job, gint answer, guint64 *files=NULL)
+{
+    gint n_questions = 0;
+
+    while (!delete_local_job_get_progress (job, files))
+    {
+        if (delete_local_job_get_question (job, NULL, NULL))
+        {
+            n_questions++;
+            delete_local_job_answer (job, answer);
+        }
+
+        g_usleep (1000);
+    }
+
+    delete_local_job_free (job);
+
+    return n_questions;
+}
+
+
+static DeleteLocalJob *start_job (const gchar *path1, const gchar *path2=NULL)
+{
+    GList *paths = g_list_append (NULL, (gpointer) path1);
+
+    if (path2)
+        paths = g_list_append (paths, (gpointer) path2);
+
+    DeleteLocalJob *job = delete_local_job_new (paths);
+
+    g_list_free (paths);
+
+    return job;
+}
+
+
+class DeleteLocalTest : public GcmdTmpDirTest
+{
+};
+
+
+TEST_F(DeleteLocalTest, DeletesTrees)
+{
+    gchar *tree = g_build_filename (base, "tree", NULL);
+
+    mkdir (tree, 0755);
+
+    // more directories than there are workers, so they are removed side by side
+    guint64 n = make_tree (tree, 50, 20) + 1;
+    guint64 files = 0;
+
+    EXPECT_EQ (0, run_job (start_job (tree), DELETE_LOCAL_ERROR_ACTION_ABORT, &files));
+
+    EXPECT_FALSE (exists (base, "tree"));
+    EXPECT_EQ (n, files);
+
+    g_free (tree);
+}
+
+
+TEST_F(DeleteLocalTest, DeletesLinksNotTheirTargets)
+{
+    gchar *tree = g_build_filename (base, "tree", NULL);
+    gchar *target = g_build_filename (base, "target", NULL);
+    gchar *link = g_build_filename (base, "link", NULL);
+    gchar *inner_link = g_build_filename (tree, "link", NULL);
+
+    mkdir (tree, 0755);
+    mkdir (target, 0755);
+    write_file (target, "keep", "x");
+
+    EXPECT_EQ (0, symlink (target, link));
+    EXPECT_EQ (0, symlink (target, inner_link));
+
+    EXPECT_EQ (0, run_job (start_job (tree, link), DELETE_LOCAL_ERROR_ACTION_ABORT));
+
+    EXPECT_FALSE (exists (base, "tree"));
+    EXPECT_FALSE (exists (base, "link"));
+    EXPECT_TRUE (exists (target, "keep"));
+
+    g_free (inner_link);
+    g_free (link);
+    g_free (target);
+    g_free (tree);
+}
+
+
+TEST_F(DeleteLocalTest, KeepsWhatCantBeDeleted)
+{
+    // root may delete anything anyway
+    if (geteuid ()==0)
+        return;
+
+    gchar *tree = g_build_filename (base, "tree", NULL);
+    gchar *locked = g_build_filename (tree, "locked", NULL);
+    gchar *open = g_build_filename (tree, "open", NULL);
+
+    g_mkdir_with_parents (locked, 0755);
+    mkdir (open, 0755);
+    write_file (locked, "file", "x");
+    write_file (open, "file", "x");
+    chmod (locked, 0555);
+
+    EXPECT_EQ (1, run_job (start_job (tree), DELETE_LOCAL_ERROR_ACTION_SKIP));
+
+    EXPECT_TRUE (exists (locked, "file"));
+    EXPECT_FALSE (exists (tree, "open"));
+
+    g_free (open);
+    g_free (locked);
+    g_free (tree);
+}
+
+
+TEST_F(DeleteLocalTest, CanBeCancelled)
+{
+    gchar *tree = g_build_filename (base, "tree", NULL);
+
+    mkdir (tree, 0755);
+    make_tree (tree, 10, 10);
+
+    DeleteLocalJob *job = start_job (tree);
+
+    delete_local_job_cancel (job);
+    delete_local_job_wait (job);
+
+    EXPECT_TRUE (delete_local_job_aborted (job));
+
+    delete_local_job_free (job);
+    g_free (tree);
+}
+
+
+static void delete_one_by_one (const gchar *path)
+{
+    GDir *dir = g_dir_open (path, 0, NULL);
+
+    if (dir)
+    {
+        while (const gchar *name = g_dir_read_name (dir))
+        {
+            gchar *sub = g_build_filename (path, name, NULL);
+            delete_one_by_one (sub);
+            g_free (sub);
+        }
+
+        g_dir_close (dir);
+    }
+
+    g_remove (path);
+}
+
+
+TEST(DeleteLocalBenchmark, HundredThousandFiles)
+{
+    if (!g_getenv ("GCMD_BENCHMARK"))
+        return;
+
+    gchar *base = g_dir_make_tmp ("gcmd-delete-local-XXXXXX", NULL);
+    gchar *native = g_build_filename (base, "native", NULL);
+    gchar *plain = g_build_filename (base, "plain", NULL);
+
+    mkdir (native, 0755);
+    mkdir (plain, 0755);
+    make_tree (native, 1000, 100);
+    make_tree (plain, 1000, 100);
+
+    gint64 start = g_get_monotonic_time ();
+    delete_one_by_one (plain);
+    gint64 plain_time = g_get_monotonic_time () - start;
+
+    start = g_get_monotonic_time ();
+    EXPECT_EQ (0, run_job (start_job (native), DELETE_LOCAL_ERROR_ACTION_ABORT));
+    gint64 native_time = g_get_monotonic_time () - start;
+
+    printf ("100k files: one by one %.1f ms, native %.1f ms\n", plain_time / 1000.0, native_time / 1000.0);
+
+    g_rmdir (base);
+    g_free (plain);
+    g_free (native);
+    g_free (base);
+}
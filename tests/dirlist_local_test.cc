@@ -0,0 +1,168 @@
+/**
+ * @file dirlist_local_test.cc
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @details Tests and benchmarks for the native listing of local
+ * directories. The listing of 100k and 1M entries directories is only
+ * timed if GCMD_BENCHMARK is set in the environment, as creating them
+ * takes a while.
+ *
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <gtest/gtest.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include "../src/dirlist-local.h"
+
+
+struct ListResult
+{
+    gint files;
+    gint dirs;
+    gint symlinks;
+    gint broken;
+};
+
+
+static void count_entries (DirListLocalEntry *entries, guint n, ListResult *res)
+{
+    for (guint i=0; i<n; ++i)
+    {
+        if (entries[i].is_broken)
+            g_atomic_int_inc (&res->broken);
+        else
+            if (S_ISDIR (entries[i].st.st_mode))
+                g_atomic_int_inc (&res->dirs);
+            else
+                g_atomic_int_inc (&res->files);
+
+        if (entries[i].is_symlink)
+            g_atomic_int_inc (&res->symlinks);
+    }
+}
+
+
+static gchar *create_test_dir (gint n_files)
+{
+    gchar *dir = g_dir_make_tmp ("gcmd-dirlist-XXXXXX", NULL);
+
+    for (gint i=0; i<n_files; ++i)
+    {
+        gchar *path = g_strdup_printf ("%s/file-%07d.txt", dir, i);
+        close (open (path, O_CREAT | O_WRONLY, 0644));
+        g_free (path);
+    }
+
+    return dir;
+}
+
+
+static void remove_test_dir (gchar *dir, gint n_files)
+{
+    for (gint i=0; i<n_files; ++i)
+    {
+        gchar *path = g_strdup_printf ("%s/file-%07d.txt", dir, i);
+        unlink (path);
+        g_free (path);
+    }
+
+    g_rmdir (dir);
+    g_free (dir);
+}
+
+
+TEST(DirListLocal, ListsAllKindsOfEntries)
+{
+    gchar *dir = create_test_dir (3);
+    gchar *subdir = g_build_filename (dir, "subdir", NULL);
+    gchar *link = g_build_filename (dir, "link", NULL);
+    gchar *broken = g_build_filename (dir, "broken", NULL);
+
+    ASSERT_EQ (0, mkdir (subdir, 0755));
+    ASSERT_EQ (0, symlink ("subdir", link));
+    ASSERT_EQ (0, symlink ("nowhere", broken));
+
+    ListResult res = {0, 0, 0, 0};
+
+    EXPECT_EQ (0, dirlist_local_scan (dir, (DirListLocalFunc) count_entries, &res, NULL, 2, 2));
+    EXPECT_EQ (3, res.files);
+    EXPECT_EQ (2, res.dirs);
+    EXPECT_EQ (2, res.symlinks);
+    EXPECT_EQ (1, res.broken);
+
+    unlink (broken);
+    unlink (link);
+    g_rmdir (subdir);
+    g_free (broken);
+    g_free (link);
+    g_free (subdir);
+    remove_test_dir (dir, 3);
+}
+
+
+TEST(DirListLocal, ReportsErrors)
+{
+    ListResult res = {0, 0, 0, 0};
+
+    EXPECT_EQ (ENOENT, dirlist_local_scan ("/nonexistent/gcmd", (DirListLocalFunc) count_entries, &res));
+    EXPECT_EQ (ENOTDIR, dirlist_local_scan ("/dev/null", (DirListLocalFunc) count_entries, &res));
+}
+
+
+TEST(DirListLocal, StopsWhenCancelled)
+{
+    gchar *dir = create_test_dir (100);
+    ListResult res = {0, 0, 0, 0};
+    volatile gint cancelled = TRUE;
+
+    EXPECT_EQ (0, dirlist_local_scan (dir, (DirListLocalFunc) count_entries, &res, &cancelled));
+    EXPECT_EQ (0, res.files);
+
+    remove_test_dir (dir, 100);
+}
+
+
+class DirListLocalBenchmark : public ::testing::TestWithParam<gint> {};
+
+INSTANTIATE_TEST_CASE_P(DirectorySizes,
+                        DirListLocalBenchmark,
+                        ::testing::Values(10000, 100000, 1000000));
+
+TEST_P(DirListLocalBenchmark, TimeListing)
+{
+    gint n_files = GetParam();
+
+    if (n_files>10000 && !g_getenv ("GCMD_BENCHMARK"))
+        return;
+
+    gchar *dir = create_test_dir (n_files);
+    ListResult res = {0, 0, 0, 0};
+
+    gint64 start = g_get_monotonic_time ();
+    EXPECT_EQ (0, dirlist_local_scan (dir, (DirListLocalFunc) count_entries, &res));
+    gint64 elapsed = g_get_monotonic_time () - start;
+
+    EXPECT_EQ (n_files, res.files);
+
+    printf ("listed %d entries in %.3f s\n", n_files, elapsed / (gdouble) G_USEC_PER_SEC);
+
+    remove_test_dir (dir, n_files);
+}
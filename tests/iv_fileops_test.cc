@@ -25,6 +25,9 @@
 #include <libgviewer.h>
 #include <gvtypes.h>
 #include <fileops.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 // The fixture for testing class FileOpsTest.
 class FileOpsTest : public ::testing::Test {};
@@ -52,3 +55,102 @@ TEST_F(FileOpsTest, gv_file_get_byte_does_read) {
     gv_file_free(fops);
     g_free(fops);
 }
+
+
+static gchar *make_sparse_file (offset_type size, const offset_type *offsets, int n_offsets)
+{
+    gchar *path = g_strdup ("/tmp/gcmd-fileops-XXXXXX");
+    int fd = mkstemp (path);
+
+    EXPECT_NE (-1, fd);
+    EXPECT_EQ (0, ftruncate (fd, (off_t) size));
+
+    // each marker is the low byte of its offset plus one, so that it isn't 0
+    for (int i=0; i<n_offsets; ++i)
+    {
+        unsigned char c = (unsigned char) (offsets[i] + 1);
+        EXPECT_EQ (1, pwrite (fd, &c, 1, (off_t) offsets[i]));
+    }
+
+    close (fd);
+
+    return path;
+}
+
+
+TEST_F(FileOpsTest, gv_file_get_byte_moves_windows) {
+    const offset_type size = (GV_WINDOWS_MAX + 2) * (offset_type) GV_WINDOW_SIZE + 123;
+    const offset_type offsets[] = {0, GV_WINDOW_SIZE - 1, GV_WINDOW_SIZE, 5 * (offset_type) GV_WINDOW_SIZE + 17, size - 1};
+    gchar *path = make_sparse_file (size, offsets, G_N_ELEMENTS(offsets));
+    ViewerFileOps *fops = gv_fileops_new();
+
+    ASSERT_NE (-1, gv_file_open(fops, path));
+    ASSERT_EQ (size, gv_file_get_max_offset(fops));
+
+    // forwards, backwards and across more windows than are kept
+    for (int pass=0; pass<2; ++pass)
+        for (int i=0; i<(int) G_N_ELEMENTS(offsets); ++i)
+        {
+            offset_type offset = offsets[pass ? G_N_ELEMENTS(offsets)-1-i : i];
+            EXPECT_EQ ((unsigned char) (offset + 1), gv_file_get_byte(fops, offset));
+        }
+
+    for (offset_type offset = 0; offset < size; offset += GV_WINDOW_SIZE / 2)
+        ASSERT_LE (0, gv_file_get_byte(fops, offset));
+
+    EXPECT_EQ (0, gv_file_get_byte(fops, GV_WINDOW_SIZE + 1));
+    EXPECT_EQ (-1, gv_file_get_byte(fops, size));
+
+    gv_file_free(fops);
+    g_free(fops);
+    unlink (path);
+    g_free (path);
+}
+
+
+TEST_F(FileOpsTest, gv_file_get_byte_beyond_4GB) {
+    const offset_type size = G_GUINT64_CONSTANT(5) << 30;
+    const offset_type offsets[] = {G_GUINT64_CONSTANT(4) << 30, (G_GUINT64_CONSTANT(4) << 30) + 7, size - 1};
+    gchar *path = make_sparse_file (size, offsets, G_N_ELEMENTS(offsets));
+    ViewerFileOps *fops = gv_fileops_new();
+
+    ASSERT_NE (-1, gv_file_open(fops, path));
+    ASSERT_EQ (size, gv_file_get_max_offset(fops));
+
+    for (int i=0; i<(int) G_N_ELEMENTS(offsets); ++i)
+        EXPECT_EQ ((unsigned char) (offsets[i] + 1), gv_file_get_byte(fops, offsets[i]));
+
+    gv_file_free(fops);
+    g_free(fops);
+    unlink (path);
+    g_free (path);
+}
+
+
+TEST_F(FileOpsTest, gv_file_get_bytes_spans_windows) {
+    const offset_type size = 3 * (offset_type) GV_WINDOW_SIZE + 5;
+    const offset_type offsets[] = {GV_WINDOW_SIZE - 2, GV_WINDOW_SIZE - 1, GV_WINDOW_SIZE, 2 * (offset_type) GV_WINDOW_SIZE, size - 1};
+    gchar *path = make_sparse_file (size, offsets, G_N_ELEMENTS(offsets));
+    ViewerFileOps *fops = gv_fileops_new();
+    unsigned char buffer[16];
+
+    ASSERT_NE (-1, gv_file_open(fops, path));
+
+    // the same bytes as one by one, across the ends of windows and of the file
+    const offset_type starts[] = {0, GV_WINDOW_SIZE - 8, 2 * (offset_type) GV_WINDOW_SIZE - 3, size - 16, size - 3, size};
+
+    for (int i=0; i<(int) G_N_ELEMENTS(starts); ++i)
+    {
+        int n = gv_file_get_bytes(fops, starts[i], buffer, sizeof(buffer));
+
+        ASSERT_EQ ((int) MIN(sizeof(buffer), size-starts[i]), n);
+
+        for (int j=0; j<n; ++j)
+            EXPECT_EQ (gv_file_get_byte(fops, starts[i]+j), buffer[j]);
+    }
+
+    gv_file_free(fops);
+    g_free(fops);
+    unlink (path);
+    g_free (path);
+}
@@ -10,6 +10,8 @@
  * Possible values: ASCII, CP437, UTF8 and all other encodings readable
  * by the iconv library. Currently you will find only a very simple,
  * nearly meaningless test. Many other tests of this module are missing.
+ * The benchmark of gv_input_mode_get_utf8_chars() only runs if
+ * GCMD_BENCHMARK is set in the environment.
  *
  * @copyright This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -28,6 +30,14 @@
 
 #include "gtest/gtest.h"
 #include <libgviewer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
 
 class ViewerInputModeTest : public ::testing::TestWithParam<const char *> {};
 
@@ -46,3 +56,133 @@ TEST_P(ViewerInputModeTest, gv_set_input_mode_test)
     gv_free_input_modes(imd);
     g_free(imd);
 }
+
+
+static int get_byte (string *text, offset_type offset)
+{
+    return offset<text->size() ? (guchar) (*text)[offset] : -1;
+}
+
+
+static int get_bytes (string *text, offset_type offset, unsigned char *buffer, int len)
+{
+    if (offset>=text->size())
+        return 0;
+
+    int n = MIN((offset_type) len, text->size()-offset);
+
+    memcpy (buffer, text->data()+offset, n);
+
+    return n;
+}
+
+
+/*
+    text with multibyte characters, CR/LF in all combinations, and broken sequences unless 'valid'
+*/
+static string random_text (gsize size, unsigned seed, gboolean valid=FALSE)
+{
+    const char *pieces[] = {"a", "text ", "\r", "\n", "\r\n", "\t", "\xc3\xa4", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "<&>",
+                            "\xc3", "\xe2\x82", "\x80", "\xff"};
+    string text;
+
+    srand (seed);
+
+    while (text.size()<size)
+        text += pieces[rand () % (valid ? 10 : G_N_ELEMENTS(pieces))];
+
+    return text;
+}
+
+
+static GVInputModesData *new_input_mode (const char *mode, string *text, gboolean bulk)
+{
+    GVInputModesData *imd = gv_input_modes_new();
+
+    gv_init_input_modes(imd, (get_byte_proc) get_byte, text, bulk ? (get_bytes_proc) get_bytes : NULL);
+    gv_set_input_mode(imd, mode);
+
+    return imd;
+}
+
+
+static void ignore_warning (const gchar *domain, GLogLevelFlags level, const gchar *message, gpointer user_data)
+{
+}
+
+
+TEST_P(ViewerInputModeTest, gv_input_mode_get_utf8_chars_test)
+{
+    // each invalid UTF-8 character decoded one by one is warned about
+    g_log_set_handler (NULL, G_LOG_LEVEL_WARNING, ignore_warning, NULL);
+
+    for (int bulk=0; bulk<2; ++bulk)
+        for (unsigned seed=1; seed<=20; ++seed)
+        {
+            // the last text is longer than a block decoded at once
+            string text = random_text (seed<20 ? rand () % 100 : 20000, seed);
+            GVInputModesData *imd = new_input_mode (GetParam(), &text, bulk);
+
+            offset_type offset = rand () % (text.size()+1);
+            int max_chars = 1 + rand () % (seed<20 ? 120 : 12000);
+            vector<char_type> chars(max_chars);
+            vector<offset_type> offsets(max_chars+1);
+
+            int count = gv_input_mode_get_utf8_chars(imd, offset, &chars[0], &offsets[0], max_chars);
+
+            ASSERT_EQ (offset, offsets[0]);
+
+            // the same characters as one by one
+            for (int i=0; i<count; ++i)
+            {
+                ASSERT_EQ (gv_input_mode_get_utf8_char(imd, offsets[i]), chars[i]) << seed << " " << i;
+                ASSERT_EQ (gv_input_get_next_char_offset(imd, offsets[i]), offsets[i+1]) << seed << " " << i;
+            }
+
+            // stopped only at the end of the text
+            if (count<max_chars)
+            {
+                ASSERT_EQ (INVALID_CHAR, gv_input_mode_get_utf8_char(imd, offsets[count])) << seed;
+            }
+
+            gv_free_input_modes(imd);
+            g_free(imd);
+        }
+}
+
+
+TEST_P(ViewerInputModeTest, gv_input_mode_get_utf8_chars_benchmark)
+{
+    if (!g_getenv ("GCMD_BENCHMARK"))
+        return;
+
+    const int CHUNK = 256;
+
+    string text = random_text (16 << 20, 1, TRUE);
+    GVInputModesData *imd = new_input_mode (GetParam(), &text, TRUE);
+    char_type sum = 0;
+    offset_type offset;
+
+    gint64 start = g_get_monotonic_time ();
+    for (offset=0; offset<text.size(); offset=gv_input_get_next_char_offset(imd, offset))
+        sum += gv_input_mode_get_utf8_char(imd, offset);
+    gint64 one_by_one_time = g_get_monotonic_time () - start;
+
+    char_type bulk_sum = 0;
+    char_type chars[CHUNK];
+    offset_type offsets[CHUNK+1];
+    int count;
+
+    start = g_get_monotonic_time ();
+    for (offset=0; (count = gv_input_mode_get_utf8_chars(imd, offset, chars, offsets, CHUNK))>0; offset=offsets[count])
+        for (int i=0; i<count; ++i)
+            bulk_sum += chars[i];
+    gint64 bulk_time = g_get_monotonic_time () - start;
+
+    EXPECT_EQ (sum, bulk_sum);
+
+    printf ("%s, 16 MB: one by one %.1f ms, in blocks %.1f ms\n", GetParam(), one_by_one_time / 1000.0, bulk_time / 1000.0);
+
+    gv_free_input_modes(imd);
+    g_free(imd);
+}
@@ -0,0 +1,191 @@
+/**
+ * @file iv_lineindex_test.cc
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @copyright (C) 2006 Assaf Gordon\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "gtest/gtest.h"
+#include <libgviewer.h>
+#include <gvtypes.h>
+#include <line-index.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+class LineIndexTest : public ::testing::TestWithParam<gboolean>
+{
+  protected:
+
+    gchar *path;
+    int fd;
+
+    virtual void SetUp()
+    {
+        path = g_strdup ("/tmp/gcmd-lineindex-XXXXXX");
+        fd = mkstemp (path);
+        ASSERT_NE (-1, fd);
+    }
+
+    virtual void TearDown()
+    {
+        close (fd);
+        unlink (path);
+        g_free (path);
+    }
+
+    void write_text (const string &text)
+    {
+        ASSERT_EQ ((ssize_t) text.size(), write (fd, text.data(), text.size()));
+    }
+
+    GVLineIndex *build (offset_type size)
+    {
+        GVLineIndex *idx = gv_line_index_new (fd, size, GetParam());
+
+        while (!gv_line_index_is_complete (idx))
+            g_usleep (1000);
+
+        return idx;
+    }
+};
+
+
+INSTANTIATE_TEST_CASE_P(InstantiationCrLf,
+                        LineIndexTest,
+                        ::testing::Values(FALSE, TRUE));
+
+
+/*
+    the line starts, the way the input modes move through the file
+*/
+static vector<offset_type> line_starts (const string &text, gboolean crlf)
+{
+    vector<offset_type> starts(1, 0);
+
+    for (offset_type i=0; i<text.size(); ++i)
+        if (text[i]=='\n' || (text[i]=='\r' && !(crlf && i+1<text.size() && text[i+1]=='\n')))
+            starts.push_back(i+1);
+
+    if (starts.back()!=text.size())
+        starts.push_back(text.size());
+
+    return starts;
+}
+
+
+TEST_P(LineIndexTest, finds_lines_and_offsets)
+{
+    string text;
+
+    srand (7);
+
+    // more lines than checkpoints, and more bytes than a block is read at once
+    while (text.size() < (3 << 20))
+    {
+        int len = rand () % 300;
+        for (int i=0; i<len; ++i)
+            text += 'a' + rand () % 26;
+
+        switch (rand () % 4)
+        {
+            case 0:  text += "\r\n"; break;
+            case 1:  text += '\r'; break;
+            default: text += '\n'; break;
+        }
+    }
+
+    write_text (text);
+
+    vector<offset_type> starts = line_starts (text, GetParam());
+    GVLineIndex *idx = build (text.size());
+
+    ASSERT_EQ (starts.size(), gv_line_index_get_line_count (idx));
+
+    for (guint64 line=0; line<starts.size(); line+=1 + rand () % 97)
+    {
+        offset_type offset;
+        guint64 found;
+
+        ASSERT_TRUE (gv_line_index_get_offset (idx, line, &offset));
+        ASSERT_EQ (starts[line], offset);
+
+        ASSERT_TRUE (gv_line_index_get_line (idx, offset, &found));
+        ASSERT_EQ (line, found);
+
+        // the last byte of the line before belongs to it
+        if (line>0)
+        {
+            ASSERT_TRUE (gv_line_index_get_line (idx, offset-1, &found));
+            ASSERT_EQ (line-1, found);
+        }
+    }
+
+    offset_type offset;
+    ASSERT_TRUE (gv_line_index_get_offset (idx, starts.size()+10, &offset));
+    ASSERT_EQ (text.size(), offset);
+
+    gv_line_index_free (idx);
+}
+
+
+TEST_P(LineIndexTest, handles_short_files)
+{
+    const char *texts[] = {"", "a", "\n", "\r", "\r\n", "a\r\nb", "\n\n\r\r\n"};
+
+    for (guint i=0; i<G_N_ELEMENTS(texts); ++i)
+    {
+        ASSERT_EQ (0, ftruncate (fd, 0));
+        ASSERT_EQ (0, lseek (fd, 0, SEEK_SET));
+        write_text (texts[i]);
+
+        vector<offset_type> starts = line_starts (texts[i], GetParam());
+        GVLineIndex *idx = build (strlen (texts[i]));
+
+        ASSERT_EQ (starts.size(), gv_line_index_get_line_count (idx)) << i;
+
+        for (guint64 line=0; line<starts.size(); ++line)
+        {
+            offset_type offset;
+            ASSERT_TRUE (gv_line_index_get_offset (idx, line, &offset));
+            ASSERT_EQ (starts[line], offset) << i;
+        }
+
+        gv_line_index_free (idx);
+    }
+}
+
+
+TEST_P(LineIndexTest, can_be_dropped_while_building)
+{
+    string line(99, 'x');
+    line += '\n';
+
+    for (int i=0; i<20000; ++i)
+        write_text (line);
+
+    GVLineIndex *idx = gv_line_index_new (fd, line.size() * 20000, GetParam());
+    gv_line_index_free (idx);
+}
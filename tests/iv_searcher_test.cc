@@ -0,0 +1,347 @@
+/**
+ * @file iv_searcher_test.cc
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @copyright (C) 2006 Assaf Gordon\n
+ * @copyright (C) 2007-2012 Piotr Eljasiak\n
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "gtest/gtest.h"
+#include <libgviewer.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <numeric>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+class ViewerSearcherTest : public ::testing::TestWithParam<const char *>
+{
+  protected:
+
+    gchar *path;
+    ViewerFileOps *fops;
+    GVInputModesData *imd;
+
+    virtual void SetUp()
+    {
+        path = g_strdup ("/tmp/gcmd-searcher-XXXXXX");
+        close (mkstemp (path));
+        fops = NULL;
+        imd = NULL;
+    }
+
+    virtual void TearDown()
+    {
+        if (imd)
+        {
+            gv_free_input_modes(imd);
+            g_free (imd);
+        }
+        if (fops)
+        {
+            gv_file_free(fops);
+            g_free (fops);
+        }
+        unlink (path);
+        g_free (path);
+    }
+
+    void load (const string &text)
+    {
+        FILE *f = fopen (path, "w");
+        ASSERT_EQ (text.size(), fwrite (text.data(), 1, text.size(), f));
+        fclose (f);
+
+        fops = gv_fileops_new();
+        ASSERT_NE (-1, gv_file_open(fops, path));
+
+        imd = gv_input_modes_new();
+        gv_init_input_modes(imd, (get_byte_proc) gv_file_get_byte, fops, (get_bytes_proc) gv_file_get_bytes);
+        gv_set_input_mode(imd, GetParam());
+    }
+
+    /*
+        the offsets the searcher finds one after the other, as "find next" does
+    */
+    vector<offset_type> find_all (GViewerSearcher *srchr)
+    {
+        vector<offset_type> found;
+
+        while (TRUE)
+        {
+            g_viewer_searcher_start_search(srchr, TRUE);
+            g_viewer_searcher_join(srchr);
+
+            if (g_viewer_searcher_get_end_of_search(srchr))
+                break;
+
+            found.push_back(g_viewer_searcher_get_search_result(srchr));
+        }
+
+        return found;
+    }
+
+    void index (GViewerSearcher *srchr)
+    {
+        ASSERT_TRUE (g_viewer_searcher_start_find_all(srchr));
+
+        while (g_viewer_searcher_get_find_all_state(srchr)==FIND_ALL_RUNNING)
+            g_usleep (1000);
+    }
+
+    /*
+        the offsets found one after the other by lookups in the index
+    */
+    vector<offset_type> find_indexed (GViewerSearcher *srchr, gboolean forward)
+    {
+        vector<offset_type> found;
+
+        while (g_viewer_searcher_find_indexed(srchr, forward) && !g_viewer_searcher_get_end_of_search(srchr))
+            found.push_back(g_viewer_searcher_get_search_result(srchr));
+
+        return found;
+    }
+
+    void expect_density (GViewerSearcher *srchr, const vector<offset_type> &expected)
+    {
+        guint bins[13];
+        g_viewer_searcher_get_hit_density(srchr, bins, G_N_ELEMENTS(bins));
+
+        // every MB boundary has a match just before it
+        for (guint b=0; b<G_N_ELEMENTS(bins); ++b)
+            EXPECT_LT (0, bins[b]) << b;
+
+        EXPECT_EQ (expected.size(), accumulate (bins, bins+G_N_ELEMENTS(bins), 0u));
+    }
+};
+
+
+INSTANTIATE_TEST_CASE_P(InstantiationInputModes,
+                        ViewerSearcherTest,
+                        ::testing::Values("ASCII", "UTF8"));
+
+
+static void ignore_warning (const gchar *domain, GLogLevelFlags level, const gchar *message, gpointer user_data)
+{
+}
+
+
+/*
+    some MB of text, with 'needle' put all over it, and across every MB boundary
+*/
+static string make_text (const string &needle)
+{
+    const char *pieces[] = {"a", "text ", "\r", "\n", "\r\n", "\xc3\xa4", "\xe2\x82\xac", "\xc3", "\x80", "\xff"};
+    string text;
+
+    srand (11);
+
+    while (text.size() < (13 << 20))
+    {
+        if (rand () % 50000 == 0)
+            text += needle;
+
+        if ((text.size() & 0xfffff) > 0xffff0)
+        {
+            text.resize(text.size() + 0xfffff - (text.size() & 0xfffff) - rand () % 4);
+            text += needle;
+        }
+
+        text += pieces[rand () % G_N_ELEMENTS(pieces)];
+    }
+
+    return text;
+}
+
+
+TEST_P(ViewerSearcherTest, finds_text_in_order)
+{
+    // a character of its own in each input mode
+    const gchar *needle = g_str_equal (GetParam(), "UTF8") ? "x\xe2\x82\xac" "ab" : "x\rab";
+
+    g_log_set_handler (NULL, G_LOG_LEVEL_WARNING, ignore_warning, NULL);
+
+    string text = make_text (needle);
+    load (text);
+
+    // the matches in the characters decoded from the start
+    int m;
+    char_type *pattern = convert_utf8_to_chartype_array(needle, m);
+    vector<char_type> chars(text.size());
+    vector<offset_type> offsets(text.size()+1);
+    int count = gv_input_mode_get_utf8_chars(imd, 0, &chars[0], &offsets[0], text.size());
+    vector<offset_type> expected;
+
+    for (int j=0; j+m<=count; ++j)
+        if (offsets[j]+m<=text.size() && equal (pattern, pattern+m, chars.begin()+j))
+            expected.push_back(offsets[j]);
+
+    g_free (pattern);
+
+    ASSERT_LT (20, expected.size());
+
+    GViewerSearcher *srchr = g_viewer_searcher_new();
+    g_viewer_searcher_setup_new_text_search(srchr, imd, fops, 0, gv_file_get_max_offset(fops), needle, TRUE);
+
+    EXPECT_EQ (expected, find_all (srchr));
+
+    g_object_unref (srchr);
+}
+
+
+TEST_P(ViewerSearcherTest, indexes_all_text)
+{
+    const gchar *needle = g_str_equal (GetParam(), "UTF8") ? "x\xe2\x82\xac" "ab" : "x\rab";
+
+    g_log_set_handler (NULL, G_LOG_LEVEL_WARNING, ignore_warning, NULL);
+
+    string text = make_text (needle);
+    load (text);
+
+    GViewerSearcher *srchr = g_viewer_searcher_new();
+    g_viewer_searcher_setup_new_text_search(srchr, imd, fops, 0, gv_file_get_max_offset(fops), needle, TRUE);
+
+    // the same matches as found one at a time
+    vector<offset_type> expected = find_all (srchr);
+    ASSERT_LT (20, expected.size());
+
+    g_object_unref (srchr);
+    srchr = g_viewer_searcher_new();
+    g_viewer_searcher_setup_new_text_search(srchr, imd, fops, 0, gv_file_get_max_offset(fops), needle, TRUE);
+
+    index (srchr);
+
+    ASSERT_EQ (FIND_ALL_DONE, g_viewer_searcher_get_find_all_state(srchr));
+    EXPECT_EQ (expected.size(), g_viewer_searcher_get_hit_count(srchr));
+    EXPECT_EQ (expected, find_indexed (srchr, TRUE));
+
+    // backwards from right after the start of the last match, the ends of the ones before it are found,
+    // the needle is as long in both input modes
+    vector<offset_type> ends;
+    for (size_t i=expected.size()-1; i>0; --i)
+        ends.push_back(expected[i-1] + strlen (needle));
+
+    EXPECT_EQ (ends, find_indexed (srchr, FALSE));
+
+    expect_density (srchr, expected);
+
+    g_object_unref (srchr);
+}
+
+
+TEST_P(ViewerSearcherTest, finds_bytes_in_order)
+{
+    const guint8 needle[] = {0xbb, 0xbb, 0xcc, 0xbb};
+
+    string text = make_text (string((const char *) needle, sizeof(needle)));
+
+    // the bad character rule must not skip this one
+    text += "\xcc\xbb\xcc\xbb\xbb\xcc\xbb";
+    load (text);
+
+    vector<offset_type> expected;
+
+    for (size_t pos=text.find((const char *) needle, 0, sizeof(needle)); pos!=string::npos; pos=text.find((const char *) needle, pos+1, sizeof(needle)))
+        expected.push_back(pos);
+
+    ASSERT_LT (20, expected.size());
+
+    GViewerSearcher *srchr = g_viewer_searcher_new();
+    g_viewer_searcher_setup_new_hex_search(srchr, imd, fops, 0, gv_file_get_max_offset(fops), needle, sizeof(needle));
+
+    EXPECT_EQ (expected, find_all (srchr));
+
+    g_object_unref (srchr);
+}
+
+
+TEST_P(ViewerSearcherTest, indexes_all_bytes)
+{
+    const guint8 needle[] = {0xbb, 0xbb, 0xcc, 0xbb};
+
+    string text = make_text (string((const char *) needle, sizeof(needle)));
+    load (text);
+
+    vector<offset_type> expected;
+
+    for (size_t pos=text.find((const char *) needle, 0, sizeof(needle)); pos!=string::npos; pos=text.find((const char *) needle, pos+1, sizeof(needle)))
+        expected.push_back(pos);
+
+    GViewerSearcher *srchr = g_viewer_searcher_new();
+    g_viewer_searcher_setup_new_hex_search(srchr, imd, fops, 0, gv_file_get_max_offset(fops), needle, sizeof(needle));
+
+    index (srchr);
+
+    ASSERT_EQ (FIND_ALL_DONE, g_viewer_searcher_get_find_all_state(srchr));
+    EXPECT_EQ (expected.size(), g_viewer_searcher_get_hit_count(srchr));
+    EXPECT_EQ (expected, find_indexed (srchr, TRUE));
+
+    // backwards from right after the start of the last match, the last bytes of the ones before it are found
+    vector<offset_type> lasts;
+    for (size_t i=expected.size()-1; i>0; --i)
+        lasts.push_back(expected[i-1] + sizeof(needle) - 1);
+
+    EXPECT_EQ (lasts, find_indexed (srchr, FALSE));
+
+    expect_density (srchr, expected);
+
+    g_object_unref (srchr);
+}
+
+
+TEST_P(ViewerSearcherTest, gives_up_on_too_many_matches)
+{
+    const guint8 needle[] = {'a'};
+
+    load (string(5 << 20, 'a'));
+
+    GViewerSearcher *srchr = g_viewer_searcher_new();
+    g_viewer_searcher_setup_new_hex_search(srchr, imd, fops, 0, gv_file_get_max_offset(fops), needle, sizeof(needle));
+
+    index (srchr);
+
+    EXPECT_EQ (FIND_ALL_TOO_MANY, g_viewer_searcher_get_find_all_state(srchr));
+    EXPECT_FALSE (g_viewer_searcher_find_indexed(srchr, TRUE));
+
+    // the searches go on without the index
+    g_viewer_searcher_start_search(srchr, TRUE);
+    g_viewer_searcher_join(srchr);
+    EXPECT_FALSE (g_viewer_searcher_get_end_of_search(srchr));
+    EXPECT_EQ (0, g_viewer_searcher_get_search_result(srchr));
+
+    g_object_unref (srchr);
+}
+
+
+TEST_P(ViewerSearcherTest, can_be_dropped_while_finding_all)
+{
+    const guint8 needle[] = {'b'};
+
+    load (string(20 << 20, 'a'));
+
+    GViewerSearcher *srchr = g_viewer_searcher_new();
+    g_viewer_searcher_setup_new_hex_search(srchr, imd, fops, 0, gv_file_get_max_offset(fops), needle, sizeof(needle));
+
+    ASSERT_TRUE (g_viewer_searcher_start_find_all(srchr));
+
+    g_object_unref (srchr);
+}
@@ -0,0 +1,177 @@
+/**
+ * @file name_match_test.cc
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @details Tests for the incremental name matching of the quick search.
+ *
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <gtest/gtest.h>
+#include <fnmatch.h>
+
+#include "../src/name-match.h"
+
+using namespace std;
+
+
+static const gchar *NAMES[] = {"README", "readme.txt", "Makefile.am", "main.cc", "MAIN.H", "Ärger.txt", "ärger.doc", "", "a.out"};
+
+
+static vector<const gchar *> names ()
+{
+    return vector<const gchar *>(NAMES, NAMES + G_N_ELEMENTS(NAMES));
+}
+
+
+static vector<guint32> find (NameMatch *m, const gchar *text)
+{
+    vector<guint32> found;
+
+    EXPECT_TRUE (name_match_find (m, text, found));
+
+    return found;
+}
+
+
+/**
+ * Returns what the quick search found with fnmatch() before.
+ */
+static vector<guint32> fnmatch_find (const vector<const gchar *> &names, const gchar *text, NameMatchMode mode, gboolean case_sens)
+{
+    gchar *pattern = mode==NAME_MATCH_EXACT ? g_strdup (text) :
+                     mode==NAME_MATCH_PREFIX ? g_strconcat (text, "*", NULL) :
+                     mode==NAME_MATCH_SUFFIX ? g_strconcat ("*", text, NULL) :
+                                               g_strconcat ("*", text, "*", NULL);
+    vector<guint32> found;
+
+    for (guint32 i=0; i<names.size(); ++i)
+        if (fnmatch (pattern, names[i], case_sens ? FNM_NOESCAPE : FNM_NOESCAPE|FNM_CASEFOLD)==0)
+            found.push_back(i);
+
+    g_free (pattern);
+
+    return found;
+}
+
+
+TEST(NameMatchTest, FindsSubstrings)
+{
+    NameMatch *m = name_match_new (names (), FALSE, NAME_MATCH_SUBSTRING);
+
+    vector<guint32> found = find (m, "MA");
+    ASSERT_EQ (3, found.size());
+    EXPECT_EQ (2, found[0]);
+    EXPECT_EQ (3, found[1]);
+    EXPECT_EQ (4, found[2]);
+
+    found = find (m, "ärg");
+    ASSERT_EQ (2, found.size());
+    EXPECT_EQ (5, found[0]);
+    EXPECT_EQ (6, found[1]);
+
+    EXPECT_EQ (G_N_ELEMENTS(NAMES), find (m, "").size());
+    EXPECT_TRUE (find (m, "nothing").empty());
+
+    name_match_free (m);
+}
+
+
+TEST(NameMatchTest, HonoursTheMode)
+{
+    NameMatch *m = name_match_new (names (), FALSE, NAME_MATCH_PREFIX);
+    vector<guint32> found = find (m, "read");
+    EXPECT_EQ (2, found.size());
+    name_match_free (m);
+
+    m = name_match_new (names (), FALSE, NAME_MATCH_SUFFIX);
+    found = find (m, ".TXT");
+    ASSERT_EQ (2, found.size());
+    EXPECT_EQ (1, found[0]);
+    EXPECT_EQ (5, found[1]);
+    name_match_free (m);
+
+    m = name_match_new (names (), FALSE, NAME_MATCH_EXACT);
+    found = find (m, "main.h");
+    ASSERT_EQ (1, found.size());
+    EXPECT_EQ (4, found[0]);
+    EXPECT_TRUE (find (m, "main").empty());
+    name_match_free (m);
+
+    m = name_match_new (names (), TRUE, NAME_MATCH_SUBSTRING);
+    found = find (m, "MA");
+    ASSERT_EQ (1, found.size());
+    EXPECT_EQ (4, found[0]);
+    name_match_free (m);
+}
+
+
+TEST(NameMatchTest, NarrowsAndWidensAsTheQueryIsTyped)
+{
+    const NameMatchMode modes[] = {NAME_MATCH_SUBSTRING, NAME_MATCH_PREFIX, NAME_MATCH_SUFFIX, NAME_MATCH_EXACT};
+    const gchar *typed[] = {"m", "ma", "mai", "main", "main.", "main.c", "main.cc", "main.c", "mai", "a", "a.", "a.o", "", "e", "me", "d"};
+
+    vector<const gchar *> many;
+
+    for (guint i=0; i<2000; ++i)
+        many.push_back(g_strdup_printf ("%s-%u.%s", i%3 ? "main" : "Readme", i, i%2 ? "cc" : "out"));
+
+    for (guint i=0; i<G_N_ELEMENTS(NAMES); ++i)
+        many.push_back(g_strdup (NAMES[i]));
+
+    for (guint j=0; j<G_N_ELEMENTS(modes); ++j)
+        for (gboolean case_sens=FALSE; case_sens<=TRUE; ++case_sens)
+        {
+            NameMatch *m = name_match_new (many, case_sens, modes[j]);
+
+            for (guint k=0; k<G_N_ELEMENTS(typed); ++k)
+                EXPECT_EQ (fnmatch_find (many, typed[k], modes[j], case_sens), find (m, typed[k])) << typed[k];
+
+            name_match_free (m);
+        }
+
+    for (guint i=0; i<many.size(); ++i)
+        g_free ((gpointer) many[i]);
+}
+
+
+TEST(NameMatchTest, KnowsWildcards)
+{
+    EXPECT_TRUE (name_match_is_plain ("main.cc"));
+    EXPECT_FALSE (name_match_is_plain ("*.cc"));
+    EXPECT_FALSE (name_match_is_plain ("main.?"));
+    EXPECT_FALSE (name_match_is_plain ("[mM]ain"));
+}
+
+
+TEST(NameMatchTest, CanBeCancelled)
+{
+    vector<const gchar *> many(100000, "same name");
+    NameMatch *m = name_match_new (many, FALSE, NAME_MATCH_SUBSTRING);
+    vector<guint32> found;
+    gint cancelled = TRUE;
+
+    EXPECT_FALSE (name_match_find (m, "name", found, &cancelled));
+
+    // nothing was kept of it
+    cancelled = FALSE;
+    EXPECT_TRUE (name_match_find (m, "name", found, &cancelled));
+    EXPECT_EQ (many.size(), found.size());
+
+    name_match_free (m);
+}
@@ -0,0 +1,458 @@
+/**
+ * @file search_index_test.cc
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @details Tests for the persistent file name index used by local
+ * searches, and a benchmark comparing a name search in the index with
+ * reading the directories, over 200k files. The benchmark only runs if
+ * GCMD_BENCHMARK is set in the environment.
+ *
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <gtest/gtest.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <set>
+#include <string>
+
+#include "../src/search-index.h"
+#include "gcmd_tests_fs.h"
+
+using namespace std;
+
+
+struct Found
+{
+    set<string> paths;
+    set<string> unindexed;
+    gint max_depth;
+    const gchar *root;
+
+    explicit Found(const gchar *dir): max_depth(-2), root(dir)   {}
+};
+
+
+static void on_found (const gchar *path, Found *found)
+{
+    found->paths.insert(path + strlen (found->root) + 1);
+}
+
+
+static void on_unindexed (const gchar *path, gint max_depth, Found *found)
+{
+    found->unindexed.insert(path + strlen (found->root) + 1);
+    found->max_depth = max_depth;
+}
+
+
+static gboolean name_is_txt (const gchar *name, gpointer unused)
+{
+    return fnmatch ("*.txt", name, 0)==0;
+}
+
+
+static gboolean name_is_deep (const gchar *name, gpointer unused)
+{
+    return strcmp (name, "deep")==0;
+}
+
+
+/**
+ * root/a.txt
+ * root/b.dat           12 bytes
+ * root/sub/c.txt
+ * root/sub/deep/d.txt
+ * root/link.txt        -> a.txt
+ * root/loop            -> . (must not be followed)
+ */
+class SearchIndexTest : public GcmdTmpDirTest
+{
+  protected:
+
+    gchar *root;
+    gchar *index_file;
+
+    virtual void SetUp()
+    {
+        GcmdTmpDirTest::SetUp();
+
+        // the index stores resolved paths
+        gchar *real_tmp = realpath (base, NULL);
+
+        index_file = g_build_filename (real_tmp, "index", NULL);
+        root = g_build_filename (real_tmp, "tree", NULL);
+
+        gchar *tree = root;
+        gchar *sub = g_build_filename (tree, "sub", NULL);
+        gchar *deep = g_build_filename (sub, "deep", NULL);
+
+        mkdir (tree, 0755);
+        mkdir (sub, 0755);
+        mkdir (deep, 0755);
+
+        write_file (tree, "a.txt", "a");
+        write_file (tree, "b.dat", "twelve bytes");
+        write_file (sub, "c.txt", "c");
+        write_file (deep, "d.txt", "d");
+
+        gchar *link = g_build_filename (tree, "link.txt", NULL);
+        gchar *loop = g_build_filename (tree, "loop", NULL);
+        symlink ("a.txt", link);
+        symlink (".", loop);
+
+        g_free (link);
+        g_free (loop);
+        g_free (deep);
+        g_free (sub);
+        free (real_tmp);
+    }
+
+    virtual void TearDown()
+    {
+        g_free (index_file);
+        g_free (root);
+        GcmdTmpDirTest::TearDown();
+    }
+
+    gint query(Found &found, const gchar *path=NULL, gint max_depth=-1, guint *n_stale=NULL, guint64 min_size=0, SearchLocalNameFunc name_matches=name_is_txt)
+    {
+        SearchIndex *index = search_index_open (index_file);
+
+        if (!index)
+            return -1;
+
+        SearchIndexQuery query;
+
+        query.max_depth = max_depth;
+        query.name_matches = name_matches;
+        query.min_size = min_size;
+        query.found = (SearchLocalFunc) on_found;
+        query.unindexed_dir = (SearchIndexDirFunc) on_unindexed;
+        query.user_data = &found;
+
+        gint retval = search_index_query (index, path ? path : root, query, n_stale);
+
+        search_index_close (index);
+
+        return retval;
+    }
+};
+
+
+static set<string> all_txt()
+{
+    set<string> expected;
+
+    expected.insert("a.txt");
+    expected.insert("link.txt");
+    expected.insert("sub/c.txt");
+    expected.insert("sub/deep/d.txt");
+
+    return expected;
+}
+
+
+TEST_F(SearchIndexTest, FindsMountRoot)
+{
+    gchar *mount_root = search_index_mount_root (root);
+
+    ASSERT_TRUE (mount_root != NULL);
+    EXPECT_TRUE (g_str_has_prefix (root, mount_root));
+
+    struct stat st1, st2;
+
+    EXPECT_EQ (0, stat (root, &st1));
+    EXPECT_EQ (0, stat (mount_root, &st2));
+    EXPECT_EQ (st1.st_dev, st2.st_dev);
+
+    g_free (mount_root);
+}
+
+
+TEST_F(SearchIndexTest, MatchesNames)
+{
+    ASSERT_EQ (0, search_index_update (index_file, root));
+
+    Found found(root);
+    guint n_stale = 99;
+
+    EXPECT_EQ (0, query(found, NULL, -1, &n_stale));
+    EXPECT_EQ (all_txt(), found.paths);
+    EXPECT_TRUE (found.unindexed.empty());
+
+    // just written, so the directories are still considered as changed
+    EXPECT_EQ (3u, n_stale);
+}
+
+
+TEST_F(SearchIndexTest, SearchesSubtrees)
+{
+    ASSERT_EQ (0, search_index_update (index_file, root));
+
+    gchar *sub = g_build_filename (root, "sub", NULL);
+    Found found(sub);
+
+    EXPECT_EQ (0, query(found, sub));
+    EXPECT_EQ (2u, found.paths.size());
+    EXPECT_EQ (1u, found.paths.count("deep/d.txt"));
+
+    Found shallow(sub);
+
+    EXPECT_EQ (0, query(shallow, sub, 0));
+    EXPECT_EQ (1u, shallow.paths.size());
+    EXPECT_EQ (1u, shallow.paths.count("c.txt"));
+
+    g_free (sub);
+}
+
+
+TEST_F(SearchIndexTest, FiltersSizes)
+{
+    write_file (root, "big.txt", "more than twelve bytes");
+
+    ASSERT_EQ (0, search_index_update (index_file, root));
+
+    Found found(root);
+
+    EXPECT_EQ (0, query(found, NULL, -1, NULL, 12));
+    EXPECT_EQ (1u, found.paths.size());
+    EXPECT_EQ (1u, found.paths.count("big.txt"));
+}
+
+
+TEST_F(SearchIndexTest, SeesChanges)
+{
+    ASSERT_EQ (0, search_index_update (index_file, root));
+
+    gchar *sub = g_build_filename (root, "sub", NULL);
+    gchar *deep = g_build_filename (root, "sub", "deep", NULL);
+    gchar *fresh = g_build_filename (root, "sub", "fresh", NULL);
+
+    remove_tree (deep);
+    mkdir (fresh, 0755);
+    write_file (fresh, "f.txt", "f");
+    write_file (sub, "e.txt", "e");
+
+    Found found(root);
+    guint n_stale = 0;
+
+    EXPECT_EQ (0, query(found, NULL, -1, &n_stale));
+    EXPECT_LT (0u, n_stale);
+    EXPECT_EQ (4u, found.paths.size());
+    EXPECT_EQ (1u, found.paths.count("sub/e.txt"));
+    EXPECT_EQ (0u, found.paths.count("sub/deep/d.txt"));
+
+    // the new directory is left to the caller
+    EXPECT_EQ (1u, found.unindexed.size());
+    EXPECT_EQ (1u, found.unindexed.count("sub/fresh"));
+    EXPECT_EQ (-1, found.max_depth);
+
+    Found limited(root);
+
+    EXPECT_EQ (0, query(limited, NULL, 2));
+    EXPECT_EQ (0, limited.max_depth);
+
+    // and in the index after the update
+    ASSERT_EQ (0, search_index_update (index_file, root));
+
+    Found updated(root);
+    set<string> expected = all_txt();
+
+    expected.erase("sub/deep/d.txt");
+    expected.insert("sub/e.txt");
+    expected.insert("sub/fresh/f.txt");
+
+    EXPECT_EQ (0, query(updated));
+    EXPECT_EQ (expected, updated.paths);
+    EXPECT_TRUE (updated.unindexed.empty());
+
+    g_free (fresh);
+    g_free (deep);
+    g_free (sub);
+}
+
+
+TEST_F(SearchIndexTest, ReusesUnchangedDirectories)
+{
+    ASSERT_EQ (0, search_index_update (index_file, root));
+
+    // let the directories age past the racy window, then update from the old index
+    gchar *sub = g_build_filename (root, "sub", NULL);
+
+    sleep (3);
+
+    ASSERT_EQ (0, search_index_update (index_file, root));
+
+    Found before(root);
+    guint n_stale = 99;
+
+    EXPECT_EQ (0, query(before, NULL, -1, &n_stale));
+    EXPECT_EQ (0u, n_stale);
+    EXPECT_EQ (all_txt(), before.paths);
+
+    // a file created without the index knowing is found by reading its directory again
+    write_file (sub, "g.txt", "g");
+
+    ASSERT_EQ (0, search_index_update (index_file, root));
+
+    Found after(root);
+
+    EXPECT_EQ (0, query(after));
+    EXPECT_EQ (1u, after.paths.count("sub/g.txt"));
+    EXPECT_EQ (5u, after.paths.size());
+
+    g_free (sub);
+}
+
+
+TEST_F(SearchIndexTest, MatchesDirectoryNames)
+{
+    ASSERT_EQ (0, search_index_update (index_file, root));
+
+    // found by reading the directories again
+    Found changed(root);
+
+    EXPECT_EQ (0, query(changed, NULL, -1, NULL, 0, name_is_deep));
+    EXPECT_EQ (1u, changed.paths.size());
+    EXPECT_EQ (1u, changed.paths.count("sub/deep"));
+
+    sleep (3);
+
+    ASSERT_EQ (0, search_index_update (index_file, root));
+
+    // and in the index
+    Found indexed(root);
+    guint n_stale = 99;
+
+    EXPECT_EQ (0, query(indexed, NULL, -1, &n_stale, 0, name_is_deep));
+    EXPECT_EQ (0u, n_stale);
+    EXPECT_EQ (1u, indexed.paths.size());
+    EXPECT_EQ (1u, indexed.paths.count("sub/deep"));
+}
+
+
+TEST_F(SearchIndexTest, RejectsInvalidIndexes)
+{
+    Found found(root);
+
+    EXPECT_EQ (NULL, search_index_open (index_file));
+
+    g_file_set_contents (index_file, "GCMDIX01 but nothing else", -1, NULL);
+
+    EXPECT_EQ (NULL, search_index_open (index_file));
+    EXPECT_EQ (ENOENT, search_index_update (index_file, "/nonexistent/gcmd"));
+
+    // an index of another directory
+    gchar *sub = g_build_filename (root, "sub", NULL);
+
+    ASSERT_EQ (0, search_index_update (index_file, sub));
+    EXPECT_EQ (ENOENT, query(found, root));
+    EXPECT_EQ (ENOENT, query(found, "/nonexistent/gcmd"));
+
+    g_free (sub);
+}
+
+
+TEST(SearchIndexBenchmark, TwoHundredThousandFiles)
+{
+    if (!g_getenv ("GCMD_BENCHMARK"))
+        return;
+
+    gchar *tmp = g_dir_make_tmp ("gcmd-index-XXXXXX", NULL);
+    gchar *root = realpath (tmp, NULL);
+    gchar *tree = g_build_filename (root, "tree", NULL);
+    gchar *index_file = g_build_filename (root, "index", NULL);
+
+    mkdir (tree, 0755);
+
+    for (gint i=0; i<200; ++i)
+    {
+        gchar *dir_name = g_strdup_printf ("dir-%03d", i);
+        gchar *dir = g_build_filename (tree, dir_name, NULL);
+
+        mkdir (dir, 0755);
+
+        for (gint j=0; j<1000; ++j)
+        {
+            gchar *name = g_strdup_printf ("file-%04d.%s", j, j % 100 ? "dat" : "txt");
+            write_file (dir, name, "");
+            g_free (name);
+        }
+
+        g_free (dir);
+        g_free (dir_name);
+    }
+
+    sleep (3);
+
+    gint64 start = g_get_monotonic_time ();
+    ASSERT_EQ (0, search_index_update (index_file, tree));
+    gint64 build_time = g_get_monotonic_time () - start;
+
+    start = g_get_monotonic_time ();
+    ASSERT_EQ (0, search_index_update (index_file, tree));
+    gint64 update_time = g_get_monotonic_time () - start;
+
+    Found indexed(tree);
+    SearchIndexQuery query;
+
+    query.name_matches = name_is_txt;
+    query.found = (SearchLocalFunc) on_found;
+    query.user_data = &indexed;
+
+    start = g_get_monotonic_time ();
+
+    SearchIndex *index = search_index_open (index_file);
+    ASSERT_TRUE (index != NULL);
+    EXPECT_EQ (0, search_index_query (index, tree, query));
+    search_index_close (index);
+
+    gint64 query_time = g_get_monotonic_time () - start;
+
+    Found traversed(tree);
+    SearchLocalParams params;
+
+    params.name_matches = name_is_txt;
+    params.found = (SearchLocalFunc) on_found;
+    params.user_data = &traversed;
+    params.n_workers = 1;
+
+    start = g_get_monotonic_time ();
+    EXPECT_EQ (0, search_local (tree, params));
+    gint64 traversal_time = g_get_monotonic_time () - start;
+
+    EXPECT_EQ (2000u, indexed.paths.size());
+    EXPECT_EQ (traversed.paths, indexed.paths);
+
+    printf ("200000 files: index built in %.3f s, updated in %.3f s, searched in %.1f ms, traversal %.1f ms\n",
+            build_time / (gdouble) G_USEC_PER_SEC, update_time / (gdouble) G_USEC_PER_SEC, query_time / 1000.0, traversal_time / 1000.0);
+
+    remove_tree (root);
+
+    g_free (index_file);
+    g_free (tree);
+    free (root);
+    g_free (tmp);
+}
@@ -0,0 +1,462 @@
+/**
+ * @file search_local_test.cc
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @details Tests and benchmarks for the parallel search of local
+ * directory trees and its literal prefilter. The benchmarks search the
+ * content of a tree of 20k files with 1, 2 and 4 workers, and compare the
+ * literal scan with regexec() on 64 MB of text. They only run if
+ * GCMD_BENCHMARK is set in the environment.
+ *
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <gtest/gtest.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <set>
+#include <string>
+
+#include "../src/search-local.h"
+#include "gcmd_tests_fs.h"
+
+using namespace std;
+
+
+struct Found
+{
+    GMutex lock;
+    set<string> paths;
+    const gchar *root;
+
+    explicit Found(const gchar *dir): root(dir)     {  g_mutex_init (&lock);   }
+    ~Found()                                        {  g_mutex_clear (&lock);  }
+};
+
+
+static void on_found (const gchar *path, Found *found)
+{
+    g_mutex_lock (&found->lock);
+    found->paths.insert(path + strlen (found->root) + 1);
+    g_mutex_unlock (&found->lock);
+}
+
+
+static gboolean name_is_txt (const gchar *name, gpointer unused)
+{
+    return fnmatch ("*.txt", name, 0)==0;
+}
+
+
+static gboolean name_is_deep (const gchar *name, gpointer unused)
+{
+    return strcmp (name, "deep")==0;
+}
+
+
+/**
+ * root/a.txt           "hello world"
+ * root/b.dat           "hello world"
+ * root/sub/c.txt       "goodbye"
+ * root/sub/deep/d.txt  "hello again", with the match behind a chunk border
+ * root/link.txt        -> a.txt
+ * root/loop            -> . (must not be followed)
+ */
+class SearchLocalTest : public GcmdTmpDirTest
+{
+  protected:
+
+    gchar *root;
+
+    virtual void SetUp()
+    {
+        GcmdTmpDirTest::SetUp();
+
+        root = g_build_filename (base, "root", NULL);
+
+        gchar *sub = g_build_filename (root, "sub", NULL);
+        gchar *deep = g_build_filename (root, "sub", "deep", NULL);
+
+        mkdir (root, 0755);
+        mkdir (sub, 0755);
+        mkdir (deep, 0755);
+
+        write_file (root, "a.txt", "hello world");
+        write_file (root, "b.dat", "hello world");
+        write_file (sub, "c.txt", "goodbye");
+
+        string big(SEARCH_LOCAL_BUFFER_SIZE - 3, 'x');
+        big += "hello again";
+        write_file (deep, "d.txt", big.c_str());
+
+        gchar *link = g_build_filename (root, "link.txt", NULL);
+        gchar *loop = g_build_filename (root, "loop", NULL);
+        symlink ("a.txt", link);
+        symlink (".", loop);
+
+        g_free (link);
+        g_free (loop);
+        g_free (deep);
+        g_free (sub);
+    }
+
+    virtual void TearDown()
+    {
+        g_free (root);
+        GcmdTmpDirTest::TearDown();
+    }
+};
+
+
+TEST_F(SearchLocalTest, MatchesNames)
+{
+    Found found(root);
+    SearchLocalParams params;
+
+    params.name_matches = name_is_txt;
+    params.found = (SearchLocalFunc) on_found;
+    params.user_data = &found;
+
+    EXPECT_EQ (0, search_local (root, params));
+
+    set<string> expected;
+    expected.insert("a.txt");
+    expected.insert("link.txt");
+    expected.insert("sub/c.txt");
+    expected.insert("sub/deep/d.txt");
+
+    EXPECT_EQ (expected, found.paths);
+}
+
+
+TEST_F(SearchLocalTest, MatchesDirectoryNames)
+{
+    Found found(root);
+    SearchLocalParams params;
+
+    params.name_matches = name_is_deep;
+    params.found = (SearchLocalFunc) on_found;
+    params.user_data = &found;
+
+    EXPECT_EQ (0, search_local (root, params));
+    EXPECT_EQ (1u, found.paths.size());
+    EXPECT_EQ (1u, found.paths.count("sub/deep"));
+
+    // directories have no content to match
+    Found by_content(root);
+
+    params.content_pattern = "hello";
+    params.user_data = &by_content;
+
+    EXPECT_EQ (0, search_local (root, params));
+    EXPECT_TRUE (by_content.paths.empty());
+}
+
+
+TEST_F(SearchLocalTest, LimitsDepth)
+{
+    Found found(root);
+    SearchLocalParams params;
+
+    params.max_depth = 1;
+    params.name_matches = name_is_txt;
+    params.found = (SearchLocalFunc) on_found;
+    params.user_data = &found;
+
+    EXPECT_EQ (0, search_local (root, params));
+    EXPECT_EQ (3u, found.paths.size());
+    EXPECT_EQ (0u, found.paths.count("sub/deep/d.txt"));
+}
+
+
+TEST_F(SearchLocalTest, MatchesContent)
+{
+    for (guint n_workers=1; n_workers<=4; n_workers*=2)
+    {
+        Found found(root);
+        SearchLocalParams params;
+
+        params.content_pattern = "hello";
+        params.found = (SearchLocalFunc) on_found;
+        params.user_data = &found;
+        params.n_workers = n_workers;
+
+        EXPECT_EQ (0, search_local (root, params));
+
+        set<string> expected;
+        expected.insert("a.txt");
+        expected.insert("b.dat");
+        expected.insert("link.txt");
+        expected.insert("sub/deep/d.txt");
+
+        EXPECT_EQ (expected, found.paths);
+    }
+}
+
+
+TEST_F(SearchLocalTest, SkipsBinaryFiles)
+{
+    gchar *path = g_build_filename (root, "blob.bin", NULL);
+    g_file_set_contents (path, "\x7f" "ELF\0\0\0hello", 12, NULL);
+
+    Found found(root);
+    SearchLocalParams params;
+
+    params.content_pattern = "hello";
+    params.found = (SearchLocalFunc) on_found;
+    params.user_data = &found;
+
+    EXPECT_EQ (0, search_local (root, params));
+    EXPECT_EQ (4u, found.paths.size());
+    EXPECT_EQ (0u, found.paths.count("blob.bin"));
+
+    g_free (path);
+}
+
+
+TEST_F(SearchLocalTest, IgnoresCase)
+{
+    write_file (root, "e.txt", "Some HELLO in capitals");
+
+    Found found(root);
+    SearchLocalParams params;
+
+    params.name_matches = name_is_txt;
+    params.content_pattern = "hel*o in c.p";
+    params.content_cflags = REG_ICASE;
+    params.found = (SearchLocalFunc) on_found;
+    params.user_data = &found;
+
+    EXPECT_EQ (0, search_local (root, params));
+    EXPECT_EQ (1u, found.paths.size());
+    EXPECT_EQ (1u, found.paths.count("e.txt"));
+}
+
+
+TEST_F(SearchLocalTest, MatchesAcrossChunks)
+{
+    string big(SEARCH_LOCAL_CHUNK_SIZE - 4, 'x');
+    big += "needle in the haystack";
+    write_file (root, "e.txt", big.c_str());
+
+    Found found(root);
+    SearchLocalParams params;
+
+    params.name_matches = name_is_txt;
+    params.content_pattern = "needle in";
+    params.found = (SearchLocalFunc) on_found;
+    params.user_data = &found;
+
+    EXPECT_EQ (0, search_local (root, params));
+    EXPECT_EQ (1u, found.paths.size());
+    EXPECT_EQ (1u, found.paths.count("e.txt"));
+}
+
+
+TEST_F(SearchLocalTest, ReportsErrors)
+{
+    Found found(root);
+    SearchLocalParams params;
+
+    params.found = (SearchLocalFunc) on_found;
+    params.user_data = &found;
+
+    EXPECT_EQ (ENOENT, search_local ("/nonexistent/gcmd", params));
+
+    params.content_pattern = "(";
+    params.content_cflags = REG_EXTENDED;
+
+    EXPECT_EQ (EINVAL, search_local (root, params));
+    EXPECT_TRUE (found.paths.empty());
+}
+
+
+TEST_F(SearchLocalTest, StopsWhenCancelled)
+{
+    Found found(root);
+    SearchLocalParams params;
+    volatile gint cancelled = TRUE;
+
+    params.found = (SearchLocalFunc) on_found;
+    params.user_data = &found;
+    params.cancelled = &cancelled;
+
+    EXPECT_EQ (0, search_local (root, params));
+    EXPECT_TRUE (found.paths.empty());
+}
+
+
+class SearchLocalBenchmark : public ::testing::TestWithParam<guint> {};
+
+INSTANTIATE_TEST_CASE_P(Workers,
+                        SearchLocalBenchmark,
+                        ::testing::Values(1u, 2u, 4u));
+
+TEST_P(SearchLocalBenchmark, TimeContentSearch)
+{
+    const gint n_dirs = 100;
+    const gint n_files = 200;
+
+    if (!g_getenv ("GCMD_BENCHMARK"))
+        return;
+
+    gchar *root = g_dir_make_tmp ("gcmd-search-XXXXXX", NULL);
+    string content;
+
+    for (gint i=0; i<2000; ++i)
+        content += "some line of source code that does not match\n";
+
+    for (gint d=0; d<n_dirs; ++d)
+    {
+        gchar *dir = g_strdup_printf ("%s/dir-%03d", root, d);
+        mkdir (dir, 0755);
+
+        for (gint f=0; f<n_files; ++f)
+        {
+            gchar *name = g_strdup_printf ("file-%03d.c", f);
+            write_file (dir, name, f==0 ? "needle" : content.c_str());
+            g_free (name);
+        }
+
+        g_free (dir);
+    }
+
+    Found found(root);
+    SearchLocalParams params;
+
+    params.content_pattern = "needle";
+    params.found = (SearchLocalFunc) on_found;
+    params.user_data = &found;
+    params.n_workers = GetParam();
+
+    gint64 start = g_get_monotonic_time ();
+    EXPECT_EQ (0, search_local (root, params));
+    gint64 elapsed = g_get_monotonic_time () - start;
+
+    EXPECT_EQ ((guint) n_dirs, found.paths.size());
+
+    printf ("searched %d files with %u workers in %.3f s\n", n_dirs*n_files, GetParam(), elapsed / (gdouble) G_USEC_PER_SEC);
+
+    remove_tree (root);
+    g_free (root);
+}
+
+
+static string required_literal (const gchar *pattern, gint cflags=0)
+{
+    gchar *literal = search_local_required_literal (pattern, cflags);
+    string retval = literal ? literal : "<none>";
+    g_free (literal);
+    return retval;
+}
+
+
+TEST(SearchLocalLiteral, FindsRequiredText)
+{
+    EXPECT_EQ ("hello", required_literal ("hello"));
+    EXPECT_EQ ("hello", required_literal ("^hello.*world$"));
+    EXPECT_EQ ("abc", required_literal ("x[0-9]abcd*"));
+    EXPECT_EQ ("needle", required_literal ("a\\(b\\|c\\)*needle"));
+    EXPECT_EQ ("func(", required_literal ("func(", 0));
+    EXPECT_EQ ("func", required_literal ("func(x)?", REG_EXTENDED));
+    EXPECT_EQ ("a.b", required_literal ("a\\.b"));
+    EXPECT_EQ ("bcd", required_literal ("ab?bcd", REG_EXTENDED));
+    EXPECT_EQ ("abc", required_literal ("abc+", REG_EXTENDED));
+    EXPECT_EQ ("xyz", required_literal ("a{2,3}xyz", REG_EXTENDED));
+    EXPECT_EQ ("hello", required_literal ("HeLLo", REG_ICASE));
+    EXPECT_EQ ("<none>", required_literal ("foo|bar", REG_EXTENDED));
+    EXPECT_EQ ("<none>", required_literal ("foo\\|bar"));
+    EXPECT_EQ ("<none>", required_literal ("[[:alpha:]]*"));
+    EXPECT_EQ ("<none>", required_literal ("\\w\\+"));
+    // folds to KELVIN SIGN and LONG S
+    EXPECT_EQ ("mar", required_literal ("markus", REG_ICASE));
+}
+
+
+TEST(SearchLocalLiteral, FindsLiteralLikeNaiveSearch)
+{
+    string text;
+
+    for (gint i=0; i<5000; ++i)
+        text += (gchar) ("abcABC\n\0xyz"[(i * 7919) % 12]);
+
+    const gchar *needles[] = {"a", "bc", "ABCa", "xyzabc", "c\nx", "zzz"};
+
+    for (guint n=0; n<G_N_ELEMENTS (needles); ++n)
+        for (gint ignore_case=0; ignore_case<2; ++ignore_case)
+            for (gsize offset=0; offset<40; offset+=13)
+            {
+                string needle = needles[n];
+
+                if (ignore_case)
+                    for (gsize i=0; i<needle.size(); ++i)
+                        needle[i] = g_ascii_tolower (needle[i]);
+
+                gssize expected = -1;
+
+                for (gsize i=offset; expected<0 && i+needle.size()<=text.size(); ++i)
+                    if (ignore_case ? g_ascii_strncasecmp (text.data()+i, needle.data(), needle.size())==0 && memchr (text.data()+i, '\0', needle.size())==NULL
+                                    : memcmp (text.data()+i, needle.data(), needle.size())==0)
+                        expected = i - offset;
+
+                EXPECT_EQ (expected, search_local_find_literal (text.data()+offset, text.size()-offset, needle.data(), needle.size(), ignore_case))
+                    << "needle " << needles[n] << " ignore_case " << ignore_case << " offset " << offset;
+            }
+}
+
+
+TEST(SearchLocalLiteral, ScanThroughput)
+{
+    if (!g_getenv ("GCMD_BENCHMARK"))
+        return;
+
+    const gsize size = 64 << 20;
+    string text;
+
+    text.reserve(size + 64);
+
+    while (text.size()<size)
+        text += "    for (gint i=0; i<n; ++i) some_function_call (argument, another_argument);\n";
+
+    regex_t re;
+    regmatch_t match;
+
+    ASSERT_EQ (0, regcomp (&re, "needle", 0));
+
+    gint64 start = g_get_monotonic_time ();
+    EXPECT_NE (0, regexec (&re, text.c_str(), 1, &match, 0));
+    gint64 regex_time = g_get_monotonic_time () - start;
+
+    start = g_get_monotonic_time ();
+    EXPECT_EQ (-1, search_local_find_literal (text.data(), text.size(), "needle", 6, FALSE));
+    gint64 literal_time = g_get_monotonic_time () - start;
+
+    start = g_get_monotonic_time ();
+    EXPECT_EQ (-1, search_local_find_literal (text.data(), text.size(), "needle", 6, TRUE));
+    gint64 icase_time = g_get_monotonic_time () - start;
+
+    printf ("64 MB: regexec %.1f MB/s, literal scan %.1f MB/s, ignoring case %.1f MB/s\n",
+            size / (gdouble) regex_time, size / (gdouble) literal_time, size / (gdouble) icase_time);
+
+    regfree (&re);
+}
@@ -0,0 +1,348 @@
+/**
+ * @file sorted_index_test.cc
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @details Tests for the sorted row index of the file list, and two
+ * benchmarks:
+ * - replaying 50k "file created" monitor events in batches as they would
+ *   arrive while a build writes into a watched directory. The longest
+ *   batch is the time the UI would stall. It only runs if GCMD_BENCHMARK
+ *   is set in the environment.
+ * - the filter, key build and sort steps of GnomeCmdFileList::show_files()
+ *   on synthetic directories, next to the g_list_append() and
+ *   g_list_sort_with_data() it used before. Directories with 100k and 1M
+ *   entries are only timed if GCMD_BENCHMARK is set in the environment.
+ *
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+#include "gnome-cmd-sorted-index.h"
+
+using namespace std;
+
+
+struct Item
+{
+    gchar name[16];
+};
+
+
+static gint compare_items (Item *a, Item *b, gint *comparisons)
+{
+    ++*comparisons;
+    return strcmp (a->name, b->name);
+}
+
+
+static vector<Item> create_items (gint n)
+{
+    vector<Item> items(n);
+
+    // pseudo random, but reproducible order
+    for (gint i=0; i<n; ++i)
+        g_snprintf (items[i].name, sizeof(items[i].name), "file-%07d", (i * 7919) % n);
+
+    return items;
+}
+
+
+static gboolean is_sorted (GnomeCmd::SortedIndex<Item> &index)
+{
+    for (guint i=1; i<index.size(); ++i)
+        if (strcmp (index[i-1]->name, index[i]->name) > 0)
+            return FALSE;
+
+    return TRUE;
+}
+
+
+TEST(SortedIndex, InsertKeepsOrder)
+{
+    vector<Item> items = create_items (1000);
+    gint comparisons = 0;
+    GnomeCmd::SortedIndex<Item> index;
+
+    index.set_compare_func((GCompareDataFunc) compare_items, &comparisons);
+
+    for (gint i=0; i<1000; ++i)
+        index.insert(&items[i]);
+
+    EXPECT_EQ (1000u, index.size());
+    EXPECT_TRUE (is_sorted (index));
+
+    for (gint i=0; i<1000; ++i)
+        EXPECT_EQ (&items[i], index[index.find(&items[i])]);
+
+    // binary search, not a linear scan
+    comparisons = 0;
+    index.find(&items[500]);
+    EXPECT_GT (20, comparisons);
+}
+
+
+TEST(SortedIndex, AppendOutOfOrder)
+{
+    vector<Item> items = create_items (10);
+    gint comparisons = 0;
+    GnomeCmd::SortedIndex<Item> index;
+
+    index.set_compare_func((GCompareDataFunc) compare_items, &comparisons);
+    index.sort();
+
+    for (gint i=0; i<10; ++i)
+        index.append(&items[i]);
+
+    EXPECT_FALSE (index.is_sorted());
+
+    for (gint i=0; i<10; ++i)
+        EXPECT_EQ (i, index.find(&items[i]));
+
+    index.sort();
+    EXPECT_TRUE (is_sorted (index));
+}
+
+
+TEST(SortedIndex, MergeAndRemove)
+{
+    vector<Item> items = create_items (100);
+    gint comparisons = 0;
+    GnomeCmd::SortedIndex<Item> index;
+
+    index.set_compare_func((GCompareDataFunc) compare_items, &comparisons);
+
+    for (gint i=0; i<50; ++i)
+        index.insert(&items[i]);
+
+    vector<Item *> added, removed;
+
+    for (gint i=50; i<100; ++i)
+        added.push_back(&items[i]);
+    for (gint i=0; i<50; i+=2)
+        removed.push_back(&items[i]);
+
+    index.merge(added);
+    EXPECT_EQ (25u, index.remove(removed));
+
+    EXPECT_EQ (75u, index.size());
+    EXPECT_TRUE (is_sorted (index));
+    EXPECT_EQ (-1, index.find(&items[0]));
+    EXPECT_TRUE (index.remove(&items[1]));
+    EXPECT_FALSE (index.remove(&items[1]));
+}
+
+
+TEST(SortedIndex, FindsChangedElements)
+{
+    vector<Item> items = create_items (100);
+    gint comparisons = 0;
+    GnomeCmd::SortedIndex<Item> index;
+
+    index.set_compare_func((GCompareDataFunc) compare_items, &comparisons);
+
+    for (gint i=0; i<100; ++i)
+        index.insert(&items[i]);
+
+    gint row = index.find(&items[42]);
+
+    strcpy (items[42].name, "renamed");
+
+    EXPECT_EQ (row, index.find(&items[42]));
+}
+
+
+class SortedIndexBenchmark : public ::testing::TestWithParam<gint> {};
+
+INSTANTIATE_TEST_CASE_P(BatchSizes,
+                        SortedIndexBenchmark,
+                        ::testing::Values(1, 100, 5000));
+
+TEST_P(SortedIndexBenchmark, FiftyThousandCreatedFiles)
+{
+    if (!g_getenv ("GCMD_BENCHMARK"))
+        return;
+
+    const gint n_files = 50000;
+    gint batch_size = GetParam();
+
+    vector<Item> items = create_items (n_files);
+    gint comparisons = 0;
+    GnomeCmd::SortedIndex<Item> index;
+
+    index.set_compare_func((GCompareDataFunc) compare_items, &comparisons);
+
+    gint64 total = 0;
+    gint64 max_stall = 0;
+
+    for (gint i=0; i<n_files; i+=batch_size)
+    {
+        gint64 start = g_get_monotonic_time ();
+
+        if (batch_size>1)
+        {
+            vector<Item *> added;
+
+            for (gint j=i; j<i+batch_size && j<n_files; ++j)
+                added.push_back(&items[j]);
+
+            index.merge(added);
+        }
+        else
+            index.insert(&items[i]);
+
+        gint64 elapsed = g_get_monotonic_time () - start;
+
+        total += elapsed;
+        max_stall = MAX (max_stall, elapsed);
+    }
+
+    EXPECT_EQ ((guint) n_files, index.size());
+    EXPECT_TRUE (is_sorted (index));
+
+    printf ("%d files in batches of %d: %.3f s total, longest stall %.3f ms, %d comparisons\n",
+            n_files, batch_size, total / (gdouble) G_USEC_PER_SEC, max_stall / 1000.0, comparisons);
+}
+
+
+struct DirEntry
+{
+    gchar name[24];
+    gchar *collate_key;
+    guint64 size;
+    gint type;
+    gboolean hidden;
+};
+
+
+struct DirEntryKey
+{
+    const gchar *name;
+    guint8 type;
+};
+
+
+static void make_entry_key (DirEntry *e, DirEntryKey &k)
+{
+    k.name = e->collate_key;
+    k.type = e->type;
+}
+
+
+static bool entry_key_less (const DirEntryKey &k1, const DirEntryKey &k2)
+{
+    if (k1.type!=k2.type)
+        return k1.type > k2.type;
+
+    return strcmp (k1.name, k2.name) < 0;
+}
+
+
+// what the sort functions of the file list do: look everything up in every call
+static gint compare_entries (DirEntry *e1, DirEntry *e2, gpointer unused)
+{
+    if (e1->type > e2->type)
+        return -1;
+
+    if (e1->type < e2->type)
+        return 1;
+
+    return strcmp (e1->collate_key, e2->collate_key);
+}
+
+
+class ShowFilesBenchmark : public ::testing::TestWithParam<gint> {};
+
+INSTANTIATE_TEST_CASE_P(DirectorySizes,
+                        ShowFilesBenchmark,
+                        ::testing::Values(10000, 100000, 1000000));
+
+TEST_P(ShowFilesBenchmark, FilterAndSort)
+{
+    gint n_files = GetParam();
+
+    if (n_files>10000 && !g_getenv ("GCMD_BENCHMARK"))
+        return;
+
+    vector<DirEntry> entries(n_files);
+    GList *dir_files = NULL;
+
+    for (gint i=n_files-1; i>=0; --i)
+    {
+        DirEntry &e = entries[i];
+
+        g_snprintf (e.name, sizeof(e.name), "%sfile-%07d", i % 10 ? "" : ".", (gint) ((gint64) i * 7919 % n_files));
+        e.collate_key = g_utf8_collate_key_for_filename (e.name, -1);
+        e.size = i;
+        e.type = i % 7 ? 1 : 2;
+        e.hidden = e.name[0]=='.';
+
+        dir_files = g_list_prepend (dir_files, &e);
+    }
+
+    // before: g_list_append() and g_list_sort_with_data(), too slow to wait for with 1M entries
+    gint64 start = g_get_monotonic_time ();
+
+    GList *shown = NULL;
+
+    if (n_files<=100000)
+    {
+        for (GList *i=dir_files; i; i=i->next)
+            if (!((DirEntry *) i->data)->hidden)
+                shown = g_list_append (shown, i->data);
+
+        shown = g_list_sort_with_data (shown, (GCompareDataFunc) compare_entries, NULL);
+    }
+
+    gint64 list_time = g_get_monotonic_time () - start;
+
+    // now: filter into a vector, build the keys, sort them
+    start = g_get_monotonic_time ();
+
+    vector<DirEntry *> files;
+    GnomeCmd::SortedIndex<DirEntry> index;
+
+    for (GList *i=dir_files; i; i=i->next)
+        if (!((DirEntry *) i->data)->hidden)
+            files.push_back((DirEntry *) i->data);
+
+    index.set_compare_func((GCompareDataFunc) compare_entries, NULL);
+    index.load<DirEntryKey>(files, make_entry_key, entry_key_less);
+
+    gint64 index_time = g_get_monotonic_time () - start;
+
+    EXPECT_EQ ((guint) n_files - n_files/10, index.size());
+
+    guint row = 0;
+
+    for (GList *i=shown; i; i=i->next, ++row)
+        EXPECT_EQ (i->data, index[row]);
+
+    if (shown)
+        printf ("%d entries: GList %.3f s, sort keys %.3f s\n",
+                n_files, list_time / (gdouble) G_USEC_PER_SEC, index_time / (gdouble) G_USEC_PER_SEC);
+    else
+        printf ("%d entries: sort keys %.3f s\n", n_files, index_time / (gdouble) G_USEC_PER_SEC);
+
+    g_list_free (shown);
+    g_list_free (dir_files);
+
+    for (gint i=0; i<n_files; ++i)
+        g_free (entries[i].collate_key);
+}
@@ -0,0 +1,333 @@
+/**
+ * @file tag_cache_test.cc
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @details Tests for the persistent cache of metadata tags.
+ *
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../src/tag-cache.h"
+#include "gcmd_tests_fs.h"
+
+using namespace std;
+
+
+#define PARSER_A    (1 << 0)
+#define PARSER_B    (1 << 1)
+
+
+static gint n_reads;
+
+
+static void read_tags (const gchar *path, guint parser, TagCacheValues &values)
+{
+    g_atomic_int_inc (&n_reads);
+
+    // parser B finds nothing
+    if (parser==PARSER_A)
+    {
+        gchar *name = g_path_get_basename (path);
+        values.push_back(make_pair(string("Image.Name"), string(name)));
+        values.push_back(make_pair(string("Image.Model"), string("Camera")));
+        g_free (name);
+    }
+}
+
+
+static TagCacheValues tags (const gchar *name, const gchar *value)
+{
+    TagCacheValues values;
+    values.push_back(make_pair(string(name), string(value)));
+    return values;
+}
+
+
+class TagCacheTest : public GcmdTmpDirTest
+{
+  protected:
+
+    gchar *cache_file;
+
+    virtual void SetUp()
+    {
+        GcmdTmpDirTest::SetUp();
+        cache_file = g_build_filename (base, "tag-cache", NULL);
+        n_reads = 0;
+    }
+
+    virtual void TearDown()
+    {
+        g_free (cache_file);
+        GcmdTmpDirTest::TearDown();
+    }
+
+    gchar *write_file (const gchar *name, const gchar *content)
+    {
+        ::write_file (base, name, content);
+        return g_build_filename (base, name, NULL);
+    }
+
+    void stat_file (const gchar *path, struct stat &st)
+    {
+        ASSERT_EQ (0, stat (path, &st));
+    }
+};
+
+
+TEST_F(TagCacheTest, KeepsTagsForEachParser)
+{
+    gchar *path = write_file ("a.jpg", "x");
+    struct stat st;
+
+    stat_file (path, st);
+
+    TagCache *cache = tag_cache_open (cache_file);
+    TagCacheValues values;
+
+    EXPECT_FALSE (tag_cache_lookup (cache, st, PARSER_A, values));
+
+    tag_cache_store (cache, st, PARSER_A, tags ("Image.Model", "Camera"));
+    tag_cache_store (cache, st, PARSER_B, TagCacheValues());
+
+    EXPECT_TRUE (tag_cache_lookup (cache, st, PARSER_A, values));
+    ASSERT_EQ (1, values.size());
+    EXPECT_EQ ("Image.Model", values[0].first);
+    EXPECT_EQ ("Camera", values[0].second);
+
+    // found nothing, which is worth knowing as well
+    values.clear();
+    EXPECT_TRUE (tag_cache_lookup (cache, st, PARSER_B, values));
+    EXPECT_TRUE (values.empty());
+
+    // storing again replaces what the parser found before
+    tag_cache_store (cache, st, PARSER_A, tags ("Image.Model", "Other"));
+    EXPECT_TRUE (tag_cache_lookup (cache, st, PARSER_A, values));
+    ASSERT_EQ (1, values.size());
+    EXPECT_EQ ("Other", values[0].second);
+
+    tag_cache_free (cache);
+    g_free (path);
+}
+
+
+TEST_F(TagCacheTest, IsKeptAcrossSessions)
+{
+    gchar *path_a = write_file ("a.jpg", "x");
+    gchar *path_b = write_file ("b.jpg", "y");
+    struct stat st_a, st_b;
+
+    stat_file (path_a, st_a);
+    stat_file (path_b, st_b);
+
+    TagCache *cache = tag_cache_open (cache_file);
+
+    tag_cache_store (cache, st_a, PARSER_A, tags ("Image.Model", "Camera"));
+    tag_cache_store (cache, st_b, PARSER_A, tags ("Image.Model", "Camera"));
+    tag_cache_store (cache, st_b, PARSER_B, tags ("Audio.Title", "Song"));
+
+    EXPECT_EQ (0, tag_cache_save (cache, cache_file));
+    tag_cache_free (cache);
+
+    cache = tag_cache_open (cache_file);
+
+    TagCacheValues values;
+
+    EXPECT_EQ (2, tag_cache_size (cache));
+    EXPECT_TRUE (tag_cache_lookup (cache, st_b, PARSER_A | PARSER_B, values));
+    ASSERT_EQ (2, values.size());
+    EXPECT_EQ ("Camera", values[0].second);
+    EXPECT_EQ ("Song", values[1].second);
+
+    values.clear();
+    EXPECT_TRUE (tag_cache_lookup (cache, st_a, PARSER_A, values));
+    EXPECT_FALSE (tag_cache_lookup (cache, st_a, PARSER_B, values));
+
+    tag_cache_free (cache);
+    g_free (path_b);
+    g_free (path_a);
+}
+
+
+TEST_F(TagCacheTest, ForgetsChangedFiles)
+{
+    gchar *path = write_file ("a.jpg", "x");
+    struct stat st;
+
+    stat_file (path, st);
+
+    TagCache *cache = tag_cache_open (cache_file);
+    TagCacheValues values;
+
+    tag_cache_store (cache, st, PARSER_A, tags ("Image.Model", "Camera"));
+
+    struct stat changed = st;
+    changed.st_size += 1;
+    EXPECT_FALSE (tag_cache_lookup (cache, changed, PARSER_A, values));
+
+    changed = st;
+    changed.st_mtim.tv_nsec = (changed.st_mtim.tv_nsec + 1) % 1000000000;
+    EXPECT_FALSE (tag_cache_lookup (cache, changed, PARSER_A, values));
+
+    // the new version replaces the old one
+    tag_cache_store (cache, changed, PARSER_B, TagCacheValues());
+    EXPECT_FALSE (tag_cache_lookup (cache, changed, PARSER_A, values));
+    EXPECT_FALSE (tag_cache_lookup (cache, st, PARSER_B, values));
+    EXPECT_EQ (1, tag_cache_size (cache));
+
+    tag_cache_free (cache);
+    g_free (path);
+}
+
+
+TEST_F(TagCacheTest, KeepsTheFilesUsedLast)
+{
+    TagCache *cache = tag_cache_open (cache_file);
+    struct stat st;
+
+    memset (&st, 0, sizeof(st));
+
+    for (guint i=0; i<TAG_CACHE_MAX_FILES; ++i)
+    {
+        st.st_ino = i + 1;
+        tag_cache_store (cache, st, PARSER_A, tags ("Image.Model", "Camera"));
+    }
+
+    EXPECT_EQ (0, tag_cache_save (cache, cache_file));
+    tag_cache_free (cache);
+
+    // the files used in this session win over the others
+    cache = tag_cache_open (cache_file);
+
+    TagCacheValues values;
+
+    st.st_ino = 1;
+    EXPECT_TRUE (tag_cache_lookup (cache, st, PARSER_A, values));
+
+    for (guint i=0; i<20; ++i)
+    {
+        st.st_ino = TAG_CACHE_MAX_FILES + 100 + i;
+        tag_cache_store (cache, st, PARSER_A, tags ("Image.Model", "Camera"));
+    }
+
+    EXPECT_EQ (0, tag_cache_save (cache, cache_file));
+    tag_cache_free (cache);
+
+    cache = tag_cache_open (cache_file);
+
+    EXPECT_EQ (TAG_CACHE_MAX_FILES, tag_cache_size (cache));
+
+    st.st_ino = 1;
+    EXPECT_TRUE (tag_cache_lookup (cache, st, PARSER_A, values));
+    st.st_ino = TAG_CACHE_MAX_FILES + 119;
+    EXPECT_TRUE (tag_cache_lookup (cache, st, PARSER_A, values));
+
+    tag_cache_free (cache);
+}
+
+
+TEST_F(TagCacheTest, IgnoresInvalidFiles)
+{
+    g_file_set_contents (cache_file, "GCMDTC01 but not much else", -1, NULL);
+
+    TagCache *cache = tag_cache_open (cache_file);
+
+    EXPECT_EQ (0, tag_cache_size (cache));
+
+    tag_cache_free (cache);
+}
+
+
+TEST_F(TagCacheTest, JobsReadWhatIsntCachedYet)
+{
+    const guint N_FILES = 50;
+    vector<gchar *> paths;
+
+    for (guint i=0; i<N_FILES; ++i)
+    {
+        gchar *name = g_strdup_printf ("photo-%03u.jpg", i);
+        paths.push_back(write_file (name, "x"));
+        g_free (name);
+    }
+
+    TagCache *cache = tag_cache_open (cache_file);
+    TagCacheJob *job = tag_cache_job_new (cache, read_tags);
+
+    for (guint i=0; i<N_FILES; ++i)
+        tag_cache_job_add (job, paths[i], PARSER_A | PARSER_B);
+
+    tag_cache_job_add (job, base, PARSER_A);
+
+    guint done = 0;
+    guint total = 0;
+
+    while (!tag_cache_job_get_progress (job, &done, &total))
+        g_usleep (1000);
+
+    EXPECT_EQ (N_FILES+1, done);
+    EXPECT_EQ (N_FILES+1, total);
+    EXPECT_EQ (2*N_FILES, n_reads);
+
+    tag_cache_job_free (job);
+
+    struct stat st;
+    TagCacheValues values;
+
+    stat_file (paths[7], st);
+    EXPECT_TRUE (tag_cache_lookup (cache, st, PARSER_A, values));
+    ASSERT_EQ (2, values.size());
+    EXPECT_EQ ("photo-007.jpg", values[0].second);
+
+    // a second job finds everything in the cache
+    job = tag_cache_job_new (cache, read_tags);
+
+    for (guint i=0; i<N_FILES; ++i)
+        tag_cache_job_add (job, paths[i], PARSER_A | PARSER_B);
+
+    while (!tag_cache_job_get_progress (job, NULL, NULL))
+        g_usleep (1000);
+
+    EXPECT_EQ (2*N_FILES, n_reads);
+
+    tag_cache_job_free (job);
+    tag_cache_free (cache);
+
+    for (guint i=0; i<N_FILES; ++i)
+        g_free (paths[i]);
+}
+
+
+TEST_F(TagCacheTest, JobsCanBeDropped)
+{
+    gchar *path = write_file ("a.jpg", "x");
+    TagCache *cache = tag_cache_open (cache_file);
+    TagCacheJob *job = tag_cache_job_new (cache, read_tags);
+
+    for (guint i=0; i<1000; ++i)
+        tag_cache_job_add (job, path, PARSER_A);
+
+    tag_cache_job_free (job);
+    tag_cache_free (cache);
+    g_free (path);
+}
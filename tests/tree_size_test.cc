@@ -0,0 +1,236 @@
+/**
+ * @file tree_size_test.cc
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @details Tests for the background tree size calculation and its cache,
+ * and a benchmark reading a tree of 100k files, first cold and then from
+ * the cache. The benchmark only runs if GCMD_BENCHMARK is set in the
+ * environment.
+ *
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../src/tree-size.h"
+#include "gcmd_tests_fs.h"
+
+using namespace std;
+
+
+// long enough ago for the cache to trust the directory, and always the same time
+static void age (const gchar *path)
+{
+    struct timespec times[2];
+
+    times[0].tv_sec = times[1].tv_sec = 1500000000;
+    times[0].tv_nsec = times[1].tv_nsec = 0;
+
+    utimensat (AT_FDCWD, path, times, AT_SYMLINK_NOFOLLOW);
+}
+
+
+/**
+ * root/a               3 bytes
+ * root/sub/b           5 bytes
+ * root/sub/deep/c      7 bytes
+ * root/link            -> sub (not followed)
+ */
+class TreeSizeTest : public GcmdTmpDirTest
+{
+  protected:
+
+    gchar *root;
+    gchar *sub;
+    gchar *deep;
+    guint64 link_size;
+
+    virtual void SetUp()
+    {
+        GcmdTmpDirTest::SetUp();
+
+        root = g_build_filename (base, "root", NULL);
+        sub = g_build_filename (root, "sub", NULL);
+        deep = g_build_filename (sub, "deep", NULL);
+
+        mkdir (root, 0755);
+        mkdir (sub, 0755);
+        mkdir (deep, 0755);
+
+        write_file (root, "a", "aaa");
+        write_file (sub, "b", "bbbbb");
+        write_file (deep, "c", "ccccccc");
+
+        gchar *link = g_build_filename (root, "link", NULL);
+        struct stat st;
+
+        symlink ("sub", link);
+        lstat (link, &st);
+        link_size = st.st_size;
+
+        g_free (link);
+
+        age (deep);
+        age (sub);
+        age (root);
+
+        tree_size_cache_clear ();
+    }
+
+    virtual void TearDown()
+    {
+        g_free (deep);
+        g_free (sub);
+        g_free (root);
+        GcmdTmpDirTest::TearDown();
+    }
+};
+
+
+TEST_F(TreeSizeTest, SumsUpTrees)
+{
+    guint64 files = 0;
+
+    EXPECT_EQ (15 + link_size, tree_size_calc (root, &files));
+    EXPECT_EQ (7u, files);                  // 3 directories, 3 files and the link
+
+    EXPECT_EQ (12u, tree_size_calc (sub, &files));
+    EXPECT_EQ (4u, files);
+
+    gchar *a = g_build_filename (root, "a", NULL);
+
+    EXPECT_EQ (3u, tree_size_calc (a, &files));
+    EXPECT_EQ (1u, files);
+    EXPECT_EQ (0u, tree_size_calc ("/nonexistent/gcmd", &files));
+    EXPECT_EQ (0u, files);
+
+    g_free (a);
+}
+
+
+TEST_F(TreeSizeTest, SumsUpSeveralPaths)
+{
+    gchar *a = g_build_filename (root, "a", NULL);
+    GList *paths = g_list_append (g_list_append (NULL, a), deep);
+
+    TreeSizeJob *job = tree_size_job_new (paths);
+    guint64 bytes, files;
+
+    tree_size_job_wait (job);
+
+    EXPECT_TRUE (tree_size_job_get (job, &bytes, &files));
+    EXPECT_EQ (10u, bytes);
+    EXPECT_EQ (3u, files);
+
+    tree_size_job_free (job);
+    g_list_free (paths);
+    g_free (a);
+}
+
+
+TEST_F(TreeSizeTest, ReusesUnchangedDirectories)
+{
+    EXPECT_EQ (15 + link_size, tree_size_calc (root));
+
+    // sneak a file past the cache: same modification time as before
+    write_file (deep, "d", "ddddddddddd");
+    age (deep);
+
+    EXPECT_EQ (15 + link_size, tree_size_calc (root));
+
+    tree_size_cache_clear ();
+
+    EXPECT_EQ (26 + link_size, tree_size_calc (root));
+
+    // a changed directory is read again
+    write_file (deep, "e", "e");
+
+    EXPECT_EQ (27 + link_size, tree_size_calc (root));
+}
+
+
+TEST_F(TreeSizeTest, CanBeCancelled)
+{
+    GList *paths = g_list_append (NULL, root);
+    TreeSizeJob *job = tree_size_job_new (paths);
+
+    tree_size_job_cancel (job);
+    tree_size_job_wait (job);
+
+    guint64 bytes = 99;
+
+    EXPECT_TRUE (tree_size_job_get (job, &bytes, NULL));
+    EXPECT_GE (15 + link_size, bytes);
+
+    tree_size_job_free (job);
+    g_list_free (paths);
+}
+
+
+TEST(TreeSizeBenchmark, HundredThousandFiles)
+{
+    if (!g_getenv ("GCMD_BENCHMARK"))
+        return;
+
+    gchar *root = g_dir_make_tmp ("gcmd-tree-size-XXXXXX", NULL);
+
+    for (gint i=0; i<100; ++i)
+    {
+        gchar *dir_name = g_strdup_printf ("dir-%03d", i);
+        gchar *dir = g_build_filename (root, dir_name, NULL);
+
+        mkdir (dir, 0755);
+
+        for (gint j=0; j<1000; ++j)
+        {
+            gchar *name = g_strdup_printf ("file-%04d", j);
+            write_file (dir, name, "x");
+            g_free (name);
+        }
+
+        age (dir);
+
+        g_free (dir);
+        g_free (dir_name);
+    }
+
+    age (root);
+
+    tree_size_cache_clear ();
+
+    guint64 files;
+    gint64 start = g_get_monotonic_time ();
+    EXPECT_EQ (100000u, tree_size_calc (root, &files));
+    gint64 cold_time = g_get_monotonic_time () - start;
+
+    start = g_get_monotonic_time ();
+    EXPECT_EQ (100000u, tree_size_calc (root, &files));
+    gint64 cached_time = g_get_monotonic_time () - start;
+
+    EXPECT_EQ (100101u, files);
+
+    printf ("100000 files: %.1f ms, cached %.1f ms\n", cold_time / 1000.0, cached_time / 1000.0);
+
+    remove_tree (root);
+    g_free (root);
+}
@@ -0,0 +1,758 @@
+/**
+ * @file xfer_local_test.cc
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @details Tests for the native local copy and move engine, and a
+ * benchmark copying 20k small files with it and one by one. The
+ * benchmark only runs if GCMD_BENCHMARK is set in the environment.
+ *
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <gtest/gtest.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../src/xfer-local.h"
+#include "../src/xfer-resume.h"
+#include "gcmd_tests_fs.h"
+
+using namespace std;
+
+
+static gchar *read_file (const gchar *dir, const gchar *name)
+{
+    gchar *path = g_build_filename (dir, name, NULL);
+    gchar *content = NULL;
+
+    if (!g_file_get_contents (path, &content, NULL, NULL))
+        content = g_strdup ("(missing)");
+
+    g_free (path);
+
+    return content;
+}
+
+
+/**
+ * Runs the job to its end, giving @a answer to every question. Returns
+ * the number of questions asked.
+ */
+static gint run_job (XferLocalJob *job, gint answer, XferLocalQuestion *last_question=NULL, gint *last_error=NULL)
+{
+    XferLocalProgress progress;
+    gint n_questions = 0;
+
+    while (!xfer_local_job_get_progress (job, &progress))
+    {
+        g_free (progress.file);
+
+        gint error;
+        XferLocalQuestion question = xfer_local_job_get_question (job, NULL, NULL, &error);
+
+        if (question)
+        {
+            if (last_question)
+                *last_question = question;
+            if (last_error)
+                *last_error = error;
+
+            n_questions++;
+            xfer_local_job_answer (job, answer);
+        }
+
+        g_usleep (1000);
+    }
+
+    g_free (progress.file);
+    xfer_local_job_free (job);
+
+    return n_questions;
+}
+
+
+/**
+ * Like run_job(), but merges into the directories in the way, and only
+ * counts the questions about the other entries.
+ */
+static gint run_merging_job (XferLocalJob *job, gint answer)
+{
+    XferLocalProgress progress;
+    gint n_questions = 0;
+
+    while (!xfer_local_job_get_progress (job, &progress))
+    {
+        g_free (progress.file);
+
+        gchar *dest = NULL;
+        XferLocalQuestion question = xfer_local_job_get_question (job, NULL, &dest, NULL);
+        struct stat st;
+
+        if (question==XFER_LOCAL_QUESTION_OVERWRITE && lstat (dest, &st)==0 && S_ISDIR (st.st_mode))
+            xfer_local_job_answer (job, XFER_LOCAL_OVERWRITE_ACTION_REPLACE);
+        else
+            if (question)
+            {
+                n_questions++;
+                xfer_local_job_answer (job, answer);
+            }
+
+        g_free (dest);
+        g_usleep (1000);
+    }
+
+    g_free (progress.file);
+    xfer_local_job_free (job);
+
+    return n_questions;
+}
+
+
+static XferLocalJob *start_job (const gchar *src, const gchar *dest, gboolean move,
+                                XferLocalOverwriteMode mode=XFER_LOCAL_OVERWRITE_MODE_QUERY, gboolean checksums=FALSE)
+{
+    GList *src_paths = g_list_append (NULL, (gpointer) src);
+    GList *dest_paths = g_list_append (NULL, (gpointer) dest);
+
+    XferLocalJob *job = xfer_local_job_new (src_paths, dest_paths, move, FALSE, mode, checksums);
+
+    g_list_free (src_paths);
+    g_list_free (dest_paths);
+
+    return job;
+}
+
+
+/**
+ * src/tree/a           "aaa", mode 0640
+ * src/tree/sub/b       "bbbbb"
+ * src/tree/sub/deep/   empty
+ * src/tree/link        -> a
+ */
+class XferLocalTest : public GcmdTmpDirTest
+{
+  protected:
+
+    gchar *src;
+    gchar *tree;
+    gchar *dest;
+
+    virtual void SetUp()
+    {
+        GcmdTmpDirTest::SetUp();
+
+        src = g_build_filename (base, "src", NULL);
+        tree = g_build_filename (src, "tree", NULL);
+        dest = g_build_filename (base, "dest", NULL);
+
+        gchar *sub = g_build_filename (tree, "sub", NULL);
+        gchar *deep = g_build_filename (sub, "deep", NULL);
+        gchar *a = g_build_filename (tree, "a", NULL);
+        gchar *link = g_build_filename (tree, "link", NULL);
+
+        g_mkdir_with_parents (deep, 0755);
+        mkdir (dest, 0755);
+
+        write_file (tree, "a", "aaa");
+        write_file (sub, "b", "bbbbb");
+        chmod (a, 0640);
+        EXPECT_EQ (0, symlink ("a", link));
+
+        struct timespec times[2];
+
+        times[0].tv_sec = times[1].tv_sec = 1500000000;
+        times[0].tv_nsec = times[1].tv_nsec = 0;
+
+        utimensat (AT_FDCWD, a, times, 0);
+        utimensat (AT_FDCWD, sub, times, 0);
+
+        g_free (link);
+        g_free (a);
+        g_free (deep);
+        g_free (sub);
+    }
+
+    virtual void TearDown()
+    {
+        g_free (dest);
+        g_free (tree);
+        g_free (src);
+        GcmdTmpDirTest::TearDown();
+    }
+
+    void expect_copied_tree (const gchar *copy)
+    {
+        gchar *sub = g_build_filename (copy, "sub", NULL);
+        gchar *a = g_build_filename (copy, "a", NULL);
+        gchar *link = g_build_filename (copy, "link", NULL);
+        gchar *content;
+        gchar target[16];
+        struct stat st;
+
+        EXPECT_STREQ ("aaa", content = read_file (copy, "a"));
+        g_free (content);
+        EXPECT_STREQ ("bbbbb", content = read_file (sub, "b"));
+        g_free (content);
+        EXPECT_TRUE (exists (sub, "deep"));
+
+        ASSERT_EQ (1, readlink (link, target, sizeof(target)));
+        EXPECT_EQ ('a', target[0]);
+
+        ASSERT_EQ (0, stat (a, &st));
+        EXPECT_EQ (0640u, st.st_mode & 07777);
+        EXPECT_EQ (1500000000, st.st_mtime);
+
+        // directories get their times once everything is copied into them
+        ASSERT_EQ (0, stat (sub, &st));
+        EXPECT_EQ (1500000000, st.st_mtime);
+        EXPECT_EQ (0755u, st.st_mode & 07777);
+
+        g_free (link);
+        g_free (a);
+        g_free (sub);
+    }
+};
+
+
+TEST_F(XferLocalTest, CopiesTrees)
+{
+    gchar *copy = g_build_filename (dest, "tree", NULL);
+
+    EXPECT_EQ (0, run_job (start_job (tree, copy, FALSE), XFER_LOCAL_ERROR_ACTION_ABORT));
+
+    expect_copied_tree (copy);
+    EXPECT_TRUE (exists (src, "tree"));
+
+    g_free (copy);
+}
+
+
+TEST_F(XferLocalTest, CountsCopiedFilesBySize)
+{
+    gchar *copy = g_build_filename (dest, "tree", NULL);
+    XferLocalJob *job = start_job (tree, copy, FALSE);
+    XferLocalProgress progress;
+
+    xfer_local_job_wait (job);
+    xfer_local_job_get_progress (job, &progress);
+    g_free (progress.file);
+    xfer_local_job_free (job);
+
+    // a and sub/b, links and directories aren't files with data
+    EXPECT_EQ (2u, progress.stats.files[XFER_SIZE_SMALL]);
+    EXPECT_EQ (8u, progress.stats.bytes[XFER_SIZE_SMALL]);
+    EXPECT_EQ (0u, progress.stats.files[XFER_SIZE_MEDIUM] + progress.stats.files[XFER_SIZE_LARGE]);
+
+    for (gint i=0; i<XFER_N_PHASES; ++i)
+        EXPECT_LE (0, progress.stats.phase_usec[i]);
+
+    g_free (copy);
+}
+
+
+TEST_F(XferLocalTest, CopiesUnderAnotherName)
+{
+    gchar *a = g_build_filename (tree, "a", NULL);
+    gchar *copy = g_build_filename (dest, "renamed", NULL);
+
+    EXPECT_EQ (0, run_job (start_job (a, copy, FALSE), XFER_LOCAL_ERROR_ACTION_ABORT));
+
+    gchar *content = read_file (dest, "renamed");
+    EXPECT_STREQ ("aaa", content);
+
+    g_free (content);
+    g_free (copy);
+    g_free (a);
+}
+
+
+TEST_F(XferLocalTest, MovesTrees)
+{
+    gchar *moved = g_build_filename (dest, "tree", NULL);
+
+    EXPECT_EQ (0, run_job (start_job (tree, moved, TRUE), XFER_LOCAL_ERROR_ACTION_ABORT));
+
+    expect_copied_tree (moved);
+    EXPECT_FALSE (exists (src, "tree"));
+
+    g_free (moved);
+}
+
+
+TEST_F(XferLocalTest, MovesAcrossFileSystems)
+{
+    gchar shm_dir[] = "/dev/shm/gcmd-xfer-local-XXXXXX";
+    struct stat shm_st, dest_st;
+
+    if (!mkdtemp (shm_dir))
+        return;
+
+    stat (shm_dir, &shm_st);
+    stat (dest, &dest_st);
+
+    if (shm_st.st_dev!=dest_st.st_dev)
+    {
+        gchar *moved = g_build_filename (shm_dir, "tree", NULL);
+
+        EXPECT_EQ (0, run_job (start_job (tree, moved, TRUE), XFER_LOCAL_ERROR_ACTION_ABORT));
+
+        expect_copied_tree (moved);
+        EXPECT_FALSE (exists (src, "tree"));
+
+        g_free (moved);
+    }
+
+    remove_tree (shm_dir);
+}
+
+
+TEST_F(XferLocalTest, MergesDirectories)
+{
+    gchar *copy = g_build_filename (dest, "tree", NULL);
+    gchar *copy_sub = g_build_filename (copy, "sub", NULL);
+
+    g_mkdir_with_parents (copy_sub, 0700);
+    write_file (copy_sub, "other", "ooo");
+
+    EXPECT_EQ (0, run_merging_job (start_job (tree, copy, TRUE), XFER_LOCAL_ERROR_ACTION_ABORT));
+
+    EXPECT_TRUE (exists (copy_sub, "other"));
+    EXPECT_TRUE (exists (copy_sub, "b"));
+    EXPECT_FALSE (exists (src, "tree"));
+
+    g_free (copy_sub);
+    g_free (copy);
+}
+
+
+TEST_F(XferLocalTest, AsksBeforeMergingDirectories)
+{
+    gchar *moved = g_build_filename (dest, "tree", NULL);
+
+    mkdir (moved, 0755);
+
+    EXPECT_EQ (1, run_job (start_job (tree, moved, TRUE), XFER_LOCAL_OVERWRITE_ACTION_SKIP));
+    EXPECT_FALSE (exists (moved, "a"));
+    EXPECT_TRUE (exists (tree, "a"));
+
+    EXPECT_EQ (0, run_job (start_job (tree, moved, TRUE, XFER_LOCAL_OVERWRITE_MODE_SKIP), XFER_LOCAL_ERROR_ACTION_ABORT));
+    EXPECT_FALSE (exists (moved, "a"));
+
+    XferLocalJob *job = start_job (tree, moved, TRUE, XFER_LOCAL_OVERWRITE_MODE_ABORT);
+
+    xfer_local_job_wait (job);
+    EXPECT_TRUE (xfer_local_job_aborted (job));
+    xfer_local_job_free (job);
+    EXPECT_FALSE (exists (moved, "a"));
+
+    EXPECT_EQ (1, run_job (start_job (tree, moved, TRUE), XFER_LOCAL_OVERWRITE_ACTION_REPLACE));
+    expect_copied_tree (moved);
+    EXPECT_FALSE (exists (src, "tree"));
+
+    g_free (moved);
+}
+
+
+TEST_F(XferLocalTest, AsksBeforeReplacing)
+{
+    gchar *copy = g_build_filename (dest, "tree", NULL);
+    gchar *content;
+
+    mkdir (copy, 0755);
+    write_file (copy, "a", "old");
+
+    EXPECT_EQ (1, run_merging_job (start_job (tree, copy, FALSE), XFER_LOCAL_OVERWRITE_ACTION_SKIP));
+    EXPECT_STREQ ("old", content = read_file (copy, "a"));
+    g_free (content);
+    EXPECT_TRUE (exists (copy, "link"));
+
+    // sub/b and the link are there now too
+    EXPECT_EQ (3, run_merging_job (start_job (tree, copy, FALSE), XFER_LOCAL_OVERWRITE_ACTION_REPLACE));
+    EXPECT_STREQ ("aaa", content = read_file (copy, "a"));
+    g_free (content);
+
+    write_file (copy, "a", "old");
+
+    EXPECT_EQ (0, run_job (start_job (tree, copy, FALSE, XFER_LOCAL_OVERWRITE_MODE_SKIP), XFER_LOCAL_ERROR_ACTION_ABORT));
+    EXPECT_STREQ ("old", content = read_file (copy, "a"));
+    g_free (content);
+
+    EXPECT_EQ (0, run_job (start_job (tree, copy, FALSE, XFER_LOCAL_OVERWRITE_MODE_REPLACE), XFER_LOCAL_ERROR_ACTION_ABORT));
+    EXPECT_STREQ ("aaa", content = read_file (copy, "a"));
+    g_free (content);
+
+    g_free (copy);
+}
+
+
+TEST_F(XferLocalTest, DoesNotCopyThroughLinksToDirectories)
+{
+    gchar *copy = g_build_filename (dest, "tree", NULL);
+    gchar *copy_sub = g_build_filename (copy, "sub", NULL);
+    gchar *elsewhere = g_build_filename (base, "elsewhere", NULL);
+    struct stat st;
+
+    mkdir (copy, 0755);
+    mkdir (elsewhere, 0755);
+    ASSERT_EQ (0, symlink (elsewhere, copy_sub));
+
+    EXPECT_EQ (1, run_merging_job (start_job (tree, copy, FALSE), XFER_LOCAL_OVERWRITE_ACTION_SKIP));
+    EXPECT_FALSE (exists (elsewhere, "b"));
+
+    // a and the link are there now too
+    EXPECT_EQ (3, run_merging_job (start_job (tree, copy, FALSE), XFER_LOCAL_OVERWRITE_ACTION_REPLACE));
+    EXPECT_FALSE (exists (elsewhere, "b"));
+    ASSERT_EQ (0, lstat (copy_sub, &st));
+    EXPECT_TRUE (S_ISDIR (st.st_mode));
+    EXPECT_TRUE (exists (copy_sub, "b"));
+
+    g_free (elsewhere);
+    g_free (copy_sub);
+    g_free (copy);
+}
+
+
+TEST_F(XferLocalTest, KeepsSkippedSourcesOfMoves)
+{
+    gchar *moved = g_build_filename (dest, "tree", NULL);
+    gchar *content;
+
+    mkdir (moved, 0755);
+    write_file (moved, "a", "old");
+
+    EXPECT_EQ (1, run_merging_job (start_job (tree, moved, TRUE), XFER_LOCAL_OVERWRITE_ACTION_SKIP_ALL));
+    EXPECT_STREQ ("old", content = read_file (moved, "a"));
+    g_free (content);
+
+    EXPECT_TRUE (exists (tree, "a"));
+    EXPECT_FALSE (exists (tree, "sub"));
+
+    g_free (moved);
+}
+
+
+TEST_F(XferLocalTest, ReportsDirectoriesInTheWayOfMoves)
+{
+    gchar *moved = g_build_filename (dest, "tree", NULL);
+    gchar *in_the_way = g_build_filename (moved, "a", NULL);
+    XferLocalQuestion question = XFER_LOCAL_NO_QUESTION;
+    gint error = 0;
+
+    // a directory that isn't empty can't be removed for the file a
+    g_mkdir_with_parents (in_the_way, 0755);
+    write_file (in_the_way, "keep", "kkk");
+
+    // the same answer replaces all and skips the error
+    EXPECT_EQ (2, run_job (start_job (tree, moved, TRUE), XFER_LOCAL_OVERWRITE_ACTION_REPLACE_ALL, &question, &error));
+    EXPECT_EQ (XFER_LOCAL_QUESTION_ERROR, question);
+    EXPECT_TRUE (error==ENOTEMPTY || error==EEXIST);
+
+    EXPECT_TRUE (exists (in_the_way, "keep"));
+    EXPECT_TRUE (exists (tree, "a"));
+
+    g_free (in_the_way);
+    g_free (moved);
+}
+
+
+TEST_F(XferLocalTest, AsksAboutErrors)
+{
+    gchar *missing = g_build_filename (src, "missing", NULL);
+    gchar *copy = g_build_filename (dest, "missing", NULL);
+    XferLocalQuestion question = XFER_LOCAL_NO_QUESTION;
+    gint error = 0;
+
+    EXPECT_EQ (1, run_job (start_job (missing, copy, FALSE), XFER_LOCAL_ERROR_ACTION_SKIP, &question, &error));
+    EXPECT_EQ (XFER_LOCAL_QUESTION_ERROR, question);
+    EXPECT_EQ (ENOENT, error);
+
+    XferLocalJob *job = start_job (missing, copy, FALSE);
+
+    EXPECT_EQ (1, run_job (job, XFER_LOCAL_ERROR_ACTION_ABORT));
+
+    g_free (copy);
+    g_free (missing);
+}
+
+
+TEST_F(XferLocalTest, CanBeCancelled)
+{
+    gchar *copy = g_build_filename (dest, "tree", NULL);
+    XferLocalJob *job = start_job (tree, copy, FALSE);
+
+    xfer_local_job_cancel (job);
+    xfer_local_job_wait (job);
+
+    EXPECT_TRUE (xfer_local_job_aborted (job));
+
+    xfer_local_job_free (job);
+    g_free (copy);
+}
+
+
+TEST_F(XferLocalTest, CanBePaused)
+{
+    gchar *copy = g_build_filename (dest, "tree", NULL);
+    XferLocalJob *job = start_job (tree, copy, FALSE);
+    XferLocalProgress before, after;
+
+    xfer_local_job_pause (job, TRUE);
+    g_usleep (50000);
+
+    EXPECT_FALSE (xfer_local_job_get_progress (job, &before));
+    g_usleep (50000);
+    EXPECT_FALSE (xfer_local_job_get_progress (job, &after));
+
+    EXPECT_EQ (before.files_done, after.files_done);
+    EXPECT_EQ (before.bytes_copied, after.bytes_copied);
+
+    g_free (before.file);
+    g_free (after.file);
+
+    xfer_local_job_pause (job, FALSE);
+
+    EXPECT_EQ (0, run_job (job, XFER_LOCAL_ERROR_ACTION_ABORT));
+    expect_copied_tree (copy);
+
+    // cancelling wakes up a paused job
+    job = start_job (tree, copy, FALSE, XFER_LOCAL_OVERWRITE_MODE_REPLACE);
+    xfer_local_job_pause (job, TRUE);
+    xfer_local_job_cancel (job);
+    xfer_local_job_wait (job);
+    xfer_local_job_free (job);
+
+    g_free (copy);
+}
+
+
+/**
+ * A large file, mostly a hole, with a mark at the start of its first
+ * chunks and at its end.
+ */
+static void make_large_file (const gchar *path)
+{
+    gint fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    ASSERT_EQ (0, ftruncate (fd, XFER_RESUME_MIN_SIZE + XFER_RESUME_CHUNK_SIZE));
+
+    for (gint i=0; i<4; ++i)
+        EXPECT_EQ (4, pwrite (fd, "mark", 4, (off_t) i * XFER_RESUME_CHUNK_SIZE));
+
+    EXPECT_EQ (4, pwrite (fd, "tail", 4, XFER_RESUME_MIN_SIZE + XFER_RESUME_CHUNK_SIZE - 4));
+
+    close (fd);
+}
+
+
+/**
+ * Leaves a partial copy of the first four chunks of @a src at @a dest,
+ * as if copying it was interrupted, with "XXXX" at the start of chunk
+ * @a changed.
+ */
+static void make_partial_copy (const gchar *src, const gchar *dest, gboolean checksums, gint changed)
+{
+    gint src_fd = open (src, O_RDONLY);
+    gchar *part = xfer_resume_part_path (dest);
+    gint part_fd = open (part, O_RDWR | O_CREAT, 0600);
+    gchar *buf = (gchar *) g_malloc (XFER_RESUME_CHUNK_SIZE);
+    struct stat st;
+    guint64 done;
+
+    ASSERT_EQ (0, fstat (src_fd, &st));
+
+    XferResumeJournal *journal = xfer_resume_open (dest, st, checksums, src_fd, part_fd, &done);
+
+    ASSERT_TRUE (journal != NULL);
+    EXPECT_EQ (0u, done);
+
+    for (guint64 offset=0; offset<4 * XFER_RESUME_CHUNK_SIZE; offset+=XFER_RESUME_CHUNK_SIZE)
+    {
+        EXPECT_EQ (XFER_RESUME_CHUNK_SIZE, pread (src_fd, buf, XFER_RESUME_CHUNK_SIZE, offset));
+        EXPECT_EQ (XFER_RESUME_CHUNK_SIZE, pwrite (part_fd, buf, XFER_RESUME_CHUNK_SIZE, offset));
+        EXPECT_EQ (0, xfer_resume_chunk_done (journal, part_fd, offset, buf, XFER_RESUME_CHUNK_SIZE));
+    }
+
+    xfer_resume_close (journal, part_fd, FALSE);
+
+    EXPECT_EQ (4, pwrite (part_fd, "XXXX", 4, (off_t) changed * XFER_RESUME_CHUNK_SIZE));
+
+    close (part_fd);
+    close (src_fd);
+    g_free (buf);
+    g_free (part);
+}
+
+
+static void expect_mark (const gchar *path, off_t offset, const gchar *mark)
+{
+    gint fd = open (path, O_RDONLY);
+    gchar buf[5] = "";
+
+    EXPECT_EQ (4, pread (fd, buf, 4, offset));
+    EXPECT_STREQ (mark, buf);
+
+    close (fd);
+}
+
+
+TEST_F(XferLocalTest, ResumesLargeFiles)
+{
+    gchar *big = g_build_filename (src, "big", NULL);
+    gchar *copy = g_build_filename (dest, "big", NULL);
+    struct stat st;
+
+    make_large_file (big);
+
+    // the chunks before the tail are taken as they are, so the changed one shows that it went on from there
+    make_partial_copy (big, copy, FALSE, 0);
+
+    EXPECT_EQ (0, run_job (start_job (big, copy, FALSE), XFER_LOCAL_ERROR_ACTION_ABORT));
+
+    ASSERT_EQ (0, stat (copy, &st));
+    EXPECT_EQ (XFER_RESUME_MIN_SIZE + XFER_RESUME_CHUNK_SIZE, st.st_size);
+    EXPECT_EQ (0644u, st.st_mode & 07777);
+
+    expect_mark (copy, 0 * XFER_RESUME_CHUNK_SIZE, "XXXX");
+    expect_mark (copy, 3 * XFER_RESUME_CHUNK_SIZE, "mark");
+    expect_mark (copy, st.st_size - 4, "tail");
+
+    EXPECT_FALSE (exists (dest, "big" XFER_RESUME_PART_SUFFIX));
+    EXPECT_FALSE (exists (dest, "big" XFER_RESUME_JOURNAL_SUFFIX));
+
+    g_free (copy);
+    g_free (big);
+}
+
+
+TEST_F(XferLocalTest, ChecksTheTailBeforeResuming)
+{
+    gchar *big = g_build_filename (src, "big", NULL);
+    gchar *copy = g_build_filename (dest, "big", NULL);
+
+    make_large_file (big);
+
+    // by the checksums
+    make_partial_copy (big, copy, TRUE, 3);
+
+    EXPECT_EQ (0, run_job (start_job (big, copy, FALSE, XFER_LOCAL_OVERWRITE_MODE_QUERY, TRUE), XFER_LOCAL_ERROR_ACTION_ABORT));
+
+    expect_mark (copy, 3 * XFER_RESUME_CHUNK_SIZE, "mark");
+
+    // and by the source without them
+    unlink (copy);
+    make_partial_copy (big, copy, FALSE, 2);
+
+    EXPECT_EQ (0, run_job (start_job (big, copy, FALSE), XFER_LOCAL_ERROR_ACTION_ABORT));
+
+    expect_mark (copy, 2 * XFER_RESUME_CHUNK_SIZE, "mark");
+
+    g_free (copy);
+    g_free (big);
+}
+
+
+TEST_F(XferLocalTest, StartsOverWhenTheSourceChanged)
+{
+    gchar *big = g_build_filename (src, "big", NULL);
+    gchar *copy = g_build_filename (dest, "big", NULL);
+    struct timespec times[2];
+
+    make_large_file (big);
+    make_partial_copy (big, copy, FALSE, 0);
+
+    times[0].tv_sec = times[1].tv_sec = 1500000000;
+    times[0].tv_nsec = times[1].tv_nsec = 0;
+    utimensat (AT_FDCWD, big, times, 0);
+
+    EXPECT_EQ (0, run_job (start_job (big, copy, FALSE), XFER_LOCAL_ERROR_ACTION_ABORT));
+
+    expect_mark (copy, 0 * XFER_RESUME_CHUNK_SIZE, "mark");
+
+    g_free (copy);
+    g_free (big);
+}
+
+
+static void copy_one_by_one (const gchar *src, const gchar *dest)
+{
+    mkdir (dest, 0755);
+
+    GDir *dir = g_dir_open (src, 0, NULL);
+    gchar buf[64 * 1024];
+
+    while (const gchar *name = g_dir_read_name (dir))
+    {
+        gchar *src_path = g_build_filename (src, name, NULL);
+        gchar *dest_path = g_build_filename (dest, name, NULL);
+        gint src_fd = open (src_path, O_RDONLY);
+        gint dest_fd = open (dest_path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+
+        for (ssize_t n; (n = read (src_fd, buf, sizeof(buf)))>0; )
+            EXPECT_EQ (n, write (dest_fd, buf, n));
+
+        close (dest_fd);
+        close (src_fd);
+        g_free (dest_path);
+        g_free (src_path);
+    }
+
+    g_dir_close (dir);
+}
+
+
+TEST(XferLocalBenchmark, TwentyThousandSmallFiles)
+{
+    if (!g_getenv ("GCMD_BENCHMARK"))
+        return;
+
+    gchar *base = g_dir_make_tmp ("gcmd-xfer-local-XXXXXX", NULL);
+    gchar *src = g_build_filename (base, "src", NULL);
+    gchar *native = g_build_filename (base, "native", NULL);
+    gchar *plain = g_build_filename (base, "plain", NULL);
+    gchar *content = g_strnfill (4096, 'x');
+
+    mkdir (src, 0755);
+
+    for (gint i=0; i<20000; ++i)
+    {
+        gchar *name = g_strdup_printf ("file-%05d", i);
+        write_file (src, name, content);
+        g_free (name);
+    }
+
+    gint64 start = g_get_monotonic_time ();
+    copy_one_by_one (src, plain);
+    gint64 plain_time = g_get_monotonic_time () - start;
+
+    start = g_get_monotonic_time ();
+    EXPECT_EQ (0, run_job (start_job (src, native, FALSE), XFER_LOCAL_ERROR_ACTION_ABORT));
+    gint64 native_time = g_get_monotonic_time () - start;
+
+    printf ("20000 files: one by one %.1f ms, native %.1f ms\n", plain_time / 1000.0, native_time / 1000.0);
+
+    remove_tree (base);
+    g_free (content);
+    g_free (plain);
+    g_free (native);
+    g_free (src);
+    g_free (base);
+}
@@ -0,0 +1,269 @@
+/**
+ * @file xfer_queue_test.cc
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @details Tests for scheduling transfers per device: jobs sharing a
+ * device take turns, jobs on other devices run at once, and waiting
+ * jobs can be held back, reordered and cancelled.
+ *
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <gtest/gtest.h>
+
+#include "../src/xfer-queue.h"
+
+using namespace std;
+
+
+/**
+ * A transfer as the queue sees it: it records when it was started,
+ * cancelled and paused.
+ */
+struct TestJob
+{
+    gint started;                       // the order it was started in, 0 if not
+    gboolean cancelled;
+    gboolean paused;
+    gboolean can_pause;
+};
+
+
+static gint n_started;
+
+
+static void start_job (TestJob *job)
+{
+    job->started = ++n_started;
+}
+
+
+static gboolean pause_job (TestJob *job, gboolean pause)
+{
+    if (!job->can_pause)
+        return FALSE;
+
+    job->paused = pause;
+
+    return TRUE;
+}
+
+
+static void cancel_job (TestJob *job, XferQueueState state)
+{
+    job->cancelled = TRUE;
+}
+
+
+class XferQueueTest : public ::testing::Test
+{
+  protected:
+
+    XferQueue *queue;
+
+    virtual void SetUp()
+    {
+        n_started = 0;
+        queue = xfer_queue_new (1);
+    }
+
+    virtual void TearDown()
+    {
+        xfer_queue_free (queue);
+    }
+
+    guint add (TestJob &job, const gchar *dev1, const gchar *dev2=NULL)
+    {
+        const gchar *devices[] = {dev1, dev2, NULL};
+
+        return xfer_queue_add (queue, "test", (gchar **) devices,
+                               (XferQueueStartFunc) start_job, (XferQueuePauseFunc) pause_job,
+                               (XferQueueCancelFunc) cancel_job, &job);
+    }
+};
+
+
+TEST_F(XferQueueTest, RunsJobsOnOtherDevicesAtOnce)
+{
+    TestJob a = {0}, b = {0};
+
+    add (a, "disk:sda", "disk:sda");        // within one disk
+    add (b, "disk:sdb", "disk:sdc");
+
+    EXPECT_EQ (1, a.started);
+    EXPECT_EQ (2, b.started);
+}
+
+
+TEST_F(XferQueueTest, SerializesJobsOnTheSameDevice)
+{
+    TestJob a = {0}, b = {0}, c = {0};
+
+    guint id_a = add (a, "disk:sda");
+    guint id_b = add (b, "disk:sdb", "disk:sda");
+    add (c, "disk:sda");
+
+    EXPECT_EQ (1, a.started);
+    EXPECT_EQ (0, b.started);
+    EXPECT_EQ (0, c.started);
+
+    xfer_queue_done (queue, id_a);
+
+    EXPECT_EQ (2, b.started);
+    EXPECT_EQ (0, c.started);
+
+    xfer_queue_done (queue, id_b);
+
+    EXPECT_EQ (3, c.started);
+    EXPECT_EQ (1u, g_list_length (xfer_queue_get_jobs (queue)));
+}
+
+
+TEST_F(XferQueueTest, KeepsDevicesForWaitingJobs)
+{
+    TestJob a = {0}, b = {0}, c = {0}, d = {0};
+
+    guint id_a = add (a, "disk:sda");
+    add (b, "disk:sda", "disk:sdb");        // waits for a
+    add (c, "disk:sdb");                    // would keep b waiting after a
+    add (d, "disk:sdc");
+
+    EXPECT_EQ (0, b.started);
+    EXPECT_EQ (0, c.started);
+    EXPECT_EQ (2, d.started);
+
+    xfer_queue_done (queue, id_a);
+
+    EXPECT_EQ (3, b.started);
+    EXPECT_EQ (0, c.started);
+}
+
+
+TEST_F(XferQueueTest, FollowsTheLimit)
+{
+    TestJob a = {0}, b = {0}, c = {0};
+
+    xfer_queue_set_max_per_device (queue, 2);
+
+    add (a, "disk:sda");
+    add (b, "disk:sda");
+    add (c, "disk:sda");
+
+    EXPECT_EQ (2, b.started);
+    EXPECT_EQ (0, c.started);
+
+    xfer_queue_set_max_per_device (queue, 3);
+
+    EXPECT_EQ (3, c.started);
+}
+
+
+TEST_F(XferQueueTest, HoldsBackPausedJobs)
+{
+    TestJob a = {0}, b = {0}, c = {0};
+
+    guint id_a = add (a, "disk:sda");
+    guint id_b = add (b, "disk:sda");
+    add (c, "disk:sda");
+
+    // a paused waiting job lets the others go first
+    EXPECT_TRUE (xfer_queue_pause (queue, id_b, TRUE));
+    xfer_queue_done (queue, id_a);
+
+    EXPECT_EQ (0, b.started);
+    EXPECT_EQ (2, c.started);
+
+    // running jobs pause only if they can, and keep their devices
+    EXPECT_FALSE (xfer_queue_pause (queue, 3, TRUE));
+    c.can_pause = TRUE;
+    EXPECT_TRUE (xfer_queue_pause (queue, 3, TRUE));
+    EXPECT_TRUE (c.paused);
+
+    EXPECT_TRUE (xfer_queue_pause (queue, id_b, FALSE));
+    EXPECT_EQ (0, b.started);
+
+    xfer_queue_done (queue, 3);
+
+    EXPECT_EQ (3, b.started);
+}
+
+
+TEST_F(XferQueueTest, ReordersWaitingJobs)
+{
+    TestJob a = {0}, b = {0}, c = {0};
+
+    guint id_a = add (a, "disk:sda");
+    add (b, "disk:sda");
+    guint id_c = add (c, "disk:sda");
+
+    xfer_queue_move (queue, id_c, -1);
+    xfer_queue_done (queue, id_a);
+
+    EXPECT_EQ (0, b.started);
+    EXPECT_EQ (2, c.started);
+
+    // moving far beyond the ends puts it at the end
+    xfer_queue_move (queue, id_c, 100);
+
+    EXPECT_EQ (id_c, ((XferQueueJob *) g_list_last (xfer_queue_get_jobs (queue))->data)->id);
+}
+
+
+TEST_F(XferQueueTest, CancelsJobs)
+{
+    TestJob a = {0}, b = {0}, c = {0};
+
+    guint id_a = add (a, "disk:sda");
+    guint id_b = add (b, "disk:sda");
+    add (c, "disk:sda");
+
+    // a waiting job is gone at once
+    xfer_queue_cancel (queue, id_b);
+
+    EXPECT_TRUE (b.cancelled);
+    EXPECT_EQ (2u, g_list_length (xfer_queue_get_jobs (queue)));
+
+    // a running one until it has stopped
+    xfer_queue_cancel (queue, id_a);
+
+    EXPECT_TRUE (a.cancelled);
+    EXPECT_EQ (0, c.started);
+
+    xfer_queue_done (queue, id_a);
+
+    EXPECT_EQ (2, c.started);
+}
+
+
+TEST(XferQueueDeviceTest, FindsTheDeviceOfMissingPaths)
+{
+    gchar *dir = g_dir_make_tmp ("gcmd-xfer-queue-XXXXXX", NULL);
+    gchar *missing = g_build_filename (dir, "not", "there", NULL);
+
+    gchar *key = xfer_queue_device_of_path (dir);
+    gchar *missing_key = xfer_queue_device_of_path (missing);
+
+    ASSERT_TRUE (key != NULL);
+    EXPECT_STREQ (key, missing_key);
+
+    g_free (missing_key);
+    g_free (key);
+    g_free (missing);
+    g_rmdir (dir);
+    g_free (dir);
+}
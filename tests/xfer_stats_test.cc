@@ -0,0 +1,149 @@
+/**
+ * @file xfer_stats_test.cc
+ * @brief Part of GNOME Commander - A GNOME based file manager
+ *
+ * @details Tests for the transfer rate window, the estimated time left
+ * and the transfer log lines.
+ *
+ * @copyright (C) 2013-2018 Uwe Scholz\n
+ *
+ * @copyright This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * @copyright You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <gtest/gtest.h>
+
+#include "../src/xfer-stats.h"
+
+using namespace std;
+
+
+#define MB (1000 * 1000)
+
+
+TEST(XferRateTest, NeedsSomeTime)
+{
+    XferRate rate;
+    gdouble bytes_per_sec;
+
+    xfer_rate_init (&rate);
+
+    EXPECT_FALSE (xfer_rate_get (&rate, &bytes_per_sec, NULL));
+
+    xfer_rate_add (&rate, 0, 0, 0);
+    xfer_rate_add (&rate, G_USEC_PER_SEC / 10, MB, 1);
+
+    EXPECT_FALSE (xfer_rate_get (&rate, &bytes_per_sec, NULL));
+    EXPECT_EQ (-1, xfer_rate_eta (&rate, MB, 1));
+    EXPECT_EQ (0, xfer_rate_eta (&rate, 0, 0));
+
+    xfer_rate_add (&rate, G_USEC_PER_SEC, 10 * MB, 10);
+
+    EXPECT_TRUE (xfer_rate_get (&rate, &bytes_per_sec, NULL));
+    EXPECT_DOUBLE_EQ (10.0 * MB, bytes_per_sec);
+}
+
+
+TEST(XferRateTest, FollowsTheRecentRate)
+{
+    XferRate rate;
+    guint64 bytes = 0;
+    guint64 files = 0;
+
+    xfer_rate_init (&rate);
+
+    // 1 MB/s and 100 files/s for 10 s, then 4 MB/s and 10 files/s for 10 s
+    for (gint i=0; i<=200; ++i)
+    {
+        xfer_rate_add (&rate, i * G_USEC_PER_SEC / 10, bytes, files);
+
+        bytes += i<100 ? MB / 10 : 4 * MB / 10;
+        files += i<100 ? 10 : 1;
+    }
+
+    gdouble bytes_per_sec, files_per_sec;
+
+    ASSERT_TRUE (xfer_rate_get (&rate, &bytes_per_sec, &files_per_sec));
+    EXPECT_NEAR (4.0 * MB, bytes_per_sec, 1.0);
+    EXPECT_NEAR (10.0, files_per_sec, 0.01);
+
+    EXPECT_EQ (5, xfer_rate_eta (&rate, 20 * MB, 0));
+    EXPECT_EQ (10, xfer_rate_eta (&rate, 20 * MB, 100));       // the files take longer
+}
+
+
+TEST(XferRateTest, IgnoresSamplesWithoutTimePassing)
+{
+    XferRate rate;
+    gdouble bytes_per_sec;
+
+    xfer_rate_init (&rate);
+
+    xfer_rate_add (&rate, 0, 0, 0);
+    xfer_rate_add (&rate, G_USEC_PER_SEC, MB, 1);
+    xfer_rate_add (&rate, G_USEC_PER_SEC, 2 * MB, 2);
+
+    ASSERT_TRUE (xfer_rate_get (&rate, &bytes_per_sec, NULL));
+    EXPECT_DOUBLE_EQ (2.0 * MB, bytes_per_sec);
+}
+
+
+TEST(XferStatsTest, SortsFilesBySize)
+{
+    XferStats stats;
+
+    xfer_stats_init (&stats);
+
+    xfer_stats_add_file (&stats, 0, 10);
+    xfer_stats_add_file (&stats, XFER_SMALL_FILE_MAX, 10);
+    xfer_stats_add_file (&stats, XFER_SMALL_FILE_MAX + 1, 20);
+    xfer_stats_add_file (&stats, 1024 * 1024 * 1024, 30);
+
+    EXPECT_EQ (2u, stats.files[XFER_SIZE_SMALL]);
+    EXPECT_EQ ((guint64) XFER_SMALL_FILE_MAX, stats.bytes[XFER_SIZE_SMALL]);
+    EXPECT_EQ (20, stats.usec[XFER_SIZE_SMALL]);
+    EXPECT_EQ (1u, stats.files[XFER_SIZE_MEDIUM]);
+    EXPECT_EQ (1u, stats.files[XFER_SIZE_LARGE]);
+}
+
+
+TEST(XferStatsTest, WritesLogLines)
+{
+    XferStats stats;
+
+    xfer_stats_init (&stats);
+
+    EXPECT_EQ (XFER_PHASE_COPY, xfer_stats_main_phase (&stats));
+
+    stats.phase_usec[XFER_PHASE_SCAN] = 250000;
+    stats.phase_usec[XFER_PHASE_CREATE] = 1500000;
+    stats.phase_usec[XFER_PHASE_COPY] = 1000000;
+    xfer_stats_add_file (&stats, 100, 2000);
+
+    EXPECT_EQ (XFER_PHASE_CREATE, xfer_stats_main_phase (&stats));
+
+    gchar *line = xfer_stats_to_log (&stats, "copy", "native", 1, 100, 2 * G_USEC_PER_SEC, FALSE);
+
+    EXPECT_TRUE (g_str_has_prefix (line, "{\"time\":\""));
+    EXPECT_TRUE (strstr (line, "\"operation\":\"copy\",\"engine\":\"native\",\"result\":\"done\"") != NULL);
+    EXPECT_TRUE (strstr (line, "\"files\":1,\"bytes\":100,\"seconds\":2.000,\"bytes_per_sec\":50,\"files_per_sec\":0.5") != NULL);
+    EXPECT_TRUE (strstr (line, "\"main_phase\":\"create\"") != NULL);
+    EXPECT_TRUE (strstr (line, "\"phases\":{\"scan\":0.250,\"create\":1.500,\"copy\":1.000,\"finish\":0.000}") != NULL);
+    EXPECT_TRUE (strstr (line, "\"small\":{\"files\":1,\"bytes\":100,\"seconds\":0.002}") != NULL);
+    EXPECT_TRUE (g_str_has_suffix (line, "}}"));
+    EXPECT_TRUE (strchr (line, '\n') == NULL);
+
+    g_free (line);
+}